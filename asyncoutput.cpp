@@ -0,0 +1,268 @@
+// Copyright (c) 2012 Havok. All rights reserved. This file is distributed under the terms
+// and conditions defined in file 'LICENSE.txt', which is part of this source code package.
+
+#include "asyncoutput.h"
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#ifdef _WIN32
+	#include <io.h>
+	#include <malloc.h>
+	static int s_open(const char* fileName, int flags) { return _open(fileName, flags | O_BINARY, _S_IREAD | _S_IWRITE); }
+	static int s_write(int fd, const char* data, size_t size) { return _write(fd, data, (unsigned int)size); }
+	static void s_close(int fd) { _close(fd); }
+	static char* s_allocAligned(size_t size, size_t alignment) { return static_cast<char*>(_aligned_malloc(size, alignment)); }
+	static void s_freeAligned(char* data) { _aligned_free(data); }
+#else
+	#include <unistd.h>
+	static int s_open(const char* fileName, int flags) { return ::open(fileName, flags, 0664); }
+	static int s_write(int fd, const char* data, size_t size) { return (int)::write(fd, data, size); }
+	static void s_close(int fd) { ::close(fd); }
+	static char* s_allocAligned(size_t size, size_t alignment)
+	{
+		void* data = NULL;
+		return posix_memalign(&data, alignment, size) == 0 ? static_cast<char*>(data) : NULL;
+	}
+	static void s_freeAligned(char* data) { free(data); }
+#endif
+
+Havok::AsyncOutputStream::AsyncOutputStream(const char* fileName, std::string& errorInfo, bool directIO, size_t bufferSize, int numBuffers)
+	: m_fd(-1), m_directIO(false), m_synchronous(false), m_queuedBytes(0), m_writtenBytes(0), m_allocatedBytes(0), m_closing(false), m_error(false)
+{
+	// direct I/O needs buffers made of whole blocks
+	m_bufferSize = (bufferSize + DIRECT_ALIGNMENT - 1) & ~size_t(DIRECT_ALIGNMENT - 1);
+	m_current.m_data = NULL;
+	m_current.m_size = 0;
+
+	const int flags = O_WRONLY | O_CREAT | O_TRUNC;
+	#ifdef O_DIRECT
+		if(directIO)
+		{
+			m_fd = s_open(fileName, flags | O_DIRECT);
+			m_directIO = (m_fd >= 0);
+		}
+	#endif
+	if(m_fd < 0)
+	{
+		// no direct I/O on this system or file system
+		m_fd = s_open(fileName, flags);
+	}
+	if(m_fd < 0)
+	{
+		errorInfo = "Error opening output file '" + std::string(fileName) + "': " + strerror(errno);
+		m_error = true;
+		return;
+	}
+
+	for( int i = 0; i < (numBuffers < 2 ? 2 : numBuffers); ++i )
+	{
+		Buffer buffer;
+		buffer.m_data = s_allocAligned(m_bufferSize, DIRECT_ALIGNMENT);
+		buffer.m_size = 0;
+		m_allBuffers.push_back(buffer);
+		m_freeBuffers.push_back(buffer);
+	}
+	m_current = m_freeBuffers.back();
+	m_freeBuffers.pop_back();
+	SetBuffer(m_current.m_data, m_bufferSize);
+
+	if(!m_writer.start(&s_writerThread, this))
+	{
+		// no thread available, formatting and writing do not overlap
+		m_synchronous = true;
+	}
+}
+
+Havok::AsyncOutputStream::~AsyncOutputStream()
+{
+	close();
+	// raw_ostream must not refer to the buffers anymore
+	SetUnbuffered();
+	for( std::vector<Buffer>::iterator it = m_allBuffers.begin(), end = m_allBuffers.end(); it != end; ++it )
+	{
+		s_freeAligned(it->m_data);
+	}
+}
+
+void Havok::AsyncOutputStream::close()
+{
+	if(m_fd < 0)
+	{
+		return;
+	}
+	flush();
+	{
+		ScopedLock lock(m_mutex);
+		m_closing = true;
+		m_bufferQueued.signal();
+	}
+	m_writer.join();
+	#ifdef __linux__
+		if(m_allocatedBytes != 0)
+		{
+			// drop the preallocated space which was not used
+			if(ftruncate(m_fd, m_writtenBytes) != 0)
+			{
+				m_error = true;
+			}
+		}
+	#endif
+	s_close(m_fd);
+	m_fd = -1;
+}
+
+bool Havok::AsyncOutputStream::hasError() const
+{
+	ScopedLock lock(const_cast<Mutex&>(m_mutex));
+	return m_error;
+}
+
+uint64_t Havok::AsyncOutputStream::current_pos() const
+{
+	return m_queuedBytes;
+}
+
+void Havok::AsyncOutputStream::write_impl(const char* ptr, size_t size)
+{
+	if(m_fd < 0 || size == 0)
+	{
+		// closed or failed to open, the data is dropped
+		return;
+	}
+	if(ptr == m_current.m_data)
+	{
+		// the usual case, raw_ostream filled (or flushed) our buffer
+		queueCurrentBuffer_i(size);
+		return;
+	}
+
+	// large writes bypass the raw_ostream buffer, copy them into free buffers
+	while(size != 0)
+	{
+		Buffer buffer = acquireBuffer_i();
+		buffer.m_size = size < m_bufferSize ? size : m_bufferSize;
+		memcpy(buffer.m_data, ptr, buffer.m_size);
+		ptr += buffer.m_size;
+		size -= buffer.m_size;
+		m_queuedBytes += buffer.m_size;
+		queueBuffer_i(buffer);
+	}
+}
+
+void Havok::AsyncOutputStream::queueCurrentBuffer_i(size_t size)
+{
+	m_current.m_size = size;
+	m_queuedBytes += size;
+	queueBuffer_i(m_current);
+	m_current = acquireBuffer_i();
+	SetBuffer(m_current.m_data, m_bufferSize);
+}
+
+void Havok::AsyncOutputStream::queueBuffer_i(const Buffer& buffer)
+{
+	if(m_synchronous)
+	{
+		writeBuffer_i(buffer);
+		ScopedLock lock(m_mutex);
+		m_freeBuffers.push_back(buffer);
+		return;
+	}
+	ScopedLock lock(m_mutex);
+	m_queuedBuffers.push_back(buffer);
+	m_bufferQueued.signal();
+}
+
+Havok::AsyncOutputStream::Buffer Havok::AsyncOutputStream::acquireBuffer_i()
+{
+	ScopedLock lock(m_mutex);
+	while(m_freeBuffers.empty())
+	{
+		m_bufferFreed.wait(m_mutex);
+	}
+	Buffer buffer = m_freeBuffers.back();
+	m_freeBuffers.pop_back();
+	return buffer;
+}
+
+void Havok::AsyncOutputStream::writeBuffer_i(const Buffer& buffer)
+{
+	#ifdef __linux__
+		if(m_directIO)
+		{
+			if(buffer.m_size % DIRECT_ALIGNMENT != 0)
+			{
+				// only whole blocks can be written directly, this is normally the last buffer
+				fcntl(m_fd, F_SETFL, fcntl(m_fd, F_GETFL) & ~O_DIRECT);
+				m_directIO = false;
+			}
+			else
+			{
+				// preallocate ahead to keep the file contiguous
+				while(m_allocatedBytes != ~uint64_t(0) && m_writtenBytes + buffer.m_size > m_allocatedBytes)
+				{
+					if(fallocate(m_fd, 0, m_allocatedBytes, PREALLOCATION_SIZE) == 0)
+					{
+						m_allocatedBytes += PREALLOCATION_SIZE;
+					}
+					else
+					{
+						// not supported by the file system
+						m_allocatedBytes = m_allocatedBytes != 0 ? m_allocatedBytes : ~uint64_t(0);
+						break;
+					}
+				}
+			}
+		}
+	#endif
+
+	const char* data = buffer.m_data;
+	size_t remaining = buffer.m_size;
+	while(remaining != 0)
+	{
+		int written = s_write(m_fd, data, remaining);
+		if(written < 0)
+		{
+			if(errno == EINTR)
+			{
+				continue;
+			}
+			ScopedLock lock(m_mutex);
+			m_error = true;
+			break;
+		}
+		data += written;
+		remaining -= written;
+	}
+	m_writtenBytes += buffer.m_size - remaining;
+}
+
+void Havok::AsyncOutputStream::s_writerThread(void* userData)
+{
+	AsyncOutputStream& stream = *static_cast<AsyncOutputStream*>(userData);
+	while(true)
+	{
+		Buffer buffer;
+		{
+			ScopedLock lock(stream.m_mutex);
+			while(stream.m_queuedBuffers.empty() && !stream.m_closing)
+			{
+				stream.m_bufferQueued.wait(stream.m_mutex);
+			}
+			if(stream.m_queuedBuffers.empty())
+			{
+				return;
+			}
+			buffer = stream.m_queuedBuffers.front();
+			stream.m_queuedBuffers.erase(stream.m_queuedBuffers.begin());
+		}
+
+		stream.writeBuffer_i(buffer);
+
+		ScopedLock lock(stream.m_mutex);
+		stream.m_freeBuffers.push_back(buffer);
+		stream.m_bufferFreed.signal();
+	}
+}
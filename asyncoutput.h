@@ -0,0 +1,98 @@
+// Copyright (c) 2012 Havok. All rights reserved. This file is distributed under the terms
+// and conditions defined in file 'LICENSE.txt', which is part of this source code package.
+
+#ifndef ASYNC_OUTPUT_H
+#define ASYNC_OUTPUT_H
+
+#pragma warning(push,0)
+	#include "llvm/Support/DataTypes.h"
+	#include "llvm/Support/raw_ostream.h"
+#pragma warning(pop)
+
+#include <string>
+#include <vector>
+#include "threads.h"
+
+namespace Havok
+{
+	/// File output stream which formats into large buffers and hands the full ones to a writer
+	/// thread, formatting never waits for the disk unless all the buffers are queued.
+	/// On Linux the file can be written with O_DIRECT, it is then also preallocated.
+	class AsyncOutputStream : public llvm::raw_ostream
+	{
+		public:
+
+			enum
+			{
+				DEFAULT_BUFFER_SIZE = 8 * 1024 * 1024,
+				DEFAULT_NUM_BUFFERS = 2,
+				// Alignment of the buffers, the file offsets and the sizes with direct I/O
+				DIRECT_ALIGNMENT = 4096,
+				// Preallocation increment with direct I/O
+				PREALLOCATION_SIZE = 64 * 1024 * 1024
+			};
+
+			// errorInfo is set if the file cannot be opened
+			AsyncOutputStream(const char* fileName, std::string& errorInfo, bool directIO = false,
+				size_t bufferSize = DEFAULT_BUFFER_SIZE, int numBuffers = DEFAULT_NUM_BUFFERS);
+			~AsyncOutputStream();
+
+			// Flush and wait until everything is written
+			void close();
+
+			// A write failed
+			bool hasError() const;
+
+		protected:
+
+			struct Buffer
+			{
+				char* m_data;
+				size_t m_size;
+			};
+
+			virtual void write_impl(const char* ptr, size_t size);
+			virtual uint64_t current_pos() const;
+
+			// Queue the buffer currently used by raw_ostream and switch to a free one
+			void queueCurrentBuffer_i(size_t size);
+			// Wait for a free buffer
+			Buffer acquireBuffer_i();
+			// Hand a full buffer to the writer thread, or write it directly without one
+			void queueBuffer_i(const Buffer& buffer);
+			// Write a buffer to the file (writer thread, or the formatting thread when synchronous)
+			void writeBuffer_i(const Buffer& buffer);
+
+			static void s_writerThread(void* userData);
+
+			int m_fd;
+			bool m_directIO;
+			// The writer thread could not be started, the buffers are written by the formatting thread
+			bool m_synchronous;
+			size_t m_bufferSize;
+			// Buffer given to raw_ostream
+			Buffer m_current;
+			// Bytes handed to the writer thread
+			uint64_t m_queuedBytes;
+			// Bytes written and preallocated, only used by the writer thread
+			uint64_t m_writtenBytes;
+			uint64_t m_allocatedBytes;
+
+			// Shared with the writer thread
+			std::vector<Buffer> m_allBuffers;
+			std::vector<Buffer> m_freeBuffers;
+			std::vector<Buffer> m_queuedBuffers;
+			bool m_closing;
+			bool m_error;
+			Mutex m_mutex;
+			Condition m_bufferFreed;
+			Condition m_bufferQueued;
+			Thread m_writer;
+
+		private:
+			AsyncOutputStream(const AsyncOutputStream&);
+			AsyncOutputStream& operator=(const AsyncOutputStream&);
+	};
+}
+
+#endif //ASYNC_OUTPUT_H
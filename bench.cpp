@@ -0,0 +1,369 @@
+// Copyright (c) 2012 Havok. All rights reserved. This file is distributed under the terms
+// and conditions defined in file 'LICENSE.txt', which is part of this source code package.
+
+// Microbenchmarks of the hot paths of ExtractASTConsumer, run on a synthetic AST context
+// without parsing anything. Each benchmark prints its time and heap allocations per operation.
+
+#pragma warning(push,0)
+	#include <llvm/ADT/APSInt.h>
+	#include <llvm/Support/CommandLine.h>
+	#include <llvm/Support/Format.h>
+	#include <llvm/Support/Host.h>
+	#include <llvm/Support/ManagedStatic.h>
+	#include <llvm/Support/TimeValue.h>
+	#include <llvm/Support/raw_ostream.h>
+
+	#include <clang/AST/ASTContext.h>
+	#include <clang/Basic/Builtins.h>
+	#include <clang/Basic/Diagnostic.h>
+	#include <clang/Basic/FileManager.h>
+	#include <clang/Basic/FileSystemOptions.h>
+	#include <clang/Basic/IdentifierTable.h>
+	#include <clang/Basic/SourceManager.h>
+	#include <clang/Basic/TargetInfo.h>
+	#include <clang/Basic/TargetOptions.h>
+#pragma warning(pop)
+
+#include <cstdlib>
+#include <new>
+#include <vector>
+#include "escape.h"
+#include "loader.h"
+#include "extract.h"
+
+// Heap allocations, counted by the global operator new
+static unsigned long s_numAllocations;
+
+void* operator new(size_t size)
+{
+	++s_numAllocations;
+	return malloc(size != 0 ? size : 1);
+}
+
+void* operator new[](size_t size)
+{
+	++s_numAllocations;
+	return malloc(size != 0 ? size : 1);
+}
+
+void operator delete(void* ptr) throw()
+{
+	free(ptr);
+}
+
+void operator delete[](void* ptr) throw()
+{
+	free(ptr);
+}
+
+static llvm::cl::opt<double> o_minTime("min-time", llvm::cl::desc("Minimum time of each benchmark in seconds"), llvm::cl::init(0.25), llvm::cl::value_desc("seconds")); // Benchmark duration
+static llvm::cl::opt<std::string> o_filter("filter", llvm::cl::desc("Only run the benchmarks whose name contains this string"), llvm::cl::value_desc("string")); // Benchmark selection
+
+static double s_getTime()
+{
+	llvm::sys::TimeValue now = llvm::sys::TimeValue::now();
+	return double(now.seconds()) + double(now.nanoseconds()) * 1e-9;
+}
+
+namespace Havok
+{
+	/// Benchmarks of the consumer internals, friend of ExtractASTConsumer
+	struct ExtractBenchmarks
+	{
+		typedef void (*Function)(ExtractBenchmarks& bench, unsigned numOps);
+
+		ExtractBenchmarks(ASTContext& context) : m_context(context), m_consumer(0), m_sink(0) {}
+
+		// Run a benchmark with more and more operations until it takes at least o_minTime
+		void run(const char* name, Function function)
+		{
+			if(!o_filter.empty() && llvm::StringRef(name).find(o_filter) == llvm::StringRef::npos)
+			{
+				return;
+			}
+			// warm up, the first run fills the caches and the known type maps
+			function(*this, 1);
+
+			unsigned numOps = 1;
+			while(true)
+			{
+				const unsigned long startAllocations = s_numAllocations;
+				const double startTime = s_getTime();
+				function(*this, numOps);
+				const double seconds = s_getTime() - startTime;
+				const unsigned long numAllocations = s_numAllocations - startAllocations;
+				if(seconds >= o_minTime || numOps >= (1u << 30))
+				{
+					llvm::outs() << "Benchmark( name='" << name << "', ops=" << numOps;
+					llvm::outs() << ", nsPerOp=" << llvm::format("%.2f", seconds * 1e9 / numOps);
+					llvm::outs() << ", allocsPerOp=" << llvm::format("%.3f", double(numAllocations) / numOps) << " )\n";
+					return;
+				}
+				numOps *= 2;
+			}
+		}
+
+		// DumpEntry with only default values, every pair is elided
+		static void s_dumpEntryDefaults(ExtractBenchmarks& bench, unsigned numOps)
+		{
+			for( unsigned i = 0; i < numOps; ++i )
+			{
+				DumpEntry entry(bench.m_os, DumpEntry::ENTRY_CONSTRUCTOR);
+				entry.dumpKeyValuePair("id", int(i));
+				entry.dumpKeyValuePair("static", false);
+				entry.dumpKeyValuePair("const", false);
+				entry.dumpKeyValuePair("isCopyAssignment", false);
+				entry.dumpKeyValuePair("isImplicit", false);
+				entry.dumpKeyValuePair("isCopyConstructor", false);
+				entry.dumpKeyValuePair("isDefaultConstructor", false);
+				entry.dumpKeyValuePair("access", EntityTables::ACCESS_PUBLIC);
+				entry.dumpKeyValuePair("numParamDefaults", 0);
+				entry.finishEntry();
+			}
+		}
+
+		// DumpEntry where every value differs from the defaults
+		static void s_dumpEntryValues(ExtractBenchmarks& bench, unsigned numOps)
+		{
+			for( unsigned i = 0; i < numOps; ++i )
+			{
+				DumpEntry entry(bench.m_os, DumpEntry::ENTRY_METHOD);
+				entry.dumpKeyValuePair("id", int(i));
+				entry.dumpKeyValuePair("recordid", 12345);
+				entry.dumpKeyValuePair("static", true);
+				entry.dumpKeyValuePair("const", true);
+				entry.dumpKeyValuePair("isImplicit", true);
+				entry.dumpKeyValuePair("access", EntityTables::ACCESS_PROTECTED);
+				entry.dumpKeyValuePair("numParamDefaults", 2);
+				entry.finishEntry();
+			}
+		}
+
+		// Integer key/value pair of a DumpEntry
+		static void s_dumpEntryInteger(ExtractBenchmarks& bench, unsigned numOps)
+		{
+			DumpEntry entry(bench.m_os, DumpEntry::ENTRY_FIELD);
+			for( unsigned i = 0; i < numOps; ++i )
+			{
+				entry.dumpKeyValuePair("typeid", int(i * 2654435761u >> 8));
+			}
+			entry.finishEntry();
+		}
+
+		// Integers written directly to the stream, like the ids of most lines
+		static void s_streamInteger(ExtractBenchmarks& bench, unsigned numOps)
+		{
+			for( unsigned i = 0; i < numOps; ++i )
+			{
+				bench.m_os << ", typeid=" << int(i * 2654435761u >> 8);
+			}
+		}
+
+		// Known type lookups which find the type
+		static void s_knownTypeLookupHit(ExtractBenchmarks& bench, unsigned numOps)
+		{
+			ExtractASTConsumer::KnownTypeMap& knownTypes = bench.m_knownTypes;
+			const std::vector<const Type*>& keys = bench.m_typeKeys;
+			int sum = 0;
+			for( unsigned i = 0; i < numOps; ++i )
+			{
+				sum += knownTypes.find(keys[(i * 7919u) % keys.size()])->second;
+			}
+			bench.m_sink += sum;
+		}
+
+		// Known type lookups which do not find the type
+		static void s_knownTypeLookupMiss(ExtractBenchmarks& bench, unsigned numOps)
+		{
+			ExtractASTConsumer::KnownTypeMap& knownTypes = bench.m_knownTypes;
+			const std::vector<const Type*>& keys = bench.m_missingTypeKeys;
+			int sum = 0;
+			for( unsigned i = 0; i < numOps; ++i )
+			{
+				sum += (knownTypes.find(keys[(i * 7919u) % keys.size()]) == knownTypes.end()) ? 1 : 0;
+			}
+			bench.m_sink += sum;
+		}
+
+		// Known types inserted one at a time into a growing map, as the dump does
+		static void s_knownTypeInsert(ExtractBenchmarks& bench, unsigned numOps)
+		{
+			const std::vector<const Type*>& keys = bench.m_typeKeys;
+			unsigned i = 0;
+			while(i < numOps)
+			{
+				ExtractASTConsumer::KnownTypeMap knownTypes;
+				for( unsigned k = 0; k < keys.size() && i < numOps; ++k, ++i )
+				{
+					knownTypes[keys[k]] = int(k);
+				}
+				bench.m_sink += knownTypes.size();
+			}
+		}
+
+		// Template argument list whose types are all known already, rendered as text
+		static void s_templateArgumentsKnown(ExtractBenchmarks& bench, unsigned numOps)
+		{
+			for( unsigned i = 0; i < numOps; ++i )
+			{
+				bench.m_consumer->dumpTemplateArgumentList_i(&bench.m_templateArgs[0], int(bench.m_templateArgs.size()), 42);
+				bench.m_consumer->writeRows_i();
+			}
+		}
+
+		// Template argument list dumped by a new consumer, every type is dumped first
+		static void s_templateArgumentsNew(ExtractBenchmarks& bench, unsigned numOps)
+		{
+			for( unsigned i = 0; i < numOps; ++i )
+			{
+				ExtractASTConsumer consumer(bench.m_os);
+				consumer.Initialize(bench.m_context);
+				consumer.dumpTemplateArgumentList_i(&bench.m_templateArgs[0], int(bench.m_templateArgs.size()), 42);
+				consumer.writeRows_i();
+			}
+		}
+
+		// Annotation text with nothing to escape, copied in bulk
+		static void s_escapePlain(ExtractBenchmarks& bench, unsigned numOps)
+		{
+			for( unsigned i = 0; i < numOps; ++i )
+			{
+				bench.m_os << escaped(bench.m_plainAnnotation);
+			}
+		}
+
+		// Annotation text with a few quotes and backslashes to escape
+		static void s_escapeQuoted(ExtractBenchmarks& bench, unsigned numOps)
+		{
+			for( unsigned i = 0; i < numOps; ++i )
+			{
+				bench.m_os << escaped(bench.m_quotedAnnotation);
+			}
+		}
+
+		// A record with its methods and fields loaded back from the text database
+		static void s_loadEntries(ExtractBenchmarks& bench, unsigned numOps)
+		{
+			std::string error;
+			for( unsigned i = 0; i < numOps; ++i )
+			{
+				bench.m_loader.load(bench.m_database, bench.m_loaderHandler, error);
+			}
+		}
+
+		void setUp()
+		{
+			// keys of the type map are only compared, they are not dereferenced
+			const unsigned numTypes = 4096;
+			m_typeStorage.resize(2 * numTypes);
+			for( unsigned i = 0; i < numTypes; ++i )
+			{
+				const Type* key = reinterpret_cast<const Type*>(&m_typeStorage[2 * i]);
+				m_typeKeys.push_back(key);
+				m_missingTypeKeys.push_back(reinterpret_cast<const Type*>(&m_typeStorage[2 * i + 1]));
+				m_knownTypes[key] = int(i);
+			}
+
+			// template<class A, class B, class C, class D, int N> instantiated with <int, char*, const float, unsigned[4], 16>
+			QualType types[] =
+			{
+				m_context.IntTy,
+				m_context.getPointerType(m_context.CharTy),
+				m_context.FloatTy.withConst(),
+				m_context.getConstantArrayType(m_context.UnsignedIntTy, llvm::APInt(32, 4), ArrayType::Normal, 0),
+			};
+			for( unsigned i = 0; i < sizeof(types) / sizeof(types[0]); ++i )
+			{
+				m_templateArgs.push_back(TemplateArgument(types[i]));
+			}
+			m_templateArgs.push_back(TemplateArgument(llvm::APSInt(llvm::APInt(32, 16), false), m_context.IntTy));
+
+			m_consumer = new ExtractASTConsumer(m_os);
+			m_consumer->Initialize(m_context);
+
+			// annotations as written by a reflection attribute macro
+			m_plainAnnotation = "hk.Reflect(serialize=True, group=Physics, version=3, ui.label=Max linear velocity, ui.range=0..1000)";
+			m_quotedAnnotation = "hk.Reflect(serialize=True, group='Physics', version=3, ui.label=\"Max linear velocity\", path=C:\\data)";
+
+			llvm::raw_string_ostream database(m_database);
+			DumpEntry::dumpDefaultEntries(database);
+			database << "RecordType( id=2, name='hkpRigidBody', polymorphic=True, abstract=False, hash=0x0123456789abcdef, scopeid=1 )\n";
+			database << "FunctionProtoType( id=3, rettypeid=4, paramtypeids=[5,6], isVariadic=False )\n";
+			database << "Method( id=7, recordid=2, typeid=3, const=True, name='getLinearVelocity' )\n";
+			database << "Constructor( id=8, recordid=2, typeid=3, isCopyConstructor=True, isImplicit=True, name='hkpRigidBody' )\n";
+			database << "Field( id=9, recordid=2, typeid=4, access=\"private\", name='m_linearVelocity' )\n";
+			database << "Annotation( refid=9, text=\"\"\"" << escaped(m_quotedAnnotation) << "\"\"\" )\n";
+			database.flush();
+		}
+
+		void tearDown()
+		{
+			delete m_consumer;
+			m_consumer = NULL;
+		}
+
+		ASTContext& m_context;
+		// Output of the benchmarks, formatted but discarded
+		llvm::raw_null_ostream m_os;
+		ExtractASTConsumer* m_consumer;
+		std::vector<TemplateArgument> m_templateArgs;
+		std::string m_plainAnnotation;
+		std::string m_quotedAnnotation;
+		std::string m_database;
+		DatabaseLoader m_loader;
+		DatabaseHandler m_loaderHandler;
+		std::vector<const Type*> m_typeKeys;
+		std::vector<const Type*> m_missingTypeKeys;
+		std::vector<void*> m_typeStorage;
+		ExtractASTConsumer::KnownTypeMap m_knownTypes;
+		// Results of the benchmarks which would otherwise be optimized away
+		size_t m_sink;
+
+		private:
+			ExtractBenchmarks& operator=(const ExtractBenchmarks&);
+	};
+}
+
+int main(int argc, char** argv)
+{
+	llvm::cl::ParseCommandLineOptions(argc, argv, "clang-extract microbenchmarks", true);
+	{
+		// the AST context of an empty C++ translation unit for the host
+		clang::DiagnosticsEngine diagnostics(llvm::IntrusiveRefCntPtr<clang::DiagnosticIDs>(new clang::DiagnosticIDs()), NULL, false);
+		clang::TargetOptions targetOptions;
+		targetOptions.Triple = llvm::sys::getHostTriple();
+		llvm::IntrusiveRefCntPtr<clang::TargetInfo> targetInfo( clang::TargetInfo::CreateTargetInfo(diagnostics, targetOptions) );
+		clang::FileSystemOptions filesystemOptions;
+		clang::FileManager fileManager(filesystemOptions);
+		clang::SourceManager sourceManager(diagnostics, fileManager);
+		clang::LangOptions langOptions;
+		langOptions.CPlusPlus = 1;
+		langOptions.Bool = 1;
+		clang::IdentifierTable identifierTable(langOptions);
+		clang::SelectorTable selectorTable;
+		clang::Builtin::Context builtinContext;
+		clang::ASTContext astcontext( langOptions, sourceManager, targetInfo.getPtr(), identifierTable, selectorTable, builtinContext, 0);
+
+		Havok::ExtractBenchmarks bench(astcontext);
+		bench.setUp();
+		bench.run("DumpEntry.defaults", &Havok::ExtractBenchmarks::s_dumpEntryDefaults);
+		bench.run("DumpEntry.values", &Havok::ExtractBenchmarks::s_dumpEntryValues);
+		bench.run("DumpEntry.integer", &Havok::ExtractBenchmarks::s_dumpEntryInteger);
+		bench.run("Stream.integer", &Havok::ExtractBenchmarks::s_streamInteger);
+		bench.run("KnownTypes.lookupHit", &Havok::ExtractBenchmarks::s_knownTypeLookupHit);
+		bench.run("KnownTypes.lookupMiss", &Havok::ExtractBenchmarks::s_knownTypeLookupMiss);
+		bench.run("KnownTypes.insert", &Havok::ExtractBenchmarks::s_knownTypeInsert);
+		bench.run("TemplateArguments.known", &Havok::ExtractBenchmarks::s_templateArgumentsKnown);
+		bench.run("TemplateArguments.new", &Havok::ExtractBenchmarks::s_templateArgumentsNew);
+		bench.run("Escape.plain", &Havok::ExtractBenchmarks::s_escapePlain);
+		bench.run("Escape.quoted", &Havok::ExtractBenchmarks::s_escapeQuoted);
+		bench.run("Loader.entries", &Havok::ExtractBenchmarks::s_loadEntries);
+		bench.tearDown();
+		if(bench.m_sink == 1)
+		{
+			llvm::outs() << "\n";
+		}
+	}
+	llvm::llvm_shutdown();
+	return 0;
+}
@@ -0,0 +1,108 @@
+// Copyright (c) 2012 Havok. All rights reserved. This file is distributed under the terms
+// and conditions defined in file 'LICENSE.txt', which is part of this source code package.
+
+#ifndef CLANG_EXTRACT_H
+#define CLANG_EXTRACT_H
+
+#include <set>
+#include <string>
+#include <vector>
+
+namespace llvm
+{
+	class raw_ostream;
+}
+
+namespace Havok
+{
+	class HeaderReport;
+	class ModuleMap;
+	class PerfCounters;
+	class EntityTables;
+
+	/// Everything needed to run one extraction. The clang-extract command line is a front end
+	/// filling this structure, other programs can fill it themselves and call extract().
+	struct ExtractionSetup
+	{
+		ExtractionSetup() : m_dumpLayouts(false), m_compactInstantiations(false), m_canonicalTypes(false), m_contentHashes(false), m_instantiationBudget(-1), m_dumpThreads(1), m_moduleMap(0) {}
+
+		// Target triple, the host triple is used if empty
+		std::string m_triple;
+		std::vector<std::string> m_defines;
+		std::vector<std::string> m_includePaths;
+		std::vector<std::string> m_passAttributes;
+		std::vector<std::string> m_forceIncludes;
+		std::vector<std::string> m_excludeFilenames;
+		std::vector<std::string> m_excludeFilenamePatterns;
+		std::vector<std::string> m_inputFilenames;
+		std::vector<std::string> m_roots;
+		std::string m_resourceDir;
+		bool m_dumpLayouts;
+		bool m_compactInstantiations;
+		bool m_canonicalTypes;
+		// Records, templates and enums have the hash of their content
+		bool m_contentHashes;
+		// Implicit instantiation definitions dumped, negative for no limit
+		int m_instantiationBudget;
+		// Threads used to dump the declarations
+		int m_dumpThreads;
+
+		// When set, each variant is extracted with this setup and its own triple and defines,
+		// and the databases are merged. The variants are name=triple[,define[=value]...]
+		std::vector<std::string> m_variants;
+		// When set, the inputs are split between these workers (host:port or unix:path), see runWorker()
+		std::vector<std::string> m_workers;
+		// Shared secret sent to the workers before the parts, it is not part of the parts
+		std::string m_workerSecret;
+
+		// Modules, disabled if there is no module map
+		const ModuleMap* m_moduleMap;
+		std::string m_moduleCachePath;
+		// When set, the inputs are the headers of a module which is written to this file instead of dumping
+		std::string m_moduleOutputFilename;
+		// Modules being built, the last one is the module of this setup
+		std::vector<std::string> m_builtModules;
+	};
+
+	/// Destination of the results of an extraction. The database and the diagnostics are always
+	/// written, the other results are only produced if the sink has somewhere to put them.
+	struct ExtractionSink
+	{
+		ExtractionSink(llvm::raw_ostream& databaseStream, llvm::raw_ostream& diagnosticStream)
+			: m_databaseStream(databaseStream), m_diagnosticStream(diagnosticStream), m_tables(0), m_headerReport(0), m_perfCounters(0), m_dependencies(0)
+		{}
+
+		llvm::raw_ostream& m_databaseStream;
+		llvm::raw_ostream& m_diagnosticStream;
+		// Entity tables, written out by the entity sinks afterwards (not with variants or workers)
+		EntityTables* m_tables;
+		// Parsing and dumping cost of each header (not with variants or workers)
+		HeaderReport* m_headerReport;
+		// Hardware counters of the parsing and dumping phases (not with variants or workers)
+		PerfCounters* m_perfCounters;
+		// The files read are added to this set
+		std::set<std::string>* m_dependencies;
+
+		private:
+			ExtractionSink& operator=(const ExtractionSink&);
+	};
+
+	// Run an extraction, returns 0 on success. There is no global state, extractions can run
+	// concurrently on several threads once llvm::llvm_start_multithreaded() has been called,
+	// which is also needed for variants, workers and several dump threads.
+	int extract(const ExtractionSetup& setup, ExtractionSink& sink);
+
+	// Extract the parts sent by the coordinators to an address (host:port or unix:path) one at
+	// a time, only returns on error. The coordinators must first send the secret, the
+	// connections which do not are closed. The secret cannot be empty.
+	int runWorker(const std::string& address, const std::string& secret, llvm::raw_ostream& diagnosticStream);
+
+	// Parse the prelude of the setup once (target, defines, include paths, forced includes and
+	// exclusions), then extract each part sent by the coordinators to an address in a child
+	// forked from the parsed prelude (POSIX only). The parts must have the same prelude, the
+	// rest of their setup is their own. The coordinators must first send the secret, as with
+	// runWorker(). Only returns on error.
+	int runForkServer(const ExtractionSetup& setup, const std::string& address, const std::string& secret, llvm::raw_ostream& diagnosticStream);
+}
+
+#endif //CLANG_EXTRACT_H
@@ -0,0 +1,360 @@
+// Copyright (c) 2012 Havok. All rights reserved. This file is distributed under the terms
+// and conditions defined in file 'LICENSE.txt', which is part of this source code package.
+
+#include "codegen.h"
+
+#include <algorithm>
+#include <cctype>
+
+// ----------------------- Static Utility Functions ------------------------- //
+
+// Writes a C string literal, anything which is not plain printable ASCII is written as an octal escape
+static void s_writeString(llvm::raw_ostream& os, llvm::StringRef str)
+{
+	os << '"';
+	for( llvm::StringRef::iterator it = str.begin(), end = str.end(); it != end; ++it )
+	{
+		unsigned char c = *it;
+		if( c == '"' || c == '\\' )
+		{
+			os << '\\' << c;
+		}
+		else if( c < 0x20 || c >= 0x7f || c == '?' ) // '?' avoids trigraphs
+		{
+			os << '\\' << char('0' + (c >> 6)) << char('0' + ((c >> 3) & 7)) << char('0' + (c & 7));
+		}
+		else
+		{
+			os << c;
+		}
+	}
+	os << '"';
+}
+
+static void s_writeInt64(llvm::raw_ostream& os, int64_t value)
+{
+	if( value == INT64_MIN )
+	{
+		// the literal for the smallest value can't be negated
+		os << "(-9223372036854775807LL - 1)";
+	}
+	else
+	{
+		os << value << "LL";
+	}
+}
+
+struct MemberOwnerLess
+{
+	MemberOwnerLess(const std::vector<int>& ownerIndices) : m_ownerIndices(ownerIndices) {}
+	bool operator()(unsigned a, unsigned b) const { return m_ownerIndices[a] < m_ownerIndices[b]; }
+	const std::vector<int>& m_ownerIndices;
+};
+
+// ------------------- ReflectionTableWriter Implementation ------------------- //
+
+Havok::ReflectionTableWriter::ReflectionTableWriter(llvm::StringRef namespaceName, llvm::StringRef headerName)
+	: m_namespaceName(namespaceName), m_headerName(headerName)
+{
+}
+
+void Havok::ReflectionTableWriter::writeFile(const EntityTables& tables, int file, llvm::raw_ostream& os) const
+{
+	if( file == 0 )
+	{
+		writeHeader(os);
+	}
+	else
+	{
+		writeSource(tables, os);
+	}
+}
+
+void Havok::ReflectionTableWriter::sortMembers_i(const EntityTables& tables, EntityTables::MemberTableId table, std::vector<unsigned>& order, std::vector<int>& firstMember, std::vector<int>& numMembers) const
+{
+	// members are grouped by owner (keeping their dump order) so each type refers to a contiguous range
+	const EntityTables::MemberTable& members = tables.getMembers(table);
+	std::vector<int> ownerIndices(members.size());
+	order.resize(members.size());
+	for( unsigned int i = 0; i < members.size(); ++i )
+	{
+		ownerIndices[i] = tables.getTypeIndex(members.m_ownerIds[i]);
+		order[i] = i;
+	}
+	std::stable_sort(order.begin(), order.end(), MemberOwnerLess(ownerIndices));
+
+	firstMember.assign(tables.getTypes().size(), 0);
+	numMembers.assign(tables.getTypes().size(), 0);
+	for( unsigned int i = 0; i < order.size(); ++i )
+	{
+		int owner = ownerIndices[order[i]];
+		if( owner >= 0 )
+		{
+			if( numMembers[owner] == 0 )
+			{
+				firstMember[owner] = int(i);
+			}
+			++numMembers[owner];
+		}
+	}
+}
+
+void Havok::ReflectionTableWriter::writeHeader(llvm::raw_ostream& os) const
+{
+	std::string guard = "CLANG_EXTRACT_TABLES_";
+	for( std::string::const_iterator it = m_namespaceName.begin(), end = m_namespaceName.end(); it != end; ++it )
+	{
+		guard += isalnum(*it) ? char(toupper(*it)) : '_';
+	}
+	guard += "_H";
+	os << "// Generated by clang-extract, do not edit.\n";
+	os << "#ifndef " << guard << "\n";
+	os << "#define " << guard << "\n\n";
+	os << "namespace " << m_namespaceName << "\n{\n";
+
+	os << "\tenum TypeKind\n\t{\n";
+	for( int i = 0; i < EntityTables::NUM_TYPE_KINDS; ++i )
+	{
+		os << "\t\t" << EntityTables::getTypeKindName(EntityTables::TypeKind(i)) << ",\n";
+	}
+	os << "\t\tNUM_TYPE_KINDS\n\t};\n\n";
+
+	os << "\tenum MethodKind { METHOD_METHOD, METHOD_CONSTRUCTOR, METHOD_DESTRUCTOR };\n";
+	os << "\tenum TemplateParamKind { PARAM_TYPE, PARAM_NON_TYPE, PARAM_TEMPLATE };\n";
+	os << "\tenum TemplateArgKind { ARG_TYPE, ARG_TEMPLATE, ARG_VALUE };\n";
+	os << "\tenum AnnotationTarget { TARGET_TYPE, TARGET_FIELD, TARGET_METHOD };\n";
+	os << "\tenum Access { ACCESS_PUBLIC, ACCESS_PROTECTED, ACCESS_PRIVATE, ACCESS_NONE };\n\n";
+
+	os << "\tenum Flags\n\t{\n";
+	os << "\t\tFLAG_POLYMORPHIC = " << unsigned(EntityTables::FLAG_POLYMORPHIC) << ",\n";
+	os << "\t\tFLAG_ABSTRACT = " << unsigned(EntityTables::FLAG_ABSTRACT) << ",\n";
+	os << "\t\tFLAG_VARIADIC = " << unsigned(EntityTables::FLAG_VARIADIC) << ",\n";
+	os << "\t\tFLAG_STATIC = " << unsigned(EntityTables::FLAG_STATIC) << ",\n";
+	os << "\t\tFLAG_CONST = " << unsigned(EntityTables::FLAG_CONST) << ",\n";
+	os << "\t\tFLAG_IMPLICIT = " << unsigned(EntityTables::FLAG_IMPLICIT) << ",\n";
+	os << "\t\tFLAG_COPY_CONSTRUCTOR = " << unsigned(EntityTables::FLAG_COPY_CONSTRUCTOR) << ",\n";
+	os << "\t\tFLAG_DEFAULT_CONSTRUCTOR = " << unsigned(EntityTables::FLAG_DEFAULT_CONSTRUCTOR) << ",\n";
+	os << "\t\tFLAG_COPY_ASSIGNMENT = " << unsigned(EntityTables::FLAG_COPY_ASSIGNMENT) << ",\n";
+	os << "\t\tFLAG_VIRTUAL = " << unsigned(EntityTables::FLAG_VIRTUAL) << ",\n";
+	os << "\t\tFLAG_HAS_LAYOUT = " << unsigned(EntityTables::FLAG_HAS_LAYOUT) << ",\n";
+	os << "\t\tFLAG_BIT_FIELD = " << unsigned(EntityTables::FLAG_BIT_FIELD) << "\n";
+	os << "\t};\n\n";
+
+	os << "\t// All indices refer to the tables below, -1 when there is nothing to refer to\n";
+	os << "\tstruct Type\n\t{\n";
+	os << "\t\tint kind;\n";
+	os << "\t\tconst char* name;\n";
+	os << "\t\tint scope; // file, namespace, record or template containing the entity\n";
+	os << "\t\tint type; // pointee, underlying, element, return or template type\n";
+	os << "\t\tint extra; // array element count or member pointer record\n";
+	os << "\t\tunsigned flags;\n";
+	os << "\t\tint size;\n";
+	os << "\t\tint align;\n";
+	os << "\t\tint firstParamType, numParamTypes;\n";
+	os << "\t\tint firstField, numFields;\n";
+	os << "\t\tint firstMethod, numMethods;\n";
+	os << "\t\tint firstBase, numBases;\n";
+	os << "\t\tint firstEnumConstant, numEnumConstants;\n";
+	os << "\t\tint firstTemplateParam, numTemplateParams;\n";
+	os << "\t\tint firstTemplateArg, numTemplateArgs;\n";
+	os << "\t};\n";
+	os << "\tstruct Field { const char* name; int record; int type; int access; unsigned flags; int offset; }; // offset in bits with FLAG_BIT_FIELD\n";
+	os << "\tstruct Method { const char* name; int record; int type; int kind; int access; unsigned flags; int numParamDefaults; };\n";
+	os << "\tstruct Base { int record; int parent; unsigned flags; int offset; };\n";
+	os << "\tstruct EnumConstant { const char* name; int enumType; long long value; };\n";
+	os << "\tstruct TemplateParam { const char* name; int owner; int kind; int type; };\n";
+	os << "\tstruct TemplateArg { int record; int kind; int ref; const char* value; };\n";
+	os << "\tstruct Annotation { int target; int targetKind; const char* text; };\n\n";
+
+	// every table is followed by a zeroed entry, so it is never empty
+	static const char* tables[][2] =
+	{
+		{ "Type", "types" },
+		{ "int", "paramTypes" },
+		{ "Field", "fields" },
+		{ "Method", "methods" },
+		{ "Base", "bases" },
+		{ "EnumConstant", "enumConstants" },
+		{ "TemplateParam", "templateParams" },
+		{ "TemplateArg", "templateArgs" },
+		{ "Annotation", "annotations" },
+	};
+	for( unsigned int i = 0; i < sizeof(tables) / sizeof(tables[0]); ++i )
+	{
+		llvm::StringRef name(tables[i][1]);
+		os << "\textern const " << tables[i][0] << " " << name << "[];\n";
+		os << "\textern const int num" << char(toupper(name[0])) << name.substr(1) << ";\n";
+	}
+	os << "}\n\n#endif // " << guard << "\n";
+}
+
+void Havok::ReflectionTableWriter::writeSource(const EntityTables& tables, llvm::raw_ostream& os) const
+{
+	// group the members of each type, this is where entity ids are turned into table indices
+	std::vector<unsigned> paramTypes, fields, methods, bases, enumConstants, templateParams, templateArgs;
+	std::vector<int> firstParamType, numParamTypes, firstField, numFields, firstMethod, numMethods, firstBase, numBases,
+		firstEnumConstant, numEnumConstants, firstTemplateParam, numTemplateParams, firstTemplateArg, numTemplateArgs;
+	sortMembers_i(tables, EntityTables::MEMBERS_PARAM_TYPES, paramTypes, firstParamType, numParamTypes);
+	sortMembers_i(tables, EntityTables::MEMBERS_FIELDS, fields, firstField, numFields);
+	sortMembers_i(tables, EntityTables::MEMBERS_METHODS, methods, firstMethod, numMethods);
+	sortMembers_i(tables, EntityTables::MEMBERS_BASES, bases, firstBase, numBases);
+	sortMembers_i(tables, EntityTables::MEMBERS_ENUM_CONSTANTS, enumConstants, firstEnumConstant, numEnumConstants);
+	sortMembers_i(tables, EntityTables::MEMBERS_TEMPLATE_PARAMS, templateParams, firstTemplateParam, numTemplateParams);
+	sortMembers_i(tables, EntityTables::MEMBERS_TEMPLATE_ARGS, templateArgs, firstTemplateArg, numTemplateArgs);
+
+	const EntityTables::TypeTable& types = tables.getTypes();
+	const EntityTables::MemberTable& paramTypeTable = tables.getMembers(EntityTables::MEMBERS_PARAM_TYPES);
+	const EntityTables::MemberTable& fieldTable = tables.getMembers(EntityTables::MEMBERS_FIELDS);
+	const EntityTables::MemberTable& methodTable = tables.getMembers(EntityTables::MEMBERS_METHODS);
+	const EntityTables::MemberTable& baseTable = tables.getMembers(EntityTables::MEMBERS_BASES);
+	const EntityTables::MemberTable& enumConstantTable = tables.getMembers(EntityTables::MEMBERS_ENUM_CONSTANTS);
+	const EntityTables::MemberTable& templateParamTable = tables.getMembers(EntityTables::MEMBERS_TEMPLATE_PARAMS);
+	const EntityTables::MemberTable& templateArgTable = tables.getMembers(EntityTables::MEMBERS_TEMPLATE_ARGS);
+	const EntityTables::MemberTable& annotationTable = tables.getMembers(EntityTables::MEMBERS_ANNOTATIONS);
+
+	typedef llvm::DenseMap<int, int> IndexMap;
+	IndexMap fieldIndices, methodIndices;
+	for( unsigned int i = 0; i < fields.size(); ++i )
+	{
+		fieldIndices[fieldTable.m_ids[fields[i]]] = i;
+	}
+	for( unsigned int i = 0; i < methods.size(); ++i )
+	{
+		methodIndices[methodTable.m_ids[methods[i]]] = i;
+	}
+
+	os << "// Generated by clang-extract, do not edit.\n";
+	os << "#include \"" << m_headerName << "\"\n\n";
+	os << "namespace " << m_namespaceName << "\n{\n";
+
+	os << "\tconst Type types[] =\n\t{\n";
+	for( unsigned int i = 0; i < types.size(); ++i )
+	{
+		const EntityTables::TypeKind kind = EntityTables::TypeKind(types.m_kinds[i]);
+		os << "\t\t{ " << EntityTables::getTypeKindName(kind) << ", ";
+		s_writeString(os, tables.getString(types.m_names[i]));
+		int extra = kind == EntityTables::KIND_MEMBER_POINTER ? tables.getTypeIndex(types.m_extras[i]) : types.m_extras[i];
+		os << ", " << tables.getTypeIndex(types.m_scopeIds[i]) << ", " << tables.getTypeIndex(types.m_typeIds[i]) << ", " << extra;
+		os << ", " << types.m_flags[i] << "u, " << types.m_sizes[i] << ", " << types.m_aligns[i];
+		os << ", " << firstParamType[i] << ", " << numParamTypes[i];
+		os << ", " << firstField[i] << ", " << numFields[i];
+		os << ", " << firstMethod[i] << ", " << numMethods[i];
+		os << ", " << firstBase[i] << ", " << numBases[i];
+		os << ", " << firstEnumConstant[i] << ", " << numEnumConstants[i];
+		os << ", " << firstTemplateParam[i] << ", " << numTemplateParams[i];
+		os << ", " << firstTemplateArg[i] << ", " << numTemplateArgs[i] << " },\n";
+	}
+	os << "\t\t{ 0 }\n\t};\n";
+	os << "\tconst int numTypes = " << types.size() << ";\n\n";
+
+	os << "\tconst int paramTypes[] =\n\t{\n";
+	for( unsigned int i = 0; i < paramTypes.size(); ++i )
+	{
+		os << "\t\t" << tables.getTypeIndex(paramTypeTable.m_typeIds[paramTypes[i]]) << ",\n";
+	}
+	os << "\t\t0\n\t};\n";
+	os << "\tconst int numParamTypes = " << paramTypes.size() << ";\n\n";
+
+	os << "\tconst Field fields[] =\n\t{\n";
+	for( unsigned int i = 0; i < fields.size(); ++i )
+	{
+		const unsigned field = fields[i];
+		os << "\t\t{ ";
+		s_writeString(os, tables.getString(fieldTable.m_names[field]));
+		os << ", " << tables.getTypeIndex(fieldTable.m_ownerIds[field]) << ", " << tables.getTypeIndex(fieldTable.m_typeIds[field]) << ", " << int(fieldTable.m_access[field]);
+		os << ", " << fieldTable.m_flags[field] << "u, " << fieldTable.m_values[field] << " },\n";
+	}
+	os << "\t\t{ 0 }\n\t};\n";
+	os << "\tconst int numFields = " << fields.size() << ";\n\n";
+
+	os << "\tconst Method methods[] =\n\t{\n";
+	for( unsigned int i = 0; i < methods.size(); ++i )
+	{
+		const unsigned method = methods[i];
+		os << "\t\t{ ";
+		s_writeString(os, tables.getString(methodTable.m_names[method]));
+		os << ", " << tables.getTypeIndex(methodTable.m_ownerIds[method]) << ", " << tables.getTypeIndex(methodTable.m_typeIds[method]) << ", " << int(methodTable.m_kinds[method]);
+		os << ", " << int(methodTable.m_access[method]) << ", " << methodTable.m_flags[method] << "u, " << methodTable.m_values[method] << " },\n";
+	}
+	os << "\t\t{ 0 }\n\t};\n";
+	os << "\tconst int numMethods = " << methods.size() << ";\n\n";
+
+	os << "\tconst Base bases[] =\n\t{\n";
+	for( unsigned int i = 0; i < bases.size(); ++i )
+	{
+		const unsigned base = bases[i];
+		os << "\t\t{ " << tables.getTypeIndex(baseTable.m_ownerIds[base]) << ", " << tables.getTypeIndex(baseTable.m_typeIds[base]);
+		os << ", " << baseTable.m_flags[base] << "u, " << baseTable.m_values[base] << " },\n";
+	}
+	os << "\t\t{ 0 }\n\t};\n";
+	os << "\tconst int numBases = " << bases.size() << ";\n\n";
+
+	os << "\tconst EnumConstant enumConstants[] =\n\t{\n";
+	for( unsigned int i = 0; i < enumConstants.size(); ++i )
+	{
+		const unsigned constant = enumConstants[i];
+		os << "\t\t{ ";
+		s_writeString(os, tables.getString(enumConstantTable.m_names[constant]));
+		os << ", " << tables.getTypeIndex(enumConstantTable.m_ownerIds[constant]) << ", ";
+		s_writeInt64(os, enumConstantTable.m_values[constant]);
+		os << " },\n";
+	}
+	os << "\t\t{ 0 }\n\t};\n";
+	os << "\tconst int numEnumConstants = " << enumConstants.size() << ";\n\n";
+
+	os << "\tconst TemplateParam templateParams[] =\n\t{\n";
+	for( unsigned int i = 0; i < templateParams.size(); ++i )
+	{
+		const unsigned param = templateParams[i];
+		os << "\t\t{ ";
+		s_writeString(os, tables.getString(templateParamTable.m_names[param]));
+		os << ", " << tables.getTypeIndex(templateParamTable.m_ownerIds[param]) << ", " << int(templateParamTable.m_kinds[param]) << ", " << tables.getTypeIndex(templateParamTable.m_typeIds[param]) << " },\n";
+	}
+	os << "\t\t{ 0 }\n\t};\n";
+	os << "\tconst int numTemplateParams = " << templateParams.size() << ";\n\n";
+
+	os << "\tconst TemplateArg templateArgs[] =\n\t{\n";
+	for( unsigned int i = 0; i < templateArgs.size(); ++i )
+	{
+		const unsigned arg = templateArgs[i];
+		os << "\t\t{ " << tables.getTypeIndex(templateArgTable.m_ownerIds[arg]) << ", " << int(templateArgTable.m_kinds[arg]) << ", " << tables.getTypeIndex(templateArgTable.m_typeIds[arg]) << ", ";
+		if( templateArgTable.m_kinds[arg] == EntityTables::ARG_VALUE )
+		{
+			s_writeString(os, tables.getString(templateArgTable.m_names[arg]));
+		}
+		else
+		{
+			os << '0';
+		}
+		os << " },\n";
+	}
+	os << "\t\t{ 0 }\n\t};\n";
+	os << "\tconst int numTemplateArgs = " << templateArgs.size() << ";\n\n";
+
+	os << "\tconst Annotation annotations[] =\n\t{\n";
+	for( unsigned int i = 0; i < annotationTable.size(); ++i )
+	{
+		const int ownerId = annotationTable.m_ownerIds[i];
+		int target = tables.getTypeIndex(ownerId);
+		const char* targetKind = "TARGET_TYPE";
+		IndexMap::const_iterator it;
+		if( target == -1 && (it = fieldIndices.find(ownerId)) != fieldIndices.end() )
+		{
+			target = it->second;
+			targetKind = "TARGET_FIELD";
+		}
+		else if( target == -1 && (it = methodIndices.find(ownerId)) != methodIndices.end() )
+		{
+			target = it->second;
+			targetKind = "TARGET_METHOD";
+		}
+		os << "\t\t{ " << target << ", " << targetKind << ", ";
+		s_writeString(os, tables.getString(annotationTable.m_names[i]));
+		os << " },\n";
+	}
+	os << "\t\t{ 0 }\n\t};\n";
+	os << "\tconst int numAnnotations = " << annotationTable.size() << ";\n";
+	os << "}\n";
+}
+
+// -------------------------------------------------------------------------- //
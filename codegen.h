@@ -0,0 +1,43 @@
+// Copyright (c) 2012 Havok. All rights reserved. This file is distributed under the terms
+// and conditions defined in file 'LICENSE.txt', which is part of this source code package.
+
+#ifndef CODEGEN_H
+#define CODEGEN_H
+
+#include "entities.h"
+
+#include <string>
+#include <vector>
+
+namespace Havok
+{
+	/// Writes the entity tables out as C++ reflection tables: constant arrays of types, fields,
+	/// methods, enum constants, etc. referring to each other by array index instead of entity id.
+	/// The generated code can be compiled directly, there is no need to go through the text database.
+	class ReflectionTableWriter : public EntitySink
+	{
+		public:
+
+			// The source includes the header with headerName
+			ReflectionTableWriter(llvm::StringRef namespaceName, llvm::StringRef headerName);
+
+			virtual int getNumFiles() const { return 2; }
+			virtual llvm::StringRef getFileSuffix(int file) const { return file == 0 ? ".h" : ".cpp"; }
+			virtual void writeFile(const EntityTables& tables, int file, llvm::raw_ostream& os) const;
+
+			// Write the declarations of the tables
+			void writeHeader(llvm::raw_ostream& os) const;
+			// Write the tables, the source includes the header written above
+			void writeSource(const EntityTables& tables, llvm::raw_ostream& os) const;
+
+		protected:
+
+			// Order the members by owner type and compute the range of members of each type
+			void sortMembers_i(const EntityTables& tables, EntityTables::MemberTableId table, std::vector<unsigned>& order, std::vector<int>& firstMember, std::vector<int>& numMembers) const;
+
+			std::string m_namespaceName;
+			std::string m_headerName;
+	};
+}
+
+#endif //CODEGEN_H
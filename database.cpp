@@ -0,0 +1,1017 @@
+// Copyright (c) 2012 Havok. All rights reserved. This file is distributed under the terms
+// and conditions defined in file 'LICENSE.txt', which is part of this source code package.
+
+#include "database.h"
+#include "escape.h"
+#include <algorithm>
+#include <cassert>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+
+// Keys whose values are ids of other entities
+static bool s_isReferenceKey(llvm::StringRef key)
+{
+	return key == "typeid" || key == "scopeid" || key == "recordid" || key == "templateid" ||
+		key == "parent" || key == "refid" || key == "rettypeid" || key == "paramtypeids" || key == "enumId";
+}
+
+static bool s_isIdentifierChar(char c)
+{
+	return isalnum((unsigned char)c) || c == '_';
+}
+
+// Find the end of a value starting at pos, values are either '...', """...""", [...] or plain tokens.
+// Quoted values are escaped (see escape.h), the first quote which is not escaped closes them.
+static size_t s_findValueEnd(llvm::StringRef line, size_t pos)
+{
+	if(line.substr(pos).startswith("\"\"\""))
+	{
+		size_t end = line.find("\"\"\"", pos + 3);
+		return end == llvm::StringRef::npos ? line.size() : end + 3;
+	}
+	if(line[pos] == '\'')
+	{
+		for(size_t i = pos + 1; i < line.size(); ++i)
+		{
+			if(line[i] == '\\')
+			{
+				++i;
+			}
+			else if(line[i] == '\'')
+			{
+				return i + 1;
+			}
+		}
+		return line.size();
+	}
+	if(line[pos] == '[')
+	{
+		size_t end = line.find(']', pos);
+		return end == llvm::StringRef::npos ? line.size() : end + 1;
+	}
+	size_t i = pos;
+	while(i < line.size() && line[i] != ',' && line[i] != ' ' && line[i] != ')')
+	{
+		++i;
+	}
+	return i;
+}
+
+// Next key and value of an entry starting at pos, returns false at the end of the entry
+static bool s_nextKeyValue(llvm::StringRef line, size_t& pos, llvm::StringRef& keyOut, llvm::StringRef& valueOut)
+{
+	size_t eq = pos;
+	while(eq < line.size() && s_isIdentifierChar(line[eq]))
+	{
+		++eq;
+	}
+	if(eq == pos || eq >= line.size() || line[eq] != '=')
+	{
+		return false;
+	}
+	keyOut = line.substr(pos, eq - pos);
+	size_t valueBegin = eq + 1;
+	size_t valueEnd = valueBegin < line.size() ? s_findValueEnd(line, valueBegin) : valueBegin;
+	valueOut = line.substr(valueBegin, valueEnd - valueBegin);
+	pos = valueEnd;
+	while(pos < line.size() && (line[pos] == ',' || line[pos] == ' '))
+	{
+		++pos;
+	}
+	return true;
+}
+
+// Key referring to the entity an entry is attached to, NULL for the entries which stand alone
+static const char* s_getParentKey(llvm::StringRef entityName)
+{
+	if(entityName == "Field" || entityName == "Method" || entityName == "Constructor" || entityName == "Destructor" ||
+		entityName == "StaticField" || entityName == "TemplateSpecializationTypeArg" || entityName == "TemplateSpecializationTemplateArg" ||
+		entityName == "TemplateSpecializationNonTypeArg" || entityName == "InstantiationPattern" || entityName == "InstantiationNotExpanded" ||
+		entityName == "FieldOffset" || entityName == "BaseOffset")
+	{
+		return "recordid";
+	}
+	if(entityName == "TemplateNonTypeParam" || entityName == "TemplateTypeParamType" || entityName == "TemplateTemplateParam")
+	{
+		return "templateid";
+	}
+	if(entityName == "EnumConstant")
+	{
+		return "enumId";
+	}
+	if(entityName == "Annotation")
+	{
+		return "refid";
+	}
+	if(entityName == "Inherit")
+	{
+		// refers to the record with "id"
+		return "id";
+	}
+	return NULL;
+}
+
+Havok::DatabaseMerger::DatabaseMerger(Mode mode)
+	: m_mode(mode), m_numDatabases(0), m_nextId(1)
+{
+}
+
+// Keys which do not identify an unnamed entity, they can differ between the versions of the entity
+static bool s_isAttributeKey(llvm::StringRef key)
+{
+	return key == "polymorphic" || key == "abstract" || key == "hash" || key == "size" || key == "align";
+}
+
+static bool s_isMethodEntry(llvm::StringRef entityName)
+{
+	return entityName == "Method" || entityName == "Constructor" || entityName == "Destructor";
+}
+
+namespace
+{
+	// Entry of a database being merged
+	struct MergedEntry
+	{
+		llvm::StringRef m_line;
+		llvm::StringRef m_name;
+		// Position of the first key
+		size_t m_valuesBegin;
+		// Local id defined by the entry, or -1
+		int m_id;
+		// Local id of the entity the entry is attached to (see s_getParentKey), or -1
+		int m_parentId;
+	};
+
+	// Stable keys of the entities of a database, which do not depend on the ids: the kind, name
+	// (or file location) and scope of the named entities, methods also have their type, and the
+	// kind and components of the unnamed types. Template instantiations and specializations also
+	// have their arguments. The keys are 64-bit hashes.
+	class EntityKeys
+	{
+		public:
+
+			EntityKeys(const std::vector<MergedEntry>& entries);
+
+			uint64_t getKey(int localId);
+			// Number of entries attached to an entity
+			unsigned getNumChildren(int localId) const;
+
+		protected:
+
+			void hashValue_i(Havok::Fnv64& hash, llvm::StringRef key, llvm::StringRef value, bool isReference);
+
+			const std::vector<MergedEntry>& m_entries;
+			// Entry defining each local id
+			llvm::DenseMap<int, unsigned> m_definitions;
+			// Template arguments of each instantiation or specialization
+			llvm::DenseMap<int, std::vector<unsigned> > m_arguments;
+			llvm::DenseMap<int, unsigned> m_numChildren;
+			llvm::DenseMap<int, uint64_t> m_keys;
+			// Entities whose key is being computed, a reference back to one of them only hashes its kind
+			llvm::DenseMap<int, bool> m_inProgress;
+
+		private:
+			EntityKeys& operator=(const EntityKeys&);
+	};
+}
+
+EntityKeys::EntityKeys(const std::vector<MergedEntry>& entries)
+	: m_entries(entries)
+{
+	for( unsigned i = 0; i < entries.size(); ++i )
+	{
+		const MergedEntry& entry = entries[i];
+		if(entry.m_id >= 0 && m_definitions.find(entry.m_id) == m_definitions.end())
+		{
+			m_definitions[entry.m_id] = i;
+		}
+		if(entry.m_parentId >= 0)
+		{
+			++m_numChildren[entry.m_parentId];
+			if(entry.m_name.startswith("TemplateSpecialization"))
+			{
+				m_arguments[entry.m_parentId].push_back(i);
+			}
+		}
+	}
+}
+
+unsigned EntityKeys::getNumChildren(int localId) const
+{
+	llvm::DenseMap<int, unsigned>::const_iterator it = m_numChildren.find(localId);
+	return it != m_numChildren.end() ? it->second : 0;
+}
+
+void EntityKeys::hashValue_i(Havok::Fnv64& hash, llvm::StringRef key, llvm::StringRef value, bool isReference)
+{
+	hash.update(key.data(), key.size());
+	hash.update("=", 1);
+	if(!isReference)
+	{
+		hash.update(value.data(), value.size());
+		hash.update(",", 1);
+		return;
+	}
+	// ids, or lists of ids
+	llvm::StringRef ids = value.startswith("[") ? value.substr(1, value.size() - 2) : value;
+	while(!ids.empty())
+	{
+		std::pair<llvm::StringRef, llvm::StringRef> split = ids.split(',');
+		const int id = atoi(split.first.str().c_str());
+		const uint64_t referenced = id >= 0 ? getKey(id) : 0;
+		hash.update(reinterpret_cast<const char*>(&referenced), sizeof(referenced));
+		ids = split.second;
+	}
+	hash.update(",", 1);
+}
+
+uint64_t EntityKeys::getKey(int localId)
+{
+	llvm::DenseMap<int, uint64_t>::const_iterator known = m_keys.find(localId);
+	if(known != m_keys.end())
+	{
+		return known->second;
+	}
+	llvm::DenseMap<int, unsigned>::const_iterator definition = m_definitions.find(localId);
+	Havok::Fnv64 hash;
+	if(definition == m_definitions.end())
+	{
+		// not defined in this database, it cannot be matched
+		hash.update("?", 1);
+		hash.update(reinterpret_cast<const char*>(&localId), sizeof(localId));
+		return hash.get();
+	}
+	const MergedEntry& entry = m_entries[definition->second];
+	hash.update(entry.m_name.data(), entry.m_name.size());
+	hash.update("(", 1);
+	if(m_inProgress[localId])
+	{
+		// the parameters of a template refer to it
+		return hash.get();
+	}
+	m_inProgress[localId] = true;
+
+	const char* parentKey = s_getParentKey(entry.m_name);
+	const llvm::StringRef scopeKey = parentKey != NULL ? parentKey : "scopeid";
+	bool isNamed = false;
+	llvm::StringRef key, value;
+	for( size_t pos = entry.m_valuesBegin; s_nextKeyValue(entry.m_line, pos, key, value); )
+	{
+		isNamed = isNamed || key == "name" || key == "location";
+	}
+	for( size_t pos = entry.m_valuesBegin; s_nextKeyValue(entry.m_line, pos, key, value); )
+	{
+		if(key == "id")
+		{
+			continue;
+		}
+		if(isNamed)
+		{
+			// methods can be overloaded
+			if(key == "name" || key == "location" || key == scopeKey || (key == "typeid" && s_isMethodEntry(entry.m_name)))
+			{
+				hashValue_i(hash, key, value, key == scopeKey || key == "typeid");
+			}
+		}
+		else if(!s_isAttributeKey(key))
+		{
+			hashValue_i(hash, key, value, s_isReferenceKey(key));
+		}
+	}
+
+	llvm::DenseMap<int, std::vector<unsigned> >::const_iterator arguments = m_arguments.find(localId);
+	if(arguments != m_arguments.end())
+	{
+		for( std::vector<unsigned>::const_iterator it = arguments->second.begin(); it != arguments->second.end(); ++it )
+		{
+			const MergedEntry& argument = m_entries[*it];
+			hash.update(argument.m_name.data(), argument.m_name.size());
+			for( size_t pos = argument.m_valuesBegin; s_nextKeyValue(argument.m_line, pos, key, value); )
+			{
+				if(key != "recordid")
+				{
+					hashValue_i(hash, key, value, s_isReferenceKey(key));
+				}
+			}
+		}
+	}
+
+	m_inProgress[localId] = false;
+	m_keys[localId] = hash.get();
+	return hash.get();
+}
+
+int Havok::DatabaseMerger::getMergedId_i(int localId, IdMap& idMap)
+{
+	if(localId < 0)
+	{
+		return localId;
+	}
+	IdMap::const_iterator it = idMap.find(localId);
+	if(it != idMap.end())
+	{
+		return it->second;
+	}
+	// an id which is not defined in its database, it is not shared
+	int mergedId = m_nextId++;
+	idMap[localId] = mergedId;
+	return mergedId;
+}
+
+void Havok::DatabaseMerger::remapLine_i(llvm::StringRef line, IdMap& idMap, std::string& remapped)
+{
+	remapped.clear();
+	size_t open = line.find("( ");
+	if(open == llvm::StringRef::npos || line.startswith("#"))
+	{
+		// comments and unknown lines are matched verbatim
+		remapped = line;
+		return;
+	}
+	size_t pos = open + 2;
+	remapped.append(line.data(), pos);
+	while(pos < line.size())
+	{
+		size_t eq = pos;
+		while(eq < line.size() && s_isIdentifierChar(line[eq]))
+		{
+			++eq;
+		}
+		if(eq == pos || eq >= line.size() || line[eq] != '=')
+		{
+			// not a key, copy the remainder of the line
+			remapped.append(line.data() + pos, line.size() - pos);
+			break;
+		}
+		llvm::StringRef key = line.substr(pos, eq - pos);
+		size_t valueBegin = eq + 1;
+		size_t valueEnd = valueBegin < line.size() ? s_findValueEnd(line, valueBegin) : valueBegin;
+		llvm::StringRef value = line.substr(valueBegin, valueEnd - valueBegin);
+		remapped.append(line.data() + pos, valueBegin - pos);
+
+		if(s_isReferenceKey(key) || key == "id")
+		{
+			if(value.startswith("["))
+			{
+				// list of ids
+				remapped += '[';
+				llvm::StringRef ids = value.substr(1, value.size() - 2);
+				while(!ids.empty())
+				{
+					std::pair<llvm::StringRef, llvm::StringRef> split = ids.split(',');
+					std::string buf;
+					llvm::raw_string_ostream idStream(buf);
+					idStream << getMergedId_i(atoi(split.first.str().c_str()), idMap);
+					remapped += idStream.str();
+					if(!split.second.empty())
+					{
+						remapped += ',';
+					}
+					ids = split.second;
+				}
+				remapped += ']';
+			}
+			else
+			{
+				std::string buf;
+				llvm::raw_string_ostream idStream(buf);
+				idStream << getMergedId_i(atoi(value.str().c_str()), idMap);
+				remapped += idStream.str();
+			}
+		}
+		else
+		{
+			remapped.append(value.data(), value.size());
+		}
+
+		// separator
+		pos = valueEnd;
+		size_t next = pos;
+		while(next < line.size() && (line[next] == ',' || line[next] == ' '))
+		{
+			++next;
+		}
+		if(next < line.size() && line[next] == ')')
+		{
+			remapped.append(line.data() + pos, line.size() - pos);
+			break;
+		}
+		remapped.append(line.data() + pos, next - pos);
+		pos = next;
+	}
+}
+
+void Havok::DatabaseMerger::addDatabase(llvm::StringRef text)
+{
+	assert(m_numDatabases < MAX_DATABASES && "too many databases to merge");
+	const unsigned bit = 1u << m_numDatabases;
+	++m_numDatabases;
+
+	// 1: the entries, with the local ids they define and the entities they are attached to
+	std::vector<MergedEntry> entries;
+	while(!text.empty())
+	{
+		std::pair<llvm::StringRef, llvm::StringRef> split = text.split('\n');
+		text = split.second;
+		if(split.first.empty())
+		{
+			continue;
+		}
+		MergedEntry entry;
+		entry.m_line = split.first;
+		entry.m_id = -1;
+		entry.m_parentId = -1;
+		const size_t open = entry.m_line.find("( ");
+		if(open != llvm::StringRef::npos && !entry.m_line.startswith("#"))
+		{
+			entry.m_name = entry.m_line.substr(0, open);
+			entry.m_valuesBegin = open + 2;
+			const char* parentKey = s_getParentKey(entry.m_name);
+			llvm::StringRef key, value;
+			for( size_t pos = entry.m_valuesBegin; s_nextKeyValue(entry.m_line, pos, key, value); )
+			{
+				if(parentKey != NULL && key == parentKey)
+				{
+					entry.m_parentId = atoi(value.str().c_str());
+				}
+				else if(key == "id")
+				{
+					// Inherit entries refer to the record with "id"
+					entry.m_id = atoi(value.str().c_str());
+				}
+			}
+		}
+		entries.push_back(entry);
+	}
+
+	// 2: match the entities with the ones of the previous databases by their stable keys, the n-th
+	// entity with a key in a database matches the n-th one in the others
+	IdMap idMap;
+	EntityKeys entityKeys(entries);
+	{
+		llvm::DenseMap<uint64_t, int> keyOccurrences;
+		for( std::vector<MergedEntry>::const_iterator it = entries.begin(); it != entries.end(); ++it )
+		{
+			if(it->m_id < 0 || idMap.find(it->m_id) != idMap.end())
+			{
+				continue;
+			}
+			Fnv64 hash;
+			const uint64_t key = entityKeys.getKey(it->m_id);
+			const int occurrence = keyOccurrences[key]++;
+			hash.update(reinterpret_cast<const char*>(&key), sizeof(key));
+			hash.update(reinterpret_cast<const char*>(&occurrence), sizeof(occurrence));
+			llvm::DenseMap<uint64_t, int>::const_iterator known = m_entityIds.find(hash.get());
+			if(known != m_entityIds.end())
+			{
+				idMap[it->m_id] = known->second;
+			}
+			else
+			{
+				idMap[it->m_id] = m_nextId;
+				m_entityIds[hash.get()] = m_nextId++;
+			}
+		}
+	}
+
+	// 3: compare the remapped lines, an entity keeps its id in all its versions
+	llvm::StringMap<int> occurrences;
+	std::string remapped;
+	for( std::vector<MergedEntry>::const_iterator it = entries.begin(); it != entries.end(); ++it )
+	{
+		remapLine_i(it->m_line, idMap, remapped);
+
+		if(it->m_id >= 0)
+		{
+			const int mergedId = idMap[it->m_id];
+			std::vector<unsigned>& versions = m_entityLines[mergedId];
+			unsigned numValues = 0;
+			llvm::StringRef key, value;
+			for( size_t pos = it->m_valuesBegin; s_nextKeyValue(it->m_line, pos, key, value); )
+			{
+				++numValues;
+			}
+			const unsigned numChildren = entityKeys.getNumChildren(it->m_id);
+			if(m_mode == MERGE_PARTS && !versions.empty())
+			{
+				// the parts have a single configuration, the versions of an entity only differ by
+				// what their part knows about it: the most complete one is kept, the definition
+				// (with its members) rather than a forward declaration
+				Line& merged = m_lines[versions.front()];
+				if(numChildren > merged.m_numChildren || (numChildren == merged.m_numChildren && numValues > merged.m_numValues))
+				{
+					merged.m_text = remapped;
+					merged.m_numChildren = numChildren;
+					merged.m_numValues = numValues;
+				}
+				merged.m_mask |= bit;
+				continue;
+			}
+			bool found = false;
+			for( std::vector<unsigned>::const_iterator version = versions.begin(); version != versions.end() && !found; ++version )
+			{
+				Line& merged = m_lines[*version];
+				if((merged.m_mask & bit) == 0 && merged.m_text == remapped)
+				{
+					merged.m_mask |= bit;
+					found = true;
+				}
+			}
+			if(!found)
+			{
+				Line newLine;
+				newLine.m_text = remapped;
+				newLine.m_mask = bit;
+				newLine.m_numChildren = numChildren;
+				newLine.m_numValues = numValues;
+				versions.push_back(unsigned(m_lines.size()));
+				m_lines.push_back(newLine);
+			}
+			continue;
+		}
+
+		// the n-th occurrence of a line in a database matches the n-th occurrence in the others
+		int occurrence = occurrences[remapped]++;
+		std::string key = remapped;
+		{
+			llvm::raw_string_ostream keyStream(key);
+			keyStream << '\0' << occurrence;
+		}
+
+		llvm::StringMap<unsigned>::iterator found = m_lineIndices.find(key);
+		if(found != m_lineIndices.end() && (m_lines[found->second].m_mask & bit) == 0)
+		{
+			m_lines[found->second].m_mask |= bit;
+			continue;
+		}
+
+		Line newLine;
+		newLine.m_text = remapped;
+		newLine.m_mask = bit;
+		newLine.m_numChildren = 0;
+		newLine.m_numValues = 0;
+		m_lineIndices[key] = unsigned(m_lines.size());
+		m_lines.push_back(newLine);
+	}
+}
+
+void Havok::DatabaseMerger::write(llvm::raw_ostream& os) const
+{
+	const unsigned allMask = m_numDatabases >= 32 ? ~0u : (1u << m_numDatabases) - 1;
+	for( std::vector<Line>::const_iterator it = m_lines.begin(), end = m_lines.end(); it != end; ++it )
+	{
+		if(m_mode == MERGE_VARIANTS && it->m_mask != allMask)
+		{
+			os << "InVariants( mask=" << it->m_mask << " )\n";
+		}
+		os << it->m_text << '\n';
+	}
+}
+
+static const char s_indexMagic[] = "CXINDEX1";
+static const size_t s_indexHeaderSize = 8 + 8 + 8 + 4 * 4;
+static const size_t s_indexEntitySize = 8 + 4 + 4 + 4 + 4;
+static const size_t s_indexNameSize = 4 + 4 + 4;
+static const size_t s_indexChildSize = 8 + 4 + 4;
+
+static void s_write32(llvm::raw_ostream& os, uint32_t value)
+{
+	char bytes[4];
+	for( int i = 0; i < 4; ++i )
+	{
+		bytes[i] = char(value >> (8 * i));
+	}
+	os.write(bytes, sizeof(bytes));
+}
+
+static void s_write64(llvm::raw_ostream& os, uint64_t value)
+{
+	s_write32(os, uint32_t(value));
+	s_write32(os, uint32_t(value >> 32));
+}
+
+static uint32_t s_read32(const char* data)
+{
+	const unsigned char* bytes = reinterpret_cast<const unsigned char*>(data);
+	return uint32_t(bytes[0]) | (uint32_t(bytes[1]) << 8) | (uint32_t(bytes[2]) << 16) | (uint32_t(bytes[3]) << 24);
+}
+
+static uint64_t s_read64(const char* data)
+{
+	return uint64_t(s_read32(data)) | (uint64_t(s_read32(data + 4)) << 32);
+}
+
+Havok::DatabaseIndexer::DatabaseIndexer(llvm::raw_ostream& os)
+	: m_os(os), m_size(0), m_lineOffset(0), m_variantsOffset(-1), m_inString(false), m_lastLineIndexed(false)
+{
+}
+
+Havok::DatabaseIndexer::~DatabaseIndexer()
+{
+	flush();
+}
+
+void Havok::DatabaseIndexer::write_impl(const char* ptr, size_t size)
+{
+	m_hash.update(ptr, size);
+	m_size += size;
+	m_os.write(ptr, size);
+
+	const char* end = ptr + size;
+	while(ptr != end)
+	{
+		const char* newline = static_cast<const char*>(memchr(ptr, '\n', end - ptr));
+		if(newline == NULL)
+		{
+			m_partialLine.append(ptr, end);
+			break;
+		}
+		++newline;
+		if(m_partialLine.empty())
+		{
+			addLine_i(llvm::StringRef(ptr, newline - ptr));
+		}
+		else
+		{
+			m_partialLine.append(ptr, newline);
+			addLine_i(m_partialLine);
+			m_partialLine.clear();
+		}
+		ptr = newline;
+	}
+}
+
+void Havok::DatabaseIndexer::addLine_i(llvm::StringRef line)
+{
+	const uint64_t offset = m_lineOffset;
+	m_lineOffset += line.size();
+
+	// annotation texts are """ strings which can span several lines
+	const bool inString = m_inString;
+	for( size_t quotes = line.find("\"\"\""); quotes != llvm::StringRef::npos; quotes = line.find("\"\"\"", quotes + 3) )
+	{
+		m_inString = !m_inString;
+	}
+	if(inString)
+	{
+		if(m_lastLineIndexed)
+		{
+			m_entries.back().m_length += uint32_t(line.size());
+		}
+		return;
+	}
+
+	m_lastLineIndexed = false;
+	const llvm::StringRef text = line.endswith("\n") ? line.drop_back() : line;
+	const size_t open = text.find("( ");
+	if(open == llvm::StringRef::npos || text.startswith("#"))
+	{
+		m_variantsOffset = -1;
+		return;
+	}
+	const llvm::StringRef entityName = text.substr(0, open);
+	if(entityName == "InVariants")
+	{
+		m_variantsOffset = int64_t(offset);
+		return;
+	}
+
+	Entry entry;
+	entry.m_offset = m_variantsOffset >= 0 ? uint64_t(m_variantsOffset) : offset;
+	entry.m_length = uint32_t(offset + line.size() - entry.m_offset);
+	entry.m_id = -1;
+	entry.m_parentId = -1;
+	entry.m_isChild = false;
+	entry.m_isFile = (entityName == "File");
+	m_variantsOffset = -1;
+
+	const char* parentKey = s_getParentKey(entityName);
+	int scopeId = -1;
+	llvm::StringRef key, value;
+	for( size_t pos = open + 2; s_nextKeyValue(text, pos, key, value); )
+	{
+		int number;
+		if(key == "id" && entityName != "Inherit")
+		{
+			if(!value.getAsInteger(10, number))
+			{
+				entry.m_id = number;
+			}
+		}
+		else if(parentKey != NULL && key == parentKey)
+		{
+			if(!value.getAsInteger(10, number))
+			{
+				entry.m_parentId = number;
+				entry.m_isChild = true;
+			}
+		}
+		else if(key == "scopeid")
+		{
+			if(!value.getAsInteger(10, number))
+			{
+				scopeId = number;
+			}
+		}
+		else if(key == "name" && value.size() >= 2 && value[0] == '\'')
+		{
+			unescape(value.substr(1, value.size() - 2), entry.m_name);
+		}
+	}
+	if(!entry.m_isChild)
+	{
+		entry.m_parentId = scopeId;
+	}
+	if(entry.m_id < 0 && !entry.m_isChild)
+	{
+		// invocation and variant entries
+		return;
+	}
+	m_entries.push_back(entry);
+	m_lastLineIndexed = true;
+}
+
+struct Havok::DatabaseIndexer::EntityIdLess
+{
+	const std::vector<Entry>* m_entries;
+	bool operator()(unsigned a, unsigned b) const { return (*m_entries)[a].m_id < (*m_entries)[b].m_id; }
+	bool operator()(unsigned a, int id) const { return (*m_entries)[a].m_id < id; }
+};
+
+int Havok::DatabaseIndexer::findEntity_i(const std::vector<unsigned>& entities, int id) const
+{
+	EntityIdLess less = { &m_entries };
+	std::vector<unsigned>::const_iterator it = std::lower_bound(entities.begin(), entities.end(), id, less);
+	if(it == entities.end() || m_entries[*it].m_id != id)
+	{
+		return -1;
+	}
+	return int(it - entities.begin());
+}
+
+bool Havok::DatabaseIndexer::getQualifiedName_i(const std::vector<unsigned>& entities, unsigned entity, std::string& nameOut) const
+{
+	nameOut = m_entries[entities[entity]].m_name;
+	int parentId = m_entries[entities[entity]].m_parentId;
+	// scopes are dumped before what they contain, the depth limit only guards against bad input
+	for( int depth = 0; parentId >= 0 && depth < 256; ++depth )
+	{
+		const int parent = findEntity_i(entities, parentId);
+		if(parent < 0)
+		{
+			return true;
+		}
+		const Entry& scope = m_entries[entities[parent]];
+		if(scope.m_isFile)
+		{
+			return true;
+		}
+		if(scope.m_name.empty())
+		{
+			// anonymous namespaces and template specializations
+			return false;
+		}
+		nameOut = scope.m_name + "::" + nameOut;
+		parentId = scope.m_parentId;
+	}
+	return parentId < 0;
+}
+
+void Havok::DatabaseIndexer::writeIndex(llvm::raw_ostream& os)
+{
+	flush();
+	if(!m_partialLine.empty())
+	{
+		// no end of line at the end of the database
+		addLine_i(m_partialLine);
+		m_partialLine.clear();
+	}
+
+	// entities by id, several entries can define the same id in merged databases
+	std::vector<unsigned> entities;
+	for( unsigned i = 0; i < m_entries.size(); ++i )
+	{
+		if(m_entries[i].m_id >= 0)
+		{
+			entities.push_back(i);
+		}
+	}
+	EntityIdLess less = { &m_entries };
+	std::stable_sort(entities.begin(), entities.end(), less);
+
+	// children grouped by entity, in database order
+	std::vector<std::pair<unsigned, unsigned> > children;
+	for( unsigned i = 0; i < m_entries.size(); ++i )
+	{
+		if(m_entries[i].m_isChild)
+		{
+			const int parent = findEntity_i(entities, m_entries[i].m_parentId);
+			if(parent >= 0)
+			{
+				children.push_back(std::make_pair(unsigned(parent), i));
+			}
+		}
+	}
+	std::stable_sort(children.begin(), children.end());
+	std::vector<unsigned> firstChild(entities.size(), 0);
+	std::vector<unsigned> numChildren(entities.size(), 0);
+	for( unsigned i = children.size(); i-- != 0; )
+	{
+		firstChild[children[i].first] = i;
+		++numChildren[children[i].first];
+	}
+
+	std::vector<std::pair<std::string, unsigned> > names;
+	std::string qualifiedName;
+	for( unsigned i = 0; i < entities.size(); ++i )
+	{
+		if(!m_entries[entities[i]].m_name.empty() && getQualifiedName_i(entities, i, qualifiedName))
+		{
+			names.push_back(std::make_pair(qualifiedName, i));
+		}
+	}
+	std::sort(names.begin(), names.end());
+
+	uint32_t stringSize = 0;
+	for( unsigned i = 0; i < names.size(); ++i )
+	{
+		stringSize += uint32_t(names[i].first.size());
+	}
+
+	os.write(s_indexMagic, 8);
+	s_write64(os, m_size);
+	s_write64(os, m_hash.get());
+	s_write32(os, uint32_t(entities.size()));
+	s_write32(os, uint32_t(names.size()));
+	s_write32(os, uint32_t(children.size()));
+	s_write32(os, stringSize);
+	for( unsigned i = 0; i < entities.size(); ++i )
+	{
+		const Entry& entry = m_entries[entities[i]];
+		s_write64(os, entry.m_offset);
+		s_write32(os, entry.m_length);
+		s_write32(os, uint32_t(entry.m_id));
+		s_write32(os, firstChild[i]);
+		s_write32(os, numChildren[i]);
+	}
+	uint32_t stringOffset = 0;
+	for( unsigned i = 0; i < names.size(); ++i )
+	{
+		s_write32(os, stringOffset);
+		s_write32(os, uint32_t(names[i].first.size()));
+		s_write32(os, names[i].second);
+		stringOffset += uint32_t(names[i].first.size());
+	}
+	for( unsigned i = 0; i < children.size(); ++i )
+	{
+		const Entry& entry = m_entries[children[i].second];
+		s_write64(os, entry.m_offset);
+		s_write32(os, entry.m_length);
+		s_write32(os, uint32_t(entry.m_id));
+	}
+	for( unsigned i = 0; i < names.size(); ++i )
+	{
+		os << names[i].first;
+	}
+}
+
+Havok::DatabaseIndex::DatabaseIndex()
+	: m_databaseSize(0), m_databaseHash(0), m_numEntities(0), m_numNames(0), m_numChildren(0),
+	m_entities(NULL), m_names(NULL), m_children(NULL), m_strings(NULL), m_stringSize(0)
+{
+}
+
+bool Havok::DatabaseIndex::load(llvm::StringRef data)
+{
+	if(data.size() < s_indexHeaderSize || !data.startswith(llvm::StringRef(s_indexMagic, 8)))
+	{
+		return false;
+	}
+	const char* header = data.data() + 8;
+	const uint64_t numEntities = s_read32(header + 16);
+	const uint64_t numNames = s_read32(header + 20);
+	const uint64_t numChildren = s_read32(header + 24);
+	const uint64_t stringSize = s_read32(header + 28);
+	if(data.size() != s_indexHeaderSize + numEntities * s_indexEntitySize + numNames * s_indexNameSize + numChildren * s_indexChildSize + stringSize)
+	{
+		return false;
+	}
+	m_databaseSize = s_read64(header);
+	m_databaseHash = s_read64(header + 8);
+	m_numEntities = unsigned(numEntities);
+	m_numNames = unsigned(numNames);
+	m_numChildren = unsigned(numChildren);
+	m_stringSize = unsigned(stringSize);
+	m_entities = data.data() + s_indexHeaderSize;
+	m_names = m_entities + numEntities * s_indexEntitySize;
+	m_children = m_names + numNames * s_indexNameSize;
+	m_strings = m_children + numChildren * s_indexChildSize;
+	return true;
+}
+
+bool Havok::DatabaseIndex::matches(llvm::StringRef database) const
+{
+	if(database.size() != m_databaseSize)
+	{
+		return false;
+	}
+	Fnv64 hash;
+	hash.update(database.data(), database.size());
+	return hash.get() == m_databaseHash;
+}
+
+int Havok::DatabaseIndex::findEntity_i(int id) const
+{
+	unsigned begin = 0;
+	unsigned end = m_numEntities;
+	while(begin < end)
+	{
+		const unsigned middle = begin + (end - begin) / 2;
+		if(int(s_read32(m_entities + middle * s_indexEntitySize + 12)) < id)
+		{
+			begin = middle + 1;
+		}
+		else
+		{
+			end = middle;
+		}
+	}
+	if(begin == m_numEntities || int(s_read32(m_entities + begin * s_indexEntitySize + 12)) != id)
+	{
+		return -1;
+	}
+	return int(begin);
+}
+
+Havok::DatabaseIndex::Range Havok::DatabaseIndex::getEntityRange_i(unsigned entity) const
+{
+	const char* record = m_entities + entity * s_indexEntitySize;
+	Range range;
+	range.m_offset = s_read64(record);
+	range.m_length = s_read32(record + 8);
+	range.m_id = int(s_read32(record + 12));
+	return range;
+}
+
+bool Havok::DatabaseIndex::findId(int id, Range& rangeOut) const
+{
+	const int entity = findEntity_i(id);
+	if(entity < 0)
+	{
+		return false;
+	}
+	rangeOut = getEntityRange_i(unsigned(entity));
+	return true;
+}
+
+void Havok::DatabaseIndex::findName(llvm::StringRef qualifiedName, std::vector<Range>& rangesOut) const
+{
+	rangesOut.clear();
+	unsigned begin = 0;
+	unsigned end = m_numNames;
+	while(begin < end)
+	{
+		const unsigned middle = begin + (end - begin) / 2;
+		const char* record = m_names + middle * s_indexNameSize;
+		if(llvm::StringRef(m_strings + s_read32(record), s_read32(record + 4)) < qualifiedName)
+		{
+			begin = middle + 1;
+		}
+		else
+		{
+			end = middle;
+		}
+	}
+	for( ; begin < m_numNames; ++begin )
+	{
+		const char* record = m_names + begin * s_indexNameSize;
+		if(llvm::StringRef(m_strings + s_read32(record), s_read32(record + 4)) != qualifiedName)
+		{
+			break;
+		}
+		rangesOut.push_back(getEntityRange_i(s_read32(record + 8)));
+	}
+}
+
+void Havok::DatabaseIndex::getChildren(int id, std::vector<Range>& rangesOut) const
+{
+	rangesOut.clear();
+	const int entity = findEntity_i(id);
+	if(entity < 0)
+	{
+		return;
+	}
+	const char* record = m_entities + entity * s_indexEntitySize;
+	const unsigned firstChild = s_read32(record + 16);
+	const unsigned numChildren = s_read32(record + 20);
+	for( unsigned i = firstChild; i < firstChild + numChildren && i < m_numChildren; ++i )
+	{
+		const char* child = m_children + i * s_indexChildSize;
+		Range range;
+		range.m_offset = s_read64(child);
+		range.m_length = s_read32(child + 8);
+		range.m_id = int(s_read32(child + 12));
+		rangesOut.push_back(range);
+	}
+}
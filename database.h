@@ -0,0 +1,205 @@
+// Copyright (c) 2012 Havok. All rights reserved. This file is distributed under the terms
+// and conditions defined in file 'LICENSE.txt', which is part of this source code package.
+
+#ifndef DATABASE_H
+#define DATABASE_H
+
+#pragma warning(push,0)
+	#include "llvm/ADT/DenseMap.h"
+	#include "llvm/ADT/StringMap.h"
+	#include "llvm/ADT/StringRef.h"
+	#include "llvm/Support/raw_ostream.h"
+#pragma warning(pop)
+
+#include <string>
+#include <vector>
+#include "hash.h"
+
+namespace Havok
+{
+	/// Merges the text databases extracted for several variants (target triples, defines) of the
+	/// same sources. Entities are matched by a stable key which does not depend on the ids: the
+	/// kind, name and scope of the named entities (methods also have their type, files their
+	/// location), the kind and components of the unnamed types, with their arguments for template
+	/// instantiations and specializations. The ids, numbered independently in each database, are
+	/// remapped through this match before the lines are compared. Lines present in all the variants
+	/// are written once, the others are preceded by an InVariants( mask=N ) line, bit i of the mask
+	/// being set if the line is in the i-th database. An entity which differs between variants, a
+	/// record with another size for example, keeps its id and has a line for each of its versions.
+	/// The databases extracted from parts of the inputs of a single configuration are merged the
+	/// same way, without the InVariants lines. An entity then has a single line, the most complete
+	/// one: a record defined in one part and only declared in another is a single defined record.
+	class DatabaseMerger
+	{
+		public:
+
+			enum
+			{
+				MAX_DATABASES = 32
+			};
+
+			enum Mode
+			{
+				MERGE_VARIANTS,
+				MERGE_PARTS
+			};
+
+			explicit DatabaseMerger(Mode mode = MERGE_VARIANTS);
+
+			// Add the database of the next variant or part
+			void addDatabase(llvm::StringRef text);
+
+			int getNumDatabases() const { return m_numDatabases; }
+
+			// Write the merged database
+			void write(llvm::raw_ostream& os) const;
+
+		protected:
+
+			struct Line
+			{
+				// Text of the line, with the merged ids
+				std::string m_text;
+				// Databases containing this line
+				unsigned m_mask;
+				// Entries attached to the entity and values of the line, in the database the line
+				// comes from (MERGE_PARTS keeps the most complete line of an entity)
+				unsigned m_numChildren;
+				unsigned m_numValues;
+			};
+
+			typedef llvm::DenseMap<int, int> IdMap;
+
+			// Remap the ids of a line
+			void remapLine_i(llvm::StringRef line, IdMap& idMap, std::string& remapped);
+			// Get the merged id of a local id referenced by the current database
+			int getMergedId_i(int localId, IdMap& idMap);
+
+			std::vector<Line> m_lines;
+			// Maps the remapped text of a line without an id (and its occurrence index within its database) to its index in m_lines
+			llvm::StringMap<unsigned> m_lineIndices;
+			// Maps the stable key of an entity (and its occurrence index within its database) to its merged id
+			llvm::DenseMap<uint64_t, int> m_entityIds;
+			// Indices in m_lines of the versions of each entity
+			llvm::DenseMap<int, std::vector<unsigned> > m_entityLines;
+			Mode m_mode;
+			int m_numDatabases;
+			int m_nextId;
+	};
+
+	/// Random access index of a text database, built while the database is written through this
+	/// stream. The index maps the id of each entity, and the qualified name of the named ones, to
+	/// the byte range of its entry, and lists the entries attached to each entity: fields, methods,
+	/// enum constants, template parameters and arguments, bases and annotations.
+	///
+	/// The index is little endian:
+	///   header:   "CXINDEX1", u64 database size, u64 database FNV-1a hash,
+	///             u32 entity count, u32 name count, u32 child count, u32 string size
+	///   entities: u64 offset, u32 length, i32 id, u32 first child, u32 child count, sorted by id
+	///   names:    u32 string offset, u32 string length, u32 entity index, sorted by name
+	///   children: u64 offset, u32 length, i32 id (-1 if the entry has none), in database order
+	///   strings:  the qualified names
+	/// Ranges include the end of line, and the InVariants line preceding the entry if any.
+	class DatabaseIndexer : public llvm::raw_ostream
+	{
+		public:
+
+			DatabaseIndexer(llvm::raw_ostream& os);
+			~DatabaseIndexer();
+
+			// Write the index of the database, once it is complete
+			void writeIndex(llvm::raw_ostream& os);
+
+		protected:
+
+			struct Entry
+			{
+				uint64_t m_offset;
+				uint32_t m_length;
+				// Id defined by the entry, or -1
+				int m_id;
+				// Entity the entry is attached to (isChild) or scope of the entity, or -1
+				int m_parentId;
+				bool m_isChild;
+				// File scopes end the qualified names
+				bool m_isFile;
+				std::string m_name;
+			};
+
+			// Orders the positions of the entries by the ids they define
+			struct EntityIdLess;
+
+			virtual void write_impl(const char* ptr, size_t size);
+			virtual uint64_t current_pos() const { return m_size; }
+
+			// Index a complete line, including its end of line
+			void addLine_i(llvm::StringRef line);
+			// Qualified name of an entity, false if a scope has no name
+			bool getQualifiedName_i(const std::vector<unsigned>& entities, unsigned entity, std::string& nameOut) const;
+			// Position in entities (sorted by id) of the first entity with this id, or -1
+			int findEntity_i(const std::vector<unsigned>& entities, int id) const;
+
+			llvm::raw_ostream& m_os;
+			uint64_t m_size;
+			Fnv64 m_hash;
+			std::vector<Entry> m_entries;
+			// Line split between two writes
+			std::string m_partialLine;
+			uint64_t m_lineOffset;
+			// Offset of the InVariants line preceding the next entry, or -1
+			int64_t m_variantsOffset;
+			// Inside a """ string spanning several lines of the last entry
+			bool m_inString;
+			bool m_lastLineIndexed;
+
+		private:
+			DatabaseIndexer(const DatabaseIndexer&);
+			DatabaseIndexer& operator=(const DatabaseIndexer&);
+	};
+
+	/// Lookups in an index written by DatabaseIndexer, usually mapped in memory with its database
+	class DatabaseIndex
+	{
+		public:
+
+			struct Range
+			{
+				uint64_t m_offset;
+				uint32_t m_length;
+				int m_id;
+			};
+
+			DatabaseIndex();
+
+			// The data is used in place and must outlive the index. Returns false if it is not an index.
+			bool load(llvm::StringRef data);
+			// True if the index was built from this database
+			bool matches(llvm::StringRef database) const;
+
+			// Returns false if there is no entity with this id
+			bool findId(int id, Range& rangeOut) const;
+			// Entities with this qualified name (methods can be overloaded)
+			void findName(llvm::StringRef qualifiedName, std::vector<Range>& rangesOut) const;
+			// Entries attached to an entity
+			void getChildren(int id, std::vector<Range>& rangesOut) const;
+
+		protected:
+
+			// Position of the first entity with this id, or -1
+			int findEntity_i(int id) const;
+			Range getEntityRange_i(unsigned entity) const;
+
+			uint64_t m_databaseSize;
+			uint64_t m_databaseHash;
+			unsigned m_numEntities;
+			unsigned m_numNames;
+			unsigned m_numChildren;
+			const char* m_entities;
+			const char* m_names;
+			const char* m_children;
+			const char* m_strings;
+			unsigned m_stringSize;
+	};
+}
+
+#endif //DATABASE_H
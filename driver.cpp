@@ -0,0 +1,1407 @@
+// Copyright (c) 2012 Havok. All rights reserved. This file is distributed under the terms
+// and conditions defined in file 'LICENSE.txt', which is part of this source code package.
+
+#include "clangextract.h"
+
+#pragma warning(push,0)
+	#include <llvm/ADT/OwningPtr.h>
+	#include <llvm/ADT/SmallString.h>
+	#include <llvm/ADT/SmallPtrSet.h>
+	#include <llvm/ADT/StringMap.h>
+	#include <llvm/Support/Host.h>
+	#include <llvm/Support/FileSystem.h>
+	#include <llvm/Support/MemoryBuffer.h>
+	#include <llvm/Support/Path.h>
+	#include <llvm/Support/PathV2.h>
+
+	#include <clang/Frontend/Utils.h>
+	#include <clang/Frontend/DiagnosticOptions.h>
+	#include <clang/Frontend/FrontendDiagnostic.h>
+	#include <clang/Frontend/TextDiagnosticPrinter.h>
+	#include <clang/Lex/Preprocessor.h>
+	#include <clang/Parse/ParseAST.h>
+	#include <clang/Basic/TargetInfo.h>
+	#include <clang/Basic/FileManager.h>
+	#include <clang/Lex/HeaderSearch.h>
+	#include <clang/Sema/SemaDiagnostic.h>
+	#include <clang/Serialization/ASTWriter.h>
+#pragma warning(pop)
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <set>
+#include "extract.h"
+#include "entities.h"
+#include "database.h"
+#include "escape.h"
+#include "headerreport.h"
+#include "modules.h"
+#include "perfcounters.h"
+#include "threads.h"
+#include "workers.h"
+
+#ifdef _WIN32
+#include <Shlwapi.h>
+static inline bool s_fileNameMatch(const char* path, const char* pattern)
+{
+	char path_s[MAX_PATH]; // local storage, extractions may run concurrently
+	strncpy(path_s, path, MAX_PATH - 1);
+	path_s[MAX_PATH - 1] = '\0';
+	PathStripPath(path_s);
+	return (PathMatchSpec(path_s, pattern) == TRUE);
+}
+#undef GetCurrentDirectory // remove annoying define from windows header
+#else
+#include <fnmatch.h>
+#include <signal.h>
+#include <sys/stat.h>
+#include <unistd.h>
+static inline bool s_fileNameMatch(const char* path, const char* pattern)
+{
+	const char* base = basename( const_cast<char*>(path) );
+	return (fnmatch(pattern, base, 0) == 0);
+}
+#endif
+
+// Included by the master file of a fork server instead of the inputs, see ForkPoint
+static const char* const s_forkInputsFileName = "/clang-extract-fork-inputs";
+
+namespace Havok
+{
+	// Contents of the files read while parsing, shared between the extractions running
+	// concurrently so that each file is only read once. Each extraction has its own
+	// FileManager (it is not thread safe), the cached contents are installed in their
+	// SourceManager when a file is included.
+	class FileContentCache
+	{
+		public:
+
+			FileContentCache()
+			{}
+
+			~FileContentCache()
+			{
+				for( llvm::StringMap<llvm::MemoryBuffer*>::iterator it = m_buffers.begin(), end = m_buffers.end(); it != end; ++it )
+				{
+					delete it->second;
+				}
+			}
+
+			// Returns the contents of the file, or NULL if it cannot be read
+			const llvm::MemoryBuffer* getFile(const clang::FileEntry* file)
+			{
+				ScopedLock lock(m_mutex);
+				llvm::StringMap<llvm::MemoryBuffer*>::iterator it = m_buffers.find(file->getName());
+				if(it != m_buffers.end())
+				{
+					return it->second;
+				}
+				llvm::OwningPtr<llvm::MemoryBuffer> buffer;
+				llvm::MemoryBuffer::getFile(file->getName(), buffer, file->getSize());
+				return m_buffers[file->getName()] = buffer.take();
+			}
+
+		protected:
+
+			llvm::StringMap<llvm::MemoryBuffer*> m_buffers;
+			Mutex m_mutex;
+
+		private:
+			FileContentCache(const FileContentCache&);
+			FileContentCache& operator=(const FileContentCache&);
+	};
+
+	// Preprocessor callbacks used to exclude specific included files (with #include)
+	// When the preprocessor processes a file, it will generate callbacks to this object
+	// on various events, when an inclusion directive is detected we will simply look
+	// it up in our set of excluded inclusion, and if something matches we will basically
+	// override that with an empty buffer.
+	class FilenamePatternExcluder : public clang::PPCallbacks
+	{
+		public:
+
+			FilenamePatternExcluder(clang::Preprocessor& preprocessor, clang::SourceManager& sourceManager, FileContentCache* contentCache)
+				: PPCallbacks(), m_preprocessor(preprocessor), m_sourceManager(sourceManager), m_contentCache(contentCache), m_moduleLoader(0)
+			{}
+
+			~FilenamePatternExcluder()
+			{}
+
+			void addExcludedPattern(const std::string& str)
+			{
+				m_excludedPatterns.push_back(str);
+			}
+
+			// Files replaced by an empty buffer, either here or by the preprocessor options
+			void addExcludedFile(const FileEntry* file)
+			{
+				m_excludedFiles.insert(file);
+			}
+
+			bool isExcluded(const FileEntry* file) const
+			{
+				return m_excludedFiles.count(file) != 0;
+			}
+
+			// Headers covered by the module map of the loader are replaced by module imports,
+			// except the ones of the module being built
+			void setModuleLoader(ModuleLoader* moduleLoader, const std::string& builtModuleName)
+			{
+				m_moduleLoader = moduleLoader;
+				m_builtModuleName = builtModuleName;
+			}
+
+			virtual void InclusionDirective(
+				SourceLocation,
+				const Token&,
+				StringRef fileName,
+				bool,
+				const FileEntry* file,
+				SourceLocation,
+				StringRef,
+				StringRef )
+			{
+				m_preprocessor.SetSuppressIncludeNotFoundError(false);
+				for(unsigned int i = 0; i < m_excludedPatterns.size(); ++i)
+				{
+					if(s_fileNameMatch(fileName.str().c_str(), m_excludedPatterns[i].c_str()))
+					{
+						if(file)
+						{
+							// file was found
+							m_sourceManager.overrideFileContents(file, llvm::MemoryBuffer::getNewMemBuffer(0), false);
+							m_overriddenFiles.insert(file);
+							m_excludedFiles.insert(file);
+						}
+						else
+						{
+							// file was not found (but as it matches one of the excluded patterns we ignore it anyway)
+							m_preprocessor.SetSuppressIncludeNotFoundError(true);
+						}
+						return;
+					}
+				}
+				if(file && m_moduleLoader && !m_overriddenFiles.count(file))
+				{
+					const ModuleMap::Module* module = m_moduleLoader->findModuleForFile(file);
+					if(module && module->m_name != m_builtModuleName)
+					{
+						// the first header of a module imports it, the other ones are empty
+						m_overriddenFiles.insert(file);
+						std::string importText;
+						if(m_importedModules.insert(module))
+						{
+							importText = ModuleLoader::getImportText(*module);
+						}
+						m_sourceManager.overrideFileContents(file, llvm::MemoryBuffer::getMemBufferCopy(importText, file->getName()), false);
+						return;
+					}
+				}
+				if(file && m_contentCache && m_overriddenFiles.insert(file))
+				{
+					// use the shared contents, the buffer installed here does not own its data
+					if(const llvm::MemoryBuffer* contents = m_contentCache->getFile(file))
+					{
+						m_sourceManager.overrideFileContents(file, llvm::MemoryBuffer::getMemBuffer(contents->getBuffer(), contents->getBufferIdentifier()), false);
+					}
+				}
+			}
+
+		protected:
+
+			// Included file patterns that will be skipped, these string should contain
+			// OS-style wildcards to exclude sets of files based on their name.
+			std::vector<std::string> m_excludedPatterns;
+
+			// Files whose contents were already replaced
+			llvm::SmallPtrSet<const FileEntry*, 64> m_overriddenFiles;
+
+			// Files replaced by an empty buffer
+			llvm::SmallPtrSet<const FileEntry*, 16> m_excludedFiles;
+
+			// Source manager used to exclude all the specified inclusions.
+			clang::SourceManager& m_sourceManager;
+
+			// Preprocessor used during parsing of the source
+			clang::Preprocessor& m_preprocessor;
+
+			// Contents shared with the other extractions (optional)
+			FileContentCache* m_contentCache;
+
+			// Loader of the modules replacing the headers of the module map (optional)
+			ModuleLoader* m_moduleLoader;
+			std::string m_builtModuleName;
+			llvm::SmallPtrSet<const ModuleMap::Module*, 16> m_importedModules;
+
+		private:
+			FilenamePatternExcluder& operator=(const FilenamePatternExcluder& other);
+	};
+
+	// Preprocessor callbacks collecting the files entered by the preprocessor, used to write
+	// a dependency file. Files excluded with an empty buffer are not dependencies.
+	class DependencyCollector : public clang::PPCallbacks
+	{
+		public:
+
+			DependencyCollector(clang::SourceManager& sourceManager, const FilenamePatternExcluder& excluder)
+				: PPCallbacks(), m_sourceManager(sourceManager), m_excluder(excluder)
+			{}
+
+			virtual void FileChanged(SourceLocation loc, FileChangeReason reason, SrcMgr::CharacteristicKind, FileID)
+			{
+				if(reason != EnterFile)
+				{
+					return;
+				}
+				// the main file is a memory buffer and has no file entry
+				if(const FileEntry* file = m_sourceManager.getFileEntryForID(m_sourceManager.getFileID(m_sourceManager.getExpansionLoc(loc))))
+				{
+					m_files.insert(file);
+				}
+			}
+
+			void getDependencies(std::vector<const FileEntry*>& dependenciesOut) const
+			{
+				for( llvm::SmallPtrSet<const FileEntry*, 256>::const_iterator it = m_files.begin(), end = m_files.end(); it != end; ++it )
+				{
+					if(!m_excluder.isExcluded(*it))
+					{
+						dependenciesOut.push_back(*it);
+					}
+				}
+			}
+
+			void getDependencies(std::set<std::string>& dependenciesOut) const
+			{
+				std::vector<const FileEntry*> files;
+				getDependencies(files);
+				for( std::vector<const FileEntry*>::const_iterator it = files.begin(), end = files.end(); it != end; ++it )
+				{
+					dependenciesOut.insert((*it)->getName());
+				}
+			}
+
+		protected:
+
+			clang::SourceManager& m_sourceManager;
+			const FilenamePatternExcluder& m_excluder;
+			llvm::SmallPtrSet<const FileEntry*, 256> m_files;
+
+		private:
+			DependencyCollector& operator=(const DependencyCollector& other);
+	};
+
+	// Process parsing the prelude of the extractions once (target, defines, include paths, forced
+	// includes and exclusions) and forking a child for each part sent to its address, see
+	// runForkServer(). serve() is called when the parse of the prelude reaches the inputs with the
+	// files read by the prelude, it returns true in the children and false in the server when it
+	// cannot go on. The parts are refused once one of the files read by the prelude has changed.
+	class ForkServer
+	{
+		public:
+
+			ForkServer(const ExtractionSetup& setup, const std::string& address, const std::string& secret, llvm::raw_ostream& logStream);
+
+			bool listen(std::string& errorOut)
+			{
+				return m_listener.listen(m_address, errorOut);
+			}
+
+			bool serve(bool preludeHasErrors, const std::vector<const FileEntry*>& preludeFiles);
+
+			const ExtractionSetup& getPrelude() const { return m_prelude; }
+			bool isChild() const { return m_isChild; }
+			// Part extracted by a child, and the connection of the coordinator which sent it
+			const ExtractionSetup& getPart() const { return m_part; }
+			Connection& getConnection() { return m_connection; }
+
+		protected:
+
+			// File read by the prelude, as it was when it was read
+			struct PreludeFile
+			{
+				std::string m_name;
+				time_t m_modificationTime;
+				long long m_size;
+			};
+
+			// Returns false and sets changedFileOut when a file read by the prelude changed on disk
+			bool checkPreludeFiles_i(std::string& changedFileOut) const;
+
+			ExtractionSetup m_prelude;
+			// Serialized prelude, the parts must have the same one
+			std::string m_preludeKey;
+			std::vector<PreludeFile> m_preludeFiles;
+			std::string m_address;
+			std::string m_secret;
+			llvm::raw_ostream& m_logStream;
+			Listener m_listener;
+			bool m_isChild;
+			ExtractionSetup m_part;
+			Connection m_connection;
+
+		private:
+			ForkServer(const ForkServer&);
+			ForkServer& operator=(const ForkServer&);
+	};
+
+	// Preprocessor callbacks running the fork server when the master file includes the inputs
+	// file. The file is empty in the server, each child replaces it with the inclusion of the
+	// inputs of its part before the preprocessor enters it, and carries on with the parse.
+	class ForkPoint : public clang::PPCallbacks
+	{
+		public:
+
+			ForkPoint(clang::Preprocessor& preprocessor, clang::SourceManager& sourceManager, ForkServer& server, const FileEntry* inputsFile, const DependencyCollector& dependencyCollector)
+				: PPCallbacks(), m_preprocessor(preprocessor), m_sourceManager(sourceManager), m_server(server), m_inputsFile(inputsFile), m_dependencyCollector(dependencyCollector)
+			{}
+
+			virtual void InclusionDirective(
+				SourceLocation,
+				const Token&,
+				StringRef,
+				bool,
+				const FileEntry* file,
+				SourceLocation,
+				StringRef,
+				StringRef )
+			{
+				if(file == NULL || file != m_inputsFile)
+				{
+					return;
+				}
+				std::vector<const FileEntry*> preludeFiles;
+				m_dependencyCollector.getDependencies(preludeFiles);
+				if(!m_server.serve(m_preprocessor.getDiagnostics().hasErrorOccurred(), preludeFiles))
+				{
+					return;
+				}
+				std::string inputsText;
+				const std::vector<std::string>& inputs = m_server.getPart().m_inputFilenames;
+				for( std::vector<std::string>::const_iterator iter = inputs.begin(), end = inputs.end(); iter != end; ++iter )
+				{
+					inputsText += "#include<" + *iter + ">\n";
+				}
+				m_sourceManager.overrideFileContents(file, llvm::MemoryBuffer::getMemBufferCopy(inputsText, file->getName()), false);
+			}
+
+		protected:
+
+			clang::Preprocessor& m_preprocessor;
+			clang::SourceManager& m_sourceManager;
+			ForkServer& m_server;
+			const FileEntry* m_inputsFile;
+			const DependencyCollector& m_dependencyCollector;
+
+		private:
+			ForkPoint& operator=(const ForkPoint& other);
+	};
+}
+
+// Split a NAME=VALUE option
+static void s_splitDefinition(const std::string& definition, std::string& name, std::string& value)
+{
+	std::string::size_type index = definition.find_first_of('=');
+	if(index != std::string::npos)
+	{
+		name = definition.substr(0, index);
+		value = definition.substr(index+1, std::string::npos);
+	}
+	else
+	{
+		name = definition;
+		value.clear();
+	}
+}
+
+static int s_runExtraction(const Havok::ExtractionSetup& setup, llvm::raw_ostream& outstream, llvm::raw_ostream& diagnosticStream,
+	Havok::EntityTables* tables, Havok::FileContentCache* contentCache, std::set<std::string>* dependencies,
+	Havok::HeaderReport* headerReport, Havok::PerfCounters* perfCounters, Havok::ForkServer* forkServer);
+static std::string s_serializeSetup(const Havok::ExtractionSetup& setup);
+static Havok::ExtractionSetup s_getPrelude(const Havok::ExtractionSetup& setup);
+
+// Invocation entries at the beginning of the database of a setup
+static void s_writeInvocation(const Havok::ExtractionSetup& setup, llvm::raw_ostream& outstream)
+{
+	// Print the LLVMClangParser working directory
+	{
+		llvm::sys::Path cwd = llvm::sys::Path::GetCurrentDirectory();
+		outstream << "InvocationWorkingDirectory( path='" << Havok::escaped(cwd.str()) << "' )\n";
+	}
+
+	// -triple
+	if(!setup.m_triple.empty())
+	{
+		outstream << "InvocationTriple( triple='" << Havok::escaped(setup.m_triple) << "' )\n";
+	}
+
+	// -D
+	for( std::vector<std::string>::const_iterator iter = setup.m_defines.begin(), end = setup.m_defines.end(); iter != end; ++iter )
+	{
+		std::string macro, value;
+		s_splitDefinition(*iter, macro, value);
+		outstream << "InvocationDefine( name='" << Havok::escaped(macro) << "', value='" << Havok::escaped(value) << "' )\n";
+	}
+
+	// -I
+	for( std::vector<std::string>::const_iterator iter = setup.m_includePaths.begin(), end = setup.m_includePaths.end(); iter != end; ++iter )
+	{
+		outstream << "InvocationIncludePath( path='" << Havok::escaped(*iter) << "' )\n";
+	}
+
+	// -A
+	for( std::vector<std::string>::const_iterator iter = setup.m_passAttributes.begin(), end = setup.m_passAttributes.end(); iter != end; ++iter )
+	{
+		std::string macro, value;
+		s_splitDefinition(*iter, macro, value);
+		outstream << "InvocationAttribute( name='" << Havok::escaped(macro) << "', value='" << Havok::escaped(value) << "' )\n";
+	}
+
+	for( std::vector<std::string>::const_iterator iter = setup.m_forceIncludes.begin(), end = setup.m_forceIncludes.end(); iter != end; ++iter )
+	{
+		outstream << "InvocationForceInclude( path='" << Havok::escaped(*iter) << "' )\n";
+	}
+	for( std::vector<std::string>::const_iterator iter = setup.m_inputFilenames.begin(), end = setup.m_inputFilenames.end(); iter != end; ++iter )
+	{
+		outstream << "InvocationInput( path='" << Havok::escaped(*iter) << "' )\n";
+	}
+
+	// -root
+	for( std::vector<std::string>::const_iterator iter = setup.m_roots.begin(), end = setup.m_roots.end(); iter != end; ++iter )
+	{
+		outstream << "InvocationRoot( name='" << Havok::escaped(*iter) << "' )\n";
+	}
+}
+
+// Dump options of a setup, they are only used once the parse is done
+static void s_configureConsumer(const Havok::ExtractionSetup& setup, Havok::ExtractASTConsumer& consumer)
+{
+	if(setup.m_dumpLayouts)
+	{
+		consumer.addDumpBits(Havok::ExtractASTConsumer::DUMP_LAYOUTS);
+	}
+	if(setup.m_compactInstantiations)
+	{
+		consumer.addDumpBits(Havok::ExtractASTConsumer::DUMP_COMPACT_INSTANTIATIONS);
+	}
+	if(setup.m_canonicalTypes)
+	{
+		consumer.addDumpBits(Havok::ExtractASTConsumer::DUMP_CANONICAL_TYPES);
+	}
+	if(setup.m_contentHashes)
+	{
+		consumer.addDumpBits(Havok::ExtractASTConsumer::DUMP_CONTENT_HASHES);
+	}
+	consumer.setInstantiationBudget(setup.m_instantiationBudget);
+	for( std::vector<std::string>::const_iterator iter = setup.m_roots.begin(), end = setup.m_roots.end(); iter != end; ++iter )
+	{
+		consumer.addRoot(*iter);
+	}
+}
+
+namespace
+{
+	// Builds the modules imported by an extraction, with the same configuration
+	class SetupModuleBuilder : public Havok::ModuleBuilder
+	{
+		public:
+
+			SetupModuleBuilder(const Havok::ExtractionSetup& setup, llvm::raw_ostream& diagnosticStream, Havok::FileContentCache* contentCache)
+				: m_setup(setup), m_diagnosticStream(diagnosticStream), m_contentCache(contentCache)
+			{}
+
+			virtual bool buildModule(const Havok::ModuleMap::Module& module, const std::string& outputFileName, std::set<std::string>& dependenciesOut)
+			{
+				if(std::find(m_setup.m_builtModules.begin(), m_setup.m_builtModules.end(), module.m_name) != m_setup.m_builtModules.end())
+				{
+					m_diagnosticStream << "error: cyclic import of module '" << module.m_name << "'\n";
+					return false;
+				}
+				Havok::ExtractionSetup moduleSetup = m_setup;
+				moduleSetup.m_inputFilenames = module.m_headers;
+				moduleSetup.m_roots.clear();
+				moduleSetup.m_moduleOutputFilename = outputFileName;
+				moduleSetup.m_builtModules.push_back(module.m_name);
+				return s_runExtraction(moduleSetup, llvm::nulls(), m_diagnosticStream, NULL, m_contentCache, &dependenciesOut, NULL, NULL, NULL) == 0;
+			}
+
+		protected:
+
+			const Havok::ExtractionSetup& m_setup;
+			llvm::raw_ostream& m_diagnosticStream;
+			Havok::FileContentCache* m_contentCache;
+
+		private:
+			SetupModuleBuilder& operator=(const SetupModuleBuilder&);
+	};
+}
+
+// Parse, then dump the database of a setup. Diagnostics are written to diagnosticStream, the
+// reflection tables are only filled if a writer is given, file contents are read through the
+// content cache if one is given, the files read are added to dependencies if given, the cost
+// of the files is added to the header report if given, the hardware counters of the phases
+// are collected if given. With a fork server, only the prelude of the setup is parsed before
+// forking, the children dump the part they receive (see ForkPoint).
+static int s_runExtraction(const Havok::ExtractionSetup& setup, llvm::raw_ostream& outstream, llvm::raw_ostream& diagnosticStream,
+	Havok::EntityTables* tables, Havok::FileContentCache* contentCache, std::set<std::string>* dependencies,
+	Havok::HeaderReport* headerReport, Havok::PerfCounters* perfCounters, Havok::ForkServer* forkServer)
+{
+	int exitStatus;
+
+	llvm::MemoryBuffer* emptyMemoryBuffer = llvm::MemoryBuffer::getNewMemBuffer(0, "emptyMemoryBuffer");
+	{
+		clang::TextDiagnosticPrinter diagnosticConsumer(diagnosticStream, clang::DiagnosticOptions(), false);
+		llvm::IntrusiveRefCntPtr<clang::DiagnosticIDs> diagnosticIDs(new clang::DiagnosticIDs());
+		clang::DiagnosticsEngine diagnostics(diagnosticIDs, &diagnosticConsumer, false);
+		// ignored warnings
+		diagnostics.setDiagnosticMapping(clang::diag::warn_undefined_internal, clang::diag::MAP_IGNORE, clang::SourceLocation()); //-Wno-undefined-internal
+
+		clang::TargetOptions targetOptions;
+		targetOptions.Triple = setup.m_triple.empty() ? llvm::sys::getHostTriple() : setup.m_triple;
+		llvm::IntrusiveRefCntPtr<clang::TargetInfo> targetInfo( clang::TargetInfo::CreateTargetInfo(diagnostics, targetOptions ) );
+		if(!targetInfo)
+		{
+			diagnosticStream << "error: unknown target triple '" << targetOptions.Triple << "'\n";
+			delete emptyMemoryBuffer;
+			return 1;
+		}
+		clang::FileSystemOptions filesystemOptions;
+		clang::FileManager fileManager(filesystemOptions);
+		clang::SourceManager sourceManager(diagnostics, fileManager);
+		clang::HeaderSearch headerSearch(fileManager);
+
+		// modules are shared by the translation units with the same target and predefined macros
+		// the modules depend on everything the prelude of a fork server does: the target (resolved,
+		// the host triple is not in the setup), defines, include paths, forced includes and exclusions
+		const std::string configurationKey = targetOptions.Triple + '\0' + s_serializeSetup(s_getPrelude(setup));
+		SetupModuleBuilder moduleBuilder(setup, diagnosticStream, contentCache);
+		Havok::ModuleLoader moduleLoader(setup.m_moduleMap, setup.m_moduleCachePath, configurationKey, &moduleBuilder);
+		clang::LangOptions langOptions;
+		langOptions.CPlusPlus = 1;
+		langOptions.CPlusPlus0x = 0;
+		langOptions.Bool = 1;
+		langOptions.ConstStrings = 1;
+		langOptions.AssumeSaneOperatorNew = 1;
+		langOptions.ImplicitInt = 0;
+		langOptions.ElideConstructors = 0;
+
+		clang::Preprocessor preprocessor(diagnostics, langOptions, targetInfo.getPtr(), sourceManager, headerSearch, moduleLoader);
+
+		Havok::FilenamePatternExcluder* filenamePatternExcluder = new Havok::FilenamePatternExcluder(preprocessor, sourceManager, contentCache);
+		preprocessor.addPPCallbacks(filenamePatternExcluder); // the preprocessor is now owner of the FilenamePatternExcluder
+		Havok::DependencyCollector* dependencyCollector = NULL;
+		if(dependencies)
+		{
+			dependencyCollector = new Havok::DependencyCollector(sourceManager, *filenamePatternExcluder);
+			preprocessor.addPPCallbacks(dependencyCollector); // the preprocessor is now owner of the DependencyCollector
+		}
+		if(headerReport)
+		{
+			preprocessor.addPPCallbacks(headerReport->createPPCallbacks(sourceManager)); // owned by the preprocessor
+		}
+		moduleLoader.setPreprocessor(preprocessor);
+		if(setup.m_moduleMap)
+		{
+			filenamePatternExcluder->setModuleLoader(&moduleLoader, setup.m_builtModules.empty() ? std::string() : setup.m_builtModules.back());
+		}
+		clang::PreprocessorOptions preprocessorOptions;
+		clang::HeaderSearchOptions headerSearchOptions;
+		clang::FrontendOptions frontendOptions;
+
+		{
+			// Gather input files into a memory
+			std::string mainFileText;
+			llvm::raw_string_ostream stream(mainFileText);
+
+			// the children of a fork server write the invocation of their part
+			if(!forkServer)
+			{
+				s_writeInvocation(setup, outstream);
+			}
+
+			// -D
+			for( std::vector<std::string>::const_iterator iter = setup.m_defines.begin(), end = setup.m_defines.end(); iter != end; ++iter )
+			{
+				std::string macro, value;
+				s_splitDefinition(*iter, macro, value);
+
+				stream << "#define " << macro << ' ' << value << '\n';
+			}
+
+			// -I
+			for( std::vector<std::string>::const_iterator iter = setup.m_includePaths.begin(), end = setup.m_includePaths.end(); iter != end; ++iter )
+			{
+				headerSearchOptions.AddPath(*iter, clang::frontend::Angled, true, false, false);
+			}
+
+			// -exclude
+			{
+				// Do not free buffers associated with the compiler invocation
+				preprocessorOptions.RetainRemappedFileBuffers = true;
+				for( std::vector<std::string>::const_iterator iter = setup.m_excludeFilenames.begin(), end = setup.m_excludeFilenames.end(); iter != end; ++iter )
+				{
+					preprocessorOptions.addRemappedFile(iter->c_str(), emptyMemoryBuffer);
+				}
+			}
+
+			// -exclude-pattern
+			{
+				for( std::vector<std::string>::const_iterator iter = setup.m_excludeFilenamePatterns.begin(), end = setup.m_excludeFilenamePatterns.end(); iter != end; ++iter )
+				{
+					filenamePatternExcluder->addExcludedPattern(*iter);
+				}
+			}
+
+			for( std::vector<std::string>::const_iterator iter = setup.m_forceIncludes.begin(), end = setup.m_forceIncludes.end(); iter != end; ++iter )
+			{
+				stream << "#include<" << iter->c_str() << ">\n";
+			}
+			if(forkServer)
+			{
+				// empty until a child of the fork server replaces it with its inputs
+				preprocessorOptions.addRemappedFile(s_forkInputsFileName, emptyMemoryBuffer);
+				stream << "#include<" << s_forkInputsFileName << ">\n";
+			}
+			for( std::vector<std::string>::const_iterator iter = setup.m_inputFilenames.begin(), end = setup.m_inputFilenames.end(); iter != end; ++iter )
+			{
+				stream << "#include<" << iter->c_str() << ">\n";
+			}
+			stream.flush();
+
+			llvm::MemoryBuffer* mainBuf = llvm::MemoryBuffer::getMemBufferCopy( llvm::StringRef(mainFileText.c_str(), mainFileText.size()), "masterInputFile" );
+			sourceManager.createMainFileIDForMemBuffer(mainBuf);
+		}
+		std::string resourceDir = setup.m_resourceDir;
+		if(!resourceDir.empty())
+		{
+			resourceDir += "/include";
+			headerSearchOptions.AddPath(resourceDir, clang::frontend::System, false, false, true);
+		}
+
+		clang::InitializePreprocessor( preprocessor, preprocessorOptions, headerSearchOptions, frontendOptions);
+		for( std::vector<std::string>::const_iterator iter = setup.m_excludeFilenames.begin(), end = setup.m_excludeFilenames.end(); iter != end; ++iter )
+		{
+			// -exclude files are remapped to an empty buffer by the preprocessor options
+			if(const clang::FileEntry* file = fileManager.getFile(*iter))
+			{
+				filenamePatternExcluder->addExcludedFile(file);
+			}
+		}
+		if(forkServer)
+		{
+			// the inputs file is not a dependency
+			const clang::FileEntry* inputsFile = fileManager.getFile(s_forkInputsFileName);
+			filenamePatternExcluder->addExcludedFile(inputsFile);
+			preprocessor.addPPCallbacks(new Havok::ForkPoint(preprocessor, sourceManager, *forkServer, inputsFile, *dependencyCollector)); // owned by the preprocessor
+		}
+
+		Havok::ExtractASTConsumer consumer(outstream);
+		if(!forkServer)
+		{
+			s_configureConsumer(setup, consumer);
+		}
+		consumer.setEntityTables(tables);
+		consumer.setHeaderReport(headerReport);
+		consumer.setPerfCounters(perfCounters);
+		clang::IdentifierTable identifierTable(langOptions);
+		clang::SelectorTable selectorTable;
+		clang::Builtin::Context builtinContext;
+		clang::ASTContext astcontext( langOptions, sourceManager, targetInfo.getPtr(), identifierTable, selectorTable, builtinContext, 0);
+
+		// When building a module, the AST is written to a temporary file first so that other
+		// translation units never load a partially written module
+		clang::ASTConsumer* parseConsumer = &consumer;
+		llvm::OwningPtr<llvm::raw_fd_ostream> moduleStream;
+		llvm::OwningPtr<clang::ASTConsumer> moduleWriter;
+		llvm::SmallString<256> moduleTempFilename;
+		if(!setup.m_moduleOutputFilename.empty())
+		{
+			int fd;
+			if(llvm::sys::fs::unique_file(setup.m_moduleOutputFilename + "-%%%%%%%%", fd, moduleTempFilename))
+			{
+				diagnosticStream << "error: could not create module file '" << setup.m_moduleOutputFilename << "'\n";
+				delete emptyMemoryBuffer;
+				return 1;
+			}
+			moduleStream.reset(new llvm::raw_fd_ostream(fd, true));
+			moduleWriter.reset(new clang::PCHGenerator(preprocessor, setup.m_moduleOutputFilename, true, "", moduleStream.get()));
+			parseConsumer = moduleWriter.get();
+		}
+		Havok::ModuleImportingConsumer importingConsumer(*parseConsumer, moduleLoader);
+		if(setup.m_moduleMap)
+		{
+			parseConsumer = &importingConsumer;
+		}
+
+		diagnostics.getClient()->BeginSourceFile(langOptions);
+		if(perfCounters)
+		{
+			perfCounters->enterPhase(Havok::PerfCounters::PHASE_PARSE);
+		}
+		clang::ParseAST(preprocessor, parseConsumer, astcontext);
+		if(perfCounters)
+		{
+			perfCounters->enterPhase(Havok::PerfCounters::PHASE_NONE);
+		}
+		diagnostics.getClient()->EndSourceFile();
+		if(headerReport)
+		{
+			headerReport->endParse();
+		}
+		exitStatus = diagnostics.hasErrorOccurred() ? 1 : 0;
+		// a child of a fork server dumps the part it received
+		const Havok::ExtractionSetup& dumpSetup = (forkServer && forkServer->isChild()) ? forkServer->getPart() : setup;
+		if(forkServer && forkServer->isChild())
+		{
+			s_writeInvocation(dumpSetup, outstream);
+			s_configureConsumer(dumpSetup, consumer);
+		}
+		if(forkServer && !forkServer->isChild())
+		{
+			// the server only finishes the parse when it stops serving, there is nothing to dump
+			exitStatus = 1;
+		}
+		else if(!setup.m_moduleOutputFilename.empty())
+		{
+			moduleWriter.reset();
+			moduleStream.reset();
+			bool existed;
+			if(exitStatus != 0 || llvm::sys::fs::rename(moduleTempFilename.str(), setup.m_moduleOutputFilename))
+			{
+				llvm::sys::fs::remove(moduleTempFilename.str(), existed);
+				exitStatus = 1;
+			}
+		}
+		else if(exitStatus == 0)
+		{
+			// AST parsing succeeded, proceed with declaration dumping
+			if(perfCounters)
+			{
+				perfCounters->enterPhase(Havok::PerfCounters::PHASE_DUMP);
+			}
+			consumer.dumpAllDeclarationsParallel(dumpSetup.m_dumpThreads);
+			if(perfCounters)
+			{
+				perfCounters->enterPhase(Havok::PerfCounters::PHASE_NONE);
+			}
+		}
+		else
+		{
+			outstream << "## The diagnostic engine returned an error during code parsing.\n";
+		}
+
+		if(dependencies)
+		{
+			// the headers of imported modules were not entered but the module depends on them
+			dependencyCollector->getDependencies(*dependencies);
+			std::vector<std::string> moduleHeaders;
+			moduleLoader.getImportedHeaders(moduleHeaders);
+			dependencies->insert(moduleHeaders.begin(), moduleHeaders.end());
+		}
+
+		outstream.flush();
+	}
+	delete emptyMemoryBuffer;
+
+	return exitStatus;
+}
+
+namespace
+{
+	// One variant of a matrix extraction, run on its own thread
+	struct VariantJob
+	{
+		std::string m_name;
+		Havok::ExtractionSetup m_setup;
+		Havok::FileContentCache* m_contentCache;
+		std::string m_database;
+		std::string m_diagnostics;
+		std::set<std::string> m_dependencies;
+		int m_exitStatus;
+
+		static void s_run(void* userData)
+		{
+			VariantJob* job = static_cast<VariantJob*>(userData);
+			llvm::raw_string_ostream databaseStream(job->m_database);
+			llvm::raw_string_ostream diagnosticStream(job->m_diagnostics);
+			job->m_exitStatus = s_runExtraction(job->m_setup, databaseStream, diagnosticStream, NULL, job->m_contentCache, &job->m_dependencies, NULL, NULL, NULL);
+			databaseStream.flush();
+			diagnosticStream.flush();
+		}
+	};
+}
+
+// Write the merged database, the entity tables are loaded back from its text. The tables keep
+// the lines of the first variant, the ids are the merged ones.
+static int s_writeMergedDatabase(const Havok::DatabaseMerger& merger, Havok::ExtractionSink& sink)
+{
+	if(sink.m_tables == NULL)
+	{
+		merger.write(sink.m_databaseStream);
+		return 0;
+	}
+	std::string text;
+	{
+		llvm::raw_string_ostream textStream(text);
+		merger.write(textStream);
+	}
+	sink.m_databaseStream << text;
+	Havok::EntityTableLoader tableLoader(*sink.m_tables);
+	std::string error;
+	if(!Havok::DatabaseLoader().load(text, tableLoader, error))
+	{
+		sink.m_diagnosticStream << "error: could not load the entity tables from the merged database: " << error << "\n";
+		return 1;
+	}
+	return 0;
+}
+
+// Extract all the variants concurrently, then write the merged database
+static int s_runMatrix(const Havok::ExtractionSetup& baseSetup, Havok::ExtractionSink& sink)
+{
+	const std::vector<std::string>& variants = baseSetup.m_variants;
+	if(variants.size() > Havok::DatabaseMerger::MAX_DATABASES)
+	{
+		sink.m_diagnosticStream << "error: at most " << int(Havok::DatabaseMerger::MAX_DATABASES) << " variants can be merged\n";
+		return 1;
+	}
+
+	Havok::FileContentCache contentCache;
+	std::vector<VariantJob> jobs(variants.size());
+	for( unsigned int i = 0; i < variants.size(); ++i )
+	{
+		// name=triple[,define[=value]...]
+		VariantJob& job = jobs[i];
+		std::string triple;
+		s_splitDefinition(variants[i], job.m_name, triple);
+		job.m_setup = baseSetup;
+		job.m_setup.m_variants.clear();
+		job.m_contentCache = &contentCache;
+		job.m_exitStatus = 1;
+		std::string::size_type comma = triple.find_first_of(',');
+		while(comma != std::string::npos)
+		{
+			std::string::size_type next = triple.find_first_of(',', comma + 1);
+			std::string define = triple.substr(comma + 1, next == std::string::npos ? std::string::npos : next - comma - 1);
+			if(!define.empty())
+			{
+				job.m_setup.m_defines.push_back(define);
+			}
+			triple.erase(comma, next == std::string::npos ? std::string::npos : next - comma);
+			comma = triple.find_first_of(',', comma);
+		}
+		job.m_setup.m_triple = triple;
+	}
+
+	{
+		std::vector<Havok::Thread*> threads;
+		for( unsigned int i = 0; i < jobs.size(); ++i )
+		{
+			threads.push_back(new Havok::Thread());
+			if(!threads.back()->start(&VariantJob::s_run, &jobs[i]))
+			{
+				// could not create a thread, run synchronously
+				VariantJob::s_run(&jobs[i]);
+			}
+		}
+		for( unsigned int i = 0; i < threads.size(); ++i )
+		{
+			threads[i]->join();
+			delete threads[i];
+		}
+	}
+
+	int exitStatus = 0;
+	Havok::DatabaseMerger merger;
+	for( unsigned int i = 0; i < jobs.size(); ++i )
+	{
+		const VariantJob& job = jobs[i];
+		sink.m_diagnosticStream << job.m_diagnostics;
+		exitStatus = job.m_exitStatus != 0 ? job.m_exitStatus : exitStatus;
+
+		sink.m_databaseStream << "Variant( index=" << i << ", name='" << Havok::escaped(job.m_name) << "', triple='" <<
+			Havok::escaped(job.m_setup.m_triple.empty() ? llvm::sys::getHostTriple() : job.m_setup.m_triple) << "' )\n";
+		merger.addDatabase(job.m_database);
+		if(sink.m_dependencies)
+		{
+			sink.m_dependencies->insert(job.m_dependencies.begin(), job.m_dependencies.end());
+		}
+	}
+	const int writeStatus = s_writeMergedDatabase(merger, sink);
+	return exitStatus != 0 ? exitStatus : writeStatus;
+}
+
+static void s_writeSetupField(llvm::raw_ostream& os, const char* name, const std::string& value)
+{
+	os << name << '\0' << value << '\0';
+}
+
+static void s_writeSetupFields(llvm::raw_ostream& os, const char* name, const std::vector<std::string>& values)
+{
+	for( std::vector<std::string>::const_iterator iter = values.begin(), end = values.end(); iter != end; ++iter )
+	{
+		s_writeSetupField(os, name, *iter);
+	}
+}
+
+// Setup of a part sent to a worker, as name and value pairs separated by '\0'. Modules are
+// not sent, the module map and the cache are local to the coordinator.
+static std::string s_serializeSetup(const Havok::ExtractionSetup& setup)
+{
+	std::string message;
+	llvm::raw_string_ostream os(message);
+	s_writeSetupField(os, "triple", setup.m_triple);
+	s_writeSetupFields(os, "define", setup.m_defines);
+	s_writeSetupFields(os, "includePath", setup.m_includePaths);
+	s_writeSetupFields(os, "passAttribute", setup.m_passAttributes);
+	s_writeSetupFields(os, "forceInclude", setup.m_forceIncludes);
+	s_writeSetupFields(os, "excludeFilename", setup.m_excludeFilenames);
+	s_writeSetupFields(os, "excludeFilenamePattern", setup.m_excludeFilenamePatterns);
+	s_writeSetupFields(os, "input", setup.m_inputFilenames);
+	s_writeSetupFields(os, "root", setup.m_roots);
+	s_writeSetupField(os, "resourceDir", setup.m_resourceDir);
+	s_writeSetupField(os, "layout", setup.m_dumpLayouts ? "1" : "0");
+	s_writeSetupField(os, "compactInstantiations", setup.m_compactInstantiations ? "1" : "0");
+	s_writeSetupField(os, "canonicalTypes", setup.m_canonicalTypes ? "1" : "0");
+	s_writeSetupField(os, "contentHashes", setup.m_contentHashes ? "1" : "0");
+	os << "instantiationBudget" << '\0' << setup.m_instantiationBudget << '\0';
+	os << "dumpThreads" << '\0' << setup.m_dumpThreads << '\0';
+	os.flush();
+	return message;
+}
+
+// Returns false if the message has a field this version does not know
+static bool s_deserializeSetup(llvm::StringRef message, Havok::ExtractionSetup& setupOut)
+{
+	while(!message.empty())
+	{
+		std::pair<llvm::StringRef, llvm::StringRef> name = message.split('\0');
+		std::pair<llvm::StringRef, llvm::StringRef> value = name.second.split('\0');
+		message = value.second;
+		const llvm::StringRef field = name.first;
+		const std::string text = value.first.str();
+		if(field == "triple")
+			setupOut.m_triple = text;
+		else if(field == "define")
+			setupOut.m_defines.push_back(text);
+		else if(field == "includePath")
+			setupOut.m_includePaths.push_back(text);
+		else if(field == "passAttribute")
+			setupOut.m_passAttributes.push_back(text);
+		else if(field == "forceInclude")
+			setupOut.m_forceIncludes.push_back(text);
+		else if(field == "excludeFilename")
+			setupOut.m_excludeFilenames.push_back(text);
+		else if(field == "excludeFilenamePattern")
+			setupOut.m_excludeFilenamePatterns.push_back(text);
+		else if(field == "input")
+			setupOut.m_inputFilenames.push_back(text);
+		else if(field == "root")
+			setupOut.m_roots.push_back(text);
+		else if(field == "resourceDir")
+			setupOut.m_resourceDir = text;
+		else if(field == "layout")
+			setupOut.m_dumpLayouts = (text == "1");
+		else if(field == "compactInstantiations")
+			setupOut.m_compactInstantiations = (text == "1");
+		else if(field == "canonicalTypes")
+			setupOut.m_canonicalTypes = (text == "1");
+		else if(field == "contentHashes")
+			setupOut.m_contentHashes = (text == "1");
+		else if(field == "instantiationBudget")
+			setupOut.m_instantiationBudget = atoi(text.c_str());
+		else if(field == "dumpThreads")
+			setupOut.m_dumpThreads = atoi(text.c_str());
+		else
+			return false;
+	}
+	return true;
+}
+
+// Reply to the coordinator which sent a part: exit status, diagnostics, database and dependencies
+static bool s_sendPartResult(Havok::Connection& connection, int exitStatus, const std::string& diagnostics, const std::string& database,
+	const std::set<std::string>& dependencies)
+{
+	std::string dependencyList;
+	for( std::set<std::string>::const_iterator it = dependencies.begin(), end = dependencies.end(); it != end; ++it )
+	{
+		dependencyList += *it + "\n";
+	}
+	return connection.sendMessage(exitStatus == 0 ? "0" : "1") && connection.sendMessage(diagnostics) &&
+		connection.sendMessage(database) && connection.sendMessage(dependencyList);
+}
+
+// Maximum size of the secret sent by the coordinators
+static const size_t s_maxSecretSize = 4096;
+// Seconds the workers wait for the first messages of a connection, the accept loops serve one
+// connection at a time and a peer which sends nothing would block them
+static const unsigned int s_handshakeTimeout = 30;
+
+// Receive the first message of a coordinator and compare it with the secret, the comparison
+// takes the same time wherever the first difference is. An empty secret accepts nobody.
+static bool s_acceptSecret(Havok::Connection& connection, const std::string& secret)
+{
+	std::string message;
+	if(secret.empty() || !connection.setReceiveTimeout(s_handshakeTimeout) || !connection.receiveMessage(message, s_maxSecretSize) ||
+		!connection.setReceiveTimeout(0) || message.size() != secret.size())
+	{
+		return false;
+	}
+	unsigned char difference = 0;
+	for( size_t i = 0; i < secret.size(); ++i )
+	{
+		difference |= static_cast<unsigned char>(message[i] ^ secret[i]);
+	}
+	return difference == 0;
+}
+
+// The part of a setup parsed once by a fork server, the parts sent to it must have the same
+static Havok::ExtractionSetup s_getPrelude(const Havok::ExtractionSetup& setup)
+{
+	Havok::ExtractionSetup prelude;
+	prelude.m_triple = setup.m_triple;
+	prelude.m_defines = setup.m_defines;
+	prelude.m_includePaths = setup.m_includePaths;
+	prelude.m_forceIncludes = setup.m_forceIncludes;
+	prelude.m_excludeFilenames = setup.m_excludeFilenames;
+	prelude.m_excludeFilenamePatterns = setup.m_excludeFilenamePatterns;
+	prelude.m_resourceDir = setup.m_resourceDir;
+	return prelude;
+}
+
+Havok::ForkServer::ForkServer(const ExtractionSetup& setup, const std::string& address, const std::string& secret, llvm::raw_ostream& logStream)
+	: m_prelude(s_getPrelude(setup))
+	, m_preludeKey(s_serializeSetup(m_prelude))
+	, m_address(address)
+	, m_secret(secret)
+	, m_logStream(logStream)
+	, m_isChild(false)
+{
+}
+
+bool Havok::ForkServer::checkPreludeFiles_i(std::string& changedFileOut) const
+{
+#ifndef _WIN32
+	for( std::vector<PreludeFile>::const_iterator it = m_preludeFiles.begin(), end = m_preludeFiles.end(); it != end; ++it )
+	{
+		struct stat status;
+		if(stat(it->m_name.c_str(), &status) != 0 || status.st_mtime != it->m_modificationTime || static_cast<long long>(status.st_size) != it->m_size)
+		{
+			changedFileOut = it->m_name;
+			return false;
+		}
+	}
+#endif
+	return true;
+}
+
+bool Havok::ForkServer::serve(bool preludeHasErrors, const std::vector<const FileEntry*>& preludeFiles)
+{
+#ifdef _WIN32
+	return false;
+#else
+	// the file manager stats each file once, before reading it
+	m_preludeFiles.resize(preludeFiles.size());
+	for( size_t i = 0; i < preludeFiles.size(); ++i )
+	{
+		m_preludeFiles[i].m_name = preludeFiles[i]->getName();
+		m_preludeFiles[i].m_modificationTime = preludeFiles[i]->getModificationTime();
+		m_preludeFiles[i].m_size = static_cast<long long>(preludeFiles[i]->getSize());
+	}
+	m_logStream << "fork server: prelude parsed" << (preludeHasErrors ? " with errors" : "") << ", waiting for parts on '" << m_address << "'\n";
+
+	// the children are never waited for, they are reaped by the system as they exit
+	struct sigaction childAction;
+	memset(&childAction, 0, sizeof(childAction));
+	childAction.sa_handler = SIG_DFL;
+	childAction.sa_flags = SA_NOCLDWAIT;
+	sigemptyset(&childAction.sa_mask);
+	struct sigaction previousChildAction;
+	sigaction(SIGCHLD, &childAction, &previousChildAction);
+
+	while(true)
+	{
+		if(!m_listener.accept(m_connection))
+		{
+			m_logStream << "error: could not accept connections on '" << m_address << "'\n";
+			return false;
+		}
+
+		// one part per connection, the child replies on it and the server goes on with the next one
+		std::string message, error, changedFile;
+		ExtractionSetup part;
+		if(!s_acceptSecret(m_connection, m_secret))
+		{
+			m_logStream << "fork server: closed a connection without the secret\n";
+			m_connection.close();
+			continue;
+		}
+		// the part follows the secret, the server waits for it before accepting the next connection
+		if(!m_connection.setReceiveTimeout(s_handshakeTimeout) || !m_connection.receiveMessage(message) || !m_connection.setReceiveTimeout(0))
+		{
+			m_connection.close();
+			continue;
+		}
+		if(!s_deserializeSetup(message, part))
+		{
+			error = "error: the fork server on '" + m_address + "' does not understand the part, check the versions\n";
+		}
+		else if(s_serializeSetup(s_getPrelude(part)) != m_preludeKey)
+		{
+			error = "error: the part does not have the target, defines, include paths, forced includes and exclusions of the fork server on '" + m_address + "'\n";
+		}
+		else if(!checkPreludeFiles_i(changedFile))
+		{
+			// the children would extract against the prelude as it was, the server has to be restarted
+			error = "error: '" + changedFile + "' changed since the fork server on '" + m_address + "' parsed its prelude, restart it\n";
+			m_logStream << "fork server: refused a part, '" << changedFile << "' changed since the prelude was parsed\n";
+		}
+		else
+		{
+			const pid_t pid = fork();
+			if(pid == 0)
+			{
+				// the child only talks to its coordinator
+				m_listener.release();
+				sigaction(SIGCHLD, &previousChildAction, NULL);
+				m_isChild = true;
+				m_part = part;
+				return true;
+			}
+			if(pid > 0)
+			{
+				m_connection.close();
+				continue;
+			}
+			error = "error: the fork server on '" + m_address + "' could not fork: " + strerror(errno) + "\n";
+		}
+		s_sendPartResult(m_connection, 1, error, std::string(), std::set<std::string>());
+	}
+#endif
+}
+
+namespace
+{
+	// One part of a distributed extraction, sent to its worker from its own thread
+	struct PartJob
+	{
+		std::string m_address;
+		Havok::ExtractionSetup m_setup;
+		std::string m_database;
+		std::string m_diagnostics;
+		std::set<std::string> m_dependencies;
+		int m_exitStatus;
+
+		static void s_run(void* userData)
+		{
+			// the worker replies with its exit status, diagnostics, database and dependencies
+			PartJob* job = static_cast<PartJob*>(userData);
+			Havok::Connection connection;
+			std::string errorInfo, status, dependencyList;
+			if(!connection.connect(job->m_address, errorInfo))
+			{
+				job->m_diagnostics = "error: could not connect to worker " + errorInfo + "\n";
+				return;
+			}
+			if(!connection.sendMessage(job->m_setup.m_workerSecret) || !connection.sendMessage(s_serializeSetup(job->m_setup)) || !connection.receiveMessage(status) ||
+				!connection.receiveMessage(job->m_diagnostics) || !connection.receiveMessage(job->m_database) ||
+				!connection.receiveMessage(dependencyList))
+			{
+				job->m_diagnostics += "error: lost the connection to worker '" + job->m_address + "'\n";
+				return;
+			}
+			job->m_exitStatus = (status == "0") ? 0 : 1;
+			llvm::StringRef dependencies(dependencyList);
+			while(!dependencies.empty())
+			{
+				std::pair<llvm::StringRef, llvm::StringRef> split = dependencies.split('\n');
+				job->m_dependencies.insert(split.first.str());
+				dependencies = split.second;
+			}
+		}
+	};
+}
+
+// Split the inputs between the workers and merge the databases of the parts
+static int s_runDistributed(const Havok::ExtractionSetup& baseSetup, Havok::ExtractionSink& sink)
+{
+	const std::vector<std::string>& inputs = baseSetup.m_inputFilenames;
+	const size_t numParts = std::min<size_t>(baseSetup.m_workers.size(), inputs.size());
+	if(numParts == 0)
+	{
+		sink.m_diagnosticStream << "error: the workers need input files\n";
+		return 1;
+	}
+	if(baseSetup.m_workerSecret.empty())
+	{
+		sink.m_diagnosticStream << "error: the workers need a shared secret\n";
+		return 1;
+	}
+	if(numParts > Havok::DatabaseMerger::MAX_DATABASES)
+	{
+		sink.m_diagnosticStream << "error: at most " << int(Havok::DatabaseMerger::MAX_DATABASES) << " workers can be used\n";
+		return 1;
+	}
+
+	std::vector<PartJob> jobs(numParts);
+	for( size_t i = 0; i < numParts; ++i )
+	{
+		// contiguous ranges of inputs, the merged database lists the inputs in order
+		PartJob& job = jobs[i];
+		job.m_address = baseSetup.m_workers[i];
+		job.m_setup = baseSetup;
+		job.m_setup.m_workers.clear();
+		job.m_setup.m_inputFilenames.assign(inputs.begin() + inputs.size() * i / numParts, inputs.begin() + inputs.size() * (i + 1) / numParts);
+		job.m_exitStatus = 1;
+	}
+
+	{
+		std::vector<Havok::Thread*> threads;
+		for( unsigned int i = 0; i < jobs.size(); ++i )
+		{
+			threads.push_back(new Havok::Thread());
+			if(!threads.back()->start(&PartJob::s_run, &jobs[i]))
+			{
+				// could not create a thread, run synchronously
+				PartJob::s_run(&jobs[i]);
+			}
+		}
+		for( unsigned int i = 0; i < threads.size(); ++i )
+		{
+			threads[i]->join();
+			delete threads[i];
+		}
+	}
+
+	// the headers shared by the parts are dumped by each of them, their entities are merged
+	int exitStatus = 0;
+	Havok::DatabaseMerger merger(Havok::DatabaseMerger::MERGE_PARTS);
+	for( unsigned int i = 0; i < jobs.size(); ++i )
+	{
+		const PartJob& job = jobs[i];
+		sink.m_diagnosticStream << job.m_diagnostics;
+		exitStatus = job.m_exitStatus != 0 ? job.m_exitStatus : exitStatus;
+		merger.addDatabase(job.m_database);
+		if(sink.m_dependencies)
+		{
+			sink.m_dependencies->insert(job.m_dependencies.begin(), job.m_dependencies.end());
+		}
+	}
+	const int writeStatus = s_writeMergedDatabase(merger, sink);
+	return exitStatus != 0 ? exitStatus : writeStatus;
+}
+
+int Havok::extract(const ExtractionSetup& setup, ExtractionSink& sink)
+{
+	if(!setup.m_variants.empty() || !setup.m_workers.empty())
+	{
+		if(sink.m_headerReport || sink.m_perfCounters)
+		{
+			sink.m_diagnosticStream << "error: header reports and performance counters cannot be produced by merged extractions\n";
+			return 1;
+		}
+		return setup.m_variants.empty() ? s_runDistributed(setup, sink) : s_runMatrix(setup, sink);
+	}
+	return s_runExtraction(setup, sink.m_databaseStream, sink.m_diagnosticStream, sink.m_tables, NULL, sink.m_dependencies, sink.m_headerReport, sink.m_perfCounters, NULL);
+}
+
+int Havok::runWorker(const std::string& address, const std::string& secret, llvm::raw_ostream& diagnosticStream)
+{
+	if(secret.empty())
+	{
+		diagnosticStream << "error: a worker needs a shared secret\n";
+		return 1;
+	}
+	Havok::Listener listener;
+	std::string errorInfo;
+	if(!listener.listen(address, errorInfo))
+	{
+		diagnosticStream << "error: could not listen on " << errorInfo << "\n";
+		return 1;
+	}
+	diagnosticStream << "worker: listening on '" << address << "'\n";
+
+	Havok::Connection connection;
+	while(listener.accept(connection))
+	{
+		if(!s_acceptSecret(connection, secret))
+		{
+			diagnosticStream << "worker: closed a connection without the secret\n";
+			connection.close();
+			continue;
+		}
+
+		// a coordinator may send several parts over the same connection
+		std::string message;
+		while(connection.receiveMessage(message))
+		{
+			Havok::ExtractionSetup setup;
+			std::string database, diagnostics;
+			std::set<std::string> dependencies;
+			int exitStatus = 1;
+			{
+				llvm::raw_string_ostream databaseStream(database);
+				llvm::raw_string_ostream diagnosticStream(diagnostics);
+				if(s_deserializeSetup(message, setup))
+				{
+					exitStatus = s_runExtraction(setup, databaseStream, diagnosticStream, NULL, NULL, &dependencies, NULL, NULL, NULL);
+				}
+				else
+				{
+					diagnosticStream << "error: the worker on '" << address << "' does not understand the part, check the versions\n";
+				}
+			}
+			if(!s_sendPartResult(connection, exitStatus, diagnostics, database, dependencies))
+			{
+				break;
+			}
+		}
+	}
+	diagnosticStream << "error: could not accept connections on '" << address << "'\n";
+	return 1;
+}
+
+int Havok::runForkServer(const ExtractionSetup& setup, const std::string& address, const std::string& secret, llvm::raw_ostream& diagnosticStream)
+{
+#ifdef _WIN32
+	diagnosticStream << "error: fork servers are not supported on this system\n";
+	return 1;
+#else
+	if(secret.empty())
+	{
+		diagnosticStream << "error: a fork server needs a shared secret\n";
+		return 1;
+	}
+	Havok::ForkServer server(setup, address, secret, diagnosticStream);
+	std::string errorInfo;
+	if(!server.listen(errorInfo))
+	{
+		diagnosticStream << "error: could not listen on " << errorInfo << "\n";
+		return 1;
+	}
+	diagnosticStream << "fork server: listening on '" << address << "', parsing the prelude\n";
+
+	// the parse of the prelude forks in the middle of s_runExtraction, which returns in each child
+	// once it has dumped its part. The diagnostics of the prelude are sent with each part.
+	std::string database, diagnostics;
+	std::set<std::string> dependencies;
+	int exitStatus;
+	{
+		llvm::raw_string_ostream databaseStream(database);
+		llvm::raw_string_ostream partDiagnosticStream(diagnostics);
+		exitStatus = s_runExtraction(server.getPrelude(), databaseStream, partDiagnosticStream, NULL, NULL, &dependencies, NULL, NULL, &server);
+	}
+	if(!server.isChild())
+	{
+		diagnosticStream << diagnostics << "error: the fork server on '" << address << "' stopped\n";
+		return 1;
+	}
+
+	// the child leaves without running the destructors, the listener would remove the socket
+	// file of the server
+	s_sendPartResult(server.getConnection(), exitStatus, diagnostics, database, dependencies);
+	_exit(exitStatus == 0 ? 0 : 1);
+#endif
+}
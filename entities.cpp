@@ -0,0 +1,1234 @@
+// Copyright (c) 2012 Havok. All rights reserved. This file is distributed under the terms
+// and conditions defined in file 'LICENSE.txt', which is part of this source code package.
+
+#include "entities.h"
+#include "escape.h"
+
+#pragma warning(push,0)
+	#include "llvm/ADT/StringSwitch.h"
+#pragma warning(pop)
+
+#include <cassert>
+#include <cstdio>
+#include <cstring>
+
+#define printf poisoned
+
+// ----------------------- Static Utility Functions ------------------------- //
+
+static const char* s_typeKindNames[] =
+{
+	"KIND_FILE",
+	"KIND_NAMESPACE",
+	"KIND_BUILTIN",
+	"KIND_POINTER",
+	"KIND_REFERENCE",
+	"KIND_MEMBER_POINTER",
+	"KIND_RECORD",
+	"KIND_ENUM",
+	"KIND_TYPEDEF",
+	"KIND_CONSTANT_ARRAY",
+	"KIND_PAREN",
+	"KIND_FUNCTION_PROTO",
+	"KIND_CONST",
+	"KIND_TEMPLATE_RECORD",
+	"KIND_TEMPLATE_INSTANTIATION",
+	"KIND_TEMPLATE_SPECIALIZATION",
+	"KIND_TEMPLATE_TYPE_PARAM",
+	"KIND_TEMPLATE_TEMPLATE_PARAM",
+	NULL
+};
+
+static const char* s_memberTableNames[] =
+{
+	"paramTypes",
+	"fields",
+	"methods",
+	"bases",
+	"enumConstants",
+	"templateParams",
+	"templateArgs",
+	"annotations",
+	"instantiations",
+	"offsets",
+	"comments",
+	NULL
+};
+
+static const char* entryNames[] =
+{
+	"Method",
+	"Constructor",
+	"Destructor",
+	"Field",
+	NULL
+};
+
+struct KeyValuePair
+{
+	const char* m_key;
+	const char* m_value;
+};
+
+static const KeyValuePair methodDefaults[] =
+{
+	{"static", "False"},
+	{"const", "False"},
+	{"isCopyAssignment", "False"},
+	{"isImplicit", "False"},
+	{"access", "\"public\""},
+	{"numParamDefaults", "0"},
+	{NULL, NULL}
+};
+
+static const KeyValuePair constructorDefaults[] =
+{
+	{"static", "False"},
+	{"const", "False"},
+	{"isCopyAssignment", "False"},
+	{"isImplicit", "False"},
+	{"isCopyConstructor", "False"},
+	{"isDefaultConstructor", "False"},
+	{"access", "\"public\""},
+	{"numParamDefaults", "0"},
+	{NULL, NULL}
+};
+
+static const KeyValuePair* destructorDefaults = methodDefaults;
+
+static const KeyValuePair fieldDefaults[] =
+{
+	{"access", "\"public\""},
+	{NULL, NULL}
+};
+
+
+static const KeyValuePair* defaults[] =
+{
+	methodDefaults,
+	constructorDefaults,
+	destructorDefaults,
+	fieldDefaults,
+	NULL,
+};
+
+// Little endian integers of the binary tables
+static void s_writeU8(llvm::raw_ostream& os, unsigned char value)
+{
+	os << char(value);
+}
+
+static void s_writeU32(llvm::raw_ostream& os, uint32_t value)
+{
+	char bytes[4];
+	for( int i = 0; i < 4; ++i )
+	{
+		bytes[i] = char(value >> (8 * i));
+	}
+	os.write(bytes, sizeof(bytes));
+}
+
+static void s_writeU64(llvm::raw_ostream& os, uint64_t value)
+{
+	char bytes[8];
+	for( int i = 0; i < 8; ++i )
+	{
+		bytes[i] = char(value >> (8 * i));
+	}
+	os.write(bytes, sizeof(bytes));
+}
+
+// A column is written in one go, the tables are read back column by column as well
+static void s_writeColumn(llvm::raw_ostream& os, const std::vector<unsigned char>& column)
+{
+	for( unsigned int i = 0; i < column.size(); ++i )
+	{
+		s_writeU8(os, column[i]);
+	}
+}
+
+static void s_writeColumn(llvm::raw_ostream& os, const std::vector<int>& column)
+{
+	for( unsigned int i = 0; i < column.size(); ++i )
+	{
+		s_writeU32(os, uint32_t(column[i]));
+	}
+}
+
+static void s_writeColumn(llvm::raw_ostream& os, const std::vector<unsigned>& column)
+{
+	for( unsigned int i = 0; i < column.size(); ++i )
+	{
+		s_writeU32(os, column[i]);
+	}
+}
+
+static void s_writeColumn(llvm::raw_ostream& os, const std::vector<int64_t>& column)
+{
+	for( unsigned int i = 0; i < column.size(); ++i )
+	{
+		s_writeU64(os, uint64_t(column[i]));
+	}
+}
+
+static void s_writeColumn(llvm::raw_ostream& os, const std::vector<uint64_t>& column)
+{
+	for( unsigned int i = 0; i < column.size(); ++i )
+	{
+		s_writeU64(os, column[i]);
+	}
+}
+
+// Pieces of the lines of the text database
+static const char* s_getBoolText(bool value)
+{
+	return value ? "True" : "False";
+}
+
+static void s_writeName(llvm::raw_ostream& os, const Havok::EntityTables& tables, unsigned name)
+{
+	os << ", name='" << Havok::escaped(tables.getString(name)) << "'";
+}
+
+static void s_writeRecordFlags(llvm::raw_ostream& os, unsigned flags)
+{
+	os << ", polymorphic=" << s_getBoolText((flags & Havok::EntityTables::FLAG_POLYMORPHIC) != 0);
+	os << ", abstract=" << s_getBoolText((flags & Havok::EntityTables::FLAG_ABSTRACT) != 0);
+}
+
+static void s_writeHashAndLayout(llvm::raw_ostream& os, const Havok::EntityTables::TypeTable& types, unsigned row)
+{
+	if( types.m_flags[row] & Havok::EntityTables::FLAG_HAS_HASH )
+	{
+		os << ", hash=0x";
+		os.write_hex(types.m_hashes[row]);
+	}
+	if( types.m_flags[row] & Havok::EntityTables::FLAG_HAS_LAYOUT )
+	{
+		// sizes are in bytes, as computed by the target we're parsing for
+		os << ", size=" << types.m_sizes[row];
+		os << ", align=" << types.m_aligns[row];
+	}
+}
+
+// Line of the type of an order entry, a function prototype is written with the parameter types following it
+static void s_writeTypeLine(llvm::raw_ostream& os, const Havok::EntityTables& tables, unsigned orderIndex, unsigned orderEnd)
+{
+	typedef Havok::EntityTables Tables;
+	const Tables::TypeTable& types = tables.getTypes();
+	const unsigned row = tables.getOrder().m_rows[orderIndex];
+	const int id = types.m_ids[row];
+	const int scopeId = types.m_scopeIds[row];
+	// namespaces and templates always have a scope, the types are only given one when they are declared
+	bool scopeAlways = false;
+	switch( types.m_kinds[row] )
+	{
+		case Tables::KIND_FILE:
+			os << "File( id=" << id << ", location='" << Havok::escaped(tables.getString(types.m_names[row])) << "' )\n";
+			return;
+		case Tables::KIND_NAMESPACE:
+			os << "Namespace( id=" << id;
+			s_writeName(os, tables, types.m_names[row]);
+			scopeAlways = true;
+			break;
+		case Tables::KIND_BUILTIN:
+			os << "BuiltinType( id=" << id << ", name='" << tables.getString(types.m_names[row]) << "'";
+			break;
+		case Tables::KIND_POINTER:
+			os << "PointerType( id=" << id << ", typeid=" << types.m_typeIds[row];
+			break;
+		case Tables::KIND_REFERENCE:
+			os << "ReferenceType( id=" << id << ", typeid=" << types.m_typeIds[row];
+			break;
+		case Tables::KIND_MEMBER_POINTER:
+			os << "MemberPointerType( id=" << id << ", recordid=" << types.m_extras[row] << ", typeid=" << types.m_typeIds[row];
+			break;
+		case Tables::KIND_RECORD:
+			os << "RecordType( id=" << id;
+			s_writeName(os, tables, types.m_names[row]);
+			s_writeRecordFlags(os, types.m_flags[row]);
+			s_writeHashAndLayout(os, types, row);
+			break;
+		case Tables::KIND_ENUM:
+			os << "EnumType( id=" << id;
+			s_writeName(os, tables, types.m_names[row]);
+			s_writeHashAndLayout(os, types, row);
+			break;
+		case Tables::KIND_TYPEDEF:
+			os << "TypedefType( id=" << id << ", typeid=" << types.m_typeIds[row];
+			s_writeName(os, tables, types.m_names[row]);
+			break;
+		case Tables::KIND_CONSTANT_ARRAY:
+			os << "ConstantArrayType( id=" << id << ", typeid=" << types.m_typeIds[row] << ", count=" << types.m_extras[row];
+			break;
+		case Tables::KIND_PAREN:
+			os << "ParenType( id=" << id << ", typeid=" << types.m_typeIds[row];
+			break;
+		case Tables::KIND_FUNCTION_PROTO:
+		{
+			const Tables::OrderTable& order = tables.getOrder();
+			const Tables::MemberTable& paramTypes = tables.getMembers(Tables::MEMBERS_PARAM_TYPES);
+			os << "FunctionProtoType( id=" << id << ", rettypeid=" << types.m_typeIds[row] << ", paramtypeids=[";
+			for( unsigned int i = orderIndex + 1; i < orderEnd && order.m_tables[i] == Tables::MEMBERS_PARAM_TYPES && paramTypes.m_ownerIds[order.m_rows[i]] == id; ++i )
+			{
+				if( i != orderIndex + 1 )
+				{
+					os << ',';
+				}
+				os << paramTypes.m_typeIds[order.m_rows[i]];
+			}
+			os << "]";
+			os << ", isVariadic=" << s_getBoolText((types.m_flags[row] & Tables::FLAG_VARIADIC) != 0);
+			break;
+		}
+		case Tables::KIND_CONST:
+			os << "ConstType( id=" << id << ", typeid=" << types.m_typeIds[row] << ")\n";
+			return;
+		case Tables::KIND_TEMPLATE_RECORD:
+			os << "TemplateRecord( id=" << id;
+			s_writeName(os, tables, types.m_names[row]);
+			s_writeRecordFlags(os, types.m_flags[row]);
+			s_writeHashAndLayout(os, types, row);
+			scopeAlways = true;
+			break;
+		case Tables::KIND_TEMPLATE_INSTANTIATION:
+			os << "TemplateRecordInstantiationType( id=" << id << ", templateid=" << types.m_typeIds[row];
+			s_writeRecordFlags(os, types.m_flags[row]);
+			s_writeHashAndLayout(os, types, row);
+			scopeAlways = true;
+			break;
+		case Tables::KIND_TEMPLATE_SPECIALIZATION:
+			os << "TemplateRecordSpecialization( id=" << id << ", templateid=" << types.m_typeIds[row];
+			s_writeRecordFlags(os, types.m_flags[row]);
+			s_writeHashAndLayout(os, types, row);
+			scopeAlways = true;
+			break;
+		default:
+			// the template parameters are written with their template parameter row
+			return;
+	}
+	if( scopeAlways || scopeId >= 0 )
+	{
+		os << ", scopeid=" << scopeId;
+	}
+	os << " )\n";
+}
+
+static void s_writeMethodLine(llvm::raw_ostream& os, const Havok::EntityTables& tables, unsigned row)
+{
+	typedef Havok::EntityTables Tables;
+	const Tables::MemberTable& methods = tables.getMembers(Tables::MEMBERS_METHODS);
+	const unsigned flags = methods.m_flags[row];
+	Havok::DumpEntry::EntryType et = Havok::DumpEntry::ENTRY_METHOD;
+	if( methods.m_kinds[row] == Tables::METHOD_CONSTRUCTOR )
+	{
+		et = Havok::DumpEntry::ENTRY_CONSTRUCTOR;
+	}
+	else if( methods.m_kinds[row] == Tables::METHOD_DESTRUCTOR )
+	{
+		et = Havok::DumpEntry::ENTRY_DESTRUCTOR;
+	}
+
+	Havok::DumpEntry e(os, et);
+	e.dumpKeyValuePair("id", methods.m_ids[row]);
+	e.dumpKeyValuePair("recordid", methods.m_ownerIds[row]);
+	e.dumpKeyValuePair("typeid", methods.m_typeIds[row]);
+	e.dumpKeyValuePair("static", (flags & Tables::FLAG_STATIC) != 0);
+	e.dumpKeyValuePair("const", (flags & Tables::FLAG_CONST) != 0);
+	if( et == Havok::DumpEntry::ENTRY_CONSTRUCTOR )
+	{
+		e.dumpKeyValuePair("isDefaultConstructor", (flags & Tables::FLAG_DEFAULT_CONSTRUCTOR) != 0);
+		e.dumpKeyValuePair("isCopyConstructor", (flags & Tables::FLAG_COPY_CONSTRUCTOR) != 0);
+	}
+	e.dumpKeyValuePair("isCopyAssignment", (flags & Tables::FLAG_COPY_ASSIGNMENT) != 0);
+	e.dumpKeyValuePair("isImplicit", (flags & Tables::FLAG_IMPLICIT) != 0);
+	e.dumpKeyValuePair("access", Tables::Access(methods.m_access[row]));
+	e.dumpKeyValuePair("numParamDefaults", int(methods.m_values[row]));
+	s_writeName(os, tables, methods.m_names[row]);
+	e.finishEntry();
+}
+
+static void s_writeFieldLine(llvm::raw_ostream& os, const Havok::EntityTables& tables, unsigned row)
+{
+	typedef Havok::EntityTables Tables;
+	const Tables::MemberTable& fields = tables.getMembers(Tables::MEMBERS_FIELDS);
+	const unsigned flags = fields.m_flags[row];
+	if( flags & Tables::FLAG_STATIC )
+	{
+		os << "StaticField( id=" << fields.m_ids[row] << ", recordid=" << fields.m_ownerIds[row] << ", typeid=" << fields.m_typeIds[row];
+		s_writeName(os, tables, fields.m_names[row]);
+		os << " )\n";
+		return;
+	}
+
+	Havok::DumpEntry e(os, Havok::DumpEntry::ENTRY_FIELD);
+	e.dumpKeyValuePair("id", fields.m_ids[row]);
+	e.dumpKeyValuePair("recordid", fields.m_ownerIds[row]);
+	e.dumpKeyValuePair("typeid", fields.m_typeIds[row]);
+	e.dumpKeyValuePair("access", Tables::Access(fields.m_access[row]));
+	if( fields.m_values[row] >= 0 )
+	{
+		e.dumpKeyValuePair((flags & Tables::FLAG_BIT_FIELD) ? "bitOffset" : "offset", int(fields.m_values[row]));
+	}
+	s_writeName(os, tables, fields.m_names[row]);
+	e.finishEntry();
+}
+
+static void s_writeMemberLine(llvm::raw_ostream& os, const Havok::EntityTables& tables, Havok::EntityTables::MemberTableId table, unsigned row)
+{
+	typedef Havok::EntityTables Tables;
+	const Tables::MemberTable& members = tables.getMembers(table);
+	const int ownerId = members.m_ownerIds[row];
+	const int typeId = members.m_typeIds[row];
+	const int kind = members.m_kinds[row];
+	const int64_t value = members.m_values[row];
+	switch( table )
+	{
+		case Tables::MEMBERS_PARAM_TYPES:
+			// written with their function prototype
+			break;
+		case Tables::MEMBERS_FIELDS:
+			s_writeFieldLine(os, tables, row);
+			break;
+		case Tables::MEMBERS_METHODS:
+			s_writeMethodLine(os, tables, row);
+			break;
+		case Tables::MEMBERS_BASES:
+			os << "Inherit( id=" << ownerId << ", parent=" << typeId;
+			if( value >= 0 )
+			{
+				os << ", offset=" << value;
+			}
+			os << " )\n";
+			break;
+		case Tables::MEMBERS_ENUM_CONSTANTS:
+			os << "EnumConstant( enumId=" << ownerId;
+			s_writeName(os, tables, members.m_names[row]);
+			os << ", value='";
+			if( members.m_flags[row] & Tables::FLAG_UNSIGNED )
+			{
+				os << uint64_t(value);
+			}
+			else
+			{
+				os << value;
+			}
+			os << "' )\n";
+			break;
+		case Tables::MEMBERS_TEMPLATE_PARAMS:
+			if( kind == Tables::PARAM_NON_TYPE )
+			{
+				os << "TemplateNonTypeParam( templateid=" << ownerId << ", typeid=" << typeId;
+			}
+			else if( kind == Tables::PARAM_TYPE )
+			{
+				os << "TemplateTypeParamType( templateid=" << ownerId << ", id=" << typeId;
+			}
+			else
+			{
+				os << "TemplateTemplateParam( templateid=" << ownerId << ", id=" << typeId;
+			}
+			s_writeName(os, tables, members.m_names[row]);
+			os << " )\n";
+			break;
+		case Tables::MEMBERS_TEMPLATE_ARGS:
+			if( kind == Tables::ARG_TYPE )
+			{
+				os << "TemplateSpecializationTypeArg( recordid=" << ownerId << ", typeid=" << typeId << " )\n";
+			}
+			else if( kind == Tables::ARG_TEMPLATE )
+			{
+				os << "TemplateSpecializationTemplateArg( recordid=" << ownerId << ", templateid=" << typeId << " )\n";
+			}
+			else
+			{
+				os << "TemplateSpecializationNonTypeArg( recordid=" << ownerId << ", value='" << Havok::escaped(tables.getString(members.m_names[row])) << "' )\n";
+			}
+			break;
+		case Tables::MEMBERS_ANNOTATIONS:
+			os << "Annotation( refid=" << ownerId << ", text=\"\"\"" << Havok::escaped(tables.getString(members.m_names[row])) << "\"\"\" )\n";
+			break;
+		case Tables::MEMBERS_INSTANTIATIONS:
+			if( kind == Tables::INSTANTIATION_PATTERN )
+			{
+				os << "InstantiationPattern( recordid=" << ownerId << ", templateid=" << typeId << " )\n";
+			}
+			else
+			{
+				os << "InstantiationNotExpanded( recordid=" << ownerId << " )\n";
+			}
+			break;
+		case Tables::MEMBERS_OFFSETS:
+			if( kind == Tables::OFFSET_FIELD )
+			{
+				os << "FieldOffset( recordid=" << ownerId << ", index=" << typeId;
+				os << ((members.m_flags[row] & Tables::FLAG_BIT_FIELD) ? ", bitOffset=" : ", offset=") << value << " )\n";
+			}
+			else
+			{
+				os << "BaseOffset( recordid=" << ownerId << ", index=" << typeId << ", offset=" << value << " )\n";
+			}
+			break;
+		case Tables::MEMBERS_COMMENTS:
+			os << tables.getString(members.m_names[row]) << "\n";
+			break;
+		default:
+			assert(0 && "unknown member table");
+			break;
+	}
+}
+
+// Integer value of a key of a database entry, the whole 64 bits of it
+static int64_t s_getInt64(const Havok::DatabaseEntry& entry, llvm::StringRef key, int64_t defaultValue)
+{
+	const Havok::DatabaseValue* value = entry.find(key);
+	return value != NULL && value->m_kind == Havok::DatabaseValue::VALUE_INTEGER ? value->m_integer : defaultValue;
+}
+
+static unsigned s_getLoadedRecordFlags(const Havok::DatabaseEntry& entry)
+{
+	unsigned flags = 0;
+	flags |= entry.getBool("polymorphic") ? Havok::EntityTables::FLAG_POLYMORPHIC : 0;
+	flags |= entry.getBool("abstract") ? Havok::EntityTables::FLAG_ABSTRACT : 0;
+	return flags;
+}
+
+static Havok::EntityTables::Access s_getLoadedAccess(const Havok::DatabaseEntry& entry)
+{
+	return llvm::StringSwitch<Havok::EntityTables::Access>(entry.getString("access"))
+		.Case("protected", Havok::EntityTables::ACCESS_PROTECTED)
+		.Case("private", Havok::EntityTables::ACCESS_PRIVATE)
+		.Default(Havok::EntityTables::ACCESS_PUBLIC);
+}
+
+// The optional keys of the records, templates and enums
+static void s_setLoadedHashAndLayout(Havok::EntityTables& tables, const Havok::DatabaseEntry& entry, int id)
+{
+	if( entry.find("hash") != NULL )
+	{
+		tables.setContentHash(id, uint64_t(s_getInt64(entry, "hash", 0)));
+	}
+	if( entry.find("size") != NULL )
+	{
+		tables.setLayout(id, s_getInt64(entry, "size", 0), s_getInt64(entry, "align", 0));
+	}
+}
+
+// ---------------------- EntityTables Implementation ----------------------- //
+
+void Havok::EntityTables::MemberTable::add(int id, int ownerId, int typeId, unsigned name, int kind, int access, unsigned flags, int64_t value)
+{
+	m_ids.push_back(id);
+	m_ownerIds.push_back(ownerId);
+	m_typeIds.push_back(typeId);
+	m_names.push_back(name);
+	m_kinds.push_back((unsigned char)kind);
+	m_access.push_back((unsigned char)access);
+	m_flags.push_back(flags);
+	m_values.push_back(value);
+}
+
+Havok::EntityTables::EntityTables()
+{
+	assert((sizeof(s_typeKindNames) / sizeof(const char*)) == NUM_TYPE_KINDS + 1);
+	assert((sizeof(s_memberTableNames) / sizeof(const char*)) == NUM_MEMBER_TABLES + 1);
+	// handle 0 is the empty string
+	m_stringChars.push_back('\0');
+	m_stringOffsets.push_back(0);
+	m_stringOffsets.push_back(0);
+}
+
+unsigned Havok::EntityTables::intern_i(llvm::StringRef str)
+{
+	if( str.empty() )
+	{
+		return 0;
+	}
+	llvm::StringMapEntry<unsigned>& entry = m_stringHandles.GetOrCreateValue(str, 0);
+	if( entry.getValue() == 0 )
+	{
+		// the null after the characters keeps the array from being empty, it is not part of any string
+		m_stringChars.pop_back();
+		m_stringChars.insert(m_stringChars.end(), str.begin(), str.end());
+		m_stringChars.push_back('\0');
+		entry.setValue(unsigned(m_stringOffsets.size() - 1));
+		m_stringOffsets.push_back(unsigned(m_stringChars.size() - 1));
+	}
+	return entry.getValue();
+}
+
+void Havok::EntityTables::append(const EntityTables& other)
+{
+	// the strings are interned again, the rows of the order are offset by the rows already there
+	unsigned firstRows[NUM_MEMBER_TABLES + 1];
+	for( int i = 0; i < NUM_MEMBER_TABLES; ++i )
+	{
+		firstRows[i] = m_members[i].size();
+	}
+	firstRows[TABLE_TYPES] = m_types.size();
+
+	const TypeTable& types = other.m_types;
+	for( unsigned i = 0; i < types.size(); ++i )
+	{
+		addTypeRow_i(types.m_ids[i], TypeKind(types.m_kinds[i]), other.getString(types.m_names[i]), types.m_scopeIds[i], types.m_typeIds[i],
+			types.m_extras[i], types.m_flags[i]);
+		m_types.m_sizes.back() = types.m_sizes[i];
+		m_types.m_aligns.back() = types.m_aligns[i];
+		m_types.m_hashes.back() = types.m_hashes[i];
+	}
+	for( int t = 0; t < NUM_MEMBER_TABLES; ++t )
+	{
+		const MemberTable& members = other.m_members[t];
+		for( unsigned i = 0; i < members.size(); ++i )
+		{
+			m_members[t].add(members.m_ids[i], members.m_ownerIds[i], members.m_typeIds[i], intern_i(other.getString(members.m_names[i])),
+				members.m_kinds[i], members.m_access[i], members.m_flags[i], members.m_values[i]);
+		}
+	}
+	const OrderTable& order = other.m_order;
+	for( unsigned i = 0; i < order.size(); ++i )
+	{
+		m_order.m_tables.push_back(order.m_tables[i]);
+		m_order.m_rows.push_back(firstRows[order.m_tables[i]] + order.m_rows[i]);
+	}
+}
+
+void Havok::EntityTables::TypeTable::clear()
+{
+	m_ids.clear();
+	m_kinds.clear();
+	m_names.clear();
+	m_scopeIds.clear();
+	m_typeIds.clear();
+	m_extras.clear();
+	m_flags.clear();
+	m_sizes.clear();
+	m_aligns.clear();
+	m_hashes.clear();
+}
+
+void Havok::EntityTables::MemberTable::clear()
+{
+	m_ids.clear();
+	m_ownerIds.clear();
+	m_typeIds.clear();
+	m_names.clear();
+	m_kinds.clear();
+	m_access.clear();
+	m_flags.clear();
+	m_values.clear();
+}
+
+void Havok::EntityTables::clear()
+{
+	m_types.clear();
+	for( int i = 0; i < NUM_MEMBER_TABLES; ++i )
+	{
+		m_members[i].clear();
+	}
+	m_order.clear();
+	m_stringChars.assign(1, '\0');
+	m_stringOffsets.assign(2, 0);
+	m_stringHandles.clear();
+	m_typeIndices.clear();
+}
+
+void Havok::EntityTables::addTypeRow_i(int id, TypeKind kind, llvm::StringRef name, int scopeId, int typeId, int extra, unsigned flags)
+{
+	m_typeIndices[id] = int(m_types.size());
+	m_types.m_ids.push_back(id);
+	m_types.m_kinds.push_back((unsigned char)kind);
+	m_types.m_names.push_back(intern_i(name));
+	m_types.m_scopeIds.push_back(scopeId);
+	m_types.m_typeIds.push_back(typeId);
+	m_types.m_extras.push_back(extra);
+	m_types.m_flags.push_back(flags);
+	m_types.m_sizes.push_back(0);
+	m_types.m_aligns.push_back(0);
+	m_types.m_hashes.push_back(0);
+}
+
+void Havok::EntityTables::addMember_i(MemberTableId table, int id, int ownerId, int typeId, unsigned name, int kind, int access, unsigned flags, int64_t value)
+{
+	m_order.m_tables.push_back((unsigned char)table);
+	m_order.m_rows.push_back(m_members[table].size());
+	m_members[table].add(id, ownerId, typeId, name, kind, access, flags, value);
+}
+
+void Havok::EntityTables::addType(int id, TypeKind kind, llvm::StringRef name, int scopeId, int typeId, int extra, unsigned flags)
+{
+	m_order.m_tables.push_back((unsigned char)TABLE_TYPES);
+	m_order.m_rows.push_back(m_types.size());
+	addTypeRow_i(id, kind, name, scopeId, typeId, extra, flags);
+}
+
+void Havok::EntityTables::setLayout(int id, int64_t size, int64_t align)
+{
+	IndexMap::const_iterator it = m_typeIndices.find(id);
+	assert(it != m_typeIndices.end() && "layout set for an unknown type");
+	m_types.m_sizes[it->second] = size;
+	m_types.m_aligns[it->second] = align;
+	m_types.m_flags[it->second] |= FLAG_HAS_LAYOUT;
+}
+
+void Havok::EntityTables::setContentHash(int id, uint64_t hash)
+{
+	IndexMap::const_iterator it = m_typeIndices.find(id);
+	assert(it != m_typeIndices.end() && "hash set for an unknown type");
+	m_types.m_hashes[it->second] = hash;
+	m_types.m_flags[it->second] |= FLAG_HAS_HASH;
+}
+
+void Havok::EntityTables::addParamType(int functionId, int typeId)
+{
+	addMember_i(MEMBERS_PARAM_TYPES, -1, functionId, typeId, 0, 0, 0, 0, 0);
+}
+
+void Havok::EntityTables::addField(int id, int recordId, int typeId, llvm::StringRef name, Access access, unsigned flags, int64_t offset)
+{
+	addMember_i(MEMBERS_FIELDS, id, recordId, typeId, intern_i(name), 0, access, flags, offset);
+}
+
+void Havok::EntityTables::addMethod(int id, int recordId, int typeId, llvm::StringRef name, MethodKind kind, Access access, unsigned flags, int numParamDefaults)
+{
+	addMember_i(MEMBERS_METHODS, id, recordId, typeId, intern_i(name), kind, access, flags, numParamDefaults);
+}
+
+void Havok::EntityTables::addInherit(int recordId, int parentId, unsigned flags, int64_t offset)
+{
+	addMember_i(MEMBERS_BASES, -1, recordId, parentId, 0, 0, 0, flags, offset);
+}
+
+void Havok::EntityTables::addEnumConstant(int enumId, llvm::StringRef name, int64_t value, unsigned flags)
+{
+	addMember_i(MEMBERS_ENUM_CONSTANTS, -1, enumId, enumId, intern_i(name), 0, 0, flags, value);
+}
+
+void Havok::EntityTables::addTemplateParam(int templateId, TemplateParamKind kind, int typeId, llvm::StringRef name)
+{
+	if( kind != PARAM_NON_TYPE )
+	{
+		// the type of the parameter is written with the parameter
+		addTypeRow_i(typeId, kind == PARAM_TYPE ? KIND_TEMPLATE_TYPE_PARAM : KIND_TEMPLATE_TEMPLATE_PARAM, name, templateId, -1, 0, 0);
+	}
+	addMember_i(MEMBERS_TEMPLATE_PARAMS, -1, templateId, typeId, intern_i(name), kind, 0, 0, 0);
+}
+
+void Havok::EntityTables::addTemplateArg(int recordId, TemplateArgKind kind, int refId, llvm::StringRef value)
+{
+	addMember_i(MEMBERS_TEMPLATE_ARGS, -1, recordId, refId, intern_i(value), kind, 0, 0, 0);
+}
+
+void Havok::EntityTables::addAnnotation(int refId, llvm::StringRef text)
+{
+	addMember_i(MEMBERS_ANNOTATIONS, -1, refId, -1, intern_i(text), 0, 0, 0, 0);
+}
+
+void Havok::EntityTables::addInstantiation(int recordId, InstantiationKind kind, int templateId)
+{
+	addMember_i(MEMBERS_INSTANTIATIONS, -1, recordId, templateId, 0, kind, 0, 0, 0);
+}
+
+void Havok::EntityTables::addOffset(int recordId, OffsetKind kind, int index, int64_t offset, unsigned flags)
+{
+	addMember_i(MEMBERS_OFFSETS, -1, recordId, index, 0, kind, 0, flags, offset);
+}
+
+void Havok::EntityTables::addComment(llvm::StringRef text)
+{
+	addMember_i(MEMBERS_COMMENTS, -1, -1, -1, intern_i(text), 0, 0, 0, 0);
+}
+
+int Havok::EntityTables::getTypeIndex(int id) const
+{
+	IndexMap::const_iterator it = m_typeIndices.find(id);
+	if( it == m_typeIndices.end() )
+	{
+		return -1;
+	}
+	return it->second;
+}
+
+const char* Havok::EntityTables::getTypeKindName(TypeKind kind)
+{
+	return s_typeKindNames[kind];
+}
+
+const char* Havok::EntityTables::getMemberTableName(MemberTableId table)
+{
+	return s_memberTableNames[table];
+}
+
+// ------------------- EntityBinaryWriter Implementation -------------------- //
+
+void Havok::EntityBinaryWriter::writeFile(const EntityTables& tables, int file, llvm::raw_ostream& os) const
+{
+	const EntityTables::TypeTable& types = tables.getTypes();
+	const EntityTables::OrderTable& order = tables.getOrder();
+	os << "CXENTS02";
+	s_writeU32(os, types.size());
+	for( int i = 0; i < EntityTables::NUM_MEMBER_TABLES; ++i )
+	{
+		s_writeU32(os, tables.getMembers(EntityTables::MemberTableId(i)).size());
+	}
+	s_writeU32(os, order.size());
+	s_writeU32(os, tables.getNumStrings());
+	s_writeU32(os, uint32_t(tables.getStringSize()));
+
+	s_writeColumn(os, types.m_ids);
+	s_writeColumn(os, types.m_kinds);
+	s_writeColumn(os, types.m_names);
+	s_writeColumn(os, types.m_scopeIds);
+	s_writeColumn(os, types.m_typeIds);
+	s_writeColumn(os, types.m_extras);
+	s_writeColumn(os, types.m_flags);
+	s_writeColumn(os, types.m_sizes);
+	s_writeColumn(os, types.m_aligns);
+	s_writeColumn(os, types.m_hashes);
+
+	for( int i = 0; i < EntityTables::NUM_MEMBER_TABLES; ++i )
+	{
+		const EntityTables::MemberTable& members = tables.getMembers(EntityTables::MemberTableId(i));
+		s_writeColumn(os, members.m_ids);
+		s_writeColumn(os, members.m_ownerIds);
+		s_writeColumn(os, members.m_typeIds);
+		s_writeColumn(os, members.m_names);
+		s_writeColumn(os, members.m_kinds);
+		s_writeColumn(os, members.m_access);
+		s_writeColumn(os, members.m_flags);
+		s_writeColumn(os, members.m_values);
+	}
+	s_writeColumn(os, order.m_tables);
+	s_writeColumn(os, order.m_rows);
+
+	// the strings are stored back to back, the string of handle i goes from offset i to offset i + 1
+	unsigned offset = 0;
+	for( unsigned int i = 0; i < tables.getNumStrings(); ++i )
+	{
+		s_writeU32(os, offset);
+		offset += unsigned(tables.getString(i).size());
+	}
+	s_writeU32(os, offset);
+	for( unsigned int i = 0; i < tables.getNumStrings(); ++i )
+	{
+		llvm::StringRef str = tables.getString(i);
+		os.write(str.data(), str.size());
+	}
+}
+
+// ----------------- EntityStatisticsWriter Implementation ------------------ //
+
+void Havok::EntityStatisticsWriter::writeFile(const EntityTables& tables, int file, llvm::raw_ostream& os) const
+{
+	const EntityTables::TypeTable& types = tables.getTypes();
+	unsigned kindCounts[EntityTables::NUM_TYPE_KINDS] = { 0 };
+	for( unsigned int i = 0; i < types.size(); ++i )
+	{
+		++kindCounts[types.m_kinds[i]];
+	}
+
+	os << "## Entity tables\n";
+	os << "EntityTable( name='types', count=" << types.size() << " )\n";
+	for( int i = 0; i < EntityTables::NUM_MEMBER_TABLES; ++i )
+	{
+		EntityTables::MemberTableId table = EntityTables::MemberTableId(i);
+		os << "EntityTable( name='" << EntityTables::getMemberTableName(table) << "', count=" << tables.getMembers(table).size() << " )\n";
+	}
+	os << "## Types of each kind\n";
+	for( int i = 0; i < EntityTables::NUM_TYPE_KINDS; ++i )
+	{
+		os << "TypeKind( name='" << EntityTables::getTypeKindName(EntityTables::TypeKind(i)) << "', count=" << kindCounts[i] << " )\n";
+	}
+	os << "## Interned strings, the empty string included\n";
+	os << "Strings( count=" << tables.getNumStrings() << ", size=" << tables.getStringSize() << " )\n";
+}
+
+// -------------------- EntityTextWriter Implementation --------------------- //
+
+void Havok::EntityTextWriter::writeFile(const EntityTables& tables, int file, llvm::raw_ostream& os) const
+{
+	DumpEntry::dumpDefaultEntries(os);
+	writeRows(tables, 0, tables.getOrder().size(), os);
+}
+
+void Havok::EntityTextWriter::writeRows(const EntityTables& tables, unsigned begin, unsigned end, llvm::raw_ostream& os)
+{
+	const EntityTables::OrderTable& order = tables.getOrder();
+	assert(begin <= end && end <= order.size() && "rows out of the order");
+	for( unsigned int i = begin; i < end; ++i )
+	{
+		if( order.m_tables[i] == EntityTables::TABLE_TYPES )
+		{
+			s_writeTypeLine(os, tables, i, end);
+		}
+		else
+		{
+			s_writeMemberLine(os, tables, EntityTables::MemberTableId(order.m_tables[i]), order.m_rows[i]);
+		}
+	}
+}
+
+// -------------------- EntityTableLoader Implementation -------------------- //
+
+namespace
+{
+	enum LoadedEntry
+	{
+		LOADED_FILE,
+		LOADED_NAMESPACE,
+		LOADED_BUILTIN_TYPE,
+		LOADED_RECORD_TYPE,
+		LOADED_ENUM_TYPE,
+		LOADED_ENUM_CONSTANT,
+		LOADED_TYPEDEF_TYPE,
+		LOADED_POINTER_TYPE,
+		LOADED_REFERENCE_TYPE,
+		LOADED_MEMBER_POINTER_TYPE,
+		LOADED_CONST_TYPE,
+		LOADED_CONSTANT_ARRAY_TYPE,
+		LOADED_PAREN_TYPE,
+		LOADED_FUNCTION_PROTO_TYPE,
+		LOADED_INHERIT,
+		LOADED_FIELD,
+		LOADED_STATIC_FIELD,
+		LOADED_METHOD,
+		LOADED_CONSTRUCTOR,
+		LOADED_DESTRUCTOR,
+		LOADED_TEMPLATE_RECORD,
+		LOADED_TEMPLATE_INSTANTIATION,
+		LOADED_TEMPLATE_SPECIALIZATION,
+		LOADED_TEMPLATE_TYPE_PARAM,
+		LOADED_TEMPLATE_NON_TYPE_PARAM,
+		LOADED_TEMPLATE_TEMPLATE_PARAM,
+		LOADED_TYPE_ARG,
+		LOADED_TEMPLATE_ARG,
+		LOADED_NON_TYPE_ARG,
+		LOADED_INSTANTIATION_PATTERN,
+		LOADED_INSTANTIATION_NOT_EXPANDED,
+		LOADED_FIELD_OFFSET,
+		LOADED_BASE_OFFSET,
+		LOADED_ANNOTATION,
+		LOADED_OTHER
+	};
+}
+
+void Havok::EntityTableLoader::onEntry(const DatabaseEntry& entry)
+{
+	const llvm::StringRef name = entry.getName();
+	if( name == "InVariants" )
+	{
+		// the lines which are not in every variant follow the mask of their variants
+		m_skipNext = (s_getInt64(entry, "mask", 0) & 1) == 0;
+		return;
+	}
+	if( m_skipNext )
+	{
+		m_skipNext = false;
+		return;
+	}
+
+	const LoadedEntry kind = llvm::StringSwitch<LoadedEntry>(name)
+		.Case("File", LOADED_FILE)
+		.Case("Namespace", LOADED_NAMESPACE)
+		.Case("BuiltinType", LOADED_BUILTIN_TYPE)
+		.Case("RecordType", LOADED_RECORD_TYPE)
+		.Case("EnumType", LOADED_ENUM_TYPE)
+		.Case("EnumConstant", LOADED_ENUM_CONSTANT)
+		.Case("TypedefType", LOADED_TYPEDEF_TYPE)
+		.Case("PointerType", LOADED_POINTER_TYPE)
+		.Case("ReferenceType", LOADED_REFERENCE_TYPE)
+		.Case("MemberPointerType", LOADED_MEMBER_POINTER_TYPE)
+		.Case("ConstType", LOADED_CONST_TYPE)
+		.Case("ConstantArrayType", LOADED_CONSTANT_ARRAY_TYPE)
+		.Case("ParenType", LOADED_PAREN_TYPE)
+		.Case("FunctionProtoType", LOADED_FUNCTION_PROTO_TYPE)
+		.Case("Inherit", LOADED_INHERIT)
+		.Case("Field", LOADED_FIELD)
+		.Case("StaticField", LOADED_STATIC_FIELD)
+		.Case("Method", LOADED_METHOD)
+		.Case("Constructor", LOADED_CONSTRUCTOR)
+		.Case("Destructor", LOADED_DESTRUCTOR)
+		.Case("TemplateRecord", LOADED_TEMPLATE_RECORD)
+		.Case("TemplateRecordInstantiationType", LOADED_TEMPLATE_INSTANTIATION)
+		.Case("TemplateRecordSpecialization", LOADED_TEMPLATE_SPECIALIZATION)
+		.Case("TemplateTypeParamType", LOADED_TEMPLATE_TYPE_PARAM)
+		.Case("TemplateNonTypeParam", LOADED_TEMPLATE_NON_TYPE_PARAM)
+		.Case("TemplateTemplateParam", LOADED_TEMPLATE_TEMPLATE_PARAM)
+		.Case("TemplateSpecializationTypeArg", LOADED_TYPE_ARG)
+		.Case("TemplateSpecializationTemplateArg", LOADED_TEMPLATE_ARG)
+		.Case("TemplateSpecializationNonTypeArg", LOADED_NON_TYPE_ARG)
+		.Case("InstantiationPattern", LOADED_INSTANTIATION_PATTERN)
+		.Case("InstantiationNotExpanded", LOADED_INSTANTIATION_NOT_EXPANDED)
+		.Case("FieldOffset", LOADED_FIELD_OFFSET)
+		.Case("BaseOffset", LOADED_BASE_OFFSET)
+		.Case("Annotation", LOADED_ANNOTATION)
+		.Default(LOADED_OTHER);
+
+	const int id = entry.getInt("id");
+	const int scopeId = entry.getInt("scopeid");
+	switch( kind )
+	{
+		case LOADED_FILE:
+			m_tables.addType(id, EntityTables::KIND_FILE, entry.getString("location"));
+			break;
+		case LOADED_NAMESPACE:
+			m_tables.addType(id, EntityTables::KIND_NAMESPACE, entry.getString("name"), scopeId);
+			break;
+		case LOADED_BUILTIN_TYPE:
+			m_tables.addType(id, EntityTables::KIND_BUILTIN, entry.getString("name"), scopeId);
+			break;
+		case LOADED_RECORD_TYPE:
+			m_tables.addType(id, EntityTables::KIND_RECORD, entry.getString("name"), scopeId, -1, 0, s_getLoadedRecordFlags(entry));
+			s_setLoadedHashAndLayout(m_tables, entry, id);
+			break;
+		case LOADED_ENUM_TYPE:
+			m_tables.addType(id, EntityTables::KIND_ENUM, entry.getString("name"), scopeId);
+			s_setLoadedHashAndLayout(m_tables, entry, id);
+			break;
+		case LOADED_ENUM_CONSTANT:
+		{
+			// the signedness is not written, only the values out of the signed range are known to be unsigned
+			const llvm::StringRef text = entry.getString("value");
+			long long value = 0;
+			unsigned long long unsignedValue = 0;
+			unsigned flags = 0;
+			if( text.getAsInteger(10, value) && !text.getAsInteger(10, unsignedValue) )
+			{
+				value = (long long)unsignedValue;
+				flags = EntityTables::FLAG_UNSIGNED;
+			}
+			m_tables.addEnumConstant(entry.getInt("enumId"), entry.getString("name"), int64_t(value), flags);
+			break;
+		}
+		case LOADED_TYPEDEF_TYPE:
+			m_tables.addType(id, EntityTables::KIND_TYPEDEF, entry.getString("name"), scopeId, entry.getInt("typeid"));
+			break;
+		case LOADED_POINTER_TYPE:
+			m_tables.addType(id, EntityTables::KIND_POINTER, "", scopeId, entry.getInt("typeid"));
+			break;
+		case LOADED_REFERENCE_TYPE:
+			m_tables.addType(id, EntityTables::KIND_REFERENCE, "", scopeId, entry.getInt("typeid"));
+			break;
+		case LOADED_MEMBER_POINTER_TYPE:
+			m_tables.addType(id, EntityTables::KIND_MEMBER_POINTER, "", scopeId, entry.getInt("typeid"), entry.getInt("recordid"));
+			break;
+		case LOADED_CONST_TYPE:
+			m_tables.addType(id, EntityTables::KIND_CONST, "", -1, entry.getInt("typeid"));
+			break;
+		case LOADED_CONSTANT_ARRAY_TYPE:
+			m_tables.addType(id, EntityTables::KIND_CONSTANT_ARRAY, "", scopeId, entry.getInt("typeid"), entry.getInt("count"));
+			break;
+		case LOADED_PAREN_TYPE:
+			m_tables.addType(id, EntityTables::KIND_PAREN, "", scopeId, entry.getInt("typeid"));
+			break;
+		case LOADED_FUNCTION_PROTO_TYPE:
+			m_tables.addType(id, EntityTables::KIND_FUNCTION_PROTO, "", scopeId, entry.getInt("rettypeid"), 0,
+				entry.getBool("isVariadic") ? EntityTables::FLAG_VARIADIC : 0);
+			entry.getIntList("paramtypeids", m_intList);
+			for( unsigned int i = 0; i < m_intList.size(); ++i )
+			{
+				m_tables.addParamType(id, m_intList[i]);
+			}
+			break;
+		case LOADED_INHERIT:
+			// virtual inheritance is not written
+			m_tables.addInherit(id, entry.getInt("parent"), 0, s_getInt64(entry, "offset", -1));
+			break;
+		case LOADED_FIELD:
+			if( entry.find("bitOffset") != NULL )
+			{
+				m_tables.addField(id, entry.getInt("recordid"), entry.getInt("typeid"), entry.getString("name"), s_getLoadedAccess(entry),
+					EntityTables::FLAG_BIT_FIELD, s_getInt64(entry, "bitOffset", -1));
+			}
+			else
+			{
+				m_tables.addField(id, entry.getInt("recordid"), entry.getInt("typeid"), entry.getString("name"), s_getLoadedAccess(entry),
+					0, s_getInt64(entry, "offset", -1));
+			}
+			break;
+		case LOADED_STATIC_FIELD:
+			// the access of the static fields is not written
+			m_tables.addField(id, entry.getInt("recordid"), entry.getInt("typeid"), entry.getString("name"), EntityTables::ACCESS_NONE,
+				EntityTables::FLAG_STATIC);
+			break;
+		case LOADED_METHOD:
+		case LOADED_CONSTRUCTOR:
+		case LOADED_DESTRUCTOR:
+		{
+			unsigned flags = 0;
+			flags |= entry.getBool("static") ? EntityTables::FLAG_STATIC : 0;
+			flags |= entry.getBool("const") ? EntityTables::FLAG_CONST : 0;
+			flags |= entry.getBool("isImplicit") ? EntityTables::FLAG_IMPLICIT : 0;
+			flags |= entry.getBool("isDefaultConstructor") ? EntityTables::FLAG_DEFAULT_CONSTRUCTOR : 0;
+			flags |= entry.getBool("isCopyConstructor") ? EntityTables::FLAG_COPY_CONSTRUCTOR : 0;
+			flags |= entry.getBool("isCopyAssignment") ? EntityTables::FLAG_COPY_ASSIGNMENT : 0;
+			const EntityTables::MethodKind methodKind = kind == LOADED_CONSTRUCTOR ? EntityTables::METHOD_CONSTRUCTOR :
+				(kind == LOADED_DESTRUCTOR ? EntityTables::METHOD_DESTRUCTOR : EntityTables::METHOD_METHOD);
+			m_tables.addMethod(id, entry.getInt("recordid"), entry.getInt("typeid"), entry.getString("name"), methodKind, s_getLoadedAccess(entry),
+				flags, entry.getInt("numParamDefaults", 0));
+			break;
+		}
+		case LOADED_TEMPLATE_RECORD:
+			m_tables.addType(id, EntityTables::KIND_TEMPLATE_RECORD, entry.getString("name"), scopeId, -1, 0, s_getLoadedRecordFlags(entry));
+			s_setLoadedHashAndLayout(m_tables, entry, id);
+			break;
+		case LOADED_TEMPLATE_INSTANTIATION:
+			m_tables.addType(id, EntityTables::KIND_TEMPLATE_INSTANTIATION, "", scopeId, entry.getInt("templateid"), 0, s_getLoadedRecordFlags(entry));
+			s_setLoadedHashAndLayout(m_tables, entry, id);
+			break;
+		case LOADED_TEMPLATE_SPECIALIZATION:
+			m_tables.addType(id, EntityTables::KIND_TEMPLATE_SPECIALIZATION, "", scopeId, entry.getInt("templateid"), 0, s_getLoadedRecordFlags(entry));
+			s_setLoadedHashAndLayout(m_tables, entry, id);
+			break;
+		case LOADED_TEMPLATE_TYPE_PARAM:
+			m_tables.addTemplateParam(entry.getInt("templateid"), EntityTables::PARAM_TYPE, id, entry.getString("name"));
+			break;
+		case LOADED_TEMPLATE_NON_TYPE_PARAM:
+			m_tables.addTemplateParam(entry.getInt("templateid"), EntityTables::PARAM_NON_TYPE, entry.getInt("typeid"), entry.getString("name"));
+			break;
+		case LOADED_TEMPLATE_TEMPLATE_PARAM:
+			m_tables.addTemplateParam(entry.getInt("templateid"), EntityTables::PARAM_TEMPLATE, id, entry.getString("name"));
+			break;
+		case LOADED_TYPE_ARG:
+			m_tables.addTemplateArg(entry.getInt("recordid"), EntityTables::ARG_TYPE, entry.getInt("typeid"));
+			break;
+		case LOADED_TEMPLATE_ARG:
+			m_tables.addTemplateArg(entry.getInt("recordid"), EntityTables::ARG_TEMPLATE, entry.getInt("templateid"));
+			break;
+		case LOADED_NON_TYPE_ARG:
+			m_tables.addTemplateArg(entry.getInt("recordid"), EntityTables::ARG_VALUE, -1, entry.getString("value"));
+			break;
+		case LOADED_INSTANTIATION_PATTERN:
+			m_tables.addInstantiation(entry.getInt("recordid"), EntityTables::INSTANTIATION_PATTERN, entry.getInt("templateid"));
+			break;
+		case LOADED_INSTANTIATION_NOT_EXPANDED:
+			m_tables.addInstantiation(entry.getInt("recordid"), EntityTables::INSTANTIATION_NOT_EXPANDED);
+			break;
+		case LOADED_FIELD_OFFSET:
+			if( entry.find("bitOffset") != NULL )
+			{
+				m_tables.addOffset(entry.getInt("recordid"), EntityTables::OFFSET_FIELD, entry.getInt("index"), s_getInt64(entry, "bitOffset", -1),
+					EntityTables::FLAG_BIT_FIELD);
+			}
+			else
+			{
+				m_tables.addOffset(entry.getInt("recordid"), EntityTables::OFFSET_FIELD, entry.getInt("index"), s_getInt64(entry, "offset", -1));
+			}
+			break;
+		case LOADED_BASE_OFFSET:
+			m_tables.addOffset(entry.getInt("recordid"), EntityTables::OFFSET_BASE, entry.getInt("index"), s_getInt64(entry, "offset", -1));
+			break;
+		case LOADED_ANNOTATION:
+			m_tables.addAnnotation(entry.getInt("refid"), entry.getString("text"));
+			break;
+		case LOADED_OTHER:
+			// DefaultsFor, Invocation and Variant entries
+			break;
+	}
+}
+
+// ------------------------ DumpEntry Implementation ------------------------ //
+
+Havok::DumpEntry::DumpEntry(llvm::raw_ostream& os, EntryType et)
+	: m_entryType(et)
+	, m_hasOutputKeyValuePair(false)
+	, m_os(os)
+{
+	assert(0 <= et);
+	assert(et < NUM_ENTRIES);
+	// Check the entry names array has the correct size.
+	assert((sizeof(entryNames) / sizeof(const char*)) == NUM_ENTRIES + 1);
+	assert((sizeof(defaults) / sizeof(const KeyValuePair*)) == NUM_ENTRIES + 1);
+	m_os << entryNames[et] << "( ";
+}
+
+void Havok::DumpEntry::checkOutputComma()
+{
+	if (m_hasOutputKeyValuePair)
+	{
+		m_os << ", ";
+	}
+	m_hasOutputKeyValuePair = true;
+}
+
+void Havok::DumpEntry::finishEntry()
+{
+	m_os << " )\n";
+}
+
+void Havok::DumpEntry::dumpKeyValuePair(const char* key, const char* val)
+{
+	const KeyValuePair* kvpairs = defaults[m_entryType];
+	if (kvpairs != NULL)
+	{
+		while (kvpairs->m_key != NULL)
+		{
+			if (strcmp(kvpairs->m_key, key) == 0)
+			{
+				if (strcmp(kvpairs->m_value, val) == 0)
+				{
+					return;
+				}
+				else
+				{
+					break;
+				}
+			}
+			++kvpairs;
+		}
+	}
+	checkOutputComma();
+	m_os << key << "=" << val;
+}
+
+void Havok::DumpEntry::dumpKeyValuePair(const char* key, int i)
+{
+	char buf[10];
+	snprintf(buf, sizeof(buf), "%d", i);
+	dumpKeyValuePair(key, buf);
+}
+
+void Havok::DumpEntry::dumpKeyValuePair(const char* key, bool b)
+{
+	dumpKeyValuePair(key, (b ? "True" : "False"));
+}
+
+void Havok::DumpEntry::dumpKeyValuePair(const char* key, EntityTables::Access access)
+{
+	switch(access)
+	{
+	case EntityTables::ACCESS_PRIVATE:
+		dumpKeyValuePair(key, "\"private\"");
+		break;
+	case EntityTables::ACCESS_PROTECTED:
+		dumpKeyValuePair(key, "\"protected\"");
+		break;
+	case EntityTables::ACCESS_PUBLIC:
+		dumpKeyValuePair(key, "\"public\"");
+		break;
+	default:
+		assert(false);
+	}
+}
+
+void Havok::DumpEntry::dumpDefaultEntries(llvm::raw_ostream& os)
+{
+	for (int i = 0; i < NUM_ENTRIES; ++i)
+	{
+		os << "DefaultsFor" << entryNames[i] << "( ";
+		const KeyValuePair* kvpairs = defaults[i];
+		if (kvpairs->m_key != NULL)
+		{
+			os << kvpairs->m_key << "=" << kvpairs->m_value;
+			++kvpairs;
+		}
+		while (kvpairs->m_key != NULL)
+		{
+			os << ", " << kvpairs->m_key << "=" << kvpairs->m_value;
+			++kvpairs;
+		}
+		os << " )\n";
+	}
+}
+
+// -------------------------------------------------------------------------- //
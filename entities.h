@@ -0,0 +1,388 @@
+// Copyright (c) 2012 Havok. All rights reserved. This file is distributed under the terms
+// and conditions defined in file 'LICENSE.txt', which is part of this source code package.
+
+#ifndef ENTITIES_H
+#define ENTITIES_H
+
+#pragma warning(push,0)
+	#include "llvm/ADT/DenseMap.h"
+	#include "llvm/ADT/StringMap.h"
+	#include "llvm/ADT/StringRef.h"
+	#include "llvm/Support/DataTypes.h"
+	#include "llvm/Support/raw_ostream.h"
+#pragma warning(pop)
+
+#include "loader.h"
+#include <vector>
+
+namespace Havok
+{
+	/// Entities dumped by ExtractASTConsumer, stored column by column (one array per attribute) so
+	/// that the sinks only touch the attributes they use. Strings are interned and referred to by
+	/// handle. The tables are filled by the dump and can then be written in several formats, the
+	/// text database included: the order the rows were dumped in is kept for it, see getOrder().
+	class EntityTables
+	{
+		public:
+
+			// Kind of the entities stored in the type table (scopes are stored there too)
+			enum TypeKind
+			{
+				KIND_FILE,
+				KIND_NAMESPACE,
+				KIND_BUILTIN,
+				KIND_POINTER,
+				KIND_REFERENCE,
+				KIND_MEMBER_POINTER,
+				KIND_RECORD,
+				KIND_ENUM,
+				KIND_TYPEDEF,
+				KIND_CONSTANT_ARRAY,
+				KIND_PAREN,
+				KIND_FUNCTION_PROTO,
+				KIND_CONST,
+				KIND_TEMPLATE_RECORD,
+				KIND_TEMPLATE_INSTANTIATION,
+				KIND_TEMPLATE_SPECIALIZATION,
+				KIND_TEMPLATE_TYPE_PARAM,
+				KIND_TEMPLATE_TEMPLATE_PARAM,
+
+				NUM_TYPE_KINDS
+			};
+
+			enum MethodKind
+			{
+				METHOD_METHOD,
+				METHOD_CONSTRUCTOR,
+				METHOD_DESTRUCTOR
+			};
+
+			enum TemplateParamKind
+			{
+				PARAM_TYPE,
+				PARAM_NON_TYPE,
+				PARAM_TEMPLATE
+			};
+
+			enum TemplateArgKind
+			{
+				ARG_TYPE,
+				ARG_TEMPLATE,
+				ARG_VALUE
+			};
+
+			enum InstantiationKind
+			{
+				// The members are those of the template, see DUMP_COMPACT_INSTANTIATIONS
+				INSTANTIATION_PATTERN,
+				// The instantiation budget was exhausted, the members are not known
+				INSTANTIATION_NOT_EXPANDED
+			};
+
+			enum OffsetKind
+			{
+				OFFSET_FIELD,
+				OFFSET_BASE
+			};
+
+			// Same values as the access specifiers of clang
+			enum Access
+			{
+				ACCESS_PUBLIC,
+				ACCESS_PROTECTED,
+				ACCESS_PRIVATE,
+				ACCESS_NONE
+			};
+
+			// Flags shared by the different tables
+			enum Flags
+			{
+				FLAG_POLYMORPHIC = 1 << 0,
+				FLAG_ABSTRACT = 1 << 1,
+				FLAG_VARIADIC = 1 << 2,
+				FLAG_STATIC = 1 << 3,
+				FLAG_CONST = 1 << 4,
+				FLAG_IMPLICIT = 1 << 5,
+				FLAG_COPY_CONSTRUCTOR = 1 << 6,
+				FLAG_DEFAULT_CONSTRUCTOR = 1 << 7,
+				FLAG_COPY_ASSIGNMENT = 1 << 8,
+				FLAG_VIRTUAL = 1 << 9,
+				FLAG_HAS_LAYOUT = 1 << 10,
+				// The offset of the field is in bits
+				FLAG_BIT_FIELD = 1 << 11,
+				// The value of the enum constant is unsigned
+				FLAG_UNSIGNED = 1 << 12,
+				FLAG_HAS_HASH = 1 << 13
+			};
+
+			// Tables of the entities belonging to a type
+			enum MemberTableId
+			{
+				MEMBERS_PARAM_TYPES,
+				MEMBERS_FIELDS,
+				MEMBERS_METHODS,
+				MEMBERS_BASES,
+				MEMBERS_ENUM_CONSTANTS,
+				MEMBERS_TEMPLATE_PARAMS,
+				MEMBERS_TEMPLATE_ARGS,
+				MEMBERS_ANNOTATIONS,
+				MEMBERS_INSTANTIATIONS,
+				MEMBERS_OFFSETS,
+				MEMBERS_COMMENTS,
+
+				NUM_MEMBER_TABLES,
+				// The type table, in the order
+				TABLE_TYPES = NUM_MEMBER_TABLES
+			};
+
+			// Types and scopes, in the order they are dumped
+			struct TypeTable
+			{
+				std::vector<int> m_ids;
+				std::vector<unsigned char> m_kinds;
+				std::vector<unsigned> m_names;
+				std::vector<int> m_scopeIds;
+				// Pointee, underlying, element, return or template type
+				std::vector<int> m_typeIds;
+				// Array element count or member pointer record
+				std::vector<int> m_extras;
+				std::vector<unsigned> m_flags;
+				std::vector<int64_t> m_sizes;
+				std::vector<int64_t> m_aligns;
+				// Content hash of the records, templates and enums (FLAG_HAS_HASH)
+				std::vector<uint64_t> m_hashes;
+
+				unsigned size() const { return unsigned(m_ids.size()); }
+				void clear();
+			};
+
+			// Members of the types. The owner is the record, enum, template or function the member
+			// belongs to, the other columns depend on the table: the type is the parent record of
+			// the bases, the referred entity of the template arguments, the template of the
+			// instantiation patterns and the field or base index of the offsets, the name is the
+			// value of the template arguments and the text of the annotations and comments, the
+			// value is the offset of the fields, bases and offsets (-1 without a layout), the value
+			// of the enum constants and the default parameter count of the methods.
+			struct MemberTable
+			{
+				// -1 for the members without an id
+				std::vector<int> m_ids;
+				std::vector<int> m_ownerIds;
+				std::vector<int> m_typeIds;
+				std::vector<unsigned> m_names;
+				std::vector<unsigned char> m_kinds;
+				std::vector<unsigned char> m_access;
+				std::vector<unsigned> m_flags;
+				std::vector<int64_t> m_values;
+
+				unsigned size() const { return unsigned(m_ids.size()); }
+				void add(int id, int ownerId, int typeId, unsigned name, int kind, int access, unsigned flags, int64_t value);
+				void clear();
+			};
+
+			// Rows of all the tables in the order they are dumped: the table (a member table or
+			// TABLE_TYPES) and the row in that table
+			struct OrderTable
+			{
+				std::vector<unsigned char> m_tables;
+				std::vector<unsigned> m_rows;
+
+				unsigned size() const { return unsigned(m_rows.size()); }
+				void clear() { m_tables.clear(); m_rows.clear(); }
+			};
+
+			EntityTables();
+
+			// Entities, added in the order they are dumped. Ids are the ones used in the text database.
+			void addType(int id, TypeKind kind, llvm::StringRef name, int scopeId = -1, int typeId = -1, int extra = 0, unsigned flags = 0);
+			void setLayout(int id, int64_t size, int64_t align);
+			void setContentHash(int id, uint64_t hash);
+			// The parameter types directly follow their function prototype
+			void addParamType(int functionId, int typeId);
+			// The offset is in bits for the bit fields (FLAG_BIT_FIELD)
+			void addField(int id, int recordId, int typeId, llvm::StringRef name, Access access, unsigned flags, int64_t offset = -1);
+			void addMethod(int id, int recordId, int typeId, llvm::StringRef name, MethodKind kind, Access access, unsigned flags, int numParamDefaults);
+			void addInherit(int recordId, int parentId, unsigned flags, int64_t offset = -1);
+			void addEnumConstant(int enumId, llvm::StringRef name, int64_t value, unsigned flags = 0);
+			// The type and template template parameters add their type as well
+			void addTemplateParam(int templateId, TemplateParamKind kind, int typeId, llvm::StringRef name);
+			void addTemplateArg(int recordId, TemplateArgKind kind, int refId, llvm::StringRef value = llvm::StringRef());
+			void addAnnotation(int refId, llvm::StringRef text);
+			void addInstantiation(int recordId, InstantiationKind kind, int templateId = -1);
+			// Offset of a field or base of an instantiation dumped with its pattern, by index in the record
+			void addOffset(int recordId, OffsetKind kind, int index, int64_t offset, unsigned flags = 0);
+			// Comment line of the text database, without its line break
+			void addComment(llvm::StringRef text);
+
+			// Add the rows of other tables after these, in their order
+			void append(const EntityTables& other);
+			// Remove every entity and string, the memory is kept for the next ones
+			void clear();
+
+			const TypeTable& getTypes() const { return m_types; }
+			const MemberTable& getMembers(MemberTableId table) const { return m_members[table]; }
+			const OrderTable& getOrder() const { return m_order; }
+			// Index of an entity id in the type table, -1 if unknown
+			int getTypeIndex(int id) const;
+
+			// Interned string of a handle, handle 0 is the empty string
+			llvm::StringRef getString(unsigned handle) const
+			{
+				return llvm::StringRef(&m_stringChars[0] + m_stringOffsets[handle], m_stringOffsets[handle + 1] - m_stringOffsets[handle]);
+			}
+			unsigned getNumStrings() const { return unsigned(m_stringOffsets.size() - 1); }
+			size_t getStringSize() const { return m_stringChars.size() - 1; }
+
+			static const char* getTypeKindName(TypeKind kind);
+			static const char* getMemberTableName(MemberTableId table);
+
+		protected:
+
+			unsigned intern_i(llvm::StringRef str);
+			// Add a row without adding it to the order
+			void addTypeRow_i(int id, TypeKind kind, llvm::StringRef name, int scopeId, int typeId, int extra, unsigned flags);
+			void addMember_i(MemberTableId table, int id, int ownerId, int typeId, unsigned name, int kind, int access, unsigned flags, int64_t value);
+
+			TypeTable m_types;
+			MemberTable m_members[NUM_MEMBER_TABLES];
+			OrderTable m_order;
+
+			// Characters of the interned strings followed by a null, string i goes from offset i to offset i + 1
+			std::vector<char> m_stringChars;
+			std::vector<unsigned> m_stringOffsets;
+			llvm::StringMap<unsigned> m_stringHandles;
+
+			// Maps entity ids to their index in the type table
+			typedef llvm::DenseMap<int, int> IndexMap;
+			IndexMap m_typeIndices;
+
+		private:
+			EntityTables(const EntityTables&);
+			EntityTables& operator=(const EntityTables&);
+	};
+
+	/// Output format written from the entity tables once the dump is done. A sink writes one or
+	/// more files, named after a base name given by the user followed by the suffix of each file.
+	class EntitySink
+	{
+		public:
+
+			virtual ~EntitySink() {}
+
+			virtual int getNumFiles() const = 0;
+			virtual llvm::StringRef getFileSuffix(int file) const = 0;
+			virtual void writeFile(const EntityTables& tables, int file, llvm::raw_ostream& os) const = 0;
+	};
+
+	/// Writes the tables as they are stored, for tools which load them without parsing. The file
+	/// is little endian: "CXENTS02", u32 type count, u32 member count of each member table, u32
+	/// order count, u32 string count, u32 string size, then the type columns (id i32, kind u8,
+	/// name u32, scope i32, type i32, extra i32, flags u32, size i64, align i64, hash u64), the
+	/// columns of each member table (id i32, owner i32, type i32, name u32, kind u8, access u8,
+	/// flags u32, value i64), the order columns (table u8, row u32), the string offsets (u32,
+	/// string count + 1 of them) and the string characters.
+	class EntityBinaryWriter : public EntitySink
+	{
+		public:
+
+			virtual int getNumFiles() const { return 1; }
+			virtual llvm::StringRef getFileSuffix(int file) const { return llvm::StringRef(); }
+			virtual void writeFile(const EntityTables& tables, int file, llvm::raw_ostream& os) const;
+	};
+
+	/// Writes the number of entities of each table and type kind, and the size of the strings
+	class EntityStatisticsWriter : public EntitySink
+	{
+		public:
+
+			virtual int getNumFiles() const { return 1; }
+			virtual llvm::StringRef getFileSuffix(int file) const { return llvm::StringRef(); }
+			virtual void writeFile(const EntityTables& tables, int file, llvm::raw_ostream& os) const;
+	};
+
+	/// Writes the text database: the DefaultsFor lines, then one line per row in the order the
+	/// rows were dumped. ExtractASTConsumer writes its rows with writeRows() as it dumps them.
+	class EntityTextWriter : public EntitySink
+	{
+		public:
+
+			virtual int getNumFiles() const { return 1; }
+			virtual llvm::StringRef getFileSuffix(int file) const { return llvm::StringRef(); }
+			virtual void writeFile(const EntityTables& tables, int file, llvm::raw_ostream& os) const;
+
+			// Lines of the rows of the order from begin to end, the parameter types of a function
+			// prototype are written with it
+			static void writeRows(const EntityTables& tables, unsigned begin, unsigned end, llvm::raw_ostream& os);
+	};
+
+	/// Fills the tables from a text database, used when the database is merged from several
+	/// extractions (-variant, -workers). Only the lines of the first variant are kept, the
+	/// comments are not.
+	class EntityTableLoader : public DatabaseHandler
+	{
+		public:
+
+			EntityTableLoader(EntityTables& tables) : m_tables(tables), m_skipNext(false) {}
+
+			virtual void onEntry(const DatabaseEntry& entry);
+
+		protected:
+
+			EntityTables& m_tables;
+			// The next entry is not in the first variant
+			bool m_skipNext;
+			llvm::SmallVector<int, 16> m_intList;
+
+		private:
+			EntityTableLoader(const EntityTableLoader&);
+			EntityTableLoader& operator=(const EntityTableLoader&);
+	};
+
+	// Some types of dump entry are routed through this class to unify default handling.
+	class DumpEntry
+	{
+	public:
+		enum EntryType
+		{
+			// Only these types are currently supported.
+			ENTRY_METHOD,
+			ENTRY_CONSTRUCTOR,
+			ENTRY_DESTRUCTOR,
+			ENTRY_FIELD,
+
+			NUM_ENTRIES
+		};
+
+		// Construct a new entry (outputs name to stream)
+		DumpEntry(llvm::raw_ostream& os, EntryType t);
+
+		// Output a key value pair when the value isn't the default value.
+		void dumpKeyValuePair(const char* key, const char* val);
+		void dumpKeyValuePair(const char* key, int i);
+		void dumpKeyValuePair(const char* key, bool b);
+		void dumpKeyValuePair(const char* key, EntityTables::Access access);
+
+		// Output a closing parenthesis and newline.
+		void finishEntry();
+
+		// Output a series of entries summarizing the defaults.
+		static void dumpDefaultEntries(llvm::raw_ostream& os);
+
+	protected:
+		// Output a comma, if necessary.
+		void checkOutputComma();
+
+	protected:
+		EntryType m_entryType;
+		/// Used to put commas in the correct position.
+		bool m_hasOutputKeyValuePair;
+		llvm::raw_ostream& m_os;
+
+	private:
+		// Private and unimplemented.
+		DumpEntry(DumpEntry& other);
+		DumpEntry& operator=(DumpEntry& other);
+	};
+}
+
+#endif //ENTITIES_H
@@ -0,0 +1,180 @@
+// Copyright (c) 2012 Havok. All rights reserved. This file is distributed under the terms
+// and conditions defined in file 'LICENSE.txt', which is part of this source code package.
+
+#include "escape.h"
+
+#pragma warning(push,0)
+	#include "llvm/Support/MathExtras.h"
+#pragma warning(pop)
+
+// The vector scan is picked at compile time, x86-64 always has SSE2 and AVX2 is used when the
+// compiler targets it (-mavx2, /arch:AVX2)
+#if defined(__AVX2__)
+	#include <immintrin.h>
+	#define ESCAPE_AVX2
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#include <emmintrin.h>
+	#define ESCAPE_SSE2
+#endif
+
+// ----------------------- Static Utility Functions ------------------------- //
+
+static inline bool s_needsEscape(unsigned char c)
+{
+	return c < 0x20 || c == 0x7f || c == '\\' || c == '\'' || c == '"';
+}
+
+// First character of [begin, end) which needs escaping, end if there is none
+static const char* s_findEscapeScalar(const char* begin, const char* end)
+{
+	while(begin != end && !s_needsEscape(*begin))
+	{
+		++begin;
+	}
+	return begin;
+}
+
+#if defined(ESCAPE_AVX2)
+
+static const char* s_findEscape(const char* begin, const char* end)
+{
+	const __m256i backslash = _mm256_set1_epi8('\\');
+	const __m256i quote = _mm256_set1_epi8('\'');
+	const __m256i doubleQuote = _mm256_set1_epi8('"');
+	const __m256i del = _mm256_set1_epi8(0x7f);
+	const __m256i lastControl = _mm256_set1_epi8(0x1f);
+	for( ; end - begin >= 32; begin += 32 )
+	{
+		const __m256i chars = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(begin));
+		// unsigned c <= 0x1f is min(c, 0x1f) == c
+		__m256i found = _mm256_cmpeq_epi8(_mm256_min_epu8(chars, lastControl), chars);
+		found = _mm256_or_si256(found, _mm256_cmpeq_epi8(chars, backslash));
+		found = _mm256_or_si256(found, _mm256_cmpeq_epi8(chars, quote));
+		found = _mm256_or_si256(found, _mm256_cmpeq_epi8(chars, doubleQuote));
+		found = _mm256_or_si256(found, _mm256_cmpeq_epi8(chars, del));
+		const uint32_t mask = uint32_t(_mm256_movemask_epi8(found));
+		if(mask != 0)
+		{
+			return begin + llvm::CountTrailingZeros_32(mask);
+		}
+	}
+	return s_findEscapeScalar(begin, end);
+}
+
+#elif defined(ESCAPE_SSE2)
+
+static const char* s_findEscape(const char* begin, const char* end)
+{
+	const __m128i backslash = _mm_set1_epi8('\\');
+	const __m128i quote = _mm_set1_epi8('\'');
+	const __m128i doubleQuote = _mm_set1_epi8('"');
+	const __m128i del = _mm_set1_epi8(0x7f);
+	const __m128i lastControl = _mm_set1_epi8(0x1f);
+	for( ; end - begin >= 16; begin += 16 )
+	{
+		const __m128i chars = _mm_loadu_si128(reinterpret_cast<const __m128i*>(begin));
+		// unsigned c <= 0x1f is min(c, 0x1f) == c
+		__m128i found = _mm_cmpeq_epi8(_mm_min_epu8(chars, lastControl), chars);
+		found = _mm_or_si128(found, _mm_cmpeq_epi8(chars, backslash));
+		found = _mm_or_si128(found, _mm_cmpeq_epi8(chars, quote));
+		found = _mm_or_si128(found, _mm_cmpeq_epi8(chars, doubleQuote));
+		found = _mm_or_si128(found, _mm_cmpeq_epi8(chars, del));
+		const uint32_t mask = uint32_t(_mm_movemask_epi8(found));
+		if(mask != 0)
+		{
+			return begin + llvm::CountTrailingZeros_32(mask);
+		}
+	}
+	return s_findEscapeScalar(begin, end);
+}
+
+#else
+
+static const char* s_findEscape(const char* begin, const char* end)
+{
+	return s_findEscapeScalar(begin, end);
+}
+
+#endif
+
+static int s_hexDigitValue(char c)
+{
+	if(c >= '0' && c <= '9')
+	{
+		return c - '0';
+	}
+	if(c >= 'a' && c <= 'f')
+	{
+		return c - 'a' + 10;
+	}
+	if(c >= 'A' && c <= 'F')
+	{
+		return c - 'A' + 10;
+	}
+	return -1;
+}
+
+// -------------------------------------------------------------------------- //
+
+void Havok::writeEscaped(llvm::raw_ostream& os, llvm::StringRef str)
+{
+	static const char hexDigits[] = "0123456789abcdef";
+	const char* begin = str.begin();
+	const char* end = str.end();
+	while(true)
+	{
+		const char* escape = s_findEscape(begin, end);
+		if(escape != begin)
+		{
+			os.write(begin, escape - begin);
+		}
+		if(escape == end)
+		{
+			return;
+		}
+		const unsigned char c = *escape;
+		switch(c)
+		{
+			case '\n': os << "\\n"; break;
+			case '\r': os << "\\r"; break;
+			case '\t': os << "\\t"; break;
+			case '\\': case '\'': case '"': os << '\\' << char(c); break;
+			default: os << "\\x" << hexDigits[c >> 4] << hexDigits[c & 15]; break;
+		}
+		begin = escape + 1;
+	}
+}
+
+void Havok::unescape(llvm::StringRef str, std::string& ret)
+{
+	ret.clear();
+	for( size_t i = 0; i < str.size(); ++i )
+	{
+		if(str[i] != '\\' || i + 1 == str.size())
+		{
+			ret += str[i];
+			continue;
+		}
+		const char c = str[++i];
+		switch(c)
+		{
+			case 'n': ret += '\n'; break;
+			case 'r': ret += '\r'; break;
+			case 't': ret += '\t'; break;
+			case 'x':
+				if(i + 2 < str.size() && s_hexDigitValue(str[i + 1]) >= 0 && s_hexDigitValue(str[i + 2]) >= 0)
+				{
+					ret += char(s_hexDigitValue(str[i + 1]) * 16 + s_hexDigitValue(str[i + 2]));
+					i += 2;
+				}
+				else
+				{
+					ret += "\\x";
+				}
+				break;
+			default: ret += c; break;
+		}
+	}
+}
+
+// -------------------------------------------------------------------------- //
@@ -0,0 +1,44 @@
+// Copyright (c) 2012 Havok. All rights reserved. This file is distributed under the terms
+// and conditions defined in file 'LICENSE.txt', which is part of this source code package.
+
+#ifndef ESCAPE_H
+#define ESCAPE_H
+
+#pragma warning(push,0)
+	#include "llvm/ADT/StringRef.h"
+	#include "llvm/Support/raw_ostream.h"
+#pragma warning(pop)
+
+#include <string>
+
+namespace Havok
+{
+	// Write a string so it can be put between quotes in the database: backslashes, quotes and
+	// control characters are escaped the Python way (\\, \', \", \n, \r, \t, \xNN), everything
+	// else is written as is. Runs of characters which need no escaping are written in one go.
+	void writeEscaped(llvm::raw_ostream& os, llvm::StringRef str);
+
+	// Reverse of writeEscaped, the result replaces the content of out
+	void unescape(llvm::StringRef str, std::string& out);
+
+	/// String written escaped by operator<<, see escaped()
+	struct EscapedString
+	{
+		explicit EscapedString(llvm::StringRef str) : m_str(str) {}
+		llvm::StringRef m_str;
+	};
+
+	// os << escaped(str) is the same as writeEscaped(os, str)
+	inline EscapedString escaped(llvm::StringRef str)
+	{
+		return EscapedString(str);
+	}
+
+	inline llvm::raw_ostream& operator<<(llvm::raw_ostream& os, const EscapedString& str)
+	{
+		writeEscaped(os, str.m_str);
+		return os;
+	}
+}
+
+#endif //ESCAPE_H
@@ -3,17 +3,37 @@
 // and conditions defined in file 'LICENSE.txt', which is part of this source code package.
 
 #include "extract.h"
+#include "entities.h"
+#include "escape.h"
+#include "hash.h"
+#include "headerreport.h"
+#include "perfcounters.h"
 #include <cstdio>
 
 #pragma warning(push,0)
+	#include <clang/AST/RecordLayout.h>
 	#include <clang/Basic/SourceManager.h>
 	#include <clang/Sema/Sema.h>
+	#include <llvm/ADT/SmallString.h>
 #pragma warning(pop)
 
 using namespace clang;
 
 #define printf poisoned
 
+namespace
+{
+	// Lock a mutex if there is one (there is only one when dumping in parallel)
+	class OptionalLock
+	{
+		public:
+			OptionalLock(Havok::Mutex* mutex) : m_mutex(mutex) { if(m_mutex) m_mutex->lock(); }
+			~OptionalLock() { if(m_mutex) m_mutex->unlock(); }
+		private:
+			Havok::Mutex* m_mutex;
+	};
+}
+
 // ----------------------- Static Utility Functions ------------------------- //
 
 static SourceLocation s_getExpansionLoc(const SourceLocation& loc, SourceManager& sm)
@@ -52,61 +72,110 @@ static FileID s_getFileId(const SourceLocation& loc, SourceManager& sm)
 
 static void s_printName(llvm::raw_ostream& os, const NamedDecl* decl)
 {
-	os << ", name='";
+	llvm::SmallString<64> name;
+	{
+		llvm::raw_svector_ostream nameStream(name);
+		decl->printName(nameStream);
+	}
+	os << ", name='" << Havok::escaped(name.str()) << "'";
+}
+
+static std::string s_getName(const NamedDecl* decl)
+{
+	std::string buf;
+	llvm::raw_string_ostream os(buf);
 	decl->printName(os);
-	os << "'";
+	return os.str();
 }
 
-static void s_printRecordFlags(llvm::raw_ostream& os, const CXXRecordDecl* decl)
+static unsigned s_getRecordTableFlags(const CXXRecordDecl* decl)
 {
-	bool isPolymorphic = false;
-	bool isAbstract = false;
+	unsigned flags = 0;
 	if(decl->hasDefinition())
 	{
 		// the class contains or inherits a virtual function
-		isPolymorphic = decl->isPolymorphic();
+		flags |= decl->isPolymorphic() ? Havok::EntityTables::FLAG_POLYMORPHIC : 0;
 		// the class contains or inherits a pure virtual function
-		isAbstract = decl->isAbstract();
+		flags |= decl->isAbstract() ? Havok::EntityTables::FLAG_ABSTRACT : 0;
 	}
-	os << ", polymorphic=" << (isPolymorphic ? "True" : "False");
-	os << ", abstract=" << (isAbstract ? "True" : "False");
+	return flags;
 }
 
-inline static void s_printDefaultRecordFlags(llvm::raw_ostream& os)
+// Returns the layout of the record definition, or NULL when there is no layout to speak of
+// (the record is incomplete, invalid or depends on template parameters). The context computes
+// the layouts on demand and caches them, it is locked when dumping in parallel.
+static const ASTRecordLayout* s_getRecordLayout(ASTContext& context, const RecordDecl* decl, Havok::Mutex* astMutex)
 {
-	os << ", polymorphic=False, abstract=False";
-}
-
-static void s_printAnnotations(llvm::raw_ostream& os, const Decl* decl, int declId)
-{
-	if(decl->hasAttr<AnnotateAttr>())
+	const RecordDecl* def = decl->getDefinition();
+	if(def == NULL || def->isInvalidDecl() || def->isDependentType())
 	{
-		const AttrVec& attrVec = decl->getAttrs();
-		for( specific_attr_iterator<AnnotateAttr> iterator = specific_attr_begin<AnnotateAttr>(attrVec), end_iterator = specific_attr_end<AnnotateAttr>(attrVec);
-			iterator != end_iterator; 
-			++iterator )
-		{
-			os << "Annotation( refid=" << declId << ", text=\"\"\"";
-			os << iterator->getAnnotation();
-			os << "\"\"\" )\n";
-		}
+		return NULL;
 	}
+	OptionalLock lock(astMutex);
+	return &context.getASTRecordLayout(def);
 }
 
 static const Type* s_getTrueType(const Type* type)
 {
-	if(const SubstTemplateTypeParmType* substType = type->getAs<SubstTemplateTypeParmType>())
+	// both are sugar, only the type itself can be one of them
+	if(type->getTypeClass() == Type::SubstTemplateTypeParm)
 	{
-		type = substType->getReplacementType().getTypePtr();
+		type = cast<SubstTemplateTypeParmType>(type)->getReplacementType().getTypePtr();
 	}
-	if(const ElaboratedType* elabType = type->getAs<ElaboratedType>())
+	if(type->getTypeClass() == Type::Elaborated)
 	{
-		return elabType->getNamedType().getTypePtr();
+		return cast<ElaboratedType>(type)->getNamedType().getTypePtr();
 	}
 
 	return type;
 }
 
+// Type classes which are recognized through any sugar, like getAs<>() does
+static bool s_isClassifiedThroughSugar(Type::TypeClass typeClass)
+{
+	switch(typeClass)
+	{
+		case Type::TemplateTypeParm:
+		case Type::Builtin:
+		case Type::Pointer:
+		case Type::LValueReference:
+		case Type::RValueReference:
+		case Type::MemberPointer:
+		case Type::Record:
+		case Type::Enum:
+			return true;
+		default:
+			return false;
+	}
+}
+
+// The member of an implicit class template instantiation is the substitution of a member of the template
+static bool s_isInstantiatedFromPattern(const Decl* decl)
+{
+	if( const FunctionDecl* functionDecl = dyn_cast<FunctionDecl>(decl) )
+	{
+		// implicitly declared members have no pattern
+		return functionDecl->getInstantiatedFromMemberFunction() != NULL &&
+			functionDecl->getTemplateSpecializationKind() != TSK_ExplicitSpecialization;
+	}
+	if( const FunctionTemplateDecl* functionTemplateDecl = dyn_cast<FunctionTemplateDecl>(decl) )
+	{
+		return functionTemplateDecl->getInstantiatedFromMemberTemplate() != NULL;
+	}
+	if( const VarDecl* varDecl = dyn_cast<VarDecl>(decl) )
+	{
+		return varDecl->getInstantiatedFromStaticDataMember() != NULL &&
+			varDecl->getTemplateSpecializationKind() != TSK_ExplicitSpecialization;
+	}
+	if( const CXXRecordDecl* recordDecl = dyn_cast<CXXRecordDecl>(decl) )
+	{
+		return recordDecl->getInstantiatedFromMemberClass() != NULL &&
+			recordDecl->getTemplateSpecializationKind() != TSK_ExplicitSpecialization;
+	}
+	// fields, enums, typedefs... are always instantiated from the template
+	return !decl->isImplicit();
+}
+
 static const ClassTemplateDecl* s_getClassTemplateDefinition(const ClassTemplateDecl* classTemplateDecl)
 {
 	const ClassTemplateDecl* current = NULL;
@@ -122,12 +191,89 @@ static const ClassTemplateDecl* s_getClassTemplateDefinition(const ClassTemplate
 	return NULL;
 }
 
+// Strings are terminated so that "ab","c" and "a","bc" hash differently
+static void s_hashString(Havok::Fnv64& hash, llvm::StringRef str)
+{
+	hash.update(str.data(), str.size());
+	hash.update("", 1);
+}
+
+static void s_hashInteger(Havok::Fnv64& hash, uint64_t value)
+{
+	char bytes[8];
+	for( int i = 0; i < 8; ++i )
+	{
+		bytes[i] = char(value >> (8 * i));
+	}
+	hash.update(bytes, sizeof(bytes));
+}
+
+static void s_hashAnnotations(Havok::Fnv64& hash, const Decl* decl)
+{
+	if(decl->hasAttr<AnnotateAttr>())
+	{
+		const AttrVec& attrVec = decl->getAttrs();
+		for( specific_attr_iterator<AnnotateAttr> it = specific_attr_begin<AnnotateAttr>(attrVec), end = specific_attr_end<AnnotateAttr>(attrVec); it != end; ++it )
+		{
+			s_hashString(hash, it->getAnnotation());
+		}
+	}
+}
+
+static void s_hashTemplateParameterList(Havok::Fnv64& hash, const TemplateParameterList* paramList, const PrintingPolicy& policy)
+{
+	for( TemplateParameterList::const_iterator it = paramList->begin(); it != paramList->end(); ++it )
+	{
+		s_hashString(hash, (*it)->getDeclKindName());
+		s_hashString(hash, s_getName(*it));
+		if( const NonTypeTemplateParmDecl* nonTypeTemplateParmDecl = dyn_cast<NonTypeTemplateParmDecl>(*it) )
+		{
+			s_hashString(hash, nonTypeTemplateParmDecl->getType().getCanonicalType().getAsString(policy));
+		}
+		else if( const TemplateTemplateParmDecl* templateTemplateParmDecl = dyn_cast<TemplateTemplateParmDecl>(*it) )
+		{
+			s_hashTemplateParameterList(hash, templateTemplateParmDecl->getTemplateParameters(), policy);
+		}
+	}
+	s_hashInteger(hash, paramList->size());
+}
+
 // ------------------- ExtractASTConsumer Implementation -------------------- //
 
 // Initialize the database object with its global state. Each consumer object is only expected to be used once
 Havok::ExtractASTConsumer::ExtractASTConsumer(llvm::raw_ostream& os)
-	: m_context(0), m_sema(0), m_os(os), m_dumpBits( DUMP_DEFAULT /*DUMP_FUNCTIONS*/ )
+	: m_context(0), m_sema(0), m_os(os), m_dumpBits( DUMP_DEFAULT /*DUMP_FUNCTIONS*/ ), m_instantiationBudget(-1), m_sharedDesugaredTypes(0), m_numSharedTypes(0), m_numWrittenRows(0), m_headerReport(0), m_perfCounters(0), m_astMutex(0)
+{
+	m_fileNames = &m_fileNameStorage;
+	m_tables = &m_tableStorage;
+}
+
+// Consumer of a chunk of the parallel dump, dumpAllDeclarationsParallel() sets the allocators
+// to their state at the start of the chunk
+Havok::ExtractASTConsumer::ExtractASTConsumer(const ExtractASTConsumer& claim, unsigned chunk, llvm::raw_ostream& os)
+	: SemaConsumer(claim),
+	m_os(os),
+	m_context(claim.m_context),
+	m_sharedDesugaredTypes(&claim.m_desugaredTypes),
+	m_numSharedTypes(0),
+	m_fileNames(claim.m_fileNames),
+	m_uid(claim.m_uid),
+	m_dumpBits(claim.m_dumpBits),
+	m_instantiationBudget(claim.m_instantiationBudget),
+	m_sema(claim.m_sema),
+	m_numWrittenRows(0),
+	m_headerReport(claim.m_headerReport),
+	m_perfCounters(claim.m_perfCounters),
+	m_astMutex(claim.m_astMutex)
 {
+	m_tables = &m_tableStorage;
+	m_knownTypes.shareHistory(claim.m_knownTypes, chunk);
+	m_structuralTypes.shareHistory(claim.m_structuralTypes, chunk);
+	m_constTypeIdMap.shareHistory(claim.m_constTypeIdMap, chunk);
+	m_knownNamespaces.shareHistory(claim.m_knownNamespaces, chunk);
+	m_knownFiles.shareHistory(claim.m_knownFiles, chunk);
+	m_entryScopes.shareHistory(claim.m_entryScopes, chunk);
+	m_knowTemplateTemplateParams.shareHistory(claim.m_knowTemplateTemplateParams, chunk);
 }
 
 Havok::ExtractASTConsumer::~ExtractASTConsumer()
@@ -141,6 +287,32 @@ void Havok::ExtractASTConsumer::Initialize(ASTContext &Context)
 	m_context = &Context;
 }
 
+void Havok::ExtractASTConsumer::addDumpBits(DumpBits bits)
+{
+	m_dumpBits = DumpBits(m_dumpBits | bits);
+}
+
+void Havok::ExtractASTConsumer::setInstantiationBudget(int budget)
+{
+	m_instantiationBudget = budget;
+}
+
+void Havok::ExtractASTConsumer::setEntityTables(EntityTables* tables)
+{
+	m_tables = tables != NULL ? tables : &m_tableStorage;
+	m_numWrittenRows = m_tables->getOrder().size();
+}
+
+void Havok::ExtractASTConsumer::setHeaderReport(HeaderReport* headerReport)
+{
+	m_headerReport = headerReport;
+}
+
+void Havok::ExtractASTConsumer::setPerfCounters(PerfCounters* perfCounters)
+{
+	m_perfCounters = perfCounters;
+}
+
 void Havok::ExtractASTConsumer::InitializeSema(Sema& sema)
 {
 	// Remember the sema instance so we can use it to perform semantic analysis
@@ -189,8 +361,23 @@ void Havok::ExtractASTConsumer::HandleTopLevelDecl(DeclGroupRef declGroupIn)
 	// returned as a group. [ e.g. class A { ... } B; ] Usually each group only contains one declaration.
 	for (DeclGroupRef::iterator iter = declGroupIn.begin(), iterEnd = declGroupIn.end(); iter != iterEnd; ++iter)
 	{
-		declareImplicitMethods(*iter);
+		// the counters are only read around the declarations which can have implicit members
+		if( m_perfCounters && (isa<CXXRecordDecl>(*iter) || isa<NamespaceDecl>(*iter)) )
+		{
+			const PerfCounters::Phase phase = m_perfCounters->getPhase();
+			m_perfCounters->enterPhase(PerfCounters::PHASE_IMPLICIT_MEMBERS);
+			declareImplicitMethods(*iter);
+			m_perfCounters->enterPhase(phase);
+		}
+		else
+		{
+			declareImplicitMethods(*iter);
+		}
 		m_decls.push_back(*iter);
+		if( m_headerReport )
+		{
+			m_headerReport->addDeclaration(*iter);
+		}
 	}
 }
 
@@ -198,174 +385,386 @@ void Havok::ExtractASTConsumer::dumpAllDeclarations()
 {
 	DumpEntry::dumpDefaultEntries(m_os);
 
-	for( std::list<const clang::Decl*>::const_iterator it = m_decls.begin();
-	     it != m_decls.end();
-	     ++it )
+	if(!m_roots.empty())
+	{
+		// only dump what can be reached from the root declarations
+		dumpRoots_i();
+	}
+	else
 	{
-		dumpDecl_i(*it);
+		dumpDeclRange_i(m_decls.begin(), m_decls.end());
 	}
+	dumpStatistics_i(m_numSharedTypes);
 }
 
+void Havok::ExtractASTConsumer::dumpStatistics_i(int numSharedTypes)
+{
+	if( m_dumpBits & DUMP_CANONICAL_TYPES )
+	{
+		std::string comment;
+		llvm::raw_string_ostream commentStream(comment);
+		commentStream << "## Structural types shared: " << numSharedTypes;
+		m_tables->addComment(commentStream.str());
+		writeRows_i();
+	}
+}
 
-static const char* entryNames[] =
+void Havok::ExtractASTConsumer::writeRows_i()
 {
-	"Method",
-	"Constructor",
-	"Destructor",
-	"Field",
-	NULL
-};
+	if( m_tables == NULL )
+	{
+		// claim walk
+		return;
+	}
+	const unsigned numRows = m_tables->getOrder().size();
+	EntityTextWriter::writeRows(*m_tables, m_numWrittenRows, numRows, m_os);
+	m_numWrittenRows = numRows;
+	if( m_tables == &m_tableStorage )
+	{
+		// nothing refers to the rows once written
+		m_tableStorage.clear();
+		m_numWrittenRows = 0;
+	}
+}
 
-struct KeyValuePair
+void Havok::ExtractASTConsumer::dumpDeclRange_i(DeclList::const_iterator begin, DeclList::const_iterator end)
 {
-	const char* m_key;
-	const char* m_value;
-};
+	for( DeclList::const_iterator it = begin; it != end; ++it )
+	{
+		if( m_headerReport )
+		{
+			dumpDeclWithCost_i(*it);
+		}
+		else
+		{
+			dumpDecl_i(*it);
+			writeRows_i();
+		}
+	}
+}
 
-static const KeyValuePair methodDefaults[] =
+void Havok::ExtractASTConsumer::dumpDeclWithCost_i(const Decl* declIn)
 {
-	{"static", "False"},
-	{"const", "False"},
-	{"isCopyAssignment", "False"},
-	{"isImplicit", "False"},
-	{"access", "\"public\""},
-	{"numParamDefaults", "0"},
-	{NULL, NULL}
-};
+	const int firstId = m_uid.peek();
+	const uint64_t startPos = m_os.tell();
+	const double startTime = HeaderReport::s_getTime();
+	dumpDecl_i(declIn);
+	writeRows_i();
+	m_headerReport->addDumpCost(declIn, m_uid.peek() - firstId, m_os.tell() - startPos, HeaderReport::s_getTime() - startTime);
+}
 
-static const KeyValuePair constructorDefaults[] =
-{
-	{"static", "False"},
-	{"const", "False"},
-	{"isCopyAssignment", "False"},
-	{"isImplicit", "False"},
-	{"isCopyConstructor", "False"},
-	{"isDefaultConstructor", "False"},
-	{"access", "\"public\""},
-	{"numParamDefaults", "0"},
-	{NULL, NULL}
+// Chunks of declarations dumped by the worker threads of dumpAllDeclarationsParallel
+struct Havok::ExtractASTConsumer::ParallelDumpJob
+{
+	struct Chunk
+	{
+		DeclList::const_iterator m_begin;
+		DeclList::const_iterator m_end;
+		// Allocators in the state the claim walk had at the start of the chunk
+		UidAllocator m_uid;
+		int m_instantiationBudget;
+		ExtractASTConsumer* m_consumer;
+		// Rows of the chunk, kept for the tables of the caller (optional)
+		EntityTables* m_tables;
+		std::string m_text;
+		llvm::raw_string_ostream* m_stream;
+	};
+	std::vector<Chunk> m_chunks;
+	size_t m_nextChunk;
+	Mutex m_mutex;
+
+	// Worker thread function, dumps the chunks until there are none left
+	static void s_run(void* userData)
+	{
+		ParallelDumpJob& job = *static_cast<ParallelDumpJob*>(userData);
+		while(true)
+		{
+			size_t index;
+			{
+				ScopedLock lock(job.m_mutex);
+				index = job.m_nextChunk++;
+			}
+			if(index >= job.m_chunks.size())
+			{
+				return;
+			}
+			Chunk& chunk = job.m_chunks[index];
+			chunk.m_consumer->dumpDeclRange_i(chunk.m_begin, chunk.m_end);
+			chunk.m_stream->flush();
+		}
+	}
 };
 
-static const KeyValuePair* destructorDefaults = methodDefaults;
-
-static const KeyValuePair fieldDefaults[] =
+void Havok::ExtractASTConsumer::dumpAllDeclarationsParallel(int numThreads)
 {
-	{"access", "\"public\""},
-	{NULL, NULL}
-};
+	// Declarations of imported modules are deserialized lazily, the AST is then not read-only.
+	// The header report measures each declaration as it is dumped.
+	if( numThreads <= 1 || !m_roots.empty() || m_context->getExternalSource() != NULL || m_headerReport != NULL )
+	{
+		dumpAllDeclarations();
+		return;
+	}
+
+	DumpEntry::dumpDefaultEntries(m_os);
+
+	// 1: claim the entity ids with a walk which only allocates them, without tables nothing is
+	// named or formatted. The ids it sets are kept with their chunk, the consumers of the chunks
+	// share them instead of copying the maps. Chunks are smaller than numThreads equal parts so
+	// that the workers stay busy when some chunks are more expensive than others.
+	ParallelDumpJob job;
+	job.m_nextChunk = 0;
+	const size_t numChunks = numThreads * 8;
+	const size_t chunkSize = (m_decls.size() + numChunks - 1) / numChunks;
+	DeclList::const_iterator it = m_decls.begin();
+	while( it != m_decls.end() )
+	{
+		ParallelDumpJob::Chunk chunk;
+		chunk.m_begin = it;
+		for( size_t i = 0; i < chunkSize && it != m_decls.end(); ++i )
+		{
+			++it;
+		}
+		chunk.m_end = it;
+		job.m_chunks.push_back(chunk);
+	}
+	EntityTables* tables = m_tables != &m_tableStorage ? m_tables : NULL;
+	m_tables = NULL;
+	keepIdHistory_i();
+	for( size_t i = 0; i < job.m_chunks.size(); ++i )
+	{
+		ParallelDumpJob::Chunk& chunk = job.m_chunks[i];
+		chunk.m_uid = m_uid;
+		chunk.m_instantiationBudget = m_instantiationBudget;
+		setIdChunk_i(unsigned(i + 1));
+		dumpDeclRange_i(chunk.m_begin, chunk.m_end);
+	}
+	m_tables = tables != NULL ? tables : &m_tableStorage;
+
+	// 2: dump the chunks in parallel, each from the state at its start, which gives the ids of the claim walk
+	for( size_t i = 0; i < job.m_chunks.size(); ++i )
+	{
+		ParallelDumpJob::Chunk& chunk = job.m_chunks[i];
+		chunk.m_stream = new llvm::raw_string_ostream(chunk.m_text);
+		chunk.m_consumer = new ExtractASTConsumer(*this, unsigned(i + 1), *chunk.m_stream);
+		chunk.m_consumer->m_uid = chunk.m_uid;
+		chunk.m_consumer->m_instantiationBudget = chunk.m_instantiationBudget;
+		chunk.m_consumer->m_astMutex = &job.m_mutex;
+		chunk.m_tables = NULL;
+		if( tables != NULL )
+		{
+			chunk.m_tables = new EntityTables();
+			chunk.m_consumer->setEntityTables(chunk.m_tables);
+		}
+	}
+	{
+		std::vector<Thread*> threads;
+		for( int i = 0; i < numThreads; ++i )
+		{
+			threads.push_back(new Thread());
+			if(!threads.back()->start(&ParallelDumpJob::s_run, &job))
+			{
+				// could not create a thread, this one takes the chunks
+				ParallelDumpJob::s_run(&job);
+			}
+		}
+		for( unsigned int i = 0; i < threads.size(); ++i )
+		{
+			threads[i]->join();
+			delete threads[i];
+		}
+	}
 
+	// 3: concatenate the chunks in order
+	for( std::vector<ParallelDumpJob::Chunk>::iterator chunk = job.m_chunks.begin(); chunk != job.m_chunks.end(); ++chunk )
+	{
+		m_os << chunk->m_text;
+		if( chunk->m_tables != NULL )
+		{
+			tables->append(*chunk->m_tables);
+			delete chunk->m_tables;
+		}
+		delete chunk->m_consumer;
+		delete chunk->m_stream;
+	}
+	clearIdHistory_i();
+	m_numWrittenRows = m_tables->getOrder().size();
+	dumpStatistics_i(m_numSharedTypes);
+}
 
-static const KeyValuePair* defaults[] =
+void Havok::ExtractASTConsumer::keepIdHistory_i()
 {
-	methodDefaults,
-	constructorDefaults,
-	destructorDefaults,
-	fieldDefaults,
-	NULL,
-};
+	m_knownTypes.keepHistory();
+	m_structuralTypes.keepHistory();
+	m_constTypeIdMap.keepHistory();
+	m_knownNamespaces.keepHistory();
+	m_knownFiles.keepHistory();
+	m_entryScopes.keepHistory();
+	m_knowTemplateTemplateParams.keepHistory();
+}
 
-Havok::ExtractASTConsumer::DumpEntry::DumpEntry(llvm::raw_ostream& os, EntryType et)
-	: m_entryType(et)
-	, m_hasOutputKeyValuePair(false)
-	, m_os(os)
+void Havok::ExtractASTConsumer::setIdChunk_i(unsigned chunk)
 {
-	assert(0 <= et);
-	assert(et < NUM_ENTRIES);
-	// Check the entry names array has the correct size.
-	assert((sizeof(entryNames) / sizeof(const char*)) == NUM_ENTRIES + 1);
-	assert((sizeof(defaults) / sizeof(const KeyValuePair*)) == NUM_ENTRIES + 1);
-	m_os << entryNames[et] << "( ";
+	m_knownTypes.setChunk(chunk);
+	m_structuralTypes.setChunk(chunk);
+	m_constTypeIdMap.setChunk(chunk);
+	m_knownNamespaces.setChunk(chunk);
+	m_knownFiles.setChunk(chunk);
+	m_entryScopes.setChunk(chunk);
+	m_knowTemplateTemplateParams.setChunk(chunk);
 }
 
-void Havok::ExtractASTConsumer::DumpEntry::checkOutputComma()
+void Havok::ExtractASTConsumer::clearIdHistory_i()
 {
-	if (m_hasOutputKeyValuePair)
-	{
-		m_os << ", ";
-	}
-	m_hasOutputKeyValuePair = true;
+	m_knownTypes.clearHistory();
+	m_structuralTypes.clearHistory();
+	m_constTypeIdMap.clearHistory();
+	m_knownNamespaces.clearHistory();
+	m_knownFiles.clearHistory();
+	m_entryScopes.clearHistory();
+	m_knowTemplateTemplateParams.clearHistory();
 }
 
-void Havok::ExtractASTConsumer::DumpEntry::finishEntry()
+void Havok::ExtractASTConsumer::addRoot(const std::string& qualifiedName)
 {
-	m_os << " )\n";
+	// names are matched without the leading global scope specifier
+	if(qualifiedName.compare(0, 2, "::") == 0)
+	{
+		m_roots.push_back(qualifiedName.substr(2));
+	}
+	else
+	{
+		m_roots.push_back(qualifiedName);
+	}
 }
 
-void Havok::ExtractASTConsumer::DumpEntry::dumpKeyValuePair(const char* key, const char* val)
+void Havok::ExtractASTConsumer::dumpRoots_i()
 {
-	const KeyValuePair* kvpairs = defaults[m_entryType];
-	if (kvpairs != NULL)
+	// 1: look for the root declarations and queue their definitions
+	std::vector<bool> rootFound(m_roots.size(), false);
+	for( std::list<const clang::Decl*>::const_iterator it = m_decls.begin();
+	     it != m_decls.end();
+	     ++it )
+	{
+		findRootDecls_i(*it, rootFound);
+	}
+	for( unsigned int i = 0; i < m_roots.size(); ++i )
 	{
-		while (kvpairs->m_key != NULL)
+		if(!rootFound[i])
 		{
-			if (strcmp(kvpairs->m_key, key) == 0)
-			{
-				if (strcmp(kvpairs->m_value, val) == 0)
-				{
-					return;
-				}
-				else
-				{
-					break;
-				}
-			}
-			++kvpairs;
+			m_tables->addComment("## Root declaration not found: " + m_roots[i]);
 		}
 	}
-	checkOutputComma();
-	m_os << key << "=" << val;
-}
+	writeRows_i();
 
-void Havok::ExtractASTConsumer::DumpEntry::dumpKeyValuePair(const char* key, int i)
-{
-	char buf[10];
-	snprintf(buf, sizeof(buf), "%d", i);
-	dumpKeyValuePair(key, buf);
+	// 2: dump the queued definitions, types are dumped on demand as usual and every record, enum
+	// or template reached this way queues its own definition, so the queue grows while we walk it.
+	for( unsigned int i = 0; i < m_pendingDefinitions.size(); ++i )
+	{
+		if( m_headerReport )
+		{
+			dumpDeclWithCost_i(m_pendingDefinitions[i]);
+		}
+		else
+		{
+			dumpDecl_i(m_pendingDefinitions[i]);
+			writeRows_i();
+		}
+	}
 }
 
-void Havok::ExtractASTConsumer::DumpEntry::dumpKeyValuePair(const char* key, bool b)
+void Havok::ExtractASTConsumer::findRootDecls_i(const Decl* decl, std::vector<bool>& rootFound)
 {
-	dumpKeyValuePair(key, (b ? "True" : "False"));
-}
+	if( const NamespaceDecl* namespaceDecl = dyn_cast<NamespaceDecl>(decl) )
+	{
+		for( DeclContext::decl_iterator it = namespaceDecl->decls_begin(); it != namespaceDecl->decls_end(); ++it )
+		{
+			findRootDecls_i(*it, rootFound);
+		}
+		return;
+	}
 
-void Havok::ExtractASTConsumer::DumpEntry::dumpKeyValuePair(const char* key, AccessSpecifier as)
-{
-	switch(as)
+	const NamedDecl* namedDecl = NULL;
+	const TagDecl* nestedContext = NULL;
+	if( const ClassTemplateDecl* classTemplateDecl = dyn_cast<ClassTemplateDecl>(decl) )
+	{
+		namedDecl = classTemplateDecl;
+	}
+	else if( isa<ClassTemplateSpecializationDecl>(decl) )
+	{
+		// specializations are reached through the types referring to them
+	}
+	else if( const TagDecl* tagDecl = dyn_cast<TagDecl>(decl) )
+	{
+		if( tagDecl->isCompleteDefinition() )
+		{
+			namedDecl = tagDecl;
+			nestedContext = tagDecl;
+		}
+	}
+	else if( const TypedefDecl* typedefDecl = dyn_cast<TypedefDecl>(decl) )
 	{
-	case AS_private:
-		dumpKeyValuePair(key, "\"private\"");
-		break;
-	case AS_protected:
-		dumpKeyValuePair(key, "\"protected\"");
-		break;
-	case AS_public:
-		dumpKeyValuePair(key, "\"public\"");
-		break;
-	default:
-		assert(false);
+		namedDecl = typedefDecl;
+	}
+
+	if( namedDecl != NULL && namedDecl->getIdentifier() != NULL )
+	{
+		const std::string qualifiedName = namedDecl->getQualifiedNameAsString();
+		for( unsigned int i = 0; i < m_roots.size(); ++i )
+		{
+			if( m_roots[i] == qualifiedName )
+			{
+				rootFound[i] = true;
+				queueDefinition_i(namedDecl);
+			}
+		}
+	}
+
+	if( nestedContext != NULL )
+	{
+		// nested records can be roots too
+		for( DeclContext::decl_iterator it = nestedContext->decls_begin(); it != nestedContext->decls_end(); ++it )
+		{
+			findRootDecls_i(*it, rootFound);
+		}
 	}
 }
 
-void Havok::ExtractASTConsumer::DumpEntry::dumpDefaultEntries(llvm::raw_ostream& os)
+void Havok::ExtractASTConsumer::queueDefinition_i(const Decl* decl)
 {
-	for (int i = 0; i < NUM_ENTRIES; ++i)
+	// queue the definition rather than the given declaration whenever there is one
+	if( const ClassTemplateDecl* classTemplateDecl = dyn_cast<ClassTemplateDecl>(decl) )
 	{
-		os << "DefaultsFor" << entryNames[i] << "( ";
-		const KeyValuePair* kvpairs = defaults[i];
-		if (kvpairs->m_key != NULL)
+		if( const ClassTemplateDecl* classTemplateDef = s_getClassTemplateDefinition(classTemplateDecl) )
 		{
-			os << kvpairs->m_key << "=" << kvpairs->m_value;
-			++kvpairs;
+			decl = classTemplateDef;
 		}
-		while (kvpairs->m_key != NULL)
+	}
+	else if( const TagDecl* tagDecl = dyn_cast<TagDecl>(decl) )
+	{
+		if( const TagDecl* tagDef = tagDecl->getDefinition() )
 		{
-			os << ", " << kvpairs->m_key << "=" << kvpairs->m_value;
-			++kvpairs;
+			decl = tagDef;
 		}
-		os << " )\n";
 	}
+
+	if( m_queuedDefinitions.insert(decl) )
+	{
+		m_pendingDefinitions.push_back(decl);
+	}
+}
+
+bool Havok::ExtractASTConsumer::claimDefinition_i(const TagDecl* tagDecl)
+{
+	// When dumping from root declarations the same definition can be reached more than once,
+	// e.g. a nested record referred to before its parent definition is dumped.
+	if( m_roots.empty() )
+	{
+		return true;
+	}
+	return m_dumpedDefinitions.insert(tagDecl);
 }
 
+
 int Havok::ExtractASTConsumer::dumpDecl_i(const Decl* declIn)
 {
 	if( dyn_cast<AccessSpecDecl>(declIn) )
@@ -387,9 +786,9 @@ int Havok::ExtractASTConsumer::dumpDecl_i(const Decl* declIn)
 		const TagDecl* tagDef = tagDecl->getDefinition();
 		int scopeId = dumpScope_i(tagDef != NULL ? tagDef : tagDecl);
 		int typeId = dumpType_i(m_context->getTagDeclType(tagDecl), scopeId);
-		if( tagDecl->isCompleteDefinition() )
+		if( tagDecl->isCompleteDefinition() && claimDefinition_i(tagDecl) )
 		{
-			s_printAnnotations(m_os, tagDecl, typeId);
+			dumpAnnotations_i(tagDecl, typeId);
 			dumpTagDefinition_i(tagDecl, typeId);
 		}
 	}
@@ -404,14 +803,22 @@ int Havok::ExtractASTConsumer::dumpDecl_i(const Decl* declIn)
 		// the containing record type has already been dumped
 		int recId = getTypeId_i( m_context->getRecordType(fieldDecl->getParent()).getTypePtr() );
 		int fieldId = m_uid.alloc();
-		DumpEntry e(m_os, DumpEntry::ENTRY_FIELD);
-		e.dumpKeyValuePair("id", fieldId);
-		e.dumpKeyValuePair("recordid", recId);
-		e.dumpKeyValuePair("typeid", tid);
-		e.dumpKeyValuePair("access", fieldDecl->getAccess());
-		s_printName(m_os, fieldDecl);
-		e.finishEntry();
-		s_printAnnotations(m_os, fieldDecl, fieldId);
+		if( m_tables )
+		{
+			// the offset of the bit fields is in bits
+			const unsigned flags = fieldDecl->isBitField() ? EntityTables::FLAG_BIT_FIELD : 0;
+			int64_t offset = -1;
+			if( m_dumpBits & DUMP_LAYOUTS )
+			{
+				if( const ASTRecordLayout* layout = s_getRecordLayout(*m_context, fieldDecl->getParent(), m_astMutex) )
+				{
+					uint64_t offsetInBits = layout->getFieldOffset(fieldDecl->getFieldIndex());
+					offset = fieldDecl->isBitField() ? int64_t(offsetInBits) : m_context->toCharUnitsFromBits(offsetInBits).getQuantity();
+				}
+			}
+			m_tables->addField(fieldId, recId, tid, s_getName(fieldDecl), EntityTables::Access(fieldDecl->getAccess()), flags, offset);
+		}
+		dumpAnnotations_i(fieldDecl, fieldId);
 	}
 	else if( const CXXMethodDecl* methodDecl = dyn_cast<CXXMethodDecl>(declIn) )
 	{
@@ -432,42 +839,23 @@ int Havok::ExtractASTConsumer::dumpDecl_i(const Decl* declIn)
 			int recId = getTypeId_i( m_context->getRecordType(parentRecord).getTypePtr() );
 			int methodId = m_uid.alloc();
 
-			const CXXConstructorDecl* constructorDecl = dyn_cast<CXXConstructorDecl>(methodDecl);
-			const CXXDestructorDecl* destructorDecl = dyn_cast<CXXDestructorDecl>(methodDecl);
-			DumpEntry::EntryType et;
-
-			if (constructorDecl)
-			{
-				et = DumpEntry::ENTRY_CONSTRUCTOR;
-			}
-			else if (destructorDecl)
-			{
-				et = DumpEntry::ENTRY_DESTRUCTOR;
-			}
-			else
+			if( m_tables )
 			{
-				et = DumpEntry::ENTRY_METHOD;
-			}
-
-			DumpEntry e(m_os, et);
+				const CXXConstructorDecl* constructorDecl = dyn_cast<CXXConstructorDecl>(methodDecl);
+				const CXXDestructorDecl* destructorDecl = dyn_cast<CXXDestructorDecl>(methodDecl);
+				EntityTables::MethodKind kind = EntityTables::METHOD_METHOD;
+				unsigned flags = 0;
+				flags |= methodDecl->isStatic() ? EntityTables::FLAG_STATIC : 0;
+				flags |= (methodDecl->getTypeQualifiers() & Qualifiers::Const) ? EntityTables::FLAG_CONST : 0;
 
-			e.dumpKeyValuePair("id", methodId);
-			e.dumpKeyValuePair("recordid", recId);
-			e.dumpKeyValuePair("typeid", tid);
-			e.dumpKeyValuePair("static", methodDecl->isStatic());
-			e.dumpKeyValuePair("const", (bool)((methodDecl->getTypeQualifiers() & Qualifiers::Const)));
-			{
 				// Determine if this was explicitly declared by user, or auto-generated.
 				bool implicitlyDeclared = false;
-				bool defaultConstructor = false;
-				bool copyConstructor = false;
-				bool copyAssignment = false;
-
 				if ( constructorDecl )
 				{
+					kind = EntityTables::METHOD_CONSTRUCTOR;
 					if (constructorDecl->isCopyConstructor())
 					{
-						copyConstructor = true;
+						flags |= EntityTables::FLAG_COPY_CONSTRUCTOR;
 						if (!parentRecord->hasUserDeclaredCopyConstructor())
 						{
 							implicitlyDeclared = true;
@@ -476,17 +864,16 @@ int Havok::ExtractASTConsumer::dumpDecl_i(const Decl* declIn)
 					// Any user declared constructor suppresses the auto-generation of a default constructor.
 					else if (constructorDecl->isDefaultConstructor())
 					{
-						defaultConstructor = true;
+						flags |= EntityTables::FLAG_DEFAULT_CONSTRUCTOR;
 						if (!parentRecord->hasUserDeclaredConstructor())
 						{
 							implicitlyDeclared = true;
 						}
 					}
-					e.dumpKeyValuePair("isDefaultConstructor", defaultConstructor);
-					e.dumpKeyValuePair("isCopyConstructor", copyConstructor);
 				}
 				else if ( destructorDecl )
 				{
+					kind = EntityTables::METHOD_DESTRUCTOR;
 					if (!parentRecord->hasUserDeclaredDestructor())
 					{
 						implicitlyDeclared = true;
@@ -494,31 +881,32 @@ int Havok::ExtractASTConsumer::dumpDecl_i(const Decl* declIn)
 				}
 				else if (methodDecl->isCopyAssignmentOperator())
 				{
-					copyAssignment = true;
+					flags |= EntityTables::FLAG_COPY_ASSIGNMENT;
 					if(!parentRecord->hasUserDeclaredCopyAssignment())
 					{
 						implicitlyDeclared = true;
 					}
 				}
-				e.dumpKeyValuePair("isCopyAssignment", copyAssignment);
-				e.dumpKeyValuePair("isImplicit", implicitlyDeclared);
+				flags |= implicitlyDeclared ? EntityTables::FLAG_IMPLICIT : 0;
+
+				// We use this value as it has a more obvious default.
+				m_tables->addMethod(methodId, recId, tid, s_getName(methodDecl), kind, EntityTables::Access(methodDecl->getAccess()), flags,
+					(int)(methodDecl->getNumParams() - methodDecl->getMinRequiredArguments()));
 			}
-			e.dumpKeyValuePair("access", methodDecl->getAccess());
-			// We use this value as it has a more obvious default.
-			e.dumpKeyValuePair("numParamDefaults", (int)(methodDecl->getNumParams() - methodDecl->getMinRequiredArguments()));
-			s_printName(m_os, methodDecl);
-			e.finishEntry();
-			s_printAnnotations(m_os, methodDecl, methodId);
+			dumpAnnotations_i(methodDecl, methodId);
 		}
 	}
 	else if( const EnumConstantDecl* enumConstantDecl = dyn_cast<EnumConstantDecl>(declIn) )
 	{	
 		// the enum has already been dumped
 		int enumId = getTypeId_i( enumConstantDecl->getType().getTypePtr() );
-		m_os << "EnumConstant( enumId=" << enumId;
-		s_printName(m_os, enumConstantDecl);
-		m_os << ", value='" << enumConstantDecl->getInitVal() << "' )\n";
-		s_printAnnotations(m_os, enumConstantDecl, enumId);
+		if( m_tables )
+		{
+			const llvm::APSInt& value = enumConstantDecl->getInitVal();
+			m_tables->addEnumConstant(enumId, s_getName(enumConstantDecl), value.isSigned() ? value.getSExtValue() : (int64_t)value.getZExtValue(),
+				value.isSigned() ? 0 : EntityTables::FLAG_UNSIGNED);
+		}
+		dumpAnnotations_i(enumConstantDecl, enumId);
 	}
 	else if( const NamespaceDecl* namespaceDecl = dyn_cast<NamespaceDecl>(declIn) )
 	{
@@ -534,20 +922,23 @@ int Havok::ExtractASTConsumer::dumpDecl_i(const Decl* declIn)
 			assert(recordDecl && "static member is not in a record declaration");
 			int recordId = getTypeId_i(m_context->getRecordType(recordDecl).getTypePtr());
 			int fieldId = m_uid.alloc();
-			m_os << "StaticField( id=" << fieldId << ", recordid=" << recordId << ", typeid=" << typeId;
-			s_printName(m_os, varDecl);
-			m_os << " )\n";
-			s_printAnnotations(m_os, varDecl, fieldId);
+			if( m_tables )
+			{
+				m_tables->addField(fieldId, recordId, typeId, s_getName(varDecl), EntityTables::Access(varDecl->getAccess()), EntityTables::FLAG_STATIC);
+			}
+			dumpAnnotations_i(varDecl, fieldId);
 		}
 	}
-	else if( m_dumpBits & DUMP_VERBOSE )
+	else if( (m_dumpBits & DUMP_VERBOSE) && m_tables )
 	{
-		m_os << "### Skipped " << declIn->getDeclKindName();
+		std::string comment;
+		llvm::raw_string_ostream commentStream(comment);
+		commentStream << "### Skipped " << declIn->getDeclKindName();
 		if( const NamedDecl* nd = dyn_cast<NamedDecl>(declIn) )
 		{
-			s_printName(m_os, nd);
+			s_printName(commentStream, nd);
 		}
-		m_os << '\n';
+		m_tables->addComment(commentStream.str());
 	}
 	return -1;
 }
@@ -559,16 +950,24 @@ int Havok::ExtractASTConsumer::dumpType_i(QualType qualTypeIn, int scopeId)
 
 	if (qualTypeIn.getQualifiers() & Qualifiers::Const)
 	{
-		int retId = findConstTypeId_i(id);
-		if (retId == -1)
+		id = dumpConstType_i(id);
+	}
+	return id;
+}
+
+int Havok::ExtractASTConsumer::dumpConstType_i(int typeId)
+{
+	int retId = findConstTypeId_i(typeId);
+	if (retId == -1)
+	{
+		retId = m_uid.alloc();
+		m_constTypeIdMap.set(typeId, retId);
+		if( m_tables )
 		{
-			retId = m_uid.alloc();
-			m_constTypeIdMap[id] = retId;
-			m_os << "ConstType( id=" << retId << ", typeid=" << id << ")\n";
+			m_tables->addType(retId, EntityTables::KIND_CONST, "", -1, typeId);
 		}
-		id = retId;
 	}
-	return id;
+	return retId;
 }
 
 int Havok::ExtractASTConsumer::dumpNonQualifiedType_i(const Type* typeIn, int scopeId)
@@ -601,14 +1000,7 @@ int Havok::ExtractASTConsumer::dumpSimpleType_i(QualType qualTypeIn, int scopeId
 
 	if (qualTypeIn.getQualifiers() & Qualifiers::Const)
 	{
-		int retId = findConstTypeId_i(id);
-		if (retId == -1)
-		{
-			retId = m_uid.alloc();
-			m_constTypeIdMap[id] = retId;
-			m_os << "ConstType( id=" << retId << ", typeid=" << id << ")\n";
-		}
-		id = retId;
+		id = dumpConstType_i(id);
 	}
 	return id;
 }
@@ -618,156 +1010,313 @@ int Havok::ExtractASTConsumer::dumpNonQualifiedSimpleType_i(const Type* typeIn,
 
 	// clean the type from any sugar used to specify it in source code (elaborated types)
 	typeIn = s_getTrueType(typeIn);
-	
+
+	// the type is desugared once and classified with its type class, typedefs are classified
+	// as they are and parens only when they do not wrap a type classified through sugar
+	const Type::TypeClass ownClass = typeIn->getTypeClass();
+	const Type* desugaredType = (ownClass == Type::Typedef) ? typeIn : getDesugaredType_i(typeIn);
+	Type::TypeClass typeClass = desugaredType->getTypeClass();
+
+	// a typedef to a template specialization type is dumped as a typedef
+	if( ownClass == Type::TemplateSpecialization || typeClass == Type::TemplateSpecialization )
 	{
-		const TemplateSpecializationType* templateSpecializationType = typeIn->getAs<TemplateSpecializationType>();
-		if( templateSpecializationType &&
-			(typeIn->getAs<TypedefType>() == NULL) ) // not a typedef to a template specialization type
-		{
-			// this type is dumped in case of an explicit instantiation when this function 
-			// is called from dumpTemplateClassSpecialization_i(), or in case of an
-			// implicit instantiation when this function is called in a generic way to
-			// dump a needed type.
+		// this type is dumped in case of an explicit instantiation when this function
+		// is called from dumpTemplateClassSpecialization_i(), or in case of an
+		// implicit instantiation when this function is called in a generic way to
+		// dump a needed type.
 
-			return dumpTemplateInstantiationType_i(templateSpecializationType);
-		}
+		return dumpTemplateInstantiationType_i(cast<TemplateSpecializationType>(ownClass == Type::TemplateSpecialization ? typeIn : desugaredType));
 	}
-	
+
 	// seen this type before?
 	int retId = findTypeId_i(typeIn);
 	if(retId != -1)
 	{
 		return retId;
 	}
-	
-	if( const TypedefType* bt = typeIn->getAs<TypedefType>() )
-	{
-		// sometimes TypedefTypes can also be casted to InjectedClassNameTypes, 
-		// for this reason we need to handle this first.
-		int tid = dumpType_i(bt->getDecl()->getUnderlyingType());
-		retId = m_uid.alloc();
-		m_os << "TypedefType( id=" << retId << ", typeid=" << tid;
-		s_printName(m_os, bt->getDecl());
-	}
-	else if( const TemplateTypeParmType* bt = typeIn->getAs<TemplateTypeParmType>() )
-	{
-		// skipped, this is treated specially after calling this function
-	}
-	else if( const BuiltinType* bt = typeIn->getAs<BuiltinType>() )
-	{
-		retId = m_uid.alloc();
-		m_os << "BuiltinType( id=" << retId << ", name='" << bt->getName(m_context->getPrintingPolicy()) << "'";
-	}
-	else if( const PointerType* bt = typeIn->getAs<PointerType>() )
-	{
-		int pt = dumpType_i(bt->getPointeeType());
-		retId = m_uid.alloc();
-		m_os << "PointerType( id=" << retId << ", typeid=" << pt;
-	}
-	else if( const ReferenceType* bt = typeIn->getAs<ReferenceType>() )
-	{
-		int pt = dumpType_i(bt->getPointeeType());
-		retId = m_uid.alloc();
-		m_os << "ReferenceType( id=" << retId << ", typeid=" << pt;
-	}
-	else if( const MemberPointerType* bt = typeIn->getAs<MemberPointerType>())
-	{
-		// C++ pointer to member (function or data)
-		int pt = dumpType_i(bt->getPointeeType());
-		int rt = dumpNonQualifiedType_i(bt->getClass());
-		retId = m_uid.alloc();
-		m_os << "MemberPointerType( id=" << retId << ", recordid=" << rt << ", typeid=" << pt;
-	}
-	else if( const RecordType* bt = typeIn->getAs<RecordType>() )
-	{
-		retId = m_uid.alloc();
-		const CXXRecordDecl* decl = dyn_cast<CXXRecordDecl>(bt->getDecl());
-		assert(decl && "retrieved declaration is not a CXX record declaration");
-		m_os << "RecordType( id=" << retId;
-		s_printName(m_os, decl);
-		s_printRecordFlags(m_os, decl);
-	}
-	else if( const EnumType* bt = typeIn->getAs<EnumType>() )
-	{
-		retId = m_uid.alloc();
-		m_os << "EnumType( id=" << retId;
-		const NamedDecl* decl = bt->getDecl();
-		s_printName(m_os, decl);
-	}
-	else if( const ConstantArrayType* bt = dyn_cast<ConstantArrayType>(typeIn) )
-	{
-		uint64_t sz = bt->getSize().getZExtValue();
-		int pt = dumpType_i(bt->getElementType());
-		retId = m_uid.alloc();
-		m_os << "ConstantArrayType( id=" << retId << ", typeid=" << pt << ", count=" << int(sz);
-	}
-	else if( const ParenType* bt = typeIn->getAs<ParenType>() )
+
+	if( ownClass == Type::Typedef ||
+		(ownClass == Type::Paren && !s_isClassifiedThroughSugar(typeClass)) )
 	{
-		int pt = dumpType_i(bt->getInnerType());
-		retId = m_uid.alloc();
-		m_os << "ParenType( id=" << retId << ", typeid=" << pt;
+		typeClass = ownClass;
 	}
-	else if( const FunctionProtoType* bt = typeIn->getAs<FunctionProtoType>() )
+
+	// -canonical-types, key of the structural type being dumped
+	std::string structuralKey;
+	bool sharedType = false;
+
+	switch( typeClass )
 	{
-		int resType = dumpType_i(bt->getResultType());
-		const int numArgs = bt->getNumArgs();
-		std::vector<int> paramTypes;
-		for(int i = 0; i < numArgs; ++i)
+		case Type::Typedef:
 		{
-			paramTypes.push_back(dumpType_i(bt->getArgType(i)));
+			// sometimes TypedefTypes can also be casted to InjectedClassNameTypes,
+			// for this reason we need to handle this first.
+			const TypedefType* bt = cast<TypedefType>(typeIn);
+			int tid = dumpType_i(bt->getDecl()->getUnderlyingType());
+			if( scopeId < 0 && !m_roots.empty() )
+			{
+				scopeId = dumpScope_i(bt->getDecl());
+			}
+			retId = m_uid.alloc();
+			if( m_tables )
+			{
+				m_tables->addType(retId, EntityTables::KIND_TYPEDEF, s_getName(bt->getDecl()), scopeId, tid);
+			}
+			break;
 		}
-		retId = m_uid.alloc();
-		m_os << "FunctionProtoType( id=" << retId << ", rettypeid=" << resType << ", paramtypeids=[";
-		for(unsigned int i = 0; i < paramTypes.size(); ++i)
+		case Type::TemplateTypeParm:
 		{
-			m_os << paramTypes[i];
-			if(i != paramTypes.size()-1)
-				m_os << ',';
+			// skipped, this is treated specially after calling this function
+			break;
 		}
-		m_os << "]";
-		m_os << ", isVariadic=" << (bt->isVariadic() ? "True" : "False");
-	}
-	else if( const ArrayType* bt = typeIn->getAsArrayTypeUnsafe() )
-	{
-		retId = m_uid.alloc();
-		m_os << "BuiltinType( id=" << retId << ", name='" << "unsupported" << "'";
+		case Type::Builtin:
+		{
+			const BuiltinType* bt = cast<BuiltinType>(desugaredType);
+			retId = m_uid.alloc();
+			if( m_tables )
+			{
+				m_tables->addType(retId, EntityTables::KIND_BUILTIN, bt->getName(m_context->getPrintingPolicy()), scopeId);
+			}
+			break;
+		}
+		case Type::Pointer:
+		{
+			const PointerType* bt = cast<PointerType>(desugaredType);
+			int pt = dumpType_i(bt->getPointeeType());
+			if( findStructuralType_i(typeClass, scopeId, &pt, 1, structuralKey, retId) )
+			{
+				sharedType = true;
+				break;
+			}
+			retId = m_uid.alloc();
+			if( m_tables )
+			{
+				m_tables->addType(retId, EntityTables::KIND_POINTER, "", scopeId, pt);
+			}
+			break;
+		}
+		case Type::LValueReference:
+		case Type::RValueReference:
+		{
+			const ReferenceType* bt = cast<ReferenceType>(desugaredType);
+			int pt = dumpType_i(bt->getPointeeType());
+			if( findStructuralType_i(typeClass, scopeId, &pt, 1, structuralKey, retId) )
+			{
+				sharedType = true;
+				break;
+			}
+			retId = m_uid.alloc();
+			if( m_tables )
+			{
+				m_tables->addType(retId, EntityTables::KIND_REFERENCE, "", scopeId, pt);
+			}
+			break;
+		}
+		case Type::MemberPointer:
+		{
+			// C++ pointer to member (function or data)
+			const MemberPointerType* bt = cast<MemberPointerType>(desugaredType);
+			int pt = dumpType_i(bt->getPointeeType());
+			int rt = dumpNonQualifiedType_i(bt->getClass());
+			const int components[] = { pt, rt };
+			if( findStructuralType_i(typeClass, scopeId, components, 2, structuralKey, retId) )
+			{
+				sharedType = true;
+				break;
+			}
+			retId = m_uid.alloc();
+			if( m_tables )
+			{
+				m_tables->addType(retId, EntityTables::KIND_MEMBER_POINTER, "", scopeId, pt, rt);
+			}
+			break;
+		}
+		case Type::Record:
+		{
+			const RecordType* bt = cast<RecordType>(desugaredType);
+			const CXXRecordDecl* decl = dyn_cast<CXXRecordDecl>(bt->getDecl());
+			assert(decl && "retrieved declaration is not a CXX record declaration");
+			if( !m_roots.empty() )
+			{
+				// reached from a root declaration, the record needs its scope and its definition
+				const CXXRecordDecl* def = decl->getDefinition();
+				if( scopeId < 0 )
+				{
+					scopeId = dumpScope_i(def != NULL ? def : decl);
+				}
+				if( !isa<ClassTemplateSpecializationDecl>(decl) )
+				{
+					queueDefinition_i(decl);
+				}
+			}
+			retId = m_uid.alloc();
+			if( m_tables )
+			{
+				m_tables->addType(retId, EntityTables::KIND_RECORD, s_getName(decl), scopeId, -1, 0, s_getRecordTableFlags(decl));
+				setContentHash_i(retId, decl);
+				setLayout_i(retId, decl);
+			}
+			break;
+		}
+		case Type::Enum:
+		{
+			const EnumType* bt = cast<EnumType>(desugaredType);
+			if( !m_roots.empty() )
+			{
+				// reached from a root declaration, the enum needs its scope and its constants
+				const EnumDecl* def = bt->getDecl()->getDefinition();
+				if( scopeId < 0 )
+				{
+					scopeId = dumpScope_i(def != NULL ? def : bt->getDecl());
+				}
+				queueDefinition_i(bt->getDecl());
+			}
+			retId = m_uid.alloc();
+			if( m_tables )
+			{
+				const NamedDecl* decl = bt->getDecl();
+				m_tables->addType(retId, EntityTables::KIND_ENUM, s_getName(decl), scopeId);
+				setContentHash_i(retId, decl);
+			}
+			break;
+		}
+		case Type::ConstantArray:
+		{
+			if( desugaredType == typeIn )
+			{
+				const ConstantArrayType* bt = cast<ConstantArrayType>(typeIn);
+				uint64_t sz = bt->getSize().getZExtValue();
+				int pt = dumpType_i(bt->getElementType());
+				const int components[] = { pt, int(sz) };
+				if( findStructuralType_i(typeClass, scopeId, components, 2, structuralKey, retId) )
+				{
+					sharedType = true;
+					break;
+				}
+				retId = m_uid.alloc();
+				if( m_tables )
+				{
+					m_tables->addType(retId, EntityTables::KIND_CONSTANT_ARRAY, "", scopeId, pt, int(sz));
+				}
+				break;
+			}
+			// behind sugar, unsupported like the other arrays
+			// fall through
+		}
+		case Type::IncompleteArray:
+		case Type::VariableArray:
+		case Type::DependentSizedArray:
+		{
+			retId = m_uid.alloc();
+			if( m_tables )
+			{
+				m_tables->addType(retId, EntityTables::KIND_BUILTIN, "unsupported", scopeId);
+			}
 
-		// todo
-// 		int eid = _dumpType( bt->getElementType().getTypePtr() );
-// 		retId = m_uid.alloc();
-// 		m_os << "ArrayType id='" << retId << "' elemId='" << eid << "' count='" << bt->getSizeExpr() ->getType().getTypePtr() << "'\n";
-	}		
-	else if( const DependentNameType* bt = typeIn->getAs<DependentNameType>() )
-	{
-		retId = m_uid.alloc();
-		//int tid = _dumpType( bt->desugar().getSingleStepDesugaredType(*m_context).getTypePtr(), scopeId );
-		m_os << "BuiltinType( id=" << retId << ", name='" << "unsupported" << "'";
-		// todo
-	}
-	else if( const InjectedClassNameType* bt = typeIn->getAs<InjectedClassNameType>() )
-	{
-		// templates are handled using a different code path, this function should never
-		// end up printing template class declaration information.
-		assert(false && "this type is expected for template class declarations, which should not be handled by this function");
+			// todo
+// 			int eid = _dumpType( bt->getElementType().getTypePtr() );
+// 			retId = m_uid.alloc();
+// 			m_os << "ArrayType id='" << retId << "' elemId='" << eid << "' count='" << bt->getSizeExpr() ->getType().getTypePtr() << "'\n";
+			break;
+		}
+		case Type::Paren:
+		{
+			const ParenType* bt = cast<ParenType>(typeIn);
+			int pt = dumpType_i(bt->getInnerType());
+			if( m_dumpBits & DUMP_CANONICAL_TYPES )
+			{
+				// parens are only sugar, the type is its inner type
+				++m_numSharedTypes;
+				retId = pt;
+				sharedType = true;
+				break;
+			}
+			retId = m_uid.alloc();
+			if( m_tables )
+			{
+				m_tables->addType(retId, EntityTables::KIND_PAREN, "", scopeId, pt);
+			}
+			break;
+		}
+		case Type::FunctionProto:
+		{
+			const FunctionProtoType* bt = cast<FunctionProtoType>(desugaredType);
+			int resType = dumpType_i(bt->getResultType());
+			const int numArgs = bt->getNumArgs();
+			std::vector<int> paramTypes;
+			for(int i = 0; i < numArgs; ++i)
+			{
+				paramTypes.push_back(dumpType_i(bt->getArgType(i)));
+			}
+			std::vector<int> components(1, resType);
+			components.push_back(bt->isVariadic() ? 1 : 0);
+			components.insert(components.end(), paramTypes.begin(), paramTypes.end());
+			if( findStructuralType_i(typeClass, scopeId, &components[0], int(components.size()), structuralKey, retId) )
+			{
+				sharedType = true;
+				break;
+			}
+			retId = m_uid.alloc();
+			if( m_tables )
+			{
+				m_tables->addType(retId, EntityTables::KIND_FUNCTION_PROTO, "", scopeId, resType, 0,
+					bt->isVariadic() ? EntityTables::FLAG_VARIADIC : 0);
+				for(unsigned int i = 0; i < paramTypes.size(); ++i)
+				{
+					m_tables->addParamType(retId, paramTypes[i]);
+				}
+			}
+			break;
+		}
+		case Type::DependentName:
+		{
+			retId = m_uid.alloc();
+			//int tid = _dumpType( bt->desugar().getSingleStepDesugaredType(*m_context).getTypePtr(), scopeId );
+			if( m_tables )
+			{
+				m_tables->addType(retId, EntityTables::KIND_BUILTIN, "unsupported", scopeId);
+			}
+			// todo
+			break;
+		}
+		case Type::InjectedClassName:
+		{
+			if( desugaredType == typeIn )
+			{
+				// templates are handled using a different code path, this function should never
+				// end up printing template class declaration information.
+				assert(false && "this type is expected for template class declarations, which should not be handled by this function");
+				break;
+			}
+			// fall through
+		}
+		default:
+		{
+			const char* name = typeIn->getTypeClassName();
+			if( m_tables )
+			{
+				m_tables->addComment(std::string("###Type kind='") + name + "'");
+			}
+			assert(0 && "Type not supported");
+			break;
+		}
 	}
-	else
+	if(sharedType)
 	{
-		const char* name = typeIn->getTypeClassName();
-		m_os << "###Type kind='" << name << "'\n";
-		assert(0 && "Type not supported");
+		// same structure as a type dumped before
+		m_knownTypes.set(typeIn, retId);
+		return retId;
 	}
 	if(retId < 0)
 	{
 		// type was skipped (it is supported but we don't have to do anything)
 		retId = m_uid.alloc();
 	}
-	else
+	if(!structuralKey.empty())
 	{
-		if(scopeId >= 0)
-			m_os << ", scopeid=" << scopeId;
-		m_os << " )\n";
+		m_structuralTypes.set(structuralKey, retId);
 	}
-	m_knownTypes[typeIn] = retId;
+	m_knownTypes.set(typeIn, retId);
 	return retId;
 }
 
@@ -814,15 +1363,30 @@ int Havok::ExtractASTConsumer::dumpTemplateInstantiationType_i(
 			}
 			assert((classTemplateInstantiationDecl || templateSpecializationType->isDependentType()) && 
 				"could not retrieve template specialization declaration for instantiation");
+			if( !m_roots.empty() &&
+				classTemplateInstantiationDecl != NULL &&
+				classTemplateInstantiationDecl->getSpecializationKind() == TSK_ExplicitSpecialization )
+			{
+				// Explicit specializations are normally dumped from their own declaration, when
+				// dumping from root declarations we might reach them here first.
+				const CXXRecordDecl* specializationDef = classTemplateInstantiationDecl->getDefinition();
+				const ClassTemplateSpecializationDecl* specializationDecl = classTemplateInstantiationDecl;
+				if( specializationDef != NULL )
+				{
+					specializationDecl = cast<ClassTemplateSpecializationDecl>(specializationDef);
+				}
+				retId = dumpTemplateSpecializationType_i(specializationDecl, dumpScope_i(specializationDecl));
+				m_knownTypes.set(templateSpecializationType, retId);
+				queueDefinition_i(specializationDecl);
+				return retId;
+			}
 			// classTemplateInstantiationDecl will be NULL only if the template instance is dependent from a template parameter
 			if(classTemplateInstantiationDecl != NULL)
 			{
 				scopeDiscoveryDecl = classTemplateInstantiationDecl;
 			}
 
-			const CXXRecordDecl* templatedDecl = dyn_cast<CXXRecordDecl>(classTemplateDecl->getTemplatedDecl());
-			assert(templatedDecl && "could not retrieve templated declaration");
-			templateId = getTypeId_i(m_context->getRecordType(templatedDecl).getTypePtr());
+			templateId = dumpTemplateRecord_i(classTemplateDecl);
 		}
 		else
 		{
@@ -830,27 +1394,27 @@ int Havok::ExtractASTConsumer::dumpTemplateInstantiationType_i(
 				dyn_cast<TemplateTemplateParmDecl>(templateDecl);
 			assert(templateTemplateParmDecl && "template declaration is not a class template or template parameter");
 			scopeDiscoveryDecl = templateTemplateParmDecl->getCanonicalDecl();
-			KnownTemplateTemplateParamMap::const_iterator it = m_knowTemplateTemplateParams.find(scopeDiscoveryDecl);
-			assert((it != m_knowTemplateTemplateParams.end()) && "template template parameter not found in map");
-			templateId = it->second;
+			if( !m_knowTemplateTemplateParams.lookup(scopeDiscoveryDecl, templateId) )
+			{
+				assert(0 && "template template parameter not found in map");
+			}
 		}
 
 		int scopeid = dumpScope_i(scopeDiscoveryDecl);
 
 		retId = m_uid.alloc();
-		m_os << "TemplateRecordInstantiationType( id=" << retId << ", templateid=" 
-			<< templateId;
-		if(classTemplateInstantiationDecl != NULL)
+		if( m_tables )
 		{
-			s_printRecordFlags(m_os, classTemplateInstantiationDecl);
-		} 
-		else
-		{
-			s_printDefaultRecordFlags(m_os);
+			m_tables->addType(retId, EntityTables::KIND_TEMPLATE_INSTANTIATION, "", scopeid, templateId, 0,
+				classTemplateInstantiationDecl != NULL ? s_getRecordTableFlags(classTemplateInstantiationDecl) : 0);
+			if(classTemplateInstantiationDecl != NULL)
+			{
+				setContentHash_i(retId, classTemplateInstantiationDecl);
+				setLayout_i(retId, classTemplateInstantiationDecl);
+			}
 		}
-		m_os << ", scopeid=" << scopeid << " )\n";
-		m_knownTypes[templateSpecializationType] = retId;
-		m_knownTypes[canonicalInstantiationType] = retId;
+		m_knownTypes.set(templateSpecializationType, retId);
+		m_knownTypes.set(canonicalInstantiationType, retId);
 
 		const int argc = templateSpecializationType->getNumArgs();
 		const TemplateArgument* argv = templateSpecializationType->getArgs();
@@ -858,7 +1422,7 @@ int Havok::ExtractASTConsumer::dumpTemplateInstantiationType_i(
 
 		if(classTemplateInstantiationDecl != NULL)
 		{
-			m_knownTypes[m_context->getRecordType(classTemplateInstantiationDecl).getTypePtr()] = retId;
+			m_knownTypes.set(m_context->getRecordType(classTemplateInstantiationDecl).getTypePtr(), retId);
 
 			const CXXRecordDecl* classTemplateInstantiationDefRecord = classTemplateInstantiationDecl->getDefinition();
 			if(classTemplateInstantiationDefRecord)
@@ -868,7 +1432,7 @@ int Havok::ExtractASTConsumer::dumpTemplateInstantiationType_i(
 
 				if(classTemplateInstantiationDef != NULL)
 				{
-					dumpTagDefinition_i(classTemplateInstantiationDef, retId);
+					dumpInstantiationDefinition_i(classTemplateInstantiationDef, retId, templateId);
 				}
 			}
 			// the definition for a template instantiation might not be found when it's only used for typedefs
@@ -883,11 +1447,7 @@ int Havok::ExtractASTConsumer::dumpTemplateSpecializationType_i(
 	const ClassTemplateSpecializationDecl* classTemplateSpecializationDecl, 
 	int scopeId )
 {
-	const TemplateArgumentList& argList = classTemplateSpecializationDecl->getTemplateArgs();
-	const QualType canonType = m_context->getRecordType(classTemplateSpecializationDecl);
-	TemplateName tempName(classTemplateSpecializationDecl->getSpecializedTemplate());
-	const TemplateSpecializationType* templateSpecializationType = m_context->
-		getTemplateSpecializationType(tempName, argList.data(), argList.size(), canonType).getTypePtr()->
+	const TemplateSpecializationType* templateSpecializationType = getTemplateSpecializationType_i(classTemplateSpecializationDecl).getTypePtr()->
 		getAs<TemplateSpecializationType>();
 	assert(templateSpecializationType && "not a template specialization type");
 
@@ -904,15 +1464,15 @@ int Havok::ExtractASTConsumer::dumpTemplateSpecializationType_i(
 	// or partial template specializations, template instantiations are handled in the
 	// usual _dumpType() function.
 
-	const CXXRecordDecl* templatedDecl = dyn_cast<CXXRecordDecl>(templateSpecializationType->getTemplateName().getAsTemplateDecl()->getTemplatedDecl());
-	assert(templatedDecl && "could not retrieve templated declaration");
-	int templateId = getTypeId_i(m_context->getRecordType(templatedDecl).getTypePtr());
+	int templateId = dumpTemplateRecord_i(classTemplateSpecializationDecl->getSpecializedTemplate());
 
 	retId = m_uid.alloc();
-	m_os << "TemplateRecordSpecialization( id=" << retId << ", templateid=" 
-		<< templateId;
-	s_printRecordFlags(m_os, classTemplateSpecializationDecl);
-	m_os << ", scopeid=" << scopeId << " )\n";
+	if( m_tables )
+	{
+		m_tables->addType(retId, EntityTables::KIND_TEMPLATE_SPECIALIZATION, "", scopeId, templateId, 0,
+			s_getRecordTableFlags(classTemplateSpecializationDecl));
+		setContentHash_i(retId, classTemplateSpecializationDecl);
+	}
 
 	if(const ClassTemplatePartialSpecializationDecl* classTemplatePartialSpecializationDecl = 
 		dyn_cast<ClassTemplatePartialSpecializationDecl>(classTemplateSpecializationDecl))
@@ -942,7 +1502,7 @@ int Havok::ExtractASTConsumer::dumpTemplateSpecializationType_i(
 		templateSpecializationType->getNumArgs(), 
 		retId);
 
-	m_knownTypes[recordType] = retId;
+	m_knownTypes.set(recordType, retId);
 	return retId;
 }
 
@@ -957,12 +1517,27 @@ int Havok::ExtractASTConsumer::dumpScope_i( const Decl* decl )
 		if(const TypeDecl* typeDecl = dyn_cast<TypeDecl>(namedDecl))
 		{
 			// return the id using the type information
-			retScopeId = getTypeId_i( m_context->getTypeDeclType(typeDecl).getTypePtr() );
+			QualType scopeType = m_context->getTypeDeclType(typeDecl);
+			if(m_roots.empty())
+			{
+				retScopeId = getTypeId_i( scopeType.getTypePtr() );
+			}
+			else
+			{
+				// when dumping from root declarations the scope might not have been reached yet
+				retScopeId = findTypeId_i( s_getTrueType(scopeType.getTypePtr()) );
+				if(retScopeId == -1)
+				{
+					const CXXRecordDecl* recordDecl = dyn_cast<CXXRecordDecl>(typeDecl);
+					const ClassTemplateDecl* classTemplateDecl = recordDecl != NULL ? recordDecl->getDescribedClassTemplate() : NULL;
+					retScopeId = classTemplateDecl != NULL ? dumpTemplateRecord_i(classTemplateDecl) : dumpType_i(scopeType);
+				}
+			}
 		}
 		else if(const NamespaceDecl* namespaceDecl = dyn_cast<NamespaceDecl>(namedDecl))
 		{
 			// return the namespace id
-			retScopeId = getNamespaceId_i(namespaceDecl);
+			retScopeId = m_roots.empty() ? getNamespaceId_i(namespaceDecl) : dumpNamespaceEntry_i(namespaceDecl);
 		} else
 		{
 			assert(false && "Invalid declaration scope");
@@ -970,25 +1545,57 @@ int Havok::ExtractASTConsumer::dumpScope_i( const Decl* decl )
 	}
 	else
 	{
-		// we need to refer to the containing file, and dump if is not in the known file map
-		SourceLocation loc = decl->getLocation();
-		loc = s_getExpansionLoc(loc, m_context->getSourceManager());
-		FileID fileId = s_getFileId(loc, m_context->getSourceManager());
-		KnownFilesMap::iterator it = m_knownFiles.find(fileId);
-		if(it == m_knownFiles.end())
-		{
-			retScopeId = m_uid.alloc();
-			m_knownFiles[fileId] = retScopeId;
-			std::string buf;
-			const char* fileName = s_getFileName(buf, loc, m_context->getSourceManager());
-			m_os << "File( id=" << retScopeId << ", location='" << fileName << "' )\n";
-		}
-		else
+		retScopeId = dumpFileScope_i(decl->getLocation());
+	}
+
+	return retScopeId;
+}
+
+int Havok::ExtractASTConsumer::dumpFileScope_i(SourceLocation loc)
+{
+	// the scope is cached for the source location entry (file or macro expansion) of the
+	// declaration so that declarations from the same expansion do not walk the chain again
+	// (the source manager caches its last lookups, it is locked when dumping in parallel)
+	SourceManager& sm = m_context->getSourceManager();
+	FileID entryId;
+	{
+		OptionalLock lock(m_astMutex);
+		entryId = sm.getFileID(loc);
+	}
+	int entryScopeId;
+	if(m_entryScopes.lookup(entryId, entryScopeId))
+	{
+		return entryScopeId;
+	}
+
+	// we need to refer to the containing file, and dump if is not in the known file map
+	FileID fileId;
+	{
+		OptionalLock lock(m_astMutex);
+		loc = s_getExpansionLoc(loc, sm);
+		fileId = s_getFileId(loc, sm);
+	}
+	int retScopeId;
+	if(!m_knownFiles.lookup(fileId, retScopeId))
+	{
+		retScopeId = m_uid.alloc();
+		m_knownFiles.set(fileId, retScopeId);
+		if( m_tables )
 		{
-			retScopeId = it->second;
+			std::string fileName;
+			{
+				OptionalLock lock(m_astMutex);
+				std::string& cachedName = (*m_fileNames)[fileId];
+				if(cachedName.empty())
+				{
+					s_getFileName(cachedName, loc, sm);
+				}
+				fileName = cachedName;
+			}
+			m_tables->addType(retScopeId, EntityTables::KIND_FILE, fileName);
 		}
 	}
-
+	m_entryScopes.set(entryId, retScopeId);
 	return retScopeId;
 }
 
@@ -1026,10 +1633,20 @@ void Havok::ExtractASTConsumer::dumpTagDefinition_i(const TagDecl* tagDecl, int
 		// class/struct/union
 		if( const CXXRecordDecl* cxxDecl = dyn_cast<CXXRecordDecl>(recordDecl) )
 		{
+			const ASTRecordLayout* layout = (m_tables && (m_dumpBits & DUMP_LAYOUTS)) ? s_getRecordLayout(*m_context, cxxDecl, m_astMutex) : NULL;
 			for( CXXRecordDecl::base_class_const_iterator bi = cxxDecl->bases_begin(), be = cxxDecl->bases_end(); bi != be; ++bi )
 			{
 				int pid = dumpType_i( bi->getType() );
-				m_os << "Inherit( id=" << recordId << ", parent=" << pid << " )\n";
+				if( m_tables )
+				{
+					int64_t offset = -1;
+					if( layout != NULL )
+					{
+						const CXXRecordDecl* baseDecl = bi->getType()->getAsCXXRecordDecl();
+						offset = (bi->isVirtual() ? layout->getVBaseClassOffset(baseDecl) : layout->getBaseClassOffset(baseDecl)).getQuantity();
+					}
+					m_tables->addInherit(recordId, pid, bi->isVirtual() ? EntityTables::FLAG_VIRTUAL : 0, offset);
+				}
 			}
 		}
 	}
@@ -1038,6 +1655,75 @@ void Havok::ExtractASTConsumer::dumpTagDefinition_i(const TagDecl* tagDecl, int
 	dumpDeclContext_i(tagDecl);
 }
 
+void Havok::ExtractASTConsumer::dumpInstantiationDefinition_i(const ClassTemplateSpecializationDecl* instantiationDef, int recordId, int templateId)
+{
+	if( instantiationDef->getSpecializationKind() != TSK_ImplicitInstantiation )
+	{
+		dumpTagDefinition_i(instantiationDef, recordId);
+		return;
+	}
+
+	if( m_instantiationBudget == 0 )
+	{
+		// the type and its arguments are known, its definition is not
+		if( m_tables )
+		{
+			m_tables->addInstantiation(recordId, EntityTables::INSTANTIATION_NOT_EXPANDED);
+		}
+		return;
+	}
+	if( m_instantiationBudget > 0 )
+	{
+		--m_instantiationBudget;
+	}
+
+	if( (m_dumpBits & DUMP_COMPACT_INSTANTIATIONS) && instantiationDef->getSpecializedTemplateOrPartial().is<ClassTemplateDecl*>() )
+	{
+		// the members are those of the template (dumped with the TemplateRecord) with the template
+		// arguments substituted, only the members which do not come from the template are dumped
+		if( m_tables )
+		{
+			m_tables->addInstantiation(recordId, EntityTables::INSTANTIATION_PATTERN, templateId);
+		}
+		if( m_tables && (m_dumpBits & DUMP_LAYOUTS) )
+		{
+			// the offsets depend on the arguments, they cannot be read from the template
+			if( const ASTRecordLayout* layout = s_getRecordLayout(*m_context, instantiationDef, m_astMutex) )
+			{
+				for( RecordDecl::field_iterator fi = instantiationDef->field_begin(), fe = instantiationDef->field_end(); fi != fe; ++fi )
+				{
+					uint64_t offsetInBits = layout->getFieldOffset(fi->getFieldIndex());
+					if( fi->isBitField() )
+					{
+						m_tables->addOffset(recordId, EntityTables::OFFSET_FIELD, int(fi->getFieldIndex()), int64_t(offsetInBits), EntityTables::FLAG_BIT_FIELD);
+					}
+					else
+					{
+						m_tables->addOffset(recordId, EntityTables::OFFSET_FIELD, int(fi->getFieldIndex()), m_context->toCharUnitsFromBits(offsetInBits).getQuantity());
+					}
+				}
+				int baseIndex = 0;
+				for( CXXRecordDecl::base_class_const_iterator bi = instantiationDef->bases_begin(), be = instantiationDef->bases_end(); bi != be; ++bi, ++baseIndex )
+				{
+					const CXXRecordDecl* baseDecl = bi->getType()->getAsCXXRecordDecl();
+					m_tables->addOffset(recordId, EntityTables::OFFSET_BASE, baseIndex,
+						(bi->isVirtual() ? layout->getVBaseClassOffset(baseDecl) : layout->getBaseClassOffset(baseDecl)).getQuantity());
+				}
+			}
+		}
+		for( DeclContext::decl_iterator it = instantiationDef->decls_begin(), end = instantiationDef->decls_end(); it != end; ++it )
+		{
+			if( !s_isInstantiatedFromPattern(*it) )
+			{
+				dumpDecl_i(*it);
+			}
+		}
+		return;
+	}
+
+	dumpTagDefinition_i(instantiationDef, recordId);
+}
+
 void Havok::ExtractASTConsumer::dumpDeclContext_i(const DeclContext* context)
 {
 	typedef RecordDecl::decl_iterator NestedIterator;
@@ -1048,54 +1734,39 @@ void Havok::ExtractASTConsumer::dumpDeclContext_i(const DeclContext* context)
 }
 
 void Havok::ExtractASTConsumer::dumpNamespace_i(const NamespaceDecl* namespaceDecl)
+{
+	dumpNamespaceEntry_i(namespaceDecl);
+
+	// dump declarations in the namespace
+	dumpDeclContext_i(namespaceDecl);
+}
+
+int Havok::ExtractASTConsumer::dumpNamespaceEntry_i(const NamespaceDecl* namespaceDecl)
 {
 	// check if already seen (if not, dump the declaration)
 	const NamespaceDecl* originalNamespaceDecl = namespaceDecl->getOriginalNamespace();
-	KnownNamespacesMap::iterator it = m_knownNamespaces.find(originalNamespaceDecl);
-	if( it == m_knownNamespaces.end() )
+	int knownId;
+	if( m_knownNamespaces.lookup(originalNamespaceDecl, knownId) )
 	{
-		int scopeId = dumpScope_i(namespaceDecl);
-		int newId = m_uid.alloc();
-		m_os << "Namespace( id=" << newId;
-		s_printName(m_os, namespaceDecl);
-		m_os << ", scopeid=" << scopeId << " )\n";
-		m_knownNamespaces[originalNamespaceDecl] = newId;
+		return knownId;
 	}
 
-	// dump declarations in the namespace
-	dumpDeclContext_i(namespaceDecl);
+	int scopeId = dumpScope_i(namespaceDecl);
+	int newId = m_uid.alloc();
+	if( m_tables )
+	{
+		m_tables->addType(newId, EntityTables::KIND_NAMESPACE, s_getName(namespaceDecl), scopeId);
+	}
+	m_knownNamespaces.set(originalNamespaceDecl, newId);
+	return newId;
 }
 
 void Havok::ExtractASTConsumer::dumpTemplateClass_i(const ClassTemplateDecl* classTemplateDecl)
 {
 	const CXXRecordDecl* templatedRecordDecl = classTemplateDecl->getTemplatedDecl();
-	const Type* injectedClassnameType = m_context->getRecordType(templatedRecordDecl).getTypePtr();
-	const ClassTemplateDecl* classTemplateDef = s_getClassTemplateDefinition(classTemplateDecl);
-
-	int templateId;
-	templateId = findTypeId_i(injectedClassnameType);
-	if(templateId == -1)
-	{
-		int scopeId = dumpScope_i(classTemplateDef != NULL ? classTemplateDef : classTemplateDecl);
-
-		templateId = m_uid.alloc();
-		m_os << "TemplateRecord( id=" << templateId;
-		s_printName(m_os, templatedRecordDecl);
-		s_printRecordFlags(m_os, templatedRecordDecl);
-
-		m_os << ", scopeid=" << scopeId << " )\n";
-		s_printAnnotations(m_os, classTemplateDef != NULL ? classTemplateDef->getTemplatedDecl() : templatedRecordDecl, templateId);
-		m_knownTypes[injectedClassnameType] = templateId;
+	int templateId = dumpTemplateRecord_i(classTemplateDecl);
 
-		// 1: dump template parameter list
-		const TemplateParameterList* paramList = 
-			classTemplateDef != NULL ? 
-			classTemplateDef->getTemplateParameters() : 
-			classTemplateDecl->getTemplateParameters();	
-		dumpTemplateParameterList_i(paramList, templateId);
-	}
-
-	if(classTemplateDecl->isThisDeclarationADefinition())
+	if(classTemplateDecl->isThisDeclarationADefinition() && claimDefinition_i(templatedRecordDecl))
 	{
 		// 2: add special entries in the type map for types referred by template parameters, consider the following template class declaration:
 		//
@@ -1117,6 +1788,44 @@ void Havok::ExtractASTConsumer::dumpTemplateClass_i(const ClassTemplateDecl* cla
 	}
 }
 
+int Havok::ExtractASTConsumer::dumpTemplateRecord_i(const ClassTemplateDecl* classTemplateDecl)
+{
+	const CXXRecordDecl* templatedRecordDecl = classTemplateDecl->getTemplatedDecl();
+	const Type* injectedClassnameType = m_context->getRecordType(templatedRecordDecl).getTypePtr();
+
+	int templateId;
+	templateId = findTypeId_i(injectedClassnameType);
+	if(templateId == -1)
+	{
+		const ClassTemplateDecl* classTemplateDef = s_getClassTemplateDefinition(classTemplateDecl);
+		int scopeId = dumpScope_i(classTemplateDef != NULL ? classTemplateDef : classTemplateDecl);
+
+		templateId = m_uid.alloc();
+		if( m_tables )
+		{
+			m_tables->addType(templateId, EntityTables::KIND_TEMPLATE_RECORD, s_getName(templatedRecordDecl), scopeId, -1, 0,
+				s_getRecordTableFlags(templatedRecordDecl));
+			setContentHash_i(templateId, classTemplateDecl);
+		}
+		dumpAnnotations_i(classTemplateDef != NULL ? classTemplateDef->getTemplatedDecl() : templatedRecordDecl, templateId);
+		m_knownTypes.set(injectedClassnameType, templateId);
+
+		// 1: dump template parameter list
+		const TemplateParameterList* paramList = 
+			classTemplateDef != NULL ? 
+			classTemplateDef->getTemplateParameters() : 
+			classTemplateDecl->getTemplateParameters();	
+		dumpTemplateParameterList_i(paramList, templateId);
+
+		if(!m_roots.empty())
+		{
+			// reached from a root declaration, the template needs its definition
+			queueDefinition_i(classTemplateDecl);
+		}
+	}
+	return templateId;
+}
+
 void Havok::ExtractASTConsumer::dumpTemplateClassSpecialization_i(const ClassTemplateSpecializationDecl* classTemplateSpecializationDecl)
 {
 	// it might be:
@@ -1139,7 +1848,7 @@ void Havok::ExtractASTConsumer::dumpTemplateClassSpecialization_i(const ClassTem
 		// dump template specializations using specific function
 		int templateId = dumpTemplateSpecializationType_i(classTemplateSpecializationDef != NULL ? classTemplateSpecializationDef : classTemplateSpecializationDecl, scopeId);
 
-		if(classTemplateSpecializationDecl->isThisDeclarationADefinition())
+		if(classTemplateSpecializationDecl->isThisDeclarationADefinition() && claimDefinition_i(classTemplateSpecializationDecl))
 		{
 			if(const ClassTemplatePartialSpecializationDecl* classTemplatePartialSpecializationDecl = 
 				dyn_cast<ClassTemplatePartialSpecializationDecl>(classTemplateSpecializationDecl))
@@ -1166,10 +1875,7 @@ void Havok::ExtractASTConsumer::dumpTemplateClassSpecialization_i(const ClassTem
 	}
 	else if(kind == TSK_ExplicitInstantiationDefinition)
 	{	
-		const TemplateArgumentList& argList = classTemplateSpecializationDecl->getTemplateArgs();
-		const QualType canonType = m_context->getRecordType(classTemplateSpecializationDecl);
-		TemplateName tempName(classTemplateSpecializationDecl->getSpecializedTemplate());
-		QualType templateSpecializationType = m_context->getTemplateSpecializationType(tempName, argList.data(), argList.size(), canonType);
+		QualType templateSpecializationType = getTemplateSpecializationType_i(classTemplateSpecializationDecl);
 		assert(templateSpecializationType.getTypePtr()->getAs<TemplateSpecializationType>() && "not a template specialization type");
 
 		int scopeId = dumpScope_i(classTemplateSpecializationDecl);
@@ -1192,38 +1898,42 @@ void Havok::ExtractASTConsumer::dumpTemplateParameterList_i(const TemplateParame
 		if ( const NonTypeTemplateParmDecl* nonTypeTemplateParmDecl = dyn_cast<NonTypeTemplateParmDecl>(paramDecl) )
 		{
 			int typeId = dumpType_i(nonTypeTemplateParmDecl->getType());
-			m_os << "TemplateNonTypeParam( templateid=" << templateId << ", typeid=" << typeId;
-			s_printName(m_os, nonTypeTemplateParmDecl);
-			m_os << " )\n";
+			if( m_tables )
+			{
+				m_tables->addTemplateParam(templateId, EntityTables::PARAM_NON_TYPE, typeId, s_getName(nonTypeTemplateParmDecl));
+			}
 		}
 		else if ( const TemplateTypeParmDecl* templateTypeParmDecl = dyn_cast<TemplateTypeParmDecl>(paramDecl) )
 		{
-			int typeId = dumpType_i(m_context->getTemplateTypeParmType(
-				templateTypeParmDecl->getDepth(), 
-				templateTypeParmDecl->getIndex(), 
-				templateTypeParmDecl->isParameterPack(),
-				const_cast<TemplateTypeParmDecl*>(templateTypeParmDecl)));
-			m_os << "TemplateTypeParamType( templateid=" << templateId << ", id=" << typeId;
-			s_printName(m_os, templateTypeParmDecl);
-			m_os << " )\n";
+			int typeId = dumpType_i(getTemplateTypeParmType_i(templateTypeParmDecl, true));
+			if( m_tables )
+			{
+				m_tables->addTemplateParam(templateId, EntityTables::PARAM_TYPE, typeId, s_getName(templateTypeParmDecl));
+			}
 		}
 		else if ( const TemplateTemplateParmDecl* templateTemplateParmDecl = dyn_cast<TemplateTemplateParmDecl>(paramDecl) )
 		{
 			int retId = m_uid.alloc();
 			const Decl* canonical = templateTemplateParmDecl->getCanonicalDecl();
-			m_knowTemplateTemplateParams[canonical] = retId;
-			m_os << "TemplateTemplateParam( templateid=" << templateId << ", id=" << retId;
-			s_printName(m_os, templateTemplateParmDecl);
-			m_os << " )\n";
+			m_knowTemplateTemplateParams.set(canonical, retId);
+			if( m_tables )
+			{
+				m_tables->addTemplateParam(templateId, EntityTables::PARAM_TEMPLATE, retId, s_getName(templateTemplateParmDecl));
+			}
 			// dump template parameter list
 			const TemplateParameterList* paramList = templateTemplateParmDecl->getTemplateParameters();
 			dumpTemplateParameterList_i(paramList, retId);
 		}
 		else
 		{
-			m_os << "### Template param declaration not supported";
-			s_printName(m_os, paramDecl);
-			m_os << "\n";
+			if( m_tables )
+			{
+				std::string comment;
+				llvm::raw_string_ostream commentStream(comment);
+				commentStream << "### Template param declaration not supported";
+				s_printName(commentStream, paramDecl);
+				m_tables->addComment(commentStream.str());
+			}
 			assert(0);
 		}
 	}
@@ -1240,7 +1950,10 @@ void Havok::ExtractASTConsumer::dumpTemplateArgumentList_i(const TemplateArgumen
 		{
 			QualType qualType = argv[i].getAsType(); 
 			int typeId = dumpType_i(qualType);
-			m_os << "TemplateSpecializationTypeArg( recordid=" << templateId << ", typeid=" << typeId << " )\n";
+			if( m_tables )
+			{
+				m_tables->addTemplateArg(templateId, EntityTables::ARG_TYPE, typeId);
+			}
 		} 
 		else if(argv[i].getKind() == TemplateArgument::Template)
 		{
@@ -1253,51 +1966,302 @@ void Havok::ExtractASTConsumer::dumpTemplateArgumentList_i(const TemplateArgumen
 				const CXXRecordDecl* templatedRecordDecl = classTemplateDecl->getTemplatedDecl();
 				const Type* injectedClassnameType = m_context->getRecordType(templatedRecordDecl).getTypePtr();
 				argTemplateId = findTypeId_i(injectedClassnameType);
+				if(argTemplateId == -1 && !m_roots.empty())
+				{
+					argTemplateId = dumpTemplateRecord_i(classTemplateDecl);
+				}
 			}
 			else
 			{
 				const TemplateTemplateParmDecl* templateTemplateParmDecl = 
 					dyn_cast<TemplateTemplateParmDecl>(templateDecl);
 				assert(templateTemplateParmDecl && "template declaration is not a class template or template parameter");
-				KnownTemplateTemplateParamMap::const_iterator it = m_knowTemplateTemplateParams.find(templateTemplateParmDecl->getCanonicalDecl());
-				assert((it != m_knowTemplateTemplateParams.end()) && "template template parameter not found in map");
-				argTemplateId = it->second;
+				if( !m_knowTemplateTemplateParams.lookup(templateTemplateParmDecl->getCanonicalDecl(), argTemplateId) )
+				{
+					assert(0 && "template template parameter not found in map");
+				}
+			}
+			if( m_tables )
+			{
+				m_tables->addTemplateArg(templateId, EntityTables::ARG_TEMPLATE, argTemplateId);
 			}
-			m_os << "TemplateSpecializationTemplateArg( recordid=" << templateId << ", templateid=" << argTemplateId << " )\n";
 		}
 		else if( (argv[i].getKind() == TemplateArgument::Integral) ||
 			     (argv[i].getKind() == TemplateArgument::Expression) )
 		{
-			m_os << "TemplateSpecializationNonTypeArg( recordid=" << templateId << ", value='";
-			argv[i].print(m_context->getPrintingPolicy(), m_os);
-			m_os << "' )\n";
+			if( m_tables )
+			{
+				std::string value;
+				{
+					llvm::raw_string_ostream valueStream(value);
+					argv[i].print(m_context->getPrintingPolicy(), valueStream);
+				}
+				m_tables->addTemplateArg(templateId, EntityTables::ARG_VALUE, -1, value);
+			}
 		}
 		else
 		{
-			m_os << "### Template argument kind not supported\n";
+			if( m_tables )
+			{
+				m_tables->addComment("### Template argument kind not supported");
+			}
 			assert(0);
 		}
 	}
 }
 
+void Havok::ExtractASTConsumer::dumpAnnotations_i(const Decl* decl, int declId)
+{
+	if(m_tables && decl->hasAttr<AnnotateAttr>())
+	{
+		const AttrVec& attrVec = decl->getAttrs();
+		for( specific_attr_iterator<AnnotateAttr> iterator = specific_attr_begin<AnnotateAttr>(attrVec), end_iterator = specific_attr_end<AnnotateAttr>(attrVec);
+			iterator != end_iterator; 
+			++iterator )
+		{
+			m_tables->addAnnotation(declId, iterator->getAnnotation());
+		}
+	}
+}
+
+QualType Havok::ExtractASTConsumer::getTemplateSpecializationType_i(const ClassTemplateSpecializationDecl* classTemplateSpecializationDecl)
+{
+	const TemplateArgumentList& argList = classTemplateSpecializationDecl->getTemplateArgs();
+	const QualType canonType = m_context->getRecordType(classTemplateSpecializationDecl);
+	TemplateName tempName(classTemplateSpecializationDecl->getSpecializedTemplate());
+	// a new type is allocated by the context every time
+	OptionalLock lock(m_astMutex);
+	return m_context->getTemplateSpecializationType(tempName, argList.data(), argList.size(), canonType);
+}
+
+QualType Havok::ExtractASTConsumer::getTemplateTypeParmType_i(const TemplateTypeParmDecl* templateTypeParmDecl, bool withDecl)
+{
+	OptionalLock lock(m_astMutex);
+	return m_context->getTemplateTypeParmType(
+		templateTypeParmDecl->getDepth(), 
+		templateTypeParmDecl->getIndex(), 
+		templateTypeParmDecl->isParameterPack(),
+		withDecl ? const_cast<TemplateTypeParmDecl*>(templateTypeParmDecl) : NULL);
+}
+
 int Havok::ExtractASTConsumer::findTypeId_i(const Type* typeIn)
 {
-	KnownTypeMap::const_iterator it = m_knownTypes.find(typeIn);
-	if(it == m_knownTypes.end())
+	int id;
+	if(!m_knownTypes.lookup(typeIn, id))
 	{
 		return -1;
 	}
-	return it->second;
+	return id;
 }
 
 int Havok::ExtractASTConsumer::findConstTypeId_i(int typeId)
 {
-	ConstTypeIdMap::const_iterator it = m_constTypeIdMap.find(typeId);
-	if(it == m_constTypeIdMap.end())
+	int id;
+	if(!m_constTypeIdMap.lookup(typeId, id))
 	{
 		return -1;
 	}
-	return it->second;
+	return id;
+}
+
+bool Havok::ExtractASTConsumer::findStructuralType_i(Type::TypeClass typeClass, int scopeId, const int* componentIds, int numComponents,
+	std::string& keyOut, int& idOut)
+{
+	if( !(m_dumpBits & DUMP_CANONICAL_TYPES) )
+	{
+		return false;
+	}
+	keyOut.clear();
+	llvm::raw_string_ostream key(keyOut);
+	key << int(typeClass) << ':' << scopeId;
+	for( int i = 0; i < numComponents; ++i )
+	{
+		key << ',' << componentIds[i];
+	}
+	key.flush();
+
+	if( !m_structuralTypes.lookup(keyOut, idOut) )
+	{
+		return false;
+	}
+	++m_numSharedTypes;
+	return true;
+}
+
+uint64_t Havok::ExtractASTConsumer::getContentHash_i(const Decl* decl)
+{
+	// the content is in the definition
+	if( const TagDecl* tagDecl = dyn_cast<TagDecl>(decl) )
+	{
+		if( const TagDecl* def = tagDecl->getDefinition() )
+		{
+			decl = def;
+		}
+	}
+	else if( const ClassTemplateDecl* classTemplateDecl = dyn_cast<ClassTemplateDecl>(decl) )
+	{
+		if( const ClassTemplateDecl* def = s_getClassTemplateDefinition(classTemplateDecl) )
+		{
+			decl = def;
+		}
+	}
+	ContentHashMap::const_iterator found = m_contentHashes.find(decl);
+	if( found != m_contentHashes.end() )
+	{
+		return found->second;
+	}
+	// records cannot contain themselves by value, but invalid code could
+	m_contentHashes[decl] = 0;
+
+	PrintingPolicy policy(m_context->getPrintingPolicy());
+	// moving an anonymous record does not change it
+	policy.AnonymousTagLocations = false;
+
+	Fnv64 hash;
+	s_hashString(hash, decl->getDeclKindName());
+	s_hashString(hash, cast<NamedDecl>(decl)->getQualifiedNameAsString());
+	s_hashAnnotations(hash, decl);
+	if( const ClassTemplateDecl* classTemplateDecl = dyn_cast<ClassTemplateDecl>(decl) )
+	{
+		s_hashTemplateParameterList(hash, classTemplateDecl->getTemplateParameters(), policy);
+		s_hashInteger(hash, getContentHash_i(classTemplateDecl->getTemplatedDecl()));
+	}
+	else if( const EnumDecl* enumDecl = dyn_cast<EnumDecl>(decl) )
+	{
+		if( !enumDecl->getIntegerType().isNull() )
+		{
+			s_hashString(hash, enumDecl->getIntegerType().getCanonicalType().getAsString(policy));
+		}
+		for( EnumDecl::enumerator_iterator it = enumDecl->enumerator_begin(), end = enumDecl->enumerator_end(); it != end; ++it )
+		{
+			s_hashString(hash, s_getName(*it));
+			s_hashString(hash, it->getInitVal().toString(10));
+			s_hashAnnotations(hash, *it);
+		}
+	}
+	else if( const CXXRecordDecl* recordDecl = dyn_cast<CXXRecordDecl>(decl) )
+	{
+		if( const ClassTemplatePartialSpecializationDecl* partialSpecializationDecl = dyn_cast<ClassTemplatePartialSpecializationDecl>(recordDecl) )
+		{
+			s_hashTemplateParameterList(hash, partialSpecializationDecl->getTemplateParameters(), policy);
+		}
+		if( const ClassTemplateSpecializationDecl* specializationDecl = dyn_cast<ClassTemplateSpecializationDecl>(recordDecl) )
+		{
+			const TemplateArgumentList& argList = specializationDecl->getTemplateArgs();
+			s_hashString(hash, TemplateSpecializationType::PrintTemplateArgumentList(argList.data(), argList.size(), policy));
+		}
+		s_hashInteger(hash, recordDecl->hasDefinition());
+		if( recordDecl->hasDefinition() )
+		{
+			for( CXXRecordDecl::base_class_const_iterator it = recordDecl->bases_begin(), end = recordDecl->bases_end(); it != end; ++it )
+			{
+				s_hashInteger(hash, it->getAccessSpecifier());
+				s_hashInteger(hash, it->isVirtual());
+				hashType_i(hash, it->getType(), policy);
+			}
+			for( DeclContext::decl_iterator it = recordDecl->decls_begin(), end = recordDecl->decls_end(); it != end; ++it )
+			{
+				const Decl* member = *it;
+				s_hashString(hash, member->getDeclKindName());
+				s_hashInteger(hash, member->getAccess());
+				if( const NamedDecl* namedMember = dyn_cast<NamedDecl>(member) )
+				{
+					s_hashString(hash, s_getName(namedMember));
+				}
+				if( const FieldDecl* fieldDecl = dyn_cast<FieldDecl>(member) )
+				{
+					hashType_i(hash, fieldDecl->getType(), policy);
+					if( fieldDecl->isBitField() && !fieldDecl->getBitWidth()->isValueDependent() )
+					{
+						s_hashInteger(hash, fieldDecl->getBitWidthValue(*m_context));
+					}
+				}
+				else if( const CXXMethodDecl* methodDecl = dyn_cast<CXXMethodDecl>(member) )
+				{
+					s_hashString(hash, methodDecl->getType().getCanonicalType().getAsString(policy));
+					s_hashInteger(hash, (methodDecl->isVirtual() ? 1 : 0) | (methodDecl->isPure() ? 2 : 0) | (methodDecl->isStatic() ? 4 : 0));
+				}
+				else if( const ValueDecl* valueDecl = dyn_cast<ValueDecl>(member) )
+				{
+					// static fields can have the type of the record itself, only their type name is hashed
+					s_hashString(hash, valueDecl->getType().getCanonicalType().getAsString(policy));
+				}
+				else if( const TypedefNameDecl* typedefNameDecl = dyn_cast<TypedefNameDecl>(member) )
+				{
+					s_hashString(hash, typedefNameDecl->getUnderlyingType().getCanonicalType().getAsString(policy));
+				}
+				else if( const FunctionTemplateDecl* functionTemplateDecl = dyn_cast<FunctionTemplateDecl>(member) )
+				{
+					s_hashTemplateParameterList(hash, functionTemplateDecl->getTemplateParameters(), policy);
+					s_hashString(hash, functionTemplateDecl->getTemplatedDecl()->getType().getCanonicalType().getAsString(policy));
+				}
+				s_hashAnnotations(hash, member);
+			}
+		}
+	}
+
+	const uint64_t contentHash = hash.get();
+	m_contentHashes[decl] = contentHash;
+	return contentHash;
+}
+
+// The records and enums held by value (fields, bases, arrays) contribute their content, the
+// other types referred to (through pointers, references, methods) only their name
+void Havok::ExtractASTConsumer::hashType_i(Fnv64& hash, QualType type, const PrintingPolicy& policy)
+{
+	const QualType canonicalType = type.getCanonicalType();
+	s_hashString(hash, canonicalType.getAsString(policy));
+	const Type* valueType = canonicalType.getTypePtr();
+	while( const ArrayType* arrayType = dyn_cast<ArrayType>(valueType) )
+	{
+		valueType = arrayType->getElementType().getTypePtr();
+	}
+	if( const TagType* tagType = dyn_cast<TagType>(valueType) )
+	{
+		s_hashInteger(hash, getContentHash_i(tagType->getDecl()));
+	}
+}
+
+void Havok::ExtractASTConsumer::setContentHash_i(int id, const Decl* decl)
+{
+	if( m_dumpBits & DUMP_CONTENT_HASHES )
+	{
+		m_tables->setContentHash(id, getContentHash_i(decl));
+	}
+}
+
+void Havok::ExtractASTConsumer::setLayout_i(int id, const RecordDecl* decl)
+{
+	if( m_dumpBits & DUMP_LAYOUTS )
+	{
+		if( const ASTRecordLayout* layout = s_getRecordLayout(*m_context, decl, m_astMutex) )
+		{
+			m_tables->setLayout(id, layout->getSize().getQuantity(), layout->getAlignment().getQuantity());
+		}
+	}
+}
+
+const Type* Havok::ExtractASTConsumer::getDesugaredType_i(const Type* typeIn)
+{
+	if(typeIn->isCanonicalUnqualified())
+	{
+		// canonical types have no sugar
+		return typeIn;
+	}
+	if( m_sharedDesugaredTypes != NULL )
+	{
+		DesugaredTypeMap::const_iterator it = m_sharedDesugaredTypes->find(typeIn);
+		if( it != m_sharedDesugaredTypes->end() )
+		{
+			return it->second;
+		}
+	}
+	const Type*& desugaredType = m_desugaredTypes[typeIn];
+	if(desugaredType == NULL)
+	{
+		desugaredType = typeIn->getUnqualifiedDesugaredType();
+	}
+	return desugaredType;
 }
 
 int Havok::ExtractASTConsumer::getTypeId_i(const Type* typeIn)
@@ -1313,7 +2277,8 @@ int Havok::ExtractASTConsumer::getTypeId_i(const Type* typeIn)
 int Havok::ExtractASTConsumer::getNamespaceId_i(const NamespaceDecl* namespaceDecl)
 {
 	const NamespaceDecl* originalNamespaceDecl = namespaceDecl->getOriginalNamespace();
-	int id = m_knownNamespaces[originalNamespaceDecl];
+	int id = 0;
+	m_knownNamespaces.lookup(originalNamespaceDecl, id);
 	assert(id != 0 && "namespace Id not found");
 	return id;
 }
@@ -1327,16 +2292,9 @@ void Havok::ExtractASTConsumer::addOrReplaceSpecializationTypeParameterTypes_i(c
 		const NamedDecl* paramDecl = (*it);
 		if ( const TemplateTypeParmDecl* templateTypeParmDecl = dyn_cast<TemplateTypeParmDecl>(paramDecl))
 		{
-			int typeId = getTypeId_i(m_context->getTemplateTypeParmType(
-				templateTypeParmDecl->getDepth(), 
-				templateTypeParmDecl->getIndex(), 
-				templateTypeParmDecl->isParameterPack(),
-				const_cast<TemplateTypeParmDecl*>(templateTypeParmDecl)).getTypePtr());
-			const Type* newType = m_context->getTemplateTypeParmType(
-				templateTypeParmDecl->getDepth(), 
-				templateTypeParmDecl->getIndex(), 
-				templateTypeParmDecl->isParameterPack()).getTypePtr();
-			m_knownTypes[newType] = typeId;
+			int typeId = getTypeId_i(getTemplateTypeParmType_i(templateTypeParmDecl, true).getTypePtr());
+			const Type* newType = getTemplateTypeParmType_i(templateTypeParmDecl, false).getTypePtr();
+			m_knownTypes.set(newType, typeId);
 		} 
 	}
 }
@@ -8,12 +8,25 @@
 	#include "clang/AST/AST.h"
 	#include "clang/Sema/SemaConsumer.h"
 	#include "clang/Frontend/CompilerInstance.h"
+	#include "llvm/ADT/SmallPtrSet.h"
+	#include "llvm/ADT/SmallVector.h"
 #pragma warning(pop)
 
+#include <list>
+#include <map>
+#include <string>
+#include <vector>
+#include "entities.h"
+#include "threads.h"
+
 namespace Havok 
 {
 	using namespace clang;
 
+	class Fnv64;
+	class HeaderReport;
+	class PerfCounters;
+
 	/// Havok AST consumer class
 	class ExtractASTConsumer : public SemaConsumer
 	{
@@ -30,18 +43,59 @@ namespace Havok
 			{
 				DUMP_DEFAULT = 0,
 				DUMP_VERBOSE = 1,
-				DUMP_FUNCTIONS = 2
+				DUMP_FUNCTIONS = 2,
+				DUMP_LAYOUTS = 4,
+				// Members of implicit instantiations which are substitutions of the template members are not dumped
+				DUMP_COMPACT_INSTANTIATIONS = 8,
+				// Structural types (pointers, references, arrays, function prototypes) with the same components share their id
+				DUMP_CANONICAL_TYPES = 16,
+				// Records, templates and enums have the hash of their content
+				DUMP_CONTENT_HASHES = 32
 			};
 
+			// Enable additional dumping configuration bits
+			void addDumpBits(DumpBits bits);
+
 			// delayed dumping of all declarations
 			void dumpAllDeclarations();
+			// same as above using several threads, the output is identical
+			void dumpAllDeclarationsParallel(int numThreads);
+
+			// Maximum number of implicit instantiation definitions dumped, negative for no limit
+			void setInstantiationBudget(int budget);
+
+			// Restrict the dump to the named record, enum or template (and the types it refers to)
+			void addRoot(const std::string& qualifiedName);
+
+			// Collect the dumped entities into the given tables instead of private ones, see EntityTables.
+			// The text database is rendered from the tables either way.
+			void setEntityTables(EntityTables* tables);
+
+			// Attribute the declarations and their dump cost to their files (the dump is then serial)
+			void setHeaderReport(HeaderReport* headerReport);
+
+			// Count the implicit member declarations in their own phase
+			void setPerfCounters(PerfCounters* perfCounters);
 
 		protected:
 
+			// Microbenchmarks of the internals (bench.cpp)
+			friend struct ExtractBenchmarks;
+
+			typedef std::list<const clang::Decl*> DeclList;
+			struct ParallelDumpJob;
+
+			// Consumer of a chunk of the parallel dump, in the state the claim walk had at the start of
+			// the chunk. The ids set by the claim walk are shared, not copied.
+			ExtractASTConsumer(const ExtractASTConsumer& claim, unsigned chunk, llvm::raw_ostream& os);
+
 			// Basic function to fix declarations of C++ special methods (e.g. copy constructor) in classes
 			void declareImplicitMethods(Decl* declIn);
 			// Basic function that dumps a generic declaration
 			int dumpDecl_i(const Decl* declIn);
+			void dumpDeclRange_i(DeclList::const_iterator begin, DeclList::const_iterator end);
+			// Same as dumpDecl_i(), the cost is added to the header report
+			void dumpDeclWithCost_i(const Decl* declIn);
 			// Functions used to dump the type referred by a declaration, the type is what we use to identify an entity
 			int dumpType_i(QualType qualTypeIn, int scopeId = -1);
 			int dumpSimpleType_i(QualType qualTypeIn, int scopeId = -1);
@@ -51,72 +105,69 @@ namespace Havok
 			int dumpTemplateSpecializationType_i(const ClassTemplateSpecializationDecl* classTemplateSpecializationDecl, int scopeId);
 			// More dumping functions
 			int dumpScope_i(const Decl* decl);
+			int dumpFileScope_i(SourceLocation loc);
 			void dumpSpecifiersRecursive_i(const NestedNameSpecifier* nestedNameSpecifier);
 			void dumpTypeSpecifiers_i(const Type* type);
 			void dumpTagDefinition_i(const TagDecl* tagDecl, int recordId);
+			void dumpInstantiationDefinition_i(const ClassTemplateSpecializationDecl* instantiationDef, int recordId, int templateId);
 			void dumpDeclContext_i(const DeclContext* context);
 			void dumpNamespace_i(const NamespaceDecl* namespaceDecl);
+			int dumpNamespaceEntry_i(const NamespaceDecl* namespaceDecl);
 			void dumpTemplateClass_i(const ClassTemplateDecl* classTemplateDecl);
+			int dumpTemplateRecord_i(const ClassTemplateDecl* classTemplateDecl);
 			void dumpTemplateClassSpecialization_i(const ClassTemplateSpecializationDecl* classTemplateSpecializationDecl);
 			void dumpTemplateParameterList_i(const TemplateParameterList* paramList, int templateId);
 			void dumpTemplateArgumentList_i(const TemplateArgument* argv, int argc, int templateId);
+			void dumpAnnotations_i(const Decl* decl, int declId);
+			int dumpConstType_i(int typeId);
+			// Types built by the AST context, locked when dumping in parallel
+			QualType getTemplateSpecializationType_i(const ClassTemplateSpecializationDecl* classTemplateSpecializationDecl);
+			QualType getTemplateTypeParmType_i(const TemplateTypeParmDecl* templateTypeParmDecl, bool withDecl);
 			// Functions used for lookups in the internal structures
 			int findTypeId_i(const Type* typeIn);
 			int findConstTypeId_i(int typeId);
 			int getTypeId_i(const Type* typeIn);
+			// The type without any sugar, cached
+			const Type* getDesugaredType_i(const Type* typeIn);
+			// Id of a structural type with the same components dumped before (DUMP_CANONICAL_TYPES only),
+			// keyOut is set to the key to add the type with otherwise
+			bool findStructuralType_i(Type::TypeClass typeClass, int scopeId, const int* componentIds, int numComponents,
+				std::string& keyOut, int& idOut);
 			int getNamespaceId_i(const NamespaceDecl* namespaceDecl);
+			// Hash of the content of a record, template or enum (DUMP_CONTENT_HASHES only), cached
+			uint64_t getContentHash_i(const Decl* decl);
+			void hashType_i(Fnv64& hash, QualType type, const PrintingPolicy& policy);
+			void setContentHash_i(int id, const Decl* decl);
+			// Size and alignment of a record type (DUMP_LAYOUTS only)
+			void setLayout_i(int id, const RecordDecl* decl);
 			// More utility functions
 			void addOrReplaceSpecializationTypeParameterTypes_i(const TemplateParameterList* paramList);
-			
-			// Some types of dump entry are routed through this class to unify default handling.
-			class DumpEntry
-			{
-			public:
-				enum EntryType
-				{
-					// Only these types are currently supported.
-					ENTRY_METHOD,
-					ENTRY_CONSTRUCTOR,
-					ENTRY_DESTRUCTOR,
-					ENTRY_FIELD,
-
-					NUM_ENTRIES
-				};
-
-				// Construct a new entry (outputs name to stream)
-				DumpEntry(llvm::raw_ostream& os, EntryType t);
-
-				// Output a key value pair when the value isn't the default value.
-				void dumpKeyValuePair(const char* key, const char* val);
-				void dumpKeyValuePair(const char* key, int i);
-				void dumpKeyValuePair(const char* key, bool b);
-				void dumpKeyValuePair(const char* key, AccessSpecifier as);
-
-				// Output a closing parenthesis and newline.
-				void finishEntry();
-
-				// Output a series of entries summarizing the defaults.
-				static void dumpDefaultEntries(llvm::raw_ostream& os);
-
-			protected:
-				// Output a comma, if necessary.
-				void checkOutputComma();
-			
-			protected:
-				EntryType m_entryType;
-				/// Used to put commas in the correct position.
-				bool m_hasOutputKeyValuePair;
-				llvm::raw_ostream& m_os;
-
-			private:
-				// Private and unimplemented.
-				DumpEntry(DumpEntry& other);
-				DumpEntry& operator=(DumpEntry& other);
-			};
-
+			// Functions used to restrict the dump to the closure of the root declarations
+			void dumpRoots_i();
+			void findRootDecls_i(const Decl* decl, std::vector<bool>& rootFound);
+			void queueDefinition_i(const Decl* decl);
+			bool claimDefinition_i(const TagDecl* tagDecl);
+			// Statistics comment lines written after the declarations
+			void dumpStatistics_i(int numSharedTypes);
+			// Render the rows added to the tables since the last call to the output stream
+			void writeRows_i();
+			// History of the ids set by the claim walk of the parallel dump, see IdMap
+			void keepIdHistory_i();
+			void setIdChunk_i(unsigned chunk);
+			void clearIdHistory_i();
 			
 			// List of declarations, declarations are collected and then dumped in a second phase
-			std::list<const clang::Decl*> m_decls;
+			DeclList m_decls;
+
+			// Qualified names of the root declarations, when empty every declaration is dumped
+			std::vector<std::string> m_roots;
+
+			// Definitions still to be dumped when dumping the closure of the root declarations
+			std::vector<const Decl*> m_pendingDefinitions;
+			llvm::SmallPtrSet<const Decl*, 64> m_queuedDefinitions;
+
+			// Tag definitions already dumped when dumping the closure of the root declarations
+			llvm::SmallPtrSet<const TagDecl*, 64> m_dumpedDefinitions;
 
 			// Output stream
 			llvm::raw_ostream& m_os;
@@ -124,25 +175,132 @@ namespace Havok
 			// AST context used during consumption of the AST
 			ASTContext* m_context;
 
+			// Ids of the entities by key. When dumping in parallel the claim walk keeps the history of
+			// the ids it sets, with the chunk they were set in, and the consumers of the chunks look
+			// it up instead of copying the map: a chunk sees the ids set by the chunks before it and
+			// the ones it set itself. The history map has the ChunkIdList of each key.
+			typedef llvm::SmallVector<std::pair<unsigned, int>, 1> ChunkIdList;
+			template<typename KeyT, typename MapT, typename HistoryMapT>
+			class IdMap
+			{
+				public:
+
+					IdMap() : m_sharedHistory(NULL), m_chunk(0), m_keepHistory(false) {}
+
+					// False if the key has no id
+					bool lookup(const KeyT& key, int& idOut) const
+					{
+						typename MapT::const_iterator it = m_ids.find(key);
+						if( it != m_ids.end() )
+						{
+							idOut = it->second;
+							return true;
+						}
+						if( m_sharedHistory != NULL )
+						{
+							typename HistoryMapT::const_iterator found = m_sharedHistory->find(key);
+							if( found != m_sharedHistory->end() )
+							{
+								// the ids of a key are in chunk order
+								const ChunkIdList& ids = found->second;
+								for( size_t i = ids.size(); i-- > 0; )
+								{
+									if( ids[i].first < m_chunk )
+									{
+										idOut = ids[i].second;
+										return true;
+									}
+								}
+							}
+						}
+						return false;
+					}
+
+					void set(const KeyT& key, int id)
+					{
+						m_ids[key] = id;
+						if( m_keepHistory )
+						{
+							m_history[key].push_back(std::make_pair(m_chunk, id));
+						}
+					}
+
+					// Keep the history of the ids set from now on, the ids already set belong to chunk 0
+					void keepHistory()
+					{
+						for( typename MapT::const_iterator it = m_ids.begin(); it != m_ids.end(); ++it )
+						{
+							m_history[it->first].push_back(std::make_pair(0u, it->second));
+						}
+						m_keepHistory = true;
+					}
+					// Chunk the ids set from now on belong to, chunks start at 1
+					void setChunk(unsigned chunk) { m_chunk = chunk; }
+					// See the ids the claim walk set before the chunk
+					void shareHistory(const IdMap& claim, unsigned chunk)
+					{
+						m_sharedHistory = &claim.m_history;
+						m_chunk = chunk;
+					}
+					void clearHistory()
+					{
+						m_history.clear();
+						m_keepHistory = false;
+					}
+
+				private:
+
+					MapT m_ids;
+					HistoryMapT m_history;
+					const HistoryMapT* m_sharedHistory;
+					unsigned m_chunk;
+					bool m_keepHistory;
+			};
+
 			// Map of know types (types are used to identify declarations of the same entity)
 			typedef llvm::DenseMap<const Type*, int> KnownTypeMap;
-			KnownTypeMap m_knownTypes;
+			IdMap<const Type*, KnownTypeMap, llvm::DenseMap<const Type*, ChunkIdList> > m_knownTypes;
+
+			// Types without their sugar (typedefs, parens...), see getDesugaredType_i(). The consumers
+			// of the chunks look up the types desugared by the claim walk first.
+			typedef llvm::DenseMap<const Type*, const Type*> DesugaredTypeMap;
+			DesugaredTypeMap m_desugaredTypes;
+			const DesugaredTypeMap* m_sharedDesugaredTypes;
+
+			// Ids of the structural types by type class and component ids, see findStructuralType_i()
+			typedef std::map<std::string, int> StructuralTypeMap;
+			IdMap<std::string, StructuralTypeMap, std::map<std::string, ChunkIdList> > m_structuralTypes;
+			// Types which got the id of a structurally identical type
+			int m_numSharedTypes;
+
+			// Content hashes of the record, template and enum definitions, see getContentHash_i()
+			typedef llvm::DenseMap<const Decl*, uint64_t> ContentHashMap;
+			ContentHashMap m_contentHashes;
 
 			// Maps a type id to the id of a const version of that type.
 			typedef llvm::DenseMap<int, int> ConstTypeIdMap;
-			ConstTypeIdMap m_constTypeIdMap;
+			IdMap<int, ConstTypeIdMap, llvm::DenseMap<int, ChunkIdList> > m_constTypeIdMap;
 
 			// Map of known namespaces (used to identify a certain namespace as scope)
 			typedef llvm::DenseMap<const NamespaceDecl*, int> KnownNamespacesMap;
-			KnownNamespacesMap m_knownNamespaces;
+			IdMap<const NamespaceDecl*, KnownNamespacesMap, llvm::DenseMap<const NamespaceDecl*, ChunkIdList> > m_knownNamespaces;
 
 			// Map of known files (used to identify a certain file, considering it the largest scope a declaration can be in).
 			typedef llvm::DenseMap<FileID, int> KnownFilesMap;
-			KnownFilesMap m_knownFiles;
+			IdMap<FileID, KnownFilesMap, llvm::DenseMap<FileID, ChunkIdList> > m_knownFiles;
+
+			// Scope ids of the source location entries (files and macro expansions) declarations were found in
+			typedef llvm::DenseMap<FileID, int> EntryScopeMap;
+			IdMap<FileID, EntryScopeMap, llvm::DenseMap<FileID, ChunkIdList> > m_entryScopes;
+
+			// Normalized names of the files, shared with the consumers cloned to dump in parallel
+			typedef llvm::DenseMap<FileID, std::string> FileNameMap;
+			FileNameMap* m_fileNames;
+			FileNameMap m_fileNameStorage;
 
 			// Map of known template template parameters (used to indentify a template template parameter)
 			typedef llvm::DenseMap<const Decl*, int> KnownTemplateTemplateParamMap;
-			KnownTemplateTemplateParamMap m_knowTemplateTemplateParams;
+			IdMap<const Decl*, KnownTemplateTemplateParamMap, llvm::DenseMap<const Decl*, ChunkIdList> > m_knowTemplateTemplateParams;
 
 			// Allocator object for entity identifiers
 			class UidAllocator
@@ -150,6 +308,8 @@ namespace Havok
 				public:
 					UidAllocator() : m_uidNext(1) {}
 					int alloc() { return m_uidNext++; }
+					// Next identifier to be allocated
+					int peek() const { return m_uidNext; }
 				private:
 					int m_uidNext;
 			};
@@ -158,9 +318,29 @@ namespace Havok
 			// Dumping configuration bits
 			DumpBits m_dumpBits;
 
+			// Implicit instantiation definitions which can still be dumped, negative for no limit
+			int m_instantiationBudget;
+
 			// clang Sema instance used to perform semantic analysis
 			Sema* m_sema;
 
+			// Tables collecting the dumped entities, the output is rendered from them. Either the tables
+			// of the caller or the private ones, which are cleared once written. NULL when the claim
+			// walk of the parallel dump only allocates the ids.
+			EntityTables* m_tables;
+			EntityTables m_tableStorage;
+			// Rows of the tables already written to the output stream
+			unsigned m_numWrittenRows;
+
+			// Cost of the files (optional)
+			HeaderReport* m_headerReport;
+
+			// Hardware counters of the phases (optional)
+			PerfCounters* m_perfCounters;
+
+			// Guards the AST context calls which are not read-only when dumping in parallel (optional)
+			Mutex* m_astMutex;
+
 		private:
 			
 			ExtractASTConsumer& operator=(ExtractASTConsumer& other);
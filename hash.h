@@ -0,0 +1,71 @@
+// Copyright (c) 2012 Havok. All rights reserved. This file is distributed under the terms
+// and conditions defined in file 'LICENSE.txt', which is part of this source code package.
+
+#ifndef HASH_H
+#define HASH_H
+
+#pragma warning(push,0)
+	#include "llvm/Support/DataTypes.h"
+	#include "llvm/Support/raw_ostream.h"
+#pragma warning(pop)
+
+namespace Havok
+{
+	/// 64-bit FNV-1a hash of a byte sequence, fed incrementally
+	class Fnv64
+	{
+		public:
+
+			Fnv64() : m_hash(UINT64_C(14695981039346656037)) {}
+
+			void update(const char* data, size_t size)
+			{
+				uint64_t hash = m_hash;
+				for( const char* end = data + size; data != end; ++data )
+				{
+					hash ^= static_cast<unsigned char>(*data);
+					hash *= UINT64_C(1099511628211);
+				}
+				m_hash = hash;
+			}
+
+			uint64_t get() const { return m_hash; }
+
+		protected:
+
+			uint64_t m_hash;
+	};
+
+	/// Forwards everything to another stream and hashes it on the way
+	class HashingOutputStream : public llvm::raw_ostream
+	{
+		public:
+
+			HashingOutputStream(llvm::raw_ostream& os) : m_os(os), m_size(0) {}
+			~HashingOutputStream() { flush(); }
+
+			// Hash of the data flushed so far
+			uint64_t getHash() const { return m_hash.get(); }
+
+		protected:
+
+			virtual void write_impl(const char* ptr, size_t size)
+			{
+				m_hash.update(ptr, size);
+				m_size += size;
+				m_os.write(ptr, size);
+			}
+
+			virtual uint64_t current_pos() const { return m_size; }
+
+			llvm::raw_ostream& m_os;
+			Fnv64 m_hash;
+			uint64_t m_size;
+
+		private:
+			HashingOutputStream(const HashingOutputStream&);
+			HashingOutputStream& operator=(const HashingOutputStream&);
+	};
+}
+
+#endif //HASH_H
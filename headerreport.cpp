@@ -0,0 +1,149 @@
+// Copyright (c) 2012 Havok. All rights reserved. This file is distributed under the terms
+// and conditions defined in file 'LICENSE.txt', which is part of this source code package.
+
+#include "headerreport.h"
+#include "escape.h"
+#include <algorithm>
+
+#pragma warning(push,0)
+	#include "clang/AST/DeclBase.h"
+	#include "clang/Basic/SourceManager.h"
+	#include "clang/Lex/PPCallbacks.h"
+	#include "llvm/Support/Format.h"
+	#include "llvm/Support/TimeValue.h"
+#pragma warning(pop)
+
+// Forwards the file changes of the preprocessor to the report
+class Havok::HeaderReport::Callbacks : public PPCallbacks
+{
+	public:
+
+		Callbacks(HeaderReport& report) : m_report(report) {}
+
+		virtual void FileChanged(SourceLocation loc, FileChangeReason reason, SrcMgr::CharacteristicKind, FileID)
+		{
+			if(reason == EnterFile)
+			{
+				m_report.chargeParseTime_i();
+				m_report.m_includeStack.push_back(&m_report.getCost_i(loc));
+			}
+			else if(reason == ExitFile && m_report.m_includeStack.size() > 1)
+			{
+				m_report.chargeParseTime_i();
+				m_report.m_includeStack.pop_back();
+			}
+		}
+
+	protected:
+
+		HeaderReport& m_report;
+
+	private:
+		Callbacks& operator=(const Callbacks&);
+};
+
+namespace
+{
+	typedef llvm::StringMapEntry<Havok::HeaderReport::FileCost> CostEntry;
+
+	// Most expensive first, then by name so that the order is stable
+	struct CostGreater
+	{
+		bool operator()(const CostEntry* a, const CostEntry* b) const
+		{
+			const double costA = a->getValue().m_parseTime + a->getValue().m_dumpTime;
+			const double costB = b->getValue().m_parseTime + b->getValue().m_dumpTime;
+			if(costA != costB)
+			{
+				return costA > costB;
+			}
+			return a->getKey() < b->getKey();
+		}
+	};
+}
+
+Havok::HeaderReport::HeaderReport()
+	: m_sourceManager(0), m_lastEventTime(0)
+{
+}
+
+clang::PPCallbacks* Havok::HeaderReport::createPPCallbacks(SourceManager& sourceManager)
+{
+	m_sourceManager = &sourceManager;
+	m_costsByFileId.clear();
+	m_includeStack.clear();
+	m_lastEventTime = s_getTime();
+	return new Callbacks(*this);
+}
+
+void Havok::HeaderReport::endParse()
+{
+	chargeParseTime_i();
+	m_includeStack.clear();
+}
+
+void Havok::HeaderReport::addDeclaration(const Decl* decl)
+{
+	getCost_i(decl->getLocation()).m_numDecls++;
+}
+
+void Havok::HeaderReport::addDumpCost(const Decl* decl, int numEntities, uint64_t numBytes, double seconds)
+{
+	FileCost& cost = getCost_i(decl->getLocation());
+	cost.m_numEntities += numEntities;
+	cost.m_numBytes += numBytes;
+	cost.m_dumpTime += seconds;
+}
+
+void Havok::HeaderReport::write(llvm::raw_ostream& os) const
+{
+	std::vector<const CostEntry*> entries;
+	for( llvm::StringMap<FileCost>::const_iterator it = m_costs.begin(), end = m_costs.end(); it != end; ++it )
+	{
+		entries.push_back(&*it);
+	}
+	std::sort(entries.begin(), entries.end(), CostGreater());
+
+	for( std::vector<const CostEntry*>::const_iterator it = entries.begin(), end = entries.end(); it != end; ++it )
+	{
+		const FileCost& cost = (*it)->getValue();
+		os << "HeaderCost( path='" << escaped((*it)->getKey()) << "'";
+		os << ", parseTime=" << llvm::format("%.6f", cost.m_parseTime);
+		os << ", decls=" << cost.m_numDecls;
+		os << ", entities=" << cost.m_numEntities;
+		os << ", bytes=" << cost.m_numBytes;
+		os << ", dumpTime=" << llvm::format("%.6f", cost.m_dumpTime);
+		os << " )\n";
+	}
+}
+
+double Havok::HeaderReport::s_getTime()
+{
+	llvm::sys::TimeValue now = llvm::sys::TimeValue::now();
+	return double(now.seconds()) + double(now.nanoseconds()) * 1e-9;
+}
+
+Havok::HeaderReport::FileCost& Havok::HeaderReport::getCost_i(SourceLocation loc)
+{
+	assert(m_sourceManager && "the report has no source manager");
+	const FileID fileId = m_sourceManager->getFileID(m_sourceManager->getExpansionLoc(loc));
+	FileCost*& cost = m_costsByFileId[fileId];
+	if(cost == NULL)
+	{
+		// the buffer name is the file name for files
+		std::string name = fileId.isInvalid() ? "<unknown>" : m_sourceManager->getBufferName(m_sourceManager->getLocForStartOfFile(fileId));
+		std::replace(name.begin(), name.end(), '\\', '/');
+		cost = &m_costs.GetOrCreateValue(name).getValue();
+	}
+	return *cost;
+}
+
+void Havok::HeaderReport::chargeParseTime_i()
+{
+	const double now = s_getTime();
+	if(!m_includeStack.empty())
+	{
+		m_includeStack.back()->m_parseTime += now - m_lastEventTime;
+	}
+	m_lastEventTime = now;
+}
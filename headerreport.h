@@ -0,0 +1,91 @@
+// Copyright (c) 2012 Havok. All rights reserved. This file is distributed under the terms
+// and conditions defined in file 'LICENSE.txt', which is part of this source code package.
+
+#ifndef HEADER_REPORT_H
+#define HEADER_REPORT_H
+
+#pragma warning(push,0)
+	#include "clang/Basic/SourceLocation.h"
+	#include "llvm/ADT/DenseMap.h"
+	#include "llvm/ADT/StringMap.h"
+	#include "llvm/Support/DataTypes.h"
+	#include "llvm/Support/raw_ostream.h"
+#pragma warning(pop)
+
+#include <vector>
+
+namespace clang
+{
+	class Decl;
+	class PPCallbacks;
+	class SourceManager;
+}
+
+namespace Havok
+{
+	using namespace clang;
+
+	/// Cost of an extraction attributed to the files it was spent in. The preprocessing and
+	/// parsing time of a file is the time the preprocessor spent in it, not counting the files
+	/// it includes. The dump cost of a top-level declaration (time, entities and bytes written)
+	/// is attributed to the file the declaration is in.
+	class HeaderReport
+	{
+		public:
+
+			HeaderReport();
+
+			// Preprocessor callbacks timing the files, the preprocessor owns them once added.
+			// The source manager is used until endParse().
+			PPCallbacks* createPPCallbacks(SourceManager& sourceManager);
+			// The parser is done, the remaining time is given to the current file
+			void endParse();
+
+			// A top-level declaration was parsed
+			void addDeclaration(const Decl* decl);
+			// A declaration was dumped
+			void addDumpCost(const Decl* decl, int numEntities, uint64_t numBytes, double seconds);
+
+			// Write a HeaderCost line per file, the most expensive first
+			void write(llvm::raw_ostream& os) const;
+
+			// Wall clock time in seconds
+			static double s_getTime();
+
+			// Cost attributed to a file
+			struct FileCost
+			{
+				FileCost() : m_parseTime(0), m_numDecls(0), m_numEntities(0), m_numBytes(0), m_dumpTime(0) {}
+
+				double m_parseTime;
+				unsigned m_numDecls;
+				unsigned m_numEntities;
+				uint64_t m_numBytes;
+				double m_dumpTime;
+			};
+
+		protected:
+
+			class Callbacks;
+
+			// Cost of the file containing a location
+			FileCost& getCost_i(SourceLocation loc);
+			// Give the time since the last event to the file on top of the include stack
+			void chargeParseTime_i();
+
+			SourceManager* m_sourceManager;
+			// Costs by file name, a header included several times has a single entry
+			llvm::StringMap<FileCost> m_costs;
+			// Costs of the files seen so far, by file id
+			llvm::DenseMap<FileID, FileCost*> m_costsByFileId;
+			// Files being preprocessed, the innermost last
+			std::vector<FileCost*> m_includeStack;
+			double m_lastEventTime;
+
+		private:
+			HeaderReport(const HeaderReport&);
+			HeaderReport& operator=(const HeaderReport&);
+	};
+}
+
+#endif //HEADER_REPORT_H
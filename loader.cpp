@@ -0,0 +1,657 @@
+// Copyright (c) 2012 Havok. All rights reserved. This file is distributed under the terms
+// and conditions defined in file 'LICENSE.txt', which is part of this source code package.
+
+#include "loader.h"
+#include "escape.h"
+
+#pragma warning(push,0)
+	#include "llvm/ADT/OwningPtr.h"
+	#include "llvm/ADT/StringSwitch.h"
+	#include "llvm/ADT/Twine.h"
+	#include "llvm/Support/MathExtras.h"
+	#include "llvm/Support/MemoryBuffer.h"
+	#include "llvm/Support/system_error.h"
+#pragma warning(pop)
+
+#include <cctype>
+#include <cstring>
+
+// Same compile time selection of the vector scan as in escape.cpp
+#if defined(__AVX2__)
+	#include <immintrin.h>
+	#define LOADER_AVX2
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#include <emmintrin.h>
+	#define LOADER_SSE2
+#endif
+
+namespace
+{
+	// Entries with a typed callback
+	enum EntryKind
+	{
+		ENTRY_OTHER,
+		ENTRY_FILE,
+		ENTRY_NAMESPACE,
+		ENTRY_BUILTIN_TYPE,
+		ENTRY_RECORD_TYPE,
+		ENTRY_ENUM_TYPE,
+		ENTRY_ENUM_CONSTANT,
+		ENTRY_TYPEDEF_TYPE,
+		ENTRY_POINTER_TYPE,
+		ENTRY_REFERENCE_TYPE,
+		ENTRY_MEMBER_POINTER_TYPE,
+		ENTRY_CONST_TYPE,
+		ENTRY_CONSTANT_ARRAY_TYPE,
+		ENTRY_PAREN_TYPE,
+		ENTRY_FUNCTION_PROTO_TYPE,
+		ENTRY_INHERIT,
+		ENTRY_FIELD,
+		ENTRY_STATIC_FIELD,
+		ENTRY_METHOD,
+		ENTRY_CONSTRUCTOR,
+		ENTRY_DESTRUCTOR,
+		ENTRY_TEMPLATE_RECORD,
+		ENTRY_TEMPLATE_RECORD_INSTANTIATION_TYPE,
+		ENTRY_TEMPLATE_RECORD_SPECIALIZATION,
+		ENTRY_TEMPLATE_TYPE_PARAM_TYPE,
+		ENTRY_TEMPLATE_NON_TYPE_PARAM,
+		ENTRY_TEMPLATE_TEMPLATE_PARAM,
+		ENTRY_TEMPLATE_SPECIALIZATION_TYPE_ARG,
+		ENTRY_TEMPLATE_SPECIALIZATION_TEMPLATE_ARG,
+		ENTRY_TEMPLATE_SPECIALIZATION_NON_TYPE_ARG,
+		ENTRY_INSTANTIATION_PATTERN,
+		ENTRY_INSTANTIATION_NOT_EXPANDED,
+		ENTRY_FIELD_OFFSET,
+		ENTRY_BASE_OFFSET,
+		ENTRY_ANNOTATION
+	};
+}
+
+// ----------------------- Static Utility Functions ------------------------- //
+
+static inline bool s_isIdentifierChar(char c)
+{
+	return isalnum((unsigned char)c) || c == '_';
+}
+
+static inline bool s_isSpace(char c)
+{
+	return c == ' ' || c == '\t' || c == '\r';
+}
+
+static size_t s_skipSpaces(llvm::StringRef text, size_t pos)
+{
+	while(pos < text.size() && s_isSpace(text[pos]))
+	{
+		++pos;
+	}
+	return pos;
+}
+
+// Beginning of the line after pos
+static size_t s_nextLine(llvm::StringRef text, size_t pos)
+{
+	const void* newLine = pos < text.size() ? memchr(text.data() + pos, '\n', text.size() - pos) : 0;
+	return newLine != 0 ? static_cast<const char*>(newLine) - text.data() + 1 : text.size();
+}
+
+// First quote or backslash of [begin, end), end if there is none
+static const char* s_findQuoteScalar(const char* begin, const char* end, char quote)
+{
+	while(begin != end && *begin != quote && *begin != '\\')
+	{
+		++begin;
+	}
+	return begin;
+}
+
+#if defined(LOADER_AVX2)
+
+static const char* s_findQuote(const char* begin, const char* end, char quote)
+{
+	const __m256i backslashes = _mm256_set1_epi8('\\');
+	const __m256i quotes = _mm256_set1_epi8(quote);
+	for( ; end - begin >= 32; begin += 32 )
+	{
+		const __m256i chars = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(begin));
+		const __m256i found = _mm256_or_si256(_mm256_cmpeq_epi8(chars, quotes), _mm256_cmpeq_epi8(chars, backslashes));
+		const uint32_t mask = uint32_t(_mm256_movemask_epi8(found));
+		if(mask != 0)
+		{
+			return begin + llvm::CountTrailingZeros_32(mask);
+		}
+	}
+	return s_findQuoteScalar(begin, end, quote);
+}
+
+#elif defined(LOADER_SSE2)
+
+static const char* s_findQuote(const char* begin, const char* end, char quote)
+{
+	const __m128i backslashes = _mm_set1_epi8('\\');
+	const __m128i quotes = _mm_set1_epi8(quote);
+	for( ; end - begin >= 16; begin += 16 )
+	{
+		const __m128i chars = _mm_loadu_si128(reinterpret_cast<const __m128i*>(begin));
+		const __m128i found = _mm_or_si128(_mm_cmpeq_epi8(chars, quotes), _mm_cmpeq_epi8(chars, backslashes));
+		const uint32_t mask = uint32_t(_mm_movemask_epi8(found));
+		if(mask != 0)
+		{
+			return begin + llvm::CountTrailingZeros_32(mask);
+		}
+	}
+	return s_findQuoteScalar(begin, end, quote);
+}
+
+#else
+
+static const char* s_findQuote(const char* begin, const char* end, char quote)
+{
+	return s_findQuoteScalar(begin, end, quote);
+}
+
+#endif
+
+// End of the quoted string whose content starts at pos: the position of its closing quote,
+// or npos if it is not closed. hasEscapes is set if it contains a backslash.
+static size_t s_findStringEnd(llvm::StringRef text, size_t pos, char quote, bool tripleQuoted, bool& hasEscapes)
+{
+	const char* end = text.end();
+	const char* cur = text.begin() + pos;
+	while(true)
+	{
+		cur = s_findQuote(cur, end, quote);
+		if(cur == end)
+		{
+			return llvm::StringRef::npos;
+		}
+		if(*cur == '\\')
+		{
+			hasEscapes = true;
+			cur += 2;
+			if(cur > end)
+			{
+				return llvm::StringRef::npos;
+			}
+			continue;
+		}
+		if(!tripleQuoted || (end - cur >= 3 && cur[1] == quote && cur[2] == quote))
+		{
+			return cur - text.begin();
+		}
+		++cur;
+	}
+}
+
+static EntryKind s_getEntryKind(llvm::StringRef name)
+{
+	return llvm::StringSwitch<EntryKind>(name)
+		.Case("File", ENTRY_FILE)
+		.Case("Namespace", ENTRY_NAMESPACE)
+		.Case("BuiltinType", ENTRY_BUILTIN_TYPE)
+		.Case("RecordType", ENTRY_RECORD_TYPE)
+		.Case("EnumType", ENTRY_ENUM_TYPE)
+		.Case("EnumConstant", ENTRY_ENUM_CONSTANT)
+		.Case("TypedefType", ENTRY_TYPEDEF_TYPE)
+		.Case("PointerType", ENTRY_POINTER_TYPE)
+		.Case("ReferenceType", ENTRY_REFERENCE_TYPE)
+		.Case("MemberPointerType", ENTRY_MEMBER_POINTER_TYPE)
+		.Case("ConstType", ENTRY_CONST_TYPE)
+		.Case("ConstantArrayType", ENTRY_CONSTANT_ARRAY_TYPE)
+		.Case("ParenType", ENTRY_PAREN_TYPE)
+		.Case("FunctionProtoType", ENTRY_FUNCTION_PROTO_TYPE)
+		.Case("Inherit", ENTRY_INHERIT)
+		.Case("Field", ENTRY_FIELD)
+		.Case("StaticField", ENTRY_STATIC_FIELD)
+		.Case("Method", ENTRY_METHOD)
+		.Case("Constructor", ENTRY_CONSTRUCTOR)
+		.Case("Destructor", ENTRY_DESTRUCTOR)
+		.Case("TemplateRecord", ENTRY_TEMPLATE_RECORD)
+		.Case("TemplateRecordInstantiationType", ENTRY_TEMPLATE_RECORD_INSTANTIATION_TYPE)
+		.Case("TemplateRecordSpecialization", ENTRY_TEMPLATE_RECORD_SPECIALIZATION)
+		.Case("TemplateTypeParamType", ENTRY_TEMPLATE_TYPE_PARAM_TYPE)
+		.Case("TemplateNonTypeParam", ENTRY_TEMPLATE_NON_TYPE_PARAM)
+		.Case("TemplateTemplateParam", ENTRY_TEMPLATE_TEMPLATE_PARAM)
+		.Case("TemplateSpecializationTypeArg", ENTRY_TEMPLATE_SPECIALIZATION_TYPE_ARG)
+		.Case("TemplateSpecializationTemplateArg", ENTRY_TEMPLATE_SPECIALIZATION_TEMPLATE_ARG)
+		.Case("TemplateSpecializationNonTypeArg", ENTRY_TEMPLATE_SPECIALIZATION_NON_TYPE_ARG)
+		.Case("InstantiationPattern", ENTRY_INSTANTIATION_PATTERN)
+		.Case("InstantiationNotExpanded", ENTRY_INSTANTIATION_NOT_EXPANDED)
+		.Case("FieldOffset", ENTRY_FIELD_OFFSET)
+		.Case("BaseOffset", ENTRY_BASE_OFFSET)
+		.Case("Annotation", ENTRY_ANNOTATION)
+		.Default(ENTRY_OTHER);
+}
+
+static Havok::DatabaseHandler::Access s_getAccess(const Havok::DatabaseEntry& entry)
+{
+	return llvm::StringSwitch<Havok::DatabaseHandler::Access>(entry.getString("access"))
+		.Case("protected", Havok::DatabaseHandler::ACCESS_PROTECTED)
+		.Case("private", Havok::DatabaseHandler::ACCESS_PRIVATE)
+		.Default(Havok::DatabaseHandler::ACCESS_PUBLIC);
+}
+
+static unsigned s_getLineNumber(llvm::StringRef text, size_t pos)
+{
+	return unsigned(text.substr(0, pos).count('\n')) + 1;
+}
+
+// -------------------------------------------------------------------------- //
+
+const Havok::DatabaseValue* Havok::DatabaseEntry::find(llvm::StringRef key) const
+{
+	for( PairVector::const_iterator it = m_pairs.begin(), end = m_pairs.end(); it != end; ++it )
+	{
+		if(it->m_key == key)
+		{
+			return &it->m_value;
+		}
+	}
+	if(m_defaults != NULL)
+	{
+		for( PairVector::const_iterator it = m_defaults->begin(), end = m_defaults->end(); it != end; ++it )
+		{
+			if(it->m_key == key)
+			{
+				return &it->m_value;
+			}
+		}
+	}
+	return NULL;
+}
+
+int Havok::DatabaseEntry::getInt(llvm::StringRef key, int defaultValue) const
+{
+	const DatabaseValue* value = find(key);
+	return value != NULL && value->m_kind == DatabaseValue::VALUE_INTEGER ? int(value->m_integer) : defaultValue;
+}
+
+bool Havok::DatabaseEntry::getBool(llvm::StringRef key, bool defaultValue) const
+{
+	const DatabaseValue* value = find(key);
+	return value != NULL && value->m_kind == DatabaseValue::VALUE_BOOL ? value->m_integer != 0 : defaultValue;
+}
+
+llvm::StringRef Havok::DatabaseEntry::getString(llvm::StringRef key) const
+{
+	const DatabaseValue* value = find(key);
+	return value != NULL && value->m_kind == DatabaseValue::VALUE_STRING ? value->m_text : llvm::StringRef();
+}
+
+bool Havok::DatabaseEntry::getIntList(llvm::StringRef key, llvm::SmallVectorImpl<int>& valuesOut) const
+{
+	valuesOut.clear();
+	const DatabaseValue* value = find(key);
+	if(value == NULL || value->m_kind != DatabaseValue::VALUE_LIST)
+	{
+		return false;
+	}
+	llvm::StringRef rest = value->m_text;
+	while(!rest.empty())
+	{
+		std::pair<llvm::StringRef, llvm::StringRef> split = rest.split(',');
+		llvm::StringRef item = split.first.trim();
+		int i;
+		if(!item.empty() && !item.getAsInteger(0, i))
+		{
+			valuesOut.push_back(i);
+		}
+		rest = split.second;
+	}
+	return true;
+}
+
+// -------------------------------------------------------------------------- //
+
+Havok::DatabaseLoader::DatabaseLoader()
+{
+	m_entry.m_defaults = NULL;
+}
+
+bool Havok::DatabaseLoader::loadFile(const std::string& fileName, DatabaseHandler& handler, std::string& errorOut)
+{
+	llvm::OwningPtr<llvm::MemoryBuffer> buffer;
+	if(llvm::error_code ec = llvm::MemoryBuffer::getFile(fileName, buffer))
+	{
+		errorOut = "could not read database '" + fileName + "': " + ec.message();
+		return false;
+	}
+	if(!load(buffer->getBuffer(), handler, errorOut))
+	{
+		errorOut = fileName + ":" + errorOut;
+		return false;
+	}
+	return true;
+}
+
+bool Havok::DatabaseLoader::load(llvm::StringRef text, DatabaseHandler& handler, std::string& errorOut)
+{
+	m_defaults.clear();
+	size_t pos = 0;
+	while(pos < text.size())
+	{
+		pos = s_skipSpaces(text, pos);
+		if(pos == text.size())
+		{
+			break;
+		}
+		// comments and blank lines
+		if(text[pos] == '#' || text[pos] == '\n')
+		{
+			pos = s_nextLine(text, pos);
+			continue;
+		}
+		const size_t entryPos = pos;
+		if(!parseEntry_i(text, pos, errorOut))
+		{
+			errorOut = llvm::Twine(s_getLineNumber(text, entryPos)).str() + ": " + errorOut;
+			return false;
+		}
+		if(m_entry.m_name.startswith("DefaultsFor"))
+		{
+			addDefaults_i();
+		}
+		dispatch_i(handler);
+	}
+	return true;
+}
+
+bool Havok::DatabaseLoader::parseEntry_i(llvm::StringRef text, size_t& pos, std::string& errorOut)
+{
+	m_entry.m_pairs.clear();
+	m_entry.m_defaults = NULL;
+
+	size_t nameEnd = pos;
+	while(nameEnd < text.size() && s_isIdentifierChar(text[nameEnd]))
+	{
+		++nameEnd;
+	}
+	m_entry.m_name = text.slice(pos, nameEnd);
+	pos = s_skipSpaces(text, nameEnd);
+	if(m_entry.m_name.empty() || pos == text.size() || text[pos] != '(')
+	{
+		errorOut = "expected 'Entry( key=value, ... )'";
+		return false;
+	}
+	++pos;
+
+	for( std::list<Defaults>::const_iterator it = m_defaults.begin(), end = m_defaults.end(); it != end; ++it )
+	{
+		if(it->m_name == m_entry.m_name)
+		{
+			m_entry.m_defaults = &it->m_pairs;
+			break;
+		}
+	}
+
+	while(true)
+	{
+		pos = s_skipSpaces(text, pos);
+		if(pos < text.size() && text[pos] == ')')
+		{
+			break;
+		}
+		size_t keyEnd = pos;
+		while(keyEnd < text.size() && s_isIdentifierChar(text[keyEnd]))
+		{
+			++keyEnd;
+		}
+		if(keyEnd == pos || keyEnd == text.size() || text[keyEnd] != '=')
+		{
+			errorOut = "expected 'key=value' in '" + m_entry.m_name.str() + "'";
+			return false;
+		}
+		DatabaseEntry::Pair pair;
+		pair.m_key = text.slice(pos, keyEnd);
+		pos = keyEnd + 1;
+		if(!parseValue_i(text, pos, m_entry.getNumValues(), pair.m_value))
+		{
+			errorOut = "malformed value of '" + pair.m_key.str() + "' in '" + m_entry.m_name.str() + "'";
+			return false;
+		}
+		m_entry.m_pairs.push_back(pair);
+
+		pos = s_skipSpaces(text, pos);
+		if(pos < text.size() && text[pos] == ',')
+		{
+			++pos;
+		}
+		else if(pos == text.size() || text[pos] != ')')
+		{
+			errorOut = "expected ',' or ')' in '" + m_entry.m_name.str() + "'";
+			return false;
+		}
+	}
+	pos = s_nextLine(text, pos);
+	return true;
+}
+
+bool Havok::DatabaseLoader::parseValue_i(llvm::StringRef text, size_t& pos, unsigned slot, DatabaseValue& valueOut)
+{
+	valueOut.m_integer = 0;
+	if(pos == text.size())
+	{
+		return false;
+	}
+
+	const char first = text[pos];
+	if(first == '\'' || first == '"')
+	{
+		const bool tripleQuoted = first == '"' && text.substr(pos).startswith("\"\"\"");
+		const size_t begin = pos + (tripleQuoted ? 3 : 1);
+		bool hasEscapes = false;
+		const size_t end = s_findStringEnd(text, begin, first, tripleQuoted, hasEscapes);
+		if(end == llvm::StringRef::npos)
+		{
+			return false;
+		}
+		valueOut.m_kind = DatabaseValue::VALUE_STRING;
+		valueOut.m_text = text.slice(begin, end);
+		if(hasEscapes)
+		{
+			while(m_unescaped.size() <= slot)
+			{
+				m_unescaped.push_back(std::string());
+			}
+			unescape(valueOut.m_text, m_unescaped[slot]);
+			valueOut.m_text = m_unescaped[slot];
+		}
+		pos = end + (tripleQuoted ? 3 : 1);
+		return true;
+	}
+
+	if(first == '[')
+	{
+		const size_t end = text.find(']', pos);
+		if(end == llvm::StringRef::npos)
+		{
+			return false;
+		}
+		valueOut.m_kind = DatabaseValue::VALUE_LIST;
+		valueOut.m_text = text.slice(pos + 1, end);
+		pos = end + 1;
+		return true;
+	}
+
+	size_t end = pos;
+	while(end < text.size() && text[end] != ',' && text[end] != ')' && text[end] != '\n' && !s_isSpace(text[end]))
+	{
+		++end;
+	}
+	valueOut.m_text = text.slice(pos, end);
+	pos = end;
+	if(valueOut.m_text.empty())
+	{
+		return false;
+	}
+
+	unsigned long long unsignedValue;
+	long long signedValue;
+	if(valueOut.m_text == "True" || valueOut.m_text == "False")
+	{
+		valueOut.m_kind = DatabaseValue::VALUE_BOOL;
+		valueOut.m_integer = valueOut.m_text[0] == 'T' ? 1 : 0;
+	}
+	else if(valueOut.m_text == "None")
+	{
+		valueOut.m_kind = DatabaseValue::VALUE_NONE;
+	}
+	// the hashes use all 64 bits, the other integers are signed
+	else if(!valueOut.m_text.getAsInteger(0, unsignedValue))
+	{
+		valueOut.m_kind = DatabaseValue::VALUE_INTEGER;
+		valueOut.m_integer = int64_t(unsignedValue);
+	}
+	else if(!valueOut.m_text.getAsInteger(0, signedValue))
+	{
+		valueOut.m_kind = DatabaseValue::VALUE_INTEGER;
+		valueOut.m_integer = int64_t(signedValue);
+	}
+	else
+	{
+		valueOut.m_kind = DatabaseValue::VALUE_TOKEN;
+	}
+	return true;
+}
+
+void Havok::DatabaseLoader::addDefaults_i()
+{
+	m_defaults.push_back(Defaults());
+	Defaults& defaults = m_defaults.back();
+	defaults.m_name = m_entry.m_name.substr(strlen("DefaultsFor"));
+	defaults.m_pairs = m_entry.m_pairs;
+	// the unescaped strings are reused by the next entries
+	for( DatabaseEntry::PairVector::iterator it = defaults.m_pairs.begin(), end = defaults.m_pairs.end(); it != end; ++it )
+	{
+		if(it->m_value.m_kind == DatabaseValue::VALUE_STRING)
+		{
+			defaults.m_strings.push_back(it->m_value.m_text.str());
+			it->m_value.m_text = defaults.m_strings.back();
+		}
+	}
+}
+
+void Havok::DatabaseLoader::dispatch_i(DatabaseHandler& handler)
+{
+	const DatabaseEntry& e = m_entry;
+	handler.onEntry(e);
+	const EntryKind kind = s_getEntryKind(e.getName());
+	switch(kind)
+	{
+		case ENTRY_OTHER:
+			break;
+		case ENTRY_FILE:
+			handler.onFile(e.getInt("id"), e.getString("location"));
+			break;
+		case ENTRY_NAMESPACE:
+			handler.onNamespace(e.getInt("id"), e.getString("name"), e.getInt("scopeid"));
+			break;
+		case ENTRY_BUILTIN_TYPE:
+			handler.onBuiltinType(e.getInt("id"), e.getString("name"));
+			break;
+		case ENTRY_RECORD_TYPE:
+			handler.onRecordType(e.getInt("id"), e.getString("name"), e.getBool("polymorphic"), e.getBool("abstract"), e.getInt("scopeid"));
+			break;
+		case ENTRY_ENUM_TYPE:
+			handler.onEnumType(e.getInt("id"), e.getString("name"), e.getInt("scopeid"));
+			break;
+		case ENTRY_ENUM_CONSTANT:
+			handler.onEnumConstant(e.getInt("enumId"), e.getString("name"), e.getString("value"));
+			break;
+		case ENTRY_TYPEDEF_TYPE:
+			handler.onTypedefType(e.getInt("id"), e.getString("name"), e.getInt("typeid"), e.getInt("scopeid"));
+			break;
+		case ENTRY_POINTER_TYPE:
+			handler.onPointerType(e.getInt("id"), e.getInt("typeid"));
+			break;
+		case ENTRY_REFERENCE_TYPE:
+			handler.onReferenceType(e.getInt("id"), e.getInt("typeid"));
+			break;
+		case ENTRY_MEMBER_POINTER_TYPE:
+			handler.onMemberPointerType(e.getInt("id"), e.getInt("recordid"), e.getInt("typeid"));
+			break;
+		case ENTRY_CONST_TYPE:
+			handler.onConstType(e.getInt("id"), e.getInt("typeid"));
+			break;
+		case ENTRY_CONSTANT_ARRAY_TYPE:
+			handler.onConstantArrayType(e.getInt("id"), e.getInt("typeid"), e.getInt("count"));
+			break;
+		case ENTRY_PAREN_TYPE:
+			handler.onParenType(e.getInt("id"), e.getInt("typeid"));
+			break;
+		case ENTRY_FUNCTION_PROTO_TYPE:
+			e.getIntList("paramtypeids", m_intList);
+			handler.onFunctionProtoType(e.getInt("id"), e.getInt("rettypeid"), m_intList.data(), unsigned(m_intList.size()), e.getBool("isVariadic"));
+			break;
+		case ENTRY_INHERIT:
+			handler.onInherit(e.getInt("id"), e.getInt("parent"));
+			break;
+		case ENTRY_FIELD:
+			handler.onField(e.getInt("id"), e.getInt("recordid"), e.getInt("typeid"), e.getString("name"), s_getAccess(e));
+			break;
+		case ENTRY_STATIC_FIELD:
+			handler.onStaticField(e.getInt("id"), e.getInt("recordid"), e.getInt("typeid"), e.getString("name"));
+			break;
+		case ENTRY_METHOD:
+		case ENTRY_CONSTRUCTOR:
+		case ENTRY_DESTRUCTOR:
+		{
+			unsigned flags = 0;
+			flags |= e.getBool("static") ? DatabaseHandler::METHOD_STATIC : 0;
+			flags |= e.getBool("const") ? DatabaseHandler::METHOD_CONST : 0;
+			flags |= e.getBool("isImplicit") ? DatabaseHandler::METHOD_IMPLICIT : 0;
+			flags |= e.getBool("isCopyAssignment") ? DatabaseHandler::METHOD_COPY_ASSIGNMENT : 0;
+			flags |= e.getBool("isCopyConstructor") ? DatabaseHandler::METHOD_COPY_CONSTRUCTOR : 0;
+			flags |= e.getBool("isDefaultConstructor") ? DatabaseHandler::METHOD_DEFAULT_CONSTRUCTOR : 0;
+			handler.onMethod(e.getInt("id"), e.getInt("recordid"), e.getInt("typeid"), e.getString("name"),
+				kind == ENTRY_CONSTRUCTOR ? DatabaseHandler::METHOD_CONSTRUCTOR : (kind == ENTRY_DESTRUCTOR ? DatabaseHandler::METHOD_DESTRUCTOR : DatabaseHandler::METHOD_METHOD),
+				s_getAccess(e), flags, e.getInt("numParamDefaults", 0));
+			break;
+		}
+		case ENTRY_TEMPLATE_RECORD:
+			handler.onTemplateRecord(e.getInt("id"), e.getString("name"), e.getBool("polymorphic"), e.getBool("abstract"), e.getInt("scopeid"));
+			break;
+		case ENTRY_TEMPLATE_RECORD_INSTANTIATION_TYPE:
+			handler.onTemplateRecordInstantiationType(e.getInt("id"), e.getInt("templateid"), e.getBool("polymorphic"), e.getBool("abstract"), e.getInt("scopeid"));
+			break;
+		case ENTRY_TEMPLATE_RECORD_SPECIALIZATION:
+			handler.onTemplateRecordSpecialization(e.getInt("id"), e.getInt("templateid"), e.getBool("polymorphic"), e.getBool("abstract"), e.getInt("scopeid"));
+			break;
+		case ENTRY_TEMPLATE_TYPE_PARAM_TYPE:
+			handler.onTemplateTypeParamType(e.getInt("templateid"), e.getInt("id"), e.getString("name"));
+			break;
+		case ENTRY_TEMPLATE_NON_TYPE_PARAM:
+			handler.onTemplateNonTypeParam(e.getInt("templateid"), e.getInt("typeid"), e.getString("name"));
+			break;
+		case ENTRY_TEMPLATE_TEMPLATE_PARAM:
+			handler.onTemplateTemplateParam(e.getInt("templateid"), e.getInt("id"), e.getString("name"));
+			break;
+		case ENTRY_TEMPLATE_SPECIALIZATION_TYPE_ARG:
+			handler.onTemplateSpecializationTypeArg(e.getInt("recordid"), e.getInt("typeid"));
+			break;
+		case ENTRY_TEMPLATE_SPECIALIZATION_TEMPLATE_ARG:
+			handler.onTemplateSpecializationTemplateArg(e.getInt("recordid"), e.getInt("templateid"));
+			break;
+		case ENTRY_TEMPLATE_SPECIALIZATION_NON_TYPE_ARG:
+			handler.onTemplateSpecializationNonTypeArg(e.getInt("recordid"), e.getString("value"));
+			break;
+		case ENTRY_INSTANTIATION_PATTERN:
+			handler.onInstantiationPattern(e.getInt("recordid"), e.getInt("templateid"));
+			break;
+		case ENTRY_INSTANTIATION_NOT_EXPANDED:
+			handler.onInstantiationNotExpanded(e.getInt("recordid"));
+			break;
+		case ENTRY_FIELD_OFFSET:
+			handler.onFieldOffset(e.getInt("recordid"), e.getInt("index"), e.getInt("offset", -1), e.getInt("bitOffset", -1));
+			break;
+		case ENTRY_BASE_OFFSET:
+			handler.onBaseOffset(e.getInt("recordid"), e.getInt("index"), e.getInt("offset"));
+			break;
+		case ENTRY_ANNOTATION:
+			handler.onAnnotation(e.getInt("refid"), e.getString("text"));
+			break;
+	}
+}
+
+// -------------------------------------------------------------------------- //
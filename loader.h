@@ -0,0 +1,197 @@
+// Copyright (c) 2012 Havok. All rights reserved. This file is distributed under the terms
+// and conditions defined in file 'LICENSE.txt', which is part of this source code package.
+
+#ifndef LOADER_H
+#define LOADER_H
+
+#pragma warning(push,0)
+	#include "llvm/ADT/SmallVector.h"
+	#include "llvm/ADT/StringRef.h"
+	#include "llvm/Support/DataTypes.h"
+#pragma warning(pop)
+
+#include <deque>
+#include <list>
+#include <string>
+#include <vector>
+
+namespace Havok
+{
+	/// Value of a key of a database entry
+	struct DatabaseValue
+	{
+		enum Kind
+		{
+			// True, False and None
+			VALUE_BOOL,
+			VALUE_NONE,
+			// Decimal or 0x hexadecimal
+			VALUE_INTEGER,
+			// '...', "..." or """...""", unescaped
+			VALUE_STRING,
+			// [...], the text between the brackets
+			VALUE_LIST,
+			// Anything else, as written
+			VALUE_TOKEN
+		};
+
+		Kind m_kind;
+		llvm::StringRef m_text;
+		// Integers, and 1 or 0 for the booleans
+		int64_t m_integer;
+	};
+
+	/// Entry of a database being loaded: the name before the parenthesis and the key=value pairs.
+	/// The strings it refers to are only valid during the callback it is passed to.
+	class DatabaseEntry
+	{
+		public:
+
+			llvm::StringRef getName() const { return m_name; }
+			unsigned getNumValues() const { return unsigned(m_pairs.size()); }
+			llvm::StringRef getKey(unsigned i) const { return m_pairs[i].m_key; }
+			const DatabaseValue& getValue(unsigned i) const { return m_pairs[i].m_value; }
+
+			// Value of a key, or its value in the DefaultsFor line of the entry if it is elided,
+			// NULL if there is neither
+			const DatabaseValue* find(llvm::StringRef key) const;
+			int getInt(llvm::StringRef key, int defaultValue = -1) const;
+			bool getBool(llvm::StringRef key, bool defaultValue = false) const;
+			llvm::StringRef getString(llvm::StringRef key) const;
+			// Integers of a list such as paramtypeids, returns false if the key is not a list
+			bool getIntList(llvm::StringRef key, llvm::SmallVectorImpl<int>& valuesOut) const;
+
+		protected:
+
+			friend class DatabaseLoader;
+
+			struct Pair
+			{
+				llvm::StringRef m_key;
+				DatabaseValue m_value;
+			};
+			typedef llvm::SmallVector<Pair, 16> PairVector;
+
+			llvm::StringRef m_name;
+			PairVector m_pairs;
+			// Values of the DefaultsFor line of this kind of entry, NULL if there was none
+			const PairVector* m_defaults;
+	};
+
+	/// Typed callbacks of DatabaseLoader, one per kind of entry written by clang-extract. The ids
+	/// are -1 when the entry does not have the key; the keys which are only written with some
+	/// options (layouts, hashes, offsets) are read from the entry passed to onEntry().
+	class DatabaseHandler
+	{
+		public:
+
+			enum Access
+			{
+				ACCESS_PUBLIC,
+				ACCESS_PROTECTED,
+				ACCESS_PRIVATE
+			};
+
+			enum MethodKind
+			{
+				METHOD_METHOD,
+				METHOD_CONSTRUCTOR,
+				METHOD_DESTRUCTOR
+			};
+
+			enum MethodFlags
+			{
+				METHOD_STATIC = 1 << 0,
+				METHOD_CONST = 1 << 1,
+				METHOD_IMPLICIT = 1 << 2,
+				METHOD_COPY_ASSIGNMENT = 1 << 3,
+				METHOD_COPY_CONSTRUCTOR = 1 << 4,
+				METHOD_DEFAULT_CONSTRUCTOR = 1 << 5
+			};
+
+			virtual ~DatabaseHandler() {}
+
+			// Every entry, before its typed callback. The Invocation, Variant, InVariants and
+			// DefaultsFor entries only reach this one. Comment lines are skipped.
+			virtual void onEntry(const DatabaseEntry& entry) {}
+
+			virtual void onFile(int id, llvm::StringRef location) {}
+			virtual void onNamespace(int id, llvm::StringRef name, int scopeId) {}
+			virtual void onBuiltinType(int id, llvm::StringRef name) {}
+			virtual void onRecordType(int id, llvm::StringRef name, bool polymorphic, bool abstract, int scopeId) {}
+			virtual void onEnumType(int id, llvm::StringRef name, int scopeId) {}
+			virtual void onEnumConstant(int enumId, llvm::StringRef name, llvm::StringRef value) {}
+			virtual void onTypedefType(int id, llvm::StringRef name, int typeId, int scopeId) {}
+			virtual void onPointerType(int id, int typeId) {}
+			virtual void onReferenceType(int id, int typeId) {}
+			virtual void onMemberPointerType(int id, int recordId, int typeId) {}
+			virtual void onConstType(int id, int typeId) {}
+			virtual void onConstantArrayType(int id, int typeId, int count) {}
+			virtual void onParenType(int id, int typeId) {}
+			virtual void onFunctionProtoType(int id, int returnTypeId, const int* paramTypeIds, unsigned numParamTypes, bool variadic) {}
+			virtual void onInherit(int recordId, int parentId) {}
+			virtual void onField(int id, int recordId, int typeId, llvm::StringRef name, Access access) {}
+			virtual void onStaticField(int id, int recordId, int typeId, llvm::StringRef name) {}
+			virtual void onMethod(int id, int recordId, int typeId, llvm::StringRef name, MethodKind kind, Access access, unsigned flags, int numParamDefaults) {}
+			virtual void onTemplateRecord(int id, llvm::StringRef name, bool polymorphic, bool abstract, int scopeId) {}
+			virtual void onTemplateRecordInstantiationType(int id, int templateId, bool polymorphic, bool abstract, int scopeId) {}
+			virtual void onTemplateRecordSpecialization(int id, int templateId, bool polymorphic, bool abstract, int scopeId) {}
+			virtual void onTemplateTypeParamType(int templateId, int id, llvm::StringRef name) {}
+			virtual void onTemplateNonTypeParam(int templateId, int typeId, llvm::StringRef name) {}
+			virtual void onTemplateTemplateParam(int templateId, int id, llvm::StringRef name) {}
+			virtual void onTemplateSpecializationTypeArg(int recordId, int typeId) {}
+			virtual void onTemplateSpecializationTemplateArg(int recordId, int templateId) {}
+			virtual void onTemplateSpecializationNonTypeArg(int recordId, llvm::StringRef value) {}
+			virtual void onInstantiationPattern(int recordId, int templateId) {}
+			virtual void onInstantiationNotExpanded(int recordId) {}
+			// Layout of the fields and bases of an instantiation dumped with its pattern, in declaration order
+			virtual void onFieldOffset(int recordId, int index, int offset, int bitOffset) {}
+			virtual void onBaseOffset(int recordId, int index, int offset) {}
+			virtual void onAnnotation(int refId, llvm::StringRef text) {}
+	};
+
+	/// Parses the text databases written by clang-extract without going through Python: each
+	/// line is tokenized in place (long strings are scanned 16 or 32 bytes at a time) and handed
+	/// to a DatabaseHandler. Nothing is allocated per entry once the first entries are loaded.
+	class DatabaseLoader
+	{
+		public:
+
+			DatabaseLoader();
+
+			// Returns false and sets errorOut if the file cannot be read or an entry is malformed
+			bool loadFile(const std::string& fileName, DatabaseHandler& handler, std::string& errorOut);
+			bool load(llvm::StringRef text, DatabaseHandler& handler, std::string& errorOut);
+
+		protected:
+
+			// Parse the entry starting at pos, pos is moved to the beginning of the next line
+			bool parseEntry_i(llvm::StringRef text, size_t& pos, std::string& errorOut);
+			// Parse a value starting at pos, pos is moved after it
+			bool parseValue_i(llvm::StringRef text, size_t& pos, unsigned slot, DatabaseValue& valueOut);
+			void dispatch_i(DatabaseHandler& handler);
+			// Keep the values of a DefaultsFor entry for the entries named after it
+			void addDefaults_i();
+
+			DatabaseEntry m_entry;
+			// Unescaped strings, one per value, a deque so they do not move when it grows
+			std::deque<std::string> m_unescaped;
+			llvm::SmallVector<int, 16> m_intList;
+
+			// Values of the DefaultsFor lines of the database being loaded, the keys and the values
+			// which are not strings refer to the loaded text
+			struct Defaults
+			{
+				llvm::StringRef m_name;
+				DatabaseEntry::PairVector m_pairs;
+				std::list<std::string> m_strings;
+			};
+			std::list<Defaults> m_defaults;
+
+		private:
+			DatabaseLoader(const DatabaseLoader&);
+			DatabaseLoader& operator=(const DatabaseLoader&);
+	};
+}
+
+#endif //LOADER_H
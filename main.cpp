@@ -2,135 +2,412 @@
 // and conditions defined in file 'LICENSE.txt', which is part of this source code package.
 
 #pragma warning(push,0)
-	#include <llvm/Support/Host.h>
+	#include <llvm/ADT/OwningPtr.h>
+	#include <llvm/ADT/SmallString.h>
 	#include <llvm/Support/ManagedStatic.h>
 	#include <llvm/Support/CommandLine.h>
+	#include <llvm/Support/FileSystem.h>
+	#include <llvm/Support/Format.h>
+	#include <llvm/Support/MemoryBuffer.h>
 	#include <llvm/Support/Path.h>
-
-	#include <clang/Frontend/Utils.h>
-	#include <clang/Frontend/DiagnosticOptions.h>
-	#include <clang/Frontend/FrontendDiagnostic.h>
-	#include <clang/Frontend/TextDiagnosticPrinter.h>
-	#include <clang/Lex/Preprocessor.h>
-	#include <clang/Parse/ParseAST.h>
-	#include <clang/Basic/TargetInfo.h>
-	#include <clang/Basic/FileManager.h>
-	#include <clang/Lex/HeaderSearch.h>
-	#include <clang/Sema/SemaDiagnostic.h>
+	#include <llvm/Support/PathV2.h>
+	#include <llvm/Support/Threading.h>
 #pragma warning(pop)
 
-#include <iostream>
-#include "extract.h"
+#include <set>
+#include <sys/stat.h>
+#include "clangextract.h"
+#include "asyncoutput.h"
+#include "codegen.h"
+#include "database.h"
+#include "entities.h"
+#include "hash.h"
+#include "headerreport.h"
+#include "modules.h"
+#include "perfcounters.h"
+#include "watch.h"
 
-#ifdef _WIN32
-#include <Shlwapi.h>
-static inline bool s_fileNameMatch(const char* path, const char* pattern)
+static llvm::cl::list<std::string> o_cppDefines(llvm::cl::ZeroOrMore, "D", llvm::cl::desc("Predefined preprocessor constants"), llvm::cl::value_desc("value") ); // Predefined constants
+static llvm::cl::list<std::string> o_includePath(llvm::cl::ZeroOrMore,"I", llvm::cl::desc("Add to the include path"), llvm::cl::value_desc("dirname") ); // Include path directories
+static llvm::cl::list<std::string> o_passAttributes(llvm::cl::ZeroOrMore, "A", llvm::cl::desc("Attributes to pass through to database"), llvm::cl::value_desc("token")); // Output file
+static llvm::cl::list<std::string> o_forceInclude(llvm::cl::ZeroOrMore, "include", llvm::cl::desc("Include before processing"), llvm::cl::value_desc("filename") ); // File included at the beginning of the master file
+static llvm::cl::list<std::string> o_excludeFilenames(llvm::cl::ZeroOrMore, "exclude", llvm::cl::desc("Files to exclude from parsing")); // Files excluded when encountered in an #include directive
+static llvm::cl::list<std::string> o_excludeFilenamePatterns(llvm::cl::ZeroOrMore, "exclude-pattern", llvm::cl::desc("File name patterns to use when excluding additional files")); // File name patterns used to exclude additional files encountered in #include directives
+static llvm::cl::list<std::string> o_inputFilenames(llvm::cl::ZeroOrMore, llvm::cl::Positional, llvm::cl::desc("<Input files>")); // Input files
+static llvm::cl::opt<std::string> o_resourceDir(llvm::cl::Optional, "resource-dir", llvm::cl::desc("Directory containing standard LLVM includes"), llvm::cl::value_desc("dirname") ); // Directory containing standard LLVM includes
+static llvm::cl::list<std::string> o_roots(llvm::cl::ZeroOrMore, "root", llvm::cl::desc("Only dump the named records and templates and the types they refer to"), llvm::cl::value_desc("qualified name")); // Root declarations of a partial dump
+static llvm::cl::opt<bool> o_dumpLayouts("layout", llvm::cl::desc("Dump record sizes and alignments, field offsets and base class offsets")); // Record layouts computed for the target
+static llvm::cl::opt<bool> o_compactInstantiations("compact-instantiations", llvm::cl::desc("Only dump the members of implicit template instantiations which are not substitutions of the template members")); // Compact implicit instantiations
+static llvm::cl::opt<int> o_instantiationBudget("instantiation-budget", llvm::cl::desc("Maximum number of implicit template instantiation definitions dumped (no limit by default)"), llvm::cl::init(-1), llvm::cl::value_desc("count")); // Instantiation definitions budget
+static llvm::cl::opt<bool> o_canonicalTypes("canonical-types", llvm::cl::desc("Dump a single entry for the pointer, reference, array and function types with the same components")); // Share structural types
+static llvm::cl::opt<bool> o_contentHashes("hashes", llvm::cl::desc("Dump a hash of the content of each record, template and enum, which changes when the generated code has to")); // Content hashes for downstream caches
+static llvm::cl::opt<int> o_dumpThreads("dump-threads", llvm::cl::desc("Experimental: number of threads dumping the declarations after a serial walk which claims the ids (1 by default)"), llvm::cl::init(1), llvm::cl::value_desc("count")); // Parallel dump
+static llvm::cl::opt<std::string> o_triple("triple", llvm::cl::desc("Target triple (defaults to the host)"), llvm::cl::value_desc("triple")); // Target of a single extraction
+static llvm::cl::list<std::string> o_variants(llvm::cl::ZeroOrMore, "variant", llvm::cl::desc("Extract a variant and merge it with the others, the triple may be empty to use the host"), llvm::cl::value_desc("name=triple[,define[=value]...]")); // Variants of a matrix extraction
+static llvm::cl::list<std::string> o_moduleMaps(llvm::cl::ZeroOrMore, "module-map", llvm::cl::desc("Load the headers listed in this module map as prebuilt modules"), llvm::cl::value_desc("filename")); // Module maps
+static llvm::cl::opt<std::string> o_moduleCachePath("module-cache", llvm::cl::desc("Directory where the modules are built (required with -module-map)"), llvm::cl::value_desc("dirname")); // Module cache
+static llvm::cl::opt<std::string> o_cppTables("cpp-tables", llvm::cl::desc("Also write C++ reflection tables to <basename>.h and <basename>.cpp"), llvm::cl::value_desc("basename")); // Generated reflection tables
+static llvm::cl::opt<std::string> o_cppTablesNamespace("cpp-tables-namespace", llvm::cl::desc("Namespace of the generated reflection tables"), llvm::cl::init("ReflectionTables"), llvm::cl::value_desc("name")); // Namespace of the generated reflection tables
+static llvm::cl::opt<std::string> o_binaryTables("binary-tables", llvm::cl::desc("Also write the entity tables to this file in a binary format described in entities.h"), llvm::cl::value_desc("filename")); // Entity tables loaded without parsing
+static llvm::cl::opt<std::string> o_tableStatistics("table-stats", llvm::cl::desc("Also write the number of entities of each kind to this file"), llvm::cl::value_desc("filename")); // Entity table statistics
+static llvm::cl::opt<std::string> o_dependencyFilename("MF", llvm::cl::desc("Write the files read during the extraction to a Makefile dependency file"), llvm::cl::value_desc("filename")); // Dependency file
+static llvm::cl::opt<std::string> o_dependencyTarget("MT", llvm::cl::desc("Target of the dependency file rule (defaults to the output file)"), llvm::cl::value_desc("target")); // Dependency file target
+static llvm::cl::opt<std::string> o_headerReportFilename("header-report", llvm::cl::desc("Write the parsing and dumping cost of each header to this file"), llvm::cl::value_desc("filename")); // Per-header cost report
+static llvm::cl::opt<bool> o_perfCounters("perf-counters", llvm::cl::desc("Report the cycles, instructions, cache misses and branch misses of each phase (Linux only)")); // Hardware counters per phase
+static llvm::cl::opt<bool> o_writeIfChanged("write-if-changed", llvm::cl::desc("Leave the output files and their timestamps untouched when their content does not change")); // Output files only replaced on change
+static llvm::cl::opt<bool> o_index("index", llvm::cl::desc("Also write a random access index of the output file to <output>.index")); // Sidecar index
+static llvm::cl::opt<bool> o_directIO("direct-io", llvm::cl::desc("Write the output file with O_DIRECT and preallocate it (Linux only)")); // Output bypassing the page cache
+static llvm::cl::opt<bool> o_watch("watch", llvm::cl::desc("Keep running and extract again when one of the files read changes, each extraction is a full one (Linux only)")); // Watch mode
+static llvm::cl::opt<int> o_watchDebounce("watch-debounce", llvm::cl::desc("Milliseconds without changes to wait before extracting again in watch mode"), llvm::cl::init(200), llvm::cl::value_desc("milliseconds")); // Watch mode edit bursts
+static llvm::cl::list<std::string> o_workers("workers", llvm::cl::CommaSeparated, llvm::cl::desc("Split the inputs between these worker processes and merge their databases"), llvm::cl::value_desc("host:port|unix:path,...")); // Coordinator of a distributed extraction
+static llvm::cl::opt<std::string> o_workerAddress("worker", llvm::cl::desc("Run as a worker extracting the parts sent by coordinators to this address, :port is the loopback interface and *:port all the interfaces"), llvm::cl::value_desc("host:port|unix:path")); // Worker of a distributed extraction
+static llvm::cl::opt<std::string> o_forkServerAddress("fork-server", llvm::cl::desc("Parse the -triple, -D, -I, -include and -exclude options once, then extract the parts sent by coordinators to this address in forked copies (POSIX only)"), llvm::cl::value_desc("host:port|unix:path")); // Worker forking from a parsed prelude
+static llvm::cl::opt<std::string> o_workerSecretFilename("worker-secret-file", llvm::cl::desc("File holding the secret shared by the coordinators and the workers (required with -worker, -fork-server and -workers)"), llvm::cl::value_desc("filename")); // Handshake of a distributed extraction
+static llvm::cl::opt<std::string> o_outputFilename(llvm::cl::Optional, "o", llvm::cl::desc("Output File (required unless -worker or -fork-server)")); // Output file
+
+// Give the temporary file the mode of the file it replaces, or the default mode of a new file,
+// unique_file creates it readable by the owner only
+static void s_copyMode(const std::string& tempFileName, const std::string& fileName)
 {
-	static char path_s[MAX_PATH]; // static storage
-	strcpy(path_s, path);
-	PathStripPath(path_s);
-	return (PathMatchSpec(path_s, pattern) == TRUE);
+	#ifndef _WIN32
+		struct stat previous;
+		mode_t mode;
+		if(::stat(fileName.c_str(), &previous) == 0)
+		{
+			mode = previous.st_mode & 07777;
+		}
+		else
+		{
+			const mode_t mask = ::umask(0);
+			::umask(mask);
+			mode = 0666 & ~mask;
+		}
+		::chmod(tempFileName.c_str(), mode);
+	#endif
 }
-#undef GetCurrentDirectory // remove annoying define from windows header
-#else
-#include <fnmatch.h>
-static inline bool s_fileNameMatch(const char* path, const char* pattern)
+
+// Replace fileName with the temporary file unless fileName already has the same content,
+// the temporary file is removed in both cases
+static bool s_replaceIfChanged(const std::string& tempFileName, const std::string& fileName, uint64_t size, uint64_t hash)
 {
-	const char* base = basename( const_cast<char*>(path) );
-	return (fnmatch(pattern, base, 0) == 0);
+	bool existed;
+	llvm::OwningPtr<llvm::MemoryBuffer> previous;
+	if(!llvm::MemoryBuffer::getFile(fileName, previous) && previous->getBufferSize() == size)
+	{
+		Havok::Fnv64 previousHash;
+		previousHash.update(previous->getBufferStart(), previous->getBufferSize());
+		if(previousHash.get() == hash)
+		{
+			// unchanged, keep the old file and its timestamp
+			previous.reset();
+			llvm::sys::fs::remove(tempFileName, existed);
+			return true;
+		}
+	}
+	previous.reset();
+	s_copyMode(tempFileName, fileName);
+	if(llvm::sys::fs::rename(tempFileName, fileName))
+	{
+		llvm::sys::fs::remove(tempFileName, existed);
+		return false;
+	}
+	return true;
 }
-#endif
 
-namespace Havok
+// Write a whole file, with -write-if-changed the file is only replaced if the content differs
+static bool s_writeFile(const std::string& fileName, llvm::StringRef content, std::string& errorInfo)
 {
-	// Module loader
-	class ModuleLoader : public clang::ModuleLoader
+	if(!o_writeIfChanged)
+	{
+		llvm::raw_fd_ostream os(fileName.c_str(), errorInfo);
+		os << content;
+		return errorInfo.empty();
+	}
+
+	int fd;
+	llvm::SmallString<256> tempFileName;
+	if(llvm::sys::fs::unique_file(fileName + "-%%%%%%%%", fd, tempFileName))
+	{
+		errorInfo = "could not create a temporary file for '" + fileName + "'";
+		return false;
+	}
+	{
+		llvm::raw_fd_ostream os(fd, true);
+		os << content;
+	}
+	Havok::Fnv64 hash;
+	hash.update(content.data(), content.size());
+	if(!s_replaceIfChanged(tempFileName.str(), fileName, content.size(), hash.get()))
 	{
-		public:
+		errorInfo = "could not replace '" + fileName + "'";
+		return false;
+	}
+	return true;
+}
 
-			virtual ModuleKey loadModule(SourceLocation, IdentifierInfo&, SourceLocation)
+// Write a Makefile rule making the target depend on the files read during the extraction
+static int s_writeDependencyFile(const std::string& fileName, const std::string& target, const std::set<std::string>& dependencies)
+{
+	std::string rule;
+	llvm::raw_string_ostream os(rule);
+	os << target << ":";
+	for( std::set<std::string>::const_iterator it = dependencies.begin(), end = dependencies.end(); it != end; ++it )
+	{
+		os << " \\\n ";
+		for( std::string::const_iterator c = it->begin(), cEnd = it->end(); c != cEnd; ++c )
+		{
+			// escaped the same way as clang -MF
+			if(*c == ' ' || *c == '#')
+			{
+				os << '\\';
+			}
+			else if(*c == '$')
 			{
-				assert(0);
-				return 0;
+				os << '$';
 			}
-	};
-	// Preprocessor callbacks used to exclude specific included files (with #include)
-	// When the preprocessor processes a file, it will generate callbacks to this object
-	// on various events, when an inclusion directive is detected we will simply look
-	// it up in our set of excluded inclusion, and if something matches we will basically
-	// override that with an empty buffer.
-	class FilenamePatternExcluder : public clang::PPCallbacks
+			os << *c;
+		}
+	}
+	os << "\n";
+	os.flush();
+
+	std::string errorInfo;
+	if(!s_writeFile(fileName, rule, errorInfo))
+	{
+		llvm::errs() << "error: could not write dependency file: " << errorInfo << "\n";
+		return 1;
+	}
+	return 0;
+}
+
+// Write the files of an entity sink, named after baseName
+static int s_writeEntitySink(const Havok::EntitySink& entitySink, const Havok::EntityTables& tables, const std::string& baseName)
+{
+	for( int file = 0; file < entitySink.getNumFiles(); ++file )
 	{
-		public:
+		std::string errorInfo;
+		std::string fileName = baseName + entitySink.getFileSuffix(file).str();
+		std::string content;
+		{
+			llvm::raw_string_ostream contentStream(content);
+			entitySink.writeFile(tables, file, contentStream);
+		}
+		if(!s_writeFile(fileName, content, errorInfo))
+		{
+			llvm::errs() << "error: could not write entity tables: " << errorInfo << "\n";
+			return 1;
+		}
+	}
+	return 0;
+}
 
-			FilenamePatternExcluder(clang::Preprocessor& preprocessor, clang::SourceManager& sourceManager) 
-				: PPCallbacks(), m_preprocessor(preprocessor), m_sourceManager(sourceManager)
-			{}
+// Run the extraction of the command line and write the output files, the files read are added to dependencies
+static int s_extract(const Havok::ExtractionSetup& setup, std::set<std::string>& dependencies)
+{
+	int exitStatus = 0;
 
-			~FilenamePatternExcluder()
-			{}
+	// -write-if-changed, the database is written to a temporary file and hashed on the way,
+	// it only replaces the output file if the hashes differ
+	std::string outputFilename = o_outputFilename;
+	llvm::SmallString<256> tempFilename;
+	if(o_writeIfChanged)
+	{
+		int fd;
+		if(llvm::sys::fs::unique_file(o_outputFilename + "-%%%%%%%%", fd, tempFilename))
+		{
+			llvm::errs() << "error: could not create a temporary file for '" << o_outputFilename << "'\n";
+			return 1;
+		}
+		// the descriptor is closed, the file is opened again by name below
+		llvm::raw_fd_ostream(fd, true);
+		outputFilename = tempFilename.str();
+	}
 
-			void addExcludedPattern(const std::string& str)
-			{
-				m_excludedPatterns.push_back(str);
-			}
+	std::string errorInfo;
+	#ifdef _DEBUG
+		// unbuffered, the output is complete up to a crash
+		llvm::raw_fd_ostream outstream(outputFilename.c_str(), errorInfo);
+		outstream.SetUnbuffered();
+	#else
+		// formatting and writing overlap
+		Havok::AsyncOutputStream outstream(outputFilename.c_str(), errorInfo, o_directIO);
+	#endif
+	if(!errorInfo.empty())
+	{
+		llvm::errs() << "error: " << errorInfo << "\n";
+		return 1;
+	}
+	Havok::HashingOutputStream hashingStream(outstream);
+	#ifdef _DEBUG
+		hashingStream.SetUnbuffered();
+	#endif
+	llvm::raw_ostream& fileStream = o_writeIfChanged ? static_cast<llvm::raw_ostream&>(hashingStream) : outstream;
+
+	// -index, the entries are indexed on their way to the file
+	Havok::DatabaseIndexer indexer(fileStream);
+	#ifdef _DEBUG
+		indexer.SetUnbuffered();
+	#endif
+	llvm::raw_ostream& databaseStream = o_index ? static_cast<llvm::raw_ostream&>(indexer) : fileStream;
+
+	// -cpp-tables, -binary-tables and -table-stats are all written from the same tables
+	Havok::ReflectionTableWriter cppTables(o_cppTablesNamespace, llvm::sys::path::filename(o_cppTables + ".h"));
+	Havok::EntityBinaryWriter binaryTables;
+	Havok::EntityStatisticsWriter tableStatistics;
+	std::vector<std::pair<const Havok::EntitySink*, std::string> > entitySinks;
+	if(!o_cppTables.empty())
+	{
+		entitySinks.push_back(std::make_pair(&cppTables, std::string(o_cppTables)));
+	}
+	if(!o_binaryTables.empty())
+	{
+		entitySinks.push_back(std::make_pair(&binaryTables, std::string(o_binaryTables)));
+	}
+	if(!o_tableStatistics.empty())
+	{
+		entitySinks.push_back(std::make_pair(&tableStatistics, std::string(o_tableStatistics)));
+	}
+
+	if(!o_variants.empty() && !o_headerReportFilename.empty())
+	{
+		llvm::errs() << "error: -header-report cannot be used with -variant\n";
+		exitStatus = 1;
+	}
+	else if(!o_workers.empty() && !o_headerReportFilename.empty())
+	{
+		llvm::errs() << "error: -header-report cannot be used with -workers\n";
+		exitStatus = 1;
+	}
+	else if(o_perfCounters && (!o_variants.empty() || !o_workers.empty()))
+	{
+		llvm::errs() << "error: -perf-counters cannot be used with -variant or -workers\n";
+		exitStatus = 1;
+	}
+	else
+	{
+		Havok::EntityTables tables;
+		Havok::HeaderReport headerReport;
+		Havok::PerfCounters perfCounters;
+		Havok::ExtractionSink sink(databaseStream, llvm::errs());
+		sink.m_tables = entitySinks.empty() ? NULL : &tables;
+		sink.m_headerReport = o_headerReportFilename.empty() ? NULL : &headerReport;
+		sink.m_perfCounters = o_perfCounters ? &perfCounters : NULL;
+		sink.m_dependencies = &dependencies;
+		exitStatus = Havok::extract(setup, sink);
+
+		// -perf-counters
+		if(o_perfCounters)
+		{
+			perfCounters.write(llvm::errs());
+		}
 
-			virtual void InclusionDirective(
-				SourceLocation, 
-				const Token&, 
-				StringRef fileName, 
-				bool, 
-				const FileEntry* file,
-				SourceLocation, 
-				StringRef, 
-				StringRef )
+		// -cpp-tables, -binary-tables and -table-stats
+		for( size_t i = 0; exitStatus == 0 && i < entitySinks.size(); ++i )
+		{
+			exitStatus = s_writeEntitySink(*entitySinks[i].first, tables, entitySinks[i].second);
+		}
+
+		// -header-report
+		if(!o_headerReportFilename.empty())
+		{
+			std::string report;
+			llvm::raw_string_ostream reportStream(report);
+			headerReport.write(reportStream);
+			reportStream.flush();
+			if(!s_writeFile(o_headerReportFilename, report, errorInfo))
 			{
-				m_preprocessor.SetSuppressIncludeNotFoundError(false);
-				for(unsigned int i = 0; i < m_excludedPatterns.size(); ++i)
-				{
-					if(s_fileNameMatch(fileName.str().c_str(), m_excludedPatterns[i].c_str()))
-					{
-						if(file)
-						{
-							// file was found
-							m_sourceManager.overrideFileContents(file, llvm::MemoryBuffer::getNewMemBuffer(0), false);
-						}
-						else
-						{
-							// file was not found (but as it matches one of the excluded patterns we ignore it anyway)
-							m_preprocessor.SetSuppressIncludeNotFoundError(true);
-						}
-						break;
-					}
-				}
+				llvm::errs() << "error: could not write header report: " << errorInfo << "\n";
+				exitStatus = 1;
 			}
+		}
+	}
 
-		protected:
-			
-			// Included file patterns that will be skipped, these string should contain
-			// OS-style wildcards to exclude sets of files based on their name.
-			std::vector<std::string> m_excludedPatterns;
+	// -MF
+	if(exitStatus == 0 && !o_dependencyFilename.empty())
+	{
+		exitStatus = s_writeDependencyFile(o_dependencyFilename, o_dependencyTarget.empty() ? std::string(o_outputFilename) : std::string(o_dependencyTarget), dependencies);
+	}
 
-			// Source manager used to exclude all the specified inclusions.
-			clang::SourceManager& m_sourceManager;
+	indexer.flush();
+	hashingStream.flush();
+	outstream.flush();
+	outstream.close();
+	#ifdef _DEBUG
+		const bool writeFailed = outstream.has_error();
+		outstream.clear_error();
+	#else
+		const bool writeFailed = outstream.hasError();
+	#endif
+	if(writeFailed)
+	{
+		llvm::errs() << "error: could not write '" << o_outputFilename << "'\n";
+		exitStatus = 1;
+	}
 
-			// Preprocessor used during parsing of the source
-			clang::Preprocessor& m_preprocessor;
+	// -write-if-changed
+	if(o_writeIfChanged)
+	{
+		bool existed;
+		if(writeFailed)
+		{
+			llvm::sys::fs::remove(tempFilename.str(), existed);
+		}
+		else if(!s_replaceIfChanged(tempFilename.str(), o_outputFilename, hashingStream.tell(), hashingStream.getHash()))
+		{
+			llvm::errs() << "error: could not replace '" << o_outputFilename << "'\n";
+			exitStatus = 1;
+		}
+	}
 
-		private:
-			FilenamePatternExcluder& operator=(const FilenamePatternExcluder& other);
-	};
+	// -index
+	if(exitStatus == 0 && o_index)
+	{
+		std::string index;
+		llvm::raw_string_ostream indexStream(index);
+		indexer.writeIndex(indexStream);
+		indexStream.flush();
+		if(!s_writeFile(o_outputFilename + ".index", index, errorInfo))
+		{
+			llvm::errs() << "error: could not write index: " << errorInfo << "\n";
+			exitStatus = 1;
+		}
+	}
+	return exitStatus;
 }
 
-static llvm::cl::list<std::string> o_cppDefines(llvm::cl::ZeroOrMore, "D", llvm::cl::desc("Predefined preprocessor constants"), llvm::cl::value_desc("value") ); // Predefined constants
-static llvm::cl::list<std::string> o_includePath(llvm::cl::ZeroOrMore,"I", llvm::cl::desc("Add to the include path"), llvm::cl::value_desc("dirname") ); // Include path directories
-static llvm::cl::list<std::string> o_passAttributes(llvm::cl::ZeroOrMore, "A", llvm::cl::desc("Attributes to pass through to database"), llvm::cl::value_desc("token")); // Output file
-static llvm::cl::list<std::string> o_forceInclude(llvm::cl::ZeroOrMore, "include", llvm::cl::desc("Include before processing"), llvm::cl::value_desc("filename") ); // File included at the beginning of the master file
-static llvm::cl::list<std::string> o_excludeFilenames(llvm::cl::ZeroOrMore, "exclude", llvm::cl::desc("Files to exclude from parsing")); // Files excluded when encountered in an #include directive
-static llvm::cl::list<std::string> o_excludeFilenamePatterns(llvm::cl::ZeroOrMore, "exclude-pattern", llvm::cl::desc("File name patterns to use when excluding additional files")); // File name patterns used to exclude additional files encountered in #include directives
-static llvm::cl::list<std::string> o_inputFilenames(llvm::cl::ZeroOrMore, llvm::cl::Positional, llvm::cl::desc("<Input files>")); // Input files
-static llvm::cl::opt<std::string> o_resourceDir(llvm::cl::Optional, "resource-dir", llvm::cl::desc("Directory containing standard LLVM includes"), llvm::cl::value_desc("dirname") ); // Directory containing standard LLVM includes
-static llvm::cl::opt<std::string> o_outputFilename(llvm::cl::Required, "o", llvm::cl::desc("Output File (required)")); // Output file
+// Extract again each time one of the files read by the previous extraction changes, never returns unless waiting fails
+static int s_watch(const Havok::ExtractionSetup& setup, std::set<std::string>& dependencies)
+{
+	Havok::FileWatcher watcher;
+	if(!watcher.isSupported())
+	{
+		llvm::errs() << "error: -watch is not supported on this system\n";
+		return 1;
+	}
+	while(true)
+	{
+		if(dependencies.empty())
+		{
+			llvm::errs() << "error: -watch has no files to watch\n";
+			return 1;
+		}
+		watcher.setFiles(dependencies);
+		llvm::errs() << "watch: waiting for changes to " << unsigned(dependencies.size()) << " files\n";
+		std::set<std::string> changedFiles;
+		if(!watcher.waitForChanges(o_watchDebounce, changedFiles))
+		{
+			llvm::errs() << "error: could not wait for file changes\n";
+			return 1;
+		}
+
+		// the modules which do not depend on the changed files are reused from the module cache
+		const double startTime = Havok::HeaderReport::s_getTime();
+		dependencies.clear();
+		const int exitStatus = s_extract(setup, dependencies);
+		llvm::errs() << "watch: " << unsigned(changedFiles.size()) << " files changed, extraction " << (exitStatus == 0 ? "done" : "failed") <<
+			" in " << llvm::format("%.3f", Havok::HeaderReport::s_getTime() - startTime) << "s\n";
+	}
+}
 
 int main(int argc, char **argv)
 {
@@ -138,164 +415,137 @@ int main(int argc, char **argv)
 
 	 //_CrtSetDbgFlag( _CRTDBG_ALLOC_MEM_DF | _CRTDBG_DELAY_FREE_MEM_DF | _CRTDBG_CHECK_EVERY_1024_DF | _CRTDBG_LEAK_CHECK_DF );
 	llvm::cl::ParseCommandLineOptions(argc, argv, "Help Text Here", true);
-	llvm::MemoryBuffer* emptyMemoryBuffer = llvm::MemoryBuffer::getNewMemBuffer(0, "emptyMemoryBuffer");
-	{
-		clang::TextDiagnosticPrinter diagnosticConsumer(llvm::errs(), clang::DiagnosticOptions(), false);
-		llvm::IntrusiveRefCntPtr<clang::DiagnosticIDs> diagnosticIDs(new clang::DiagnosticIDs());
-		clang::DiagnosticsEngine diagnostics(diagnosticIDs, &diagnosticConsumer, false);
-		// ignored warnings
-		diagnostics.setDiagnosticMapping(clang::diag::warn_undefined_internal, clang::diag::MAP_IGNORE, clang::SourceLocation()); //-Wno-undefined-internal
-
-		clang::TargetOptions targetOptions;
-		targetOptions.Triple = llvm::sys::getHostTriple();
-		llvm::IntrusiveRefCntPtr<clang::TargetInfo> targetInfo( clang::TargetInfo::CreateTargetInfo(diagnostics, targetOptions ) );	
-		clang::FileSystemOptions filesystemOptions;
-		clang::FileManager fileManager(filesystemOptions);
-		clang::SourceManager sourceManager(diagnostics, fileManager);
-		clang::HeaderSearch headerSearch(fileManager);
-		Havok::ModuleLoader moduleLoader;
-		clang::LangOptions langOptions;
-		langOptions.CPlusPlus = 1;
-		langOptions.CPlusPlus0x = 0;
-		langOptions.Bool = 1;
-		langOptions.ConstStrings = 1;
-		langOptions.AssumeSaneOperatorNew = 1;
-		langOptions.ImplicitInt = 0;
-		langOptions.ElideConstructors = 0;
-
-		clang::Preprocessor preprocessor(diagnostics, langOptions, targetInfo.getPtr(), sourceManager, headerSearch, moduleLoader);
-		
-		Havok::FilenamePatternExcluder* filenamePatternExcluder = new Havok::FilenamePatternExcluder(preprocessor, sourceManager);
-		preprocessor.addPPCallbacks(filenamePatternExcluder); // the preprocessor is now owner of the FilenamePatternExcluder
-		clang::PreprocessorOptions preprocessorOptions;
-		clang::HeaderSearchOptions headerSearchOptions;
-		clang::FrontendOptions frontendOptions;
 
-		std::string errorInfo;
-		llvm::raw_fd_ostream outstream(o_outputFilename.c_str(), errorInfo);
+	// -worker-secret-file, read from a file to keep it out of the command lines
+	std::string workerSecret;
+	if(!o_workerSecretFilename.empty())
+	{
+		llvm::OwningPtr<llvm::MemoryBuffer> secretFile;
+		if(llvm::MemoryBuffer::getFile(o_workerSecretFilename, secretFile))
 		{
-			// Gather input files into a memory 
-			std::string mainFileText;
-			llvm::raw_string_ostream stream(mainFileText);
-
-			// Print the LLVMClangParser working directory
-			{
-				llvm::sys::Path cwd = llvm::sys::Path::GetCurrentDirectory();
-				outstream << "InvocationWorkingDirectory( path='" << cwd.c_str() << "' )\n";
-			}
-
-			// -D
-			for( llvm::cl::list<std::string>::iterator iter = o_cppDefines.begin(), end = o_cppDefines.end(); iter != end; ++iter )
-			{
-				std::string::size_type index = iter->find_first_of('=');
-				std::string macro, value;
-				if(index != std::string::npos)
-				{
-					macro = iter->substr(0, index);
-					value = iter->substr(index+1, std::string::npos);
-				}
-				else
-				{
-					macro = (*iter);
-				}
-
-				stream << "#define " << macro << ' ' << value << '\n';
-				outstream << "InvocationDefine( name='" << macro << "', value='" << value << "' )\n";
-			}
-
-			// -I
-			for( std::vector<std::string>::iterator iter = o_includePath.begin(), end = o_includePath.end(); iter != end; ++iter )
-			{
-				headerSearchOptions.AddPath(*iter, clang::frontend::Angled, true, false, false);
-				outstream << "InvocationIncludePath( path='" << *iter << "' )\n";
-			}
-
-			// -exclude
-			{
-				// Do not free buffers associated with the compiler invocation
-				preprocessorOptions.RetainRemappedFileBuffers = true;
-				for( std::vector<std::string>::iterator iter = o_excludeFilenames.begin(), end = o_excludeFilenames.end(); iter != end; ++iter )
-				{
-					preprocessorOptions.addRemappedFile(iter->c_str(), emptyMemoryBuffer);
-				}
-			}
+			llvm::errs() << "error: could not read the worker secret '" << o_workerSecretFilename << "'\n";
+			return 1;
+		}
+		workerSecret = secretFile->getBuffer().trim().str();
+	}
+	// the peers of a worker choose the files it reads, they have to prove who they are
+	if(workerSecret.empty() && (!o_workerAddress.empty() || !o_forkServerAddress.empty() || !o_workers.empty()))
+	{
+		llvm::errs() << "error: -worker, -fork-server and -workers need a non empty -worker-secret-file\n";
+		return 1;
+	}
 
-			// -exclude-pattern
-			{
-				for( std::vector<std::string>::iterator iter = o_excludeFilenamePatterns.begin(), end = o_excludeFilenamePatterns.end(); iter != end; ++iter )
-				{
-					filenamePatternExcluder->addExcludedPattern(*iter);
-				}
-			}
+	if(!o_workerAddress.empty())
+	{
+		// -worker, the setup comes from the coordinators and may ask for several dump threads
+		llvm::llvm_start_multithreaded();
+		exitStatus = Havok::runWorker(o_workerAddress, workerSecret, llvm::errs());
+		llvm::llvm_shutdown();
+		return exitStatus;
+	}
+	if(!o_forkServerAddress.empty())
+	{
+		// -fork-server, the prelude comes from the command line and the rest of the setup from the coordinators
+		Havok::ExtractionSetup prelude;
+		prelude.m_triple = o_triple;
+		prelude.m_defines.assign(o_cppDefines.begin(), o_cppDefines.end());
+		prelude.m_includePaths.assign(o_includePath.begin(), o_includePath.end());
+		prelude.m_forceIncludes.assign(o_forceInclude.begin(), o_forceInclude.end());
+		prelude.m_excludeFilenames.assign(o_excludeFilenames.begin(), o_excludeFilenames.end());
+		prelude.m_excludeFilenamePatterns.assign(o_excludeFilenamePatterns.begin(), o_excludeFilenamePatterns.end());
+		prelude.m_resourceDir = o_resourceDir;
+		llvm::llvm_start_multithreaded();
+		exitStatus = Havok::runForkServer(prelude, o_forkServerAddress, workerSecret, llvm::errs());
+		llvm::llvm_shutdown();
+		return exitStatus;
+	}
+	if(o_outputFilename.empty())
+	{
+		llvm::errs() << "error: the output file (-o) is required\n";
+		llvm::llvm_shutdown();
+		return 1;
+	}
+	{
+		Havok::ExtractionSetup setup;
+		setup.m_triple = o_triple;
+		setup.m_defines.assign(o_cppDefines.begin(), o_cppDefines.end());
+		setup.m_includePaths.assign(o_includePath.begin(), o_includePath.end());
+		setup.m_passAttributes.assign(o_passAttributes.begin(), o_passAttributes.end());
+		setup.m_forceIncludes.assign(o_forceInclude.begin(), o_forceInclude.end());
+		setup.m_excludeFilenames.assign(o_excludeFilenames.begin(), o_excludeFilenames.end());
+		setup.m_excludeFilenamePatterns.assign(o_excludeFilenamePatterns.begin(), o_excludeFilenamePatterns.end());
+		setup.m_inputFilenames.assign(o_inputFilenames.begin(), o_inputFilenames.end());
+		setup.m_roots.assign(o_roots.begin(), o_roots.end());
+		setup.m_resourceDir = o_resourceDir;
+		setup.m_dumpLayouts = o_dumpLayouts;
+		setup.m_compactInstantiations = o_compactInstantiations;
+		setup.m_instantiationBudget = o_instantiationBudget;
+		setup.m_canonicalTypes = o_canonicalTypes;
+		setup.m_contentHashes = o_contentHashes;
+		setup.m_dumpThreads = o_dumpThreads;
+		setup.m_variants.assign(o_variants.begin(), o_variants.end());
+		setup.m_workers.assign(o_workers.begin(), o_workers.end());
+		setup.m_workerSecret = workerSecret;
+		if(setup.m_dumpThreads > 1 || !setup.m_variants.empty() || !setup.m_workers.empty())
+		{
+			llvm::llvm_start_multithreaded();
+		}
 
-			// -A
-			for( llvm::cl::list<std::string>::iterator iter = o_passAttributes.begin(), end = o_passAttributes.end(); iter != end; ++iter )
+		// -module-map
+		Havok::ModuleMap moduleMap;
+		exitStatus = 0;
+		for( std::vector<std::string>::iterator iter = o_moduleMaps.begin(), end = o_moduleMaps.end(); iter != end; ++iter )
+		{
+			std::string errorInfo;
+			if(!moduleMap.parseFile(*iter, errorInfo))
 			{
-				std::string::size_type index = iter->find_first_of('=');
-				std::string macro, value;
-				if(index != std::string::npos)
-				{
-					macro = iter->substr(0, index);
-					value = iter->substr(index+1, std::string::npos);
-				}
-				else
-				{
-					macro = (*iter);
-				}
-
-				outstream << "InvocationAttribute( name='" << macro << "', value='" << value << "' )\n";
+				llvm::errs() << "error: " << errorInfo << "\n";
+				exitStatus = 1;
 			}
-
-			for( std::vector<std::string>::iterator iter = o_forceInclude.begin(), end = o_forceInclude.end(); iter != end; ++iter )
+		}
+		if(!o_workers.empty() && (!o_variants.empty() || !o_moduleMaps.empty() || !o_roots.empty()))
+		{
+			// the parts would each dump their own closure of the roots, modules are local
+			llvm::errs() << "error: -workers cannot be used with -variant, -module-map or -root\n";
+			exitStatus = 1;
+		}
+		if(o_compactInstantiations && !o_cppTables.empty())
+		{
+			// the generated tables have no notion of template pattern, instantiations need all their members
+			llvm::errs() << "error: -compact-instantiations cannot be used with -cpp-tables\n";
+			exitStatus = 1;
+		}
+		if(!o_moduleMaps.empty())
+		{
+			bool existed;
+			if(o_moduleCachePath.empty())
 			{
-				stream << "#include<" << iter->c_str() << ">\n";
-				outstream << "InvocationForceInclude( path='" << iter->c_str() << "' )\n";
+				llvm::errs() << "error: -module-map requires a -module-cache directory\n";
+				exitStatus = 1;
 			}
-			for( std::vector<std::string>::iterator iter = o_inputFilenames.begin(), end = o_inputFilenames.end(); iter != end; ++iter )
+			else if(llvm::sys::fs::create_directories(o_moduleCachePath.getValue(), existed))
 			{
-				stream << "#include<" << iter->c_str() << ">\n";
-				outstream << "InvocationInput( path='" << iter->c_str() << "' )\n";
+				llvm::errs() << "error: could not create the module cache '" << o_moduleCachePath << "'\n";
+				exitStatus = 1;
 			}
-			stream.flush();
-
-			llvm::MemoryBuffer* mainBuf = llvm::MemoryBuffer::getMemBufferCopy( llvm::StringRef(mainFileText.c_str(), mainFileText.size()), "masterInputFile" );
-			sourceManager.createMainFileIDForMemBuffer(mainBuf);
+			setup.m_moduleMap = &moduleMap;
+			setup.m_moduleCachePath = o_moduleCachePath;
 		}
-		std::string resourceDir = o_resourceDir;
-		if(!resourceDir.empty())
+		if(exitStatus != 0)
 		{
-			resourceDir += "/include";
-			headerSearchOptions.AddPath(resourceDir, clang::frontend::System, false, false, true);
+			llvm::llvm_shutdown();
+			return exitStatus;
 		}
 
-		clang::InitializePreprocessor( preprocessor, clang::PreprocessorOptions(), headerSearchOptions, frontendOptions);
-
-		Havok::ExtractASTConsumer consumer(outstream);
-		clang::IdentifierTable identifierTable(langOptions);
-		clang::SelectorTable selectorTable;
-		clang::Builtin::Context builtinContext;
-		clang::ASTContext astcontext( langOptions, sourceManager, targetInfo.getPtr(), identifierTable, selectorTable, builtinContext, 0);
-
-		#ifdef _DEBUG
-			outstream.SetUnbuffered();
-		#endif
-		diagnostics.getClient()->BeginSourceFile(langOptions);
-		clang::ParseAST(preprocessor, &consumer, astcontext);
-		diagnostics.getClient()->EndSourceFile();
-		exitStatus = diagnostics.hasErrorOccurred() ? 1 : 0;
-		if(exitStatus == 0)
-		{
-			// AST parsing succeeded, proceed with declaration dumping
-			consumer.dumpAllDeclarations();
-		}
-		else
+		std::set<std::string> dependencies;
+		exitStatus = s_extract(setup, dependencies);
+
+		// -watch
+		if(o_watch)
 		{
-			outstream << "## The diagnostic engine returned an error during code parsing.\n";
+			exitStatus = s_watch(setup, dependencies);
 		}
-
-		outstream.flush();
 	}
-	delete emptyMemoryBuffer;
 	llvm::llvm_shutdown();
 
 	return exitStatus;
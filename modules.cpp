@@ -0,0 +1,481 @@
+// Copyright (c) 2012 Havok. All rights reserved. This file is distributed under the terms
+// and conditions defined in file 'LICENSE.txt', which is part of this source code package.
+
+#include "modules.h"
+
+#pragma warning(push,0)
+	#include <clang/AST/ASTContext.h>
+	#include <clang/Basic/FileManager.h>
+	#include <clang/Lex/Preprocessor.h>
+	#include <clang/Serialization/ASTReader.h>
+	#include <llvm/ADT/OwningPtr.h>
+	#include <llvm/ADT/SmallString.h>
+	#include <llvm/ADT/StringExtras.h>
+	#include <llvm/Support/FileSystem.h>
+	#include <llvm/Support/MemoryBuffer.h>
+	#include <llvm/Support/Path.h>
+	#include <llvm/Support/PathV2.h>
+	#include <llvm/Support/raw_ostream.h>
+#pragma warning(pop)
+
+#include <cctype>
+
+// ------------------------------ Module map ------------------------------- //
+
+namespace
+{
+	// Tokenizer for module map files: identifiers, string literals and punctuation
+	class ModuleMapLexer
+	{
+		public:
+
+			ModuleMapLexer(llvm::StringRef text) : m_text(text), m_pos(0) {}
+
+			// Returns false at the end of the file, string literals are returned without their quotes
+			bool next(llvm::StringRef& token, bool& isString)
+			{
+				skipWhitespaceAndComments();
+				isString = false;
+				if(m_pos >= m_text.size())
+				{
+					return false;
+				}
+				size_t begin = m_pos;
+				char c = m_text[m_pos];
+				if(c == '"')
+				{
+					size_t end = m_text.find('"', m_pos + 1);
+					end = (end == llvm::StringRef::npos) ? m_text.size() : end;
+					token = m_text.substr(m_pos + 1, end - m_pos - 1);
+					m_pos = end + 1;
+					isString = true;
+				}
+				else if(isalnum((unsigned char)c) || c == '_')
+				{
+					while(m_pos < m_text.size() && (isalnum((unsigned char)m_text[m_pos]) || m_text[m_pos] == '_'))
+					{
+						++m_pos;
+					}
+					token = m_text.substr(begin, m_pos - begin);
+				}
+				else
+				{
+					token = m_text.substr(m_pos++, 1);
+				}
+				return true;
+			}
+
+		protected:
+
+			void skipWhitespaceAndComments()
+			{
+				while(m_pos < m_text.size())
+				{
+					if(isspace((unsigned char)m_text[m_pos]))
+					{
+						++m_pos;
+					}
+					else if(m_text.substr(m_pos).startswith("//"))
+					{
+						size_t end = m_text.find('\n', m_pos);
+						m_pos = (end == llvm::StringRef::npos) ? m_text.size() : end;
+					}
+					else
+					{
+						break;
+					}
+				}
+			}
+
+			llvm::StringRef m_text;
+			size_t m_pos;
+	};
+}
+
+bool Havok::ModuleMap::parseFile(const std::string& fileName, std::string& errorOut)
+{
+	llvm::OwningPtr<llvm::MemoryBuffer> buffer;
+	if(llvm::error_code ec = llvm::MemoryBuffer::getFile(fileName, buffer))
+	{
+		errorOut = "could not read module map '" + fileName + "': " + ec.message();
+		return false;
+	}
+
+	// header paths are relative to the module map
+	llvm::SmallString<256> directory(llvm::sys::path::parent_path(fileName));
+	llvm::sys::fs::make_absolute(directory);
+
+	ModuleMapLexer lexer(buffer->getBuffer());
+	llvm::StringRef token;
+	bool isString;
+	while(lexer.next(token, isString))
+	{
+		Module module;
+		if(token != "module" || !lexer.next(token, isString) || isString)
+		{
+			errorOut = "expected 'module <name>' in module map '" + fileName + "'";
+			return false;
+		}
+		module.m_name = token;
+		if(!lexer.next(token, isString) || token != "{")
+		{
+			errorOut = "expected '{' after module '" + module.m_name + "' in '" + fileName + "'";
+			return false;
+		}
+		while(lexer.next(token, isString) && token != "}")
+		{
+			bool excluded = (token == "exclude");
+			if(token == "umbrella" || excluded)
+			{
+				lexer.next(token, isString);
+			}
+			if(token != "header" || !lexer.next(token, isString) || !isString)
+			{
+				errorOut = "expected 'header \"<path>\"' in module '" + module.m_name + "' in '" + fileName + "'";
+				return false;
+			}
+			if(!excluded)
+			{
+				llvm::SmallString<256> path(token);
+				if(!llvm::sys::path::is_absolute(path.str()))
+				{
+					path = directory;
+					llvm::sys::path::append(path, token);
+				}
+				module.m_headers.push_back(path.str());
+			}
+		}
+		if(token != "}")
+		{
+			errorOut = "missing '}' at the end of module '" + module.m_name + "' in '" + fileName + "'";
+			return false;
+		}
+		m_modules.push_back(module);
+	}
+	return true;
+}
+
+void Havok::ModuleMap::addModule(const Module& module)
+{
+	m_modules.push_back(module);
+}
+
+const Havok::ModuleMap::Module* Havok::ModuleMap::findModule(llvm::StringRef name) const
+{
+	for( std::vector<Module>::const_iterator it = m_modules.begin(), end = m_modules.end(); it != end; ++it )
+	{
+		if(it->m_name == name)
+		{
+			return &(*it);
+		}
+	}
+	return NULL;
+}
+
+// ----------------------------- Module loader ------------------------------ //
+
+Havok::ModuleLoader::ModuleLoader(const ModuleMap* moduleMap, const std::string& cachePath, const std::string& configurationKey, ModuleBuilder* builder)
+	: m_moduleMap(moduleMap), m_cachePath(cachePath), m_configurationKey(configurationKey), m_builder(builder),
+	m_preprocessor(0), m_context(0), m_consumer(0), m_sema(0), m_reader(0), m_headersResolved(false)
+{
+}
+
+Havok::ModuleLoader::~ModuleLoader()
+{
+}
+
+void Havok::ModuleLoader::setPreprocessor(Preprocessor& preprocessor)
+{
+	m_preprocessor = &preprocessor;
+}
+
+void Havok::ModuleLoader::setContext(ASTContext& context)
+{
+	m_context = &context;
+}
+
+void Havok::ModuleLoader::setConsumer(ASTConsumer& consumer)
+{
+	m_consumer = &consumer;
+}
+
+void Havok::ModuleLoader::setSema(Sema* sema)
+{
+	m_sema = sema;
+}
+
+const Havok::ModuleMap::Module* Havok::ModuleLoader::findModuleForFile(const FileEntry* file)
+{
+	if(m_moduleMap == NULL)
+	{
+		return NULL;
+	}
+	if(!m_headersResolved)
+	{
+		// the file manager gives the same entry to all the paths of a file
+		FileManager& fileManager = m_preprocessor->getFileManager();
+		const std::vector<ModuleMap::Module>& modules = m_moduleMap->getModules();
+		for( std::vector<ModuleMap::Module>::const_iterator it = modules.begin(), end = modules.end(); it != end; ++it )
+		{
+			for( std::vector<std::string>::const_iterator header = it->m_headers.begin(), headerEnd = it->m_headers.end(); header != headerEnd; ++header )
+			{
+				if(const FileEntry* headerFile = fileManager.getFile(*header))
+				{
+					m_moduleForFile[headerFile] = &(*it);
+				}
+			}
+		}
+		m_headersResolved = true;
+	}
+	llvm::DenseMap<const FileEntry*, const ModuleMap::Module*>::const_iterator it = m_moduleForFile.find(file);
+	return it != m_moduleForFile.end() ? it->second : NULL;
+}
+
+std::string Havok::ModuleLoader::getImportText(const ModuleMap::Module& module)
+{
+	return "__import_module__ " + module.m_name + ";\n";
+}
+
+void Havok::ModuleLoader::getImportedHeaders(std::vector<std::string>& headersOut) const
+{
+	for( llvm::StringMap<ModuleKey>::const_iterator it = m_loadedModules.begin(), end = m_loadedModules.end(); it != end; ++it )
+	{
+		if(const ModuleMap::Module* module = static_cast<const ModuleMap::Module*>(it->second))
+		{
+			headersOut.insert(headersOut.end(), module->m_headers.begin(), module->m_headers.end());
+			llvm::StringMap<std::vector<std::string> >::const_iterator dependencies = m_moduleDependencies.find(it->getKey());
+			if(dependencies != m_moduleDependencies.end())
+			{
+				headersOut.insert(headersOut.end(), dependencies->second.begin(), dependencies->second.end());
+			}
+		}
+	}
+}
+
+std::string Havok::ModuleLoader::getModuleFileName_i(const ModuleMap::Module& module) const
+{
+	// modules built with different configurations can live side by side in the cache
+	llvm::SmallString<256> path(m_cachePath);
+	llvm::sys::path::append(path, module.m_name + "-" + llvm::utohexstr(llvm::HashString(m_configurationKey)) + ".pcm");
+	return path.str();
+}
+
+static bool s_getTimestamp(const std::string& fileName, llvm::sys::TimeValue& timestampOut)
+{
+	llvm::sys::PathWithStatus path(fileName);
+	const llvm::sys::FileStatus* status = path.getFileStatus();
+	if(status == NULL)
+	{
+		return false;
+	}
+	timestampOut = status->getTimestamp();
+	return true;
+}
+
+// Files read to build a module, one per line, written next to the module file
+static std::string s_getDependencyListFileName(const std::string& moduleFileName)
+{
+	return moduleFileName + ".deps";
+}
+
+// Write the list to a temporary file renamed into place, an extraction running concurrently
+// never reads a partial list. If the list cannot be written, the module is built again next time.
+static void s_writeDependencyList(const std::string& fileName, const std::vector<std::string>& dependencies)
+{
+	bool existed;
+	int fd;
+	llvm::SmallString<256> tempFileName;
+	if(llvm::sys::fs::unique_file(fileName + "-%%%%%%%%", fd, tempFileName))
+	{
+		llvm::sys::fs::remove(fileName, existed);
+		return;
+	}
+	bool written;
+	{
+		llvm::raw_fd_ostream dependencyList(fd, true);
+		for( std::vector<std::string>::const_iterator it = dependencies.begin(), end = dependencies.end(); it != end; ++it )
+		{
+			dependencyList << *it << "\n";
+		}
+		dependencyList.close();
+		written = !dependencyList.has_error();
+		dependencyList.clear_error();
+	}
+	if(!written || llvm::sys::fs::rename(tempFileName.str(), fileName))
+	{
+		llvm::sys::fs::remove(tempFileName.str(), existed);
+		llvm::sys::fs::remove(fileName, existed);
+	}
+}
+
+bool Havok::ModuleLoader::isOutOfDate_i(const ModuleMap::Module& module, const std::string& moduleFileName, std::vector<std::string>& dependenciesOut) const
+{
+	llvm::sys::TimeValue moduleTime;
+	llvm::OwningPtr<llvm::MemoryBuffer> dependencyList;
+	if(!s_getTimestamp(moduleFileName, moduleTime) || llvm::MemoryBuffer::getFile(s_getDependencyListFileName(moduleFileName), dependencyList))
+	{
+		return true;
+	}
+	llvm::SmallVector<llvm::StringRef, 256> lines;
+	dependencyList->getBuffer().split(lines, "\n", -1, false);
+	dependenciesOut.assign(module.m_headers.begin(), module.m_headers.end());
+	dependenciesOut.insert(dependenciesOut.end(), lines.begin(), lines.end());
+	for( std::vector<std::string>::const_iterator it = dependenciesOut.begin(), end = dependenciesOut.end(); it != end; ++it )
+	{
+		// timestamps may only have a one second resolution, a file changed in the second the
+		// module was built is considered newer
+		llvm::sys::TimeValue fileTime;
+		if(!s_getTimestamp(*it, fileTime) || moduleTime <= fileTime)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+clang::ModuleKey Havok::ModuleLoader::loadModule(SourceLocation importLoc, IdentifierInfo& moduleName, SourceLocation moduleNameLoc)
+{
+	// both the preprocessor and the parser ask for the module
+	llvm::StringMap<ModuleKey>::const_iterator loaded = m_loadedModules.find(moduleName.getName());
+	if(loaded != m_loadedModules.end())
+	{
+		return loaded->second;
+	}
+	m_loadedModules[moduleName.getName()] = 0;
+
+	DiagnosticsEngine& diagnostics = m_preprocessor->getDiagnostics();
+	const ModuleMap::Module* module = m_moduleMap ? m_moduleMap->findModule(moduleName.getName()) : NULL;
+	if(module == NULL)
+	{
+		diagnostics.Report(moduleNameLoc, diagnostics.getCustomDiagID(DiagnosticsEngine::Error, "module '%0' not found in the module maps")) << moduleName.getName();
+		return 0;
+	}
+
+	std::string moduleFileName = getModuleFileName_i(*module);
+	std::vector<std::string>& dependencies = m_moduleDependencies[moduleName.getName()];
+	if(isOutOfDate_i(*module, moduleFileName, dependencies))
+	{
+		std::set<std::string> builtDependencies;
+		if(m_builder == NULL || !m_builder->buildModule(*module, moduleFileName, builtDependencies))
+		{
+			diagnostics.Report(moduleNameLoc, diagnostics.getCustomDiagID(DiagnosticsEngine::Error, "could not build module '%0'")) << moduleName.getName();
+			return 0;
+		}
+		dependencies.assign(builtDependencies.begin(), builtDependencies.end());
+		s_writeDependencyList(s_getDependencyListFileName(moduleFileName), dependencies);
+	}
+
+	if(m_reader == NULL)
+	{
+		assert(m_context && m_sema && "modules can only be imported while parsing");
+		m_reader = new ASTReader(*m_preprocessor, *m_context);
+		llvm::OwningPtr<ExternalASTSource> source(m_reader);
+		m_context->setExternalSource(source); // the context is now owner of the reader
+		m_reader->InitializeSema(*m_sema);
+	}
+	if(m_reader->ReadAST(moduleFileName, serialization::MK_Module) != ASTReader::Success)
+	{
+		diagnostics.Report(moduleNameLoc, diagnostics.getCustomDiagID(DiagnosticsEngine::Error, "could not load module file '%0'")) << moduleFileName;
+		return 0;
+	}
+
+	ModuleKey key = const_cast<ModuleMap::Module*>(module);
+	m_loadedModules[moduleName.getName()] = key;
+	passDeclsToConsumer_i();
+	return key;
+}
+
+void Havok::ModuleLoader::passDeclsToConsumer_i()
+{
+	if(m_consumer == NULL)
+	{
+		return;
+	}
+	// the reader returns the top-level declarations of all the modules loaded so far
+	llvm::SmallVector<Decl*, 256> decls;
+	m_reader->FindExternalLexicalDecls(m_context->getTranslationUnitDecl(), decls);
+	for( llvm::SmallVector<Decl*, 256>::const_iterator it = decls.begin(), end = decls.end(); it != end; ++it )
+	{
+		if(m_passedDecls.insert(*it))
+		{
+			m_consumer->HandleTopLevelDecl(DeclGroupRef(*it));
+		}
+	}
+}
+
+// ------------------------ Module importing consumer ----------------------- //
+
+Havok::ModuleImportingConsumer::ModuleImportingConsumer(ASTConsumer& consumer, ModuleLoader& loader)
+	: m_consumer(consumer), m_loader(loader)
+{
+	m_loader.setConsumer(m_consumer);
+}
+
+void Havok::ModuleImportingConsumer::Initialize(ASTContext& context)
+{
+	m_loader.setContext(context);
+	m_consumer.Initialize(context);
+}
+
+void Havok::ModuleImportingConsumer::HandleTopLevelDecl(DeclGroupRef declGroup)
+{
+	m_consumer.HandleTopLevelDecl(declGroup);
+}
+
+void Havok::ModuleImportingConsumer::HandleInterestingDecl(DeclGroupRef declGroup)
+{
+	m_consumer.HandleInterestingDecl(declGroup);
+}
+
+void Havok::ModuleImportingConsumer::HandleTranslationUnit(ASTContext& context)
+{
+	m_consumer.HandleTranslationUnit(context);
+}
+
+void Havok::ModuleImportingConsumer::HandleTagDeclDefinition(TagDecl* decl)
+{
+	m_consumer.HandleTagDeclDefinition(decl);
+}
+
+void Havok::ModuleImportingConsumer::CompleteTentativeDefinition(VarDecl* decl)
+{
+	m_consumer.CompleteTentativeDefinition(decl);
+}
+
+void Havok::ModuleImportingConsumer::HandleVTable(CXXRecordDecl* recordDecl, bool definitionRequired)
+{
+	m_consumer.HandleVTable(recordDecl, definitionRequired);
+}
+
+clang::ASTMutationListener* Havok::ModuleImportingConsumer::GetASTMutationListener()
+{
+	return m_consumer.GetASTMutationListener();
+}
+
+clang::ASTDeserializationListener* Havok::ModuleImportingConsumer::GetASTDeserializationListener()
+{
+	return m_consumer.GetASTDeserializationListener();
+}
+
+void Havok::ModuleImportingConsumer::PrintStats()
+{
+	m_consumer.PrintStats();
+}
+
+void Havok::ModuleImportingConsumer::InitializeSema(Sema& sema)
+{
+	if(SemaConsumer* semaConsumer = dyn_cast<SemaConsumer>(&m_consumer))
+	{
+		semaConsumer->InitializeSema(sema);
+	}
+	m_loader.setSema(&sema);
+}
+
+void Havok::ModuleImportingConsumer::ForgetSema()
+{
+	if(SemaConsumer* semaConsumer = dyn_cast<SemaConsumer>(&m_consumer))
+	{
+		semaConsumer->ForgetSema();
+	}
+	m_loader.setSema(NULL);
+}
@@ -0,0 +1,171 @@
+// Copyright (c) 2012 Havok. All rights reserved. This file is distributed under the terms
+// and conditions defined in file 'LICENSE.txt', which is part of this source code package.
+
+#ifndef MODULES_H
+#define MODULES_H
+
+#pragma warning(push,0)
+	#include "clang/Lex/ModuleLoader.h"
+	#include "clang/Sema/SemaConsumer.h"
+	#include "llvm/ADT/DenseMap.h"
+	#include "llvm/ADT/SmallPtrSet.h"
+	#include "llvm/ADT/StringMap.h"
+#pragma warning(pop)
+
+#include <set>
+#include <string>
+#include <vector>
+
+namespace clang
+{
+	class ASTReader;
+	class FileEntry;
+	class Preprocessor;
+}
+
+namespace Havok
+{
+	using namespace clang;
+
+	/// Modules declared in module map files. Only a subset of the clang module map syntax is
+	/// understood:
+	///   module Name {
+	///     header "relative/path.h"
+	///   }
+	/// Header paths are relative to the directory of the module map.
+	class ModuleMap
+	{
+		public:
+
+			struct Module
+			{
+				std::string m_name;
+				// Absolute paths of the headers
+				std::vector<std::string> m_headers;
+			};
+
+			// Parse a module map file, returns false and sets errorOut on failure
+			bool parseFile(const std::string& fileName, std::string& errorOut);
+
+			const Module* findModule(llvm::StringRef name) const;
+
+			// Add a module which is not declared in a module map file, the header paths have to be absolute
+			void addModule(const Module& module);
+
+			const std::vector<Module>& getModules() const { return m_modules; }
+
+		protected:
+
+			std::vector<Module> m_modules;
+	};
+
+	/// Builds the module file of a module, implemented by the driver since the module has to be
+	/// parsed with the same configuration as the translation unit importing it.
+	class ModuleBuilder
+	{
+		public:
+			virtual ~ModuleBuilder() {}
+			// The files read while building the module are added to dependenciesOut
+			virtual bool buildModule(const ModuleMap::Module& module, const std::string& outputFileName, std::set<std::string>& dependenciesOut) = 0;
+	};
+
+	/// Module loader backed by a module cache directory. Headers covered by the module map are
+	/// replaced with a module import (see getImportText()), the module file is built on first use
+	/// and rebuilt when it is not newer than the files read to build it, which are listed next to
+	/// the module file. The top-level declarations of imported modules are handed to the consumer
+	/// as if they had been parsed.
+	class ModuleLoader : public clang::ModuleLoader
+	{
+		public:
+
+			// configurationKey identifies the language options and predefined macros, module files
+			// are only shared between translation units with the same configuration.
+			ModuleLoader(const ModuleMap* moduleMap, const std::string& cachePath, const std::string& configurationKey, ModuleBuilder* builder);
+			virtual ~ModuleLoader();
+
+			// Has to be set before parsing
+			void setPreprocessor(Preprocessor& preprocessor);
+			void setContext(ASTContext& context);
+			void setConsumer(ASTConsumer& consumer);
+			void setSema(Sema* sema);
+
+			// Returns the module covering a file (NULL if none)
+			const ModuleMap::Module* findModuleForFile(const FileEntry* file);
+
+			// Source text importing a module
+			static std::string getImportText(const ModuleMap::Module& module);
+
+			// Headers of the modules imported so far and the files they include
+			void getImportedHeaders(std::vector<std::string>& headersOut) const;
+
+			virtual ModuleKey loadModule(SourceLocation importLoc, IdentifierInfo& moduleName, SourceLocation moduleNameLoc);
+
+		protected:
+
+			// Path of the module file in the cache
+			std::string getModuleFileName_i(const ModuleMap::Module& module) const;
+			// The module file is missing or not newer than its headers and the files they include,
+			// which are returned in dependenciesOut when it is up to date
+			bool isOutOfDate_i(const ModuleMap::Module& module, const std::string& moduleFileName, std::vector<std::string>& dependenciesOut) const;
+			// Hand the newly loaded top-level declarations to the consumer
+			void passDeclsToConsumer_i();
+
+			const ModuleMap* m_moduleMap;
+			std::string m_cachePath;
+			std::string m_configurationKey;
+			ModuleBuilder* m_builder;
+
+			Preprocessor* m_preprocessor;
+			ASTContext* m_context;
+			ASTConsumer* m_consumer;
+			Sema* m_sema;
+			// Owned by the context once created
+			ASTReader* m_reader;
+
+			// Module files loaded so far, by module name
+			llvm::StringMap<ModuleKey> m_loadedModules;
+			// Files read to build the modules loaded so far, by module name
+			llvm::StringMap<std::vector<std::string> > m_moduleDependencies;
+			// Header files of the module map, resolved by the file manager on first use
+			llvm::DenseMap<const FileEntry*, const ModuleMap::Module*> m_moduleForFile;
+			bool m_headersResolved;
+			// Declarations already handed to the consumer
+			llvm::SmallPtrSet<const Decl*, 256> m_passedDecls;
+
+		private:
+			ModuleLoader(const ModuleLoader&);
+			ModuleLoader& operator=(const ModuleLoader&);
+	};
+
+	/// Forwards to another consumer, the Sema instance is also given to the module loader
+	/// so that modules can be imported while parsing.
+	class ModuleImportingConsumer : public SemaConsumer
+	{
+		public:
+
+			ModuleImportingConsumer(ASTConsumer& consumer, ModuleLoader& loader);
+
+			virtual void Initialize(ASTContext& context);
+			virtual void HandleTopLevelDecl(DeclGroupRef declGroup);
+			virtual void HandleInterestingDecl(DeclGroupRef declGroup);
+			virtual void HandleTranslationUnit(ASTContext& context);
+			virtual void HandleTagDeclDefinition(TagDecl* decl);
+			virtual void CompleteTentativeDefinition(VarDecl* decl);
+			virtual void HandleVTable(CXXRecordDecl* recordDecl, bool definitionRequired);
+			virtual ASTMutationListener* GetASTMutationListener();
+			virtual ASTDeserializationListener* GetASTDeserializationListener();
+			virtual void PrintStats();
+			virtual void InitializeSema(Sema& sema);
+			virtual void ForgetSema();
+
+		protected:
+
+			ASTConsumer& m_consumer;
+			ModuleLoader& m_loader;
+
+		private:
+			ModuleImportingConsumer& operator=(const ModuleImportingConsumer&);
+	};
+}
+
+#endif //MODULES_H
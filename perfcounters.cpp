@@ -0,0 +1,118 @@
+// Copyright (c) 2012 Havok. All rights reserved. This file is distributed under the terms
+// and conditions defined in file 'LICENSE.txt', which is part of this source code package.
+
+#include "perfcounters.h"
+#include <cstring>
+
+#ifdef __linux__
+	#include <linux/perf_event.h>
+	#include <sys/syscall.h>
+	#include <unistd.h>
+#endif
+
+static const char* const s_counterNames[Havok::PerfCounters::NUM_COUNTERS] = { "cycles", "instructions", "cacheMisses", "branchMisses" };
+static const char* const s_phaseNames[Havok::PerfCounters::NUM_PHASES] = { "parse", "implicitMembers", "dump" };
+
+Havok::PerfCounters::PerfCounters()
+	: m_phase(PHASE_NONE)
+{
+	memset(m_phaseStart, 0, sizeof(m_phaseStart));
+	memset(m_counts, 0, sizeof(m_counts));
+	for( int i = 0; i < NUM_COUNTERS; ++i )
+	{
+		m_fds[i] = -1;
+	}
+	#ifdef __linux__
+		static const unsigned long long s_configs[NUM_COUNTERS] =
+		{
+			PERF_COUNT_HW_CPU_CYCLES,
+			PERF_COUNT_HW_INSTRUCTIONS,
+			PERF_COUNT_HW_CACHE_MISSES,
+			PERF_COUNT_HW_BRANCH_MISSES
+		};
+		for( int i = 0; i < NUM_COUNTERS; ++i )
+		{
+			// separate counters rather than a group, group reads cannot be combined with inherit
+			struct perf_event_attr attr;
+			memset(&attr, 0, sizeof(attr));
+			attr.size = sizeof(attr);
+			attr.type = PERF_TYPE_HARDWARE;
+			attr.config = s_configs[i];
+			attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+			attr.inherit = 1;
+			// user space only, which is allowed with the default perf_event_paranoid
+			attr.exclude_kernel = 1;
+			attr.exclude_hv = 1;
+			m_fds[i] = int(syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0));
+		}
+	#endif
+}
+
+Havok::PerfCounters::~PerfCounters()
+{
+	#ifdef __linux__
+		for( int i = 0; i < NUM_COUNTERS; ++i )
+		{
+			if(m_fds[i] >= 0)
+			{
+				close(m_fds[i]);
+			}
+		}
+	#endif
+}
+
+void Havok::PerfCounters::read_i(uint64_t valuesOut[NUM_COUNTERS]) const
+{
+	for( int i = 0; i < NUM_COUNTERS; ++i )
+	{
+		valuesOut[i] = 0;
+		#ifdef __linux__
+			// value, time enabled, time running
+			uint64_t data[3];
+			if(m_fds[i] >= 0 && read(m_fds[i], data, sizeof(data)) == sizeof(data) && data[2] != 0)
+			{
+				valuesOut[i] = data[2] < data[1] ? uint64_t(double(data[0]) * double(data[1]) / double(data[2])) : data[0];
+			}
+		#endif
+	}
+}
+
+void Havok::PerfCounters::enterPhase(Phase phase)
+{
+	if(phase == m_phase)
+	{
+		return;
+	}
+	uint64_t values[NUM_COUNTERS];
+	read_i(values);
+	for( int i = 0; i < NUM_COUNTERS; ++i )
+	{
+		if(m_phase != PHASE_NONE && values[i] > m_phaseStart[i])
+		{
+			m_counts[m_phase][i] += values[i] - m_phaseStart[i];
+		}
+		m_phaseStart[i] = values[i];
+	}
+	m_phase = phase;
+}
+
+void Havok::PerfCounters::write(llvm::raw_ostream& os) const
+{
+	for( int phase = 0; phase < NUM_PHASES; ++phase )
+	{
+		os << "PerfCounters( phase='" << s_phaseNames[phase] << "'";
+		for( int i = 0; i < NUM_COUNTERS; ++i )
+		{
+			os << ", " << s_counterNames[i] << "=";
+			if(m_fds[i] >= 0)
+			{
+				os << m_counts[phase][i];
+			}
+			else
+			{
+				os << "None";
+			}
+		}
+		os << " )\n";
+	}
+}
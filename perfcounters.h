@@ -0,0 +1,73 @@
+// Copyright (c) 2012 Havok. All rights reserved. This file is distributed under the terms
+// and conditions defined in file 'LICENSE.txt', which is part of this source code package.
+
+#ifndef PERF_COUNTERS_H
+#define PERF_COUNTERS_H
+
+#pragma warning(push,0)
+	#include "llvm/Support/DataTypes.h"
+	#include "llvm/Support/raw_ostream.h"
+#pragma warning(pop)
+
+namespace Havok
+{
+	/// Hardware performance counters of the phases of an extraction, read with perf_event_open
+	/// (Linux only). The threads started while counting are included once they have exited, so
+	/// the parallel dump is counted. The counters which cannot be opened (other systems, no
+	/// hardware support, restricted by perf_event_paranoid) are reported as unavailable.
+	class PerfCounters
+	{
+		public:
+
+			enum Counter
+			{
+				COUNTER_CYCLES,
+				COUNTER_INSTRUCTIONS,
+				COUNTER_CACHE_MISSES,
+				COUNTER_BRANCH_MISSES,
+				NUM_COUNTERS
+			};
+
+			enum Phase
+			{
+				PHASE_NONE = -1,
+				// Preprocessing and parsing, without the implicit member declarations
+				PHASE_PARSE,
+				PHASE_IMPLICIT_MEMBERS,
+				PHASE_DUMP,
+				NUM_PHASES
+			};
+
+			PerfCounters();
+			~PerfCounters();
+
+			bool isAvailable(Counter counter) const { return m_fds[counter] >= 0; }
+
+			// Attribute the events from now on to a phase, PHASE_NONE stops counting
+			void enterPhase(Phase phase);
+			Phase getPhase() const { return m_phase; }
+
+			// Events counted in a phase, estimated from the time the counter was running if the
+			// kernel had to share the hardware counters
+			uint64_t getCount(Phase phase, Counter counter) const { return m_counts[phase][counter]; }
+
+			// Write a PerfCounters line per phase
+			void write(llvm::raw_ostream& os) const;
+
+		protected:
+
+			// Current value of the counters since they were opened
+			void read_i(uint64_t valuesOut[NUM_COUNTERS]) const;
+
+			int m_fds[NUM_COUNTERS];
+			Phase m_phase;
+			uint64_t m_phaseStart[NUM_COUNTERS];
+			uint64_t m_counts[NUM_PHASES][NUM_COUNTERS];
+
+		private:
+			PerfCounters(const PerfCounters&);
+			PerfCounters& operator=(const PerfCounters&);
+	};
+}
+
+#endif //PERF_COUNTERS_H
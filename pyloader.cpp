@@ -0,0 +1,167 @@
+// Copyright (c) 2012 Havok. All rights reserved. This file is distributed under the terms
+// and conditions defined in file 'LICENSE.txt', which is part of this source code package.
+
+// Python extension module clangextract_loader, built with 'make python'. Instead of
+//	exec(open(fileName).read(), namespace)
+// call
+//	clangextract_loader.load(fileName, namespace)
+// which calls the same functions of the namespace with the same arguments, the DefaultsFor
+// entries included, without going through the Python parser.
+
+#include <Python.h>
+
+#include "loader.h"
+
+namespace
+{
+	class PythonHandler : public Havok::DatabaseHandler
+	{
+		public:
+
+			PythonHandler(PyObject* nameSpace) : m_namespace(nameSpace), m_failed(false) {}
+
+			virtual void onEntry(const Havok::DatabaseEntry& entry);
+
+			bool hasFailed() const { return m_failed; }
+
+		protected:
+
+			PyObject* makeValue_i(const Havok::DatabaseValue& value);
+
+			PyObject* m_namespace;
+			// Set when a Python exception was raised, the following entries are skipped
+			bool m_failed;
+			llvm::SmallVector<int, 16> m_intList;
+
+		private:
+			PythonHandler(const PythonHandler&);
+			PythonHandler& operator=(const PythonHandler&);
+	};
+}
+
+PyObject* PythonHandler::makeValue_i(const Havok::DatabaseValue& value)
+{
+	switch(value.m_kind)
+	{
+		case Havok::DatabaseValue::VALUE_BOOL:
+			return PyBool_FromLong(long(value.m_integer));
+		case Havok::DatabaseValue::VALUE_NONE:
+			Py_RETURN_NONE;
+		case Havok::DatabaseValue::VALUE_INTEGER:
+			// the hashes are 64 bit unsigned
+			return value.m_text.startswith("-") ? PyLong_FromLongLong(value.m_integer) : PyLong_FromUnsignedLongLong(uint64_t(value.m_integer));
+		case Havok::DatabaseValue::VALUE_LIST:
+		{
+			// the only lists written are lists of ids
+			PyObject* list = PyList_New(0);
+			llvm::StringRef rest = value.m_text;
+			while(list != NULL && !rest.trim().empty())
+			{
+				std::pair<llvm::StringRef, llvm::StringRef> split = rest.split(',');
+				long long i;
+				if(split.first.trim().getAsInteger(0, i))
+				{
+					PyErr_Format(PyExc_ValueError, "unexpected list item '%s'", split.first.trim().str().c_str());
+					Py_DECREF(list);
+					return NULL;
+				}
+				PyObject* item = PyLong_FromLongLong(i);
+				if(item == NULL || PyList_Append(list, item) != 0)
+				{
+					Py_XDECREF(item);
+					Py_DECREF(list);
+					return NULL;
+				}
+				Py_DECREF(item);
+				rest = split.second;
+			}
+			return list;
+		}
+		case Havok::DatabaseValue::VALUE_STRING:
+			return PyUnicode_DecodeUTF8(value.m_text.data(), Py_ssize_t(value.m_text.size()), "surrogateescape");
+		case Havok::DatabaseValue::VALUE_TOKEN:
+			break;
+	}
+	PyErr_Format(PyExc_ValueError, "unexpected value '%s'", value.m_text.str().c_str());
+	return NULL;
+}
+
+void PythonHandler::onEntry(const Havok::DatabaseEntry& entry)
+{
+	if(m_failed)
+	{
+		return;
+	}
+	const std::string name = entry.getName().str();
+	PyObject* function = PyMapping_GetItemString(m_namespace, name.c_str());
+	if(function == NULL)
+	{
+		PyErr_Clear();
+		PyErr_Format(PyExc_NameError, "name '%s' is not defined", name.c_str());
+		m_failed = true;
+		return;
+	}
+	PyObject* args = PyTuple_New(0);
+	PyObject* kwargs = PyDict_New();
+	for( unsigned i = 0; i < entry.getNumValues() && kwargs != NULL; ++i )
+	{
+		PyObject* value = makeValue_i(entry.getValue(i));
+		if(value == NULL || PyDict_SetItemString(kwargs, entry.getKey(i).str().c_str(), value) != 0)
+		{
+			Py_CLEAR(kwargs);
+		}
+		Py_XDECREF(value);
+	}
+	PyObject* result = args != NULL && kwargs != NULL ? PyObject_Call(function, args, kwargs) : NULL;
+	m_failed = result == NULL;
+	Py_XDECREF(result);
+	Py_XDECREF(kwargs);
+	Py_XDECREF(args);
+	Py_DECREF(function);
+}
+
+static PyObject* s_load(PyObject* self, PyObject* args)
+{
+	const char* fileName;
+	PyObject* nameSpace;
+	if(!PyArg_ParseTuple(args, "sO:load", &fileName, &nameSpace))
+	{
+		return NULL;
+	}
+	if(!PyMapping_Check(nameSpace))
+	{
+		PyErr_SetString(PyExc_TypeError, "load() expects a mapping of entry names to functions");
+		return NULL;
+	}
+
+	PythonHandler handler(nameSpace);
+	Havok::DatabaseLoader loader;
+	std::string error;
+	const bool loaded = loader.loadFile(fileName, handler, error);
+	if(handler.hasFailed())
+	{
+		return NULL;
+	}
+	if(!loaded)
+	{
+		PyErr_SetString(PyExc_ValueError, error.c_str());
+		return NULL;
+	}
+	Py_RETURN_NONE;
+}
+
+static PyMethodDef s_methods[] =
+{
+	{ "load", s_load, METH_VARARGS, "load(fileName, namespace): call namespace[Entry](**values) for each entry of a clang-extract database" },
+	{ NULL, NULL, 0, NULL }
+};
+
+static struct PyModuleDef s_module =
+{
+	PyModuleDef_HEAD_INIT, "clangextract_loader", "Native loader of the clang-extract databases", -1, s_methods, NULL, NULL, NULL, NULL
+};
+
+PyMODINIT_FUNC PyInit_clangextract_loader()
+{
+	return PyModule_Create(&s_module);
+}
@@ -0,0 +1,160 @@
+// Copyright (c) 2012 Havok. All rights reserved. This file is distributed under the terms
+// and conditions defined in file 'LICENSE.txt', which is part of this source code package.
+
+#ifndef THREADS_H
+#define THREADS_H
+
+#ifdef _WIN32
+	#include <windows.h>
+	#undef GetCurrentDirectory // remove annoying define from windows header
+#else
+	#include <pthread.h>
+#endif
+
+namespace Havok
+{
+	/// Minimal portable thread, the thread function is started by start() and must be joined.
+	class Thread
+	{
+		public:
+
+			typedef void (*Function)(void* userData);
+
+			Thread() : m_function(0), m_userData(0), m_started(false) {}
+			~Thread() { join(); }
+
+			// Returns false if the thread could not be created, the function is then not called
+			bool start(Function function, void* userData)
+			{
+				m_function = function;
+				m_userData = userData;
+				#ifdef _WIN32
+					m_handle = CreateThread(NULL, 0, &s_entry, this, 0, NULL);
+					m_started = (m_handle != NULL);
+				#else
+					m_started = (pthread_create(&m_handle, NULL, &s_entry, this) == 0);
+				#endif
+				return m_started;
+			}
+
+			void join()
+			{
+				if(m_started)
+				{
+					#ifdef _WIN32
+						WaitForSingleObject(m_handle, INFINITE);
+						CloseHandle(m_handle);
+					#else
+						pthread_join(m_handle, NULL);
+					#endif
+					m_started = false;
+				}
+			}
+
+		protected:
+
+			#ifdef _WIN32
+				static DWORD WINAPI s_entry(LPVOID self)
+				{
+					static_cast<Thread*>(self)->m_function(static_cast<Thread*>(self)->m_userData);
+					return 0;
+				}
+				HANDLE m_handle;
+			#else
+				static void* s_entry(void* self)
+				{
+					static_cast<Thread*>(self)->m_function(static_cast<Thread*>(self)->m_userData);
+					return NULL;
+				}
+				pthread_t m_handle;
+			#endif
+
+			Function m_function;
+			void* m_userData;
+			bool m_started;
+
+		private:
+			Thread(const Thread&);
+			Thread& operator=(const Thread&);
+	};
+
+	/// Non recursive mutex
+	class Mutex
+	{
+		public:
+
+			#ifdef _WIN32
+				Mutex() { InitializeCriticalSection(&m_mutex); }
+				~Mutex() { DeleteCriticalSection(&m_mutex); }
+				void lock() { EnterCriticalSection(&m_mutex); }
+				void unlock() { LeaveCriticalSection(&m_mutex); }
+			#else
+				Mutex() { pthread_mutex_init(&m_mutex, NULL); }
+				~Mutex() { pthread_mutex_destroy(&m_mutex); }
+				void lock() { pthread_mutex_lock(&m_mutex); }
+				void unlock() { pthread_mutex_unlock(&m_mutex); }
+			#endif
+
+		protected:
+
+			#ifdef _WIN32
+				CRITICAL_SECTION m_mutex;
+			#else
+				pthread_mutex_t m_mutex;
+			#endif
+
+			friend class Condition;
+
+		private:
+			Mutex(const Mutex&);
+			Mutex& operator=(const Mutex&);
+	};
+
+	/// Scoped lock of a Mutex
+	class ScopedLock
+	{
+		public:
+			ScopedLock(Mutex& mutex) : m_mutex(mutex) { m_mutex.lock(); }
+			~ScopedLock() { m_mutex.unlock(); }
+
+		protected:
+			Mutex& m_mutex;
+
+		private:
+			ScopedLock& operator=(const ScopedLock&);
+	};
+
+	/// Condition variable, always used together with a locked Mutex
+	class Condition
+	{
+		public:
+
+			#ifdef _WIN32
+				Condition() { InitializeConditionVariable(&m_condition); }
+				~Condition() {}
+				void wait(Mutex& mutex) { SleepConditionVariableCS(&m_condition, &mutex.m_mutex, INFINITE); }
+				void signal() { WakeConditionVariable(&m_condition); }
+				void broadcast() { WakeAllConditionVariable(&m_condition); }
+			#else
+				Condition() { pthread_cond_init(&m_condition, NULL); }
+				~Condition() { pthread_cond_destroy(&m_condition); }
+				void wait(Mutex& mutex) { pthread_cond_wait(&m_condition, &mutex.m_mutex); }
+				void signal() { pthread_cond_signal(&m_condition); }
+				void broadcast() { pthread_cond_broadcast(&m_condition); }
+			#endif
+
+		protected:
+
+			#ifdef _WIN32
+				CONDITION_VARIABLE m_condition;
+			#else
+				pthread_cond_t m_condition;
+			#endif
+
+		private:
+			Condition(const Condition&);
+			Condition& operator=(const Condition&);
+	};
+}
+
+#endif //THREADS_H
@@ -0,0 +1,132 @@
+// Copyright (c) 2012 Havok. All rights reserved. This file is distributed under the terms
+// and conditions defined in file 'LICENSE.txt', which is part of this source code package.
+
+#include "watch.h"
+#include <cerrno>
+
+#pragma warning(push,0)
+	#include "llvm/ADT/SmallString.h"
+	#include "llvm/Support/FileSystem.h"
+	#include "llvm/Support/PathV2.h"
+#pragma warning(pop)
+
+#ifdef __linux__
+	#include <poll.h>
+	#include <sys/inotify.h>
+	#include <unistd.h>
+#endif
+
+Havok::FileWatcher::FileWatcher()
+	: m_fd(-1)
+{
+	#ifdef __linux__
+		m_fd = inotify_init();
+	#endif
+}
+
+Havok::FileWatcher::~FileWatcher()
+{
+	#ifdef __linux__
+		if(m_fd >= 0)
+		{
+			close(m_fd);
+		}
+	#endif
+}
+
+void Havok::FileWatcher::setFiles(const std::set<std::string>& files)
+{
+	m_files.clear();
+	#ifdef __linux__
+		std::set<int> watches;
+		for( std::set<std::string>::const_iterator it = files.begin(), end = files.end(); it != end; ++it )
+		{
+			llvm::SmallString<256> path(*it);
+			llvm::sys::fs::make_absolute(path);
+			const std::string directory = llvm::sys::path::parent_path(path.str()).str();
+			// adding a directory which is already watched returns its descriptor
+			const int wd = inotify_add_watch(m_fd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE | IN_DELETE);
+			if(wd >= 0)
+			{
+				watches.insert(wd);
+				m_files.insert(std::make_pair(std::make_pair(wd, llvm::sys::path::filename(path.str()).str()), *it));
+			}
+		}
+		for( std::set<int>::const_iterator it = m_watches.begin(), end = m_watches.end(); it != end; ++it )
+		{
+			if(!watches.count(*it))
+			{
+				inotify_rm_watch(m_fd, *it);
+			}
+		}
+		m_watches.swap(watches);
+	#endif
+}
+
+bool Havok::FileWatcher::waitForChanges(int debounceMilliseconds, std::set<std::string>& changedFilesOut)
+{
+	#ifdef __linux__
+		changedFilesOut.clear();
+		while(true)
+		{
+			// no timeout until the first change
+			struct pollfd pollFd;
+			pollFd.fd = m_fd;
+			pollFd.events = POLLIN;
+			const int ready = poll(&pollFd, 1, changedFilesOut.empty() ? -1 : debounceMilliseconds);
+			if(ready < 0 && errno != EINTR)
+			{
+				return false;
+			}
+			if(ready == 0)
+			{
+				// quiet for debounceMilliseconds
+				return true;
+			}
+			if(ready > 0 && !readEvents_i(changedFilesOut))
+			{
+				return false;
+			}
+		}
+	#else
+		return false;
+	#endif
+}
+
+bool Havok::FileWatcher::readEvents_i(std::set<std::string>& changedFilesOut)
+{
+	#ifdef __linux__
+		char buffer[64 * 1024] __attribute__((aligned(__alignof__(struct inotify_event))));
+		const ssize_t size = read(m_fd, buffer, sizeof(buffer));
+		if(size < 0)
+		{
+			return errno == EINTR || errno == EAGAIN;
+		}
+		for( const char* ptr = buffer; ptr < buffer + size; )
+		{
+			const struct inotify_event* event = reinterpret_cast<const struct inotify_event*>(ptr);
+			ptr += sizeof(struct inotify_event) + event->len;
+			if(event->mask & IN_Q_OVERFLOW)
+			{
+				// events were lost, anything may have changed
+				for( WatchedFileMap::const_iterator it = m_files.begin(), end = m_files.end(); it != end; ++it )
+				{
+					changedFilesOut.insert(it->second);
+				}
+				continue;
+			}
+			if(event->len == 0)
+			{
+				continue;
+			}
+			std::pair<WatchedFileMap::const_iterator, WatchedFileMap::const_iterator> range = m_files.equal_range(std::make_pair(event->wd, std::string(event->name)));
+			for( WatchedFileMap::const_iterator it = range.first; it != range.second; ++it )
+			{
+				changedFilesOut.insert(it->second);
+			}
+		}
+		return true;
+	#else
+		return false;
+	#endif
+}
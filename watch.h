@@ -0,0 +1,53 @@
+// Copyright (c) 2012 Havok. All rights reserved. This file is distributed under the terms
+// and conditions defined in file 'LICENSE.txt', which is part of this source code package.
+
+#ifndef WATCH_H
+#define WATCH_H
+
+#include <map>
+#include <set>
+#include <string>
+#include <utility>
+
+namespace Havok
+{
+	/// Waits for changes to a set of files, with inotify (Linux only). The directories of the
+	/// files are watched rather than the files themselves so that the editors saving a file by
+	/// renaming a new one over it are noticed.
+	class FileWatcher
+	{
+		public:
+
+			FileWatcher();
+			~FileWatcher();
+
+			// False if files cannot be watched on this system
+			bool isSupported() const { return m_fd >= 0; }
+
+			// Replace the set of watched files
+			void setFiles(const std::set<std::string>& files);
+
+			// Block until a watched file changes, then until no watched file changed for
+			// debounceMilliseconds so that a burst of edits is seen as a single change.
+			// Returns false on error.
+			bool waitForChanges(int debounceMilliseconds, std::set<std::string>& changedFilesOut);
+
+		protected:
+
+			// Read the pending events, returns false on error
+			bool readEvents_i(std::set<std::string>& changedFilesOut);
+
+			int m_fd;
+			// Watched files by watch descriptor of their directory and file name, a directory
+			// can be reached through several paths
+			typedef std::multimap<std::pair<int, std::string>, std::string> WatchedFileMap;
+			WatchedFileMap m_files;
+			std::set<int> m_watches;
+
+		private:
+			FileWatcher(const FileWatcher&);
+			FileWatcher& operator=(const FileWatcher&);
+	};
+}
+
+#endif //WATCH_H
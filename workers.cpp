@@ -0,0 +1,330 @@
+// Copyright (c) 2012 Havok. All rights reserved. This file is distributed under the terms
+// and conditions defined in file 'LICENSE.txt', which is part of this source code package.
+
+#include "workers.h"
+#include <cerrno>
+#include <cstring>
+
+#ifndef _WIN32
+	#include <netdb.h>
+	#include <sys/socket.h>
+	#include <sys/time.h>
+	#include <sys/un.h>
+	#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+
+bool Havok::Connection::connect(const std::string& address, std::string& errorOut)
+{
+	errorOut = "workers are not supported on this system";
+	return false;
+}
+
+void Havok::Connection::close()
+{
+}
+
+bool Havok::Connection::sendMessage(llvm::StringRef message)
+{
+	return false;
+}
+
+bool Havok::Connection::receiveMessage(std::string& messageOut, size_t maxSize)
+{
+	return false;
+}
+
+bool Havok::Connection::setReceiveTimeout(unsigned int seconds)
+{
+	return false;
+}
+
+Havok::Listener::~Listener()
+{
+}
+
+bool Havok::Listener::listen(const std::string& address, std::string& errorOut)
+{
+	errorOut = "workers are not supported on this system";
+	return false;
+}
+
+bool Havok::Listener::accept(Connection& connectionOut)
+{
+	return false;
+}
+
+void Havok::Listener::release()
+{
+}
+
+#else
+
+#ifdef MSG_NOSIGNAL
+	// a worker which went away is an error, not a SIGPIPE
+	static const int s_sendFlags = MSG_NOSIGNAL;
+#else
+	static const int s_sendFlags = 0;
+#endif
+
+namespace
+{
+	// Socket address of "unix:path" or "host:port"
+	struct SocketAddress
+	{
+		int m_family;
+		std::string m_host;
+		std::string m_port;
+		std::string m_path;
+
+		bool parse(const std::string& address, std::string& errorOut)
+		{
+			if(address.compare(0, 5, "unix:") == 0)
+			{
+				m_family = AF_UNIX;
+				m_path = address.substr(5);
+				return !m_path.empty();
+			}
+			std::string::size_type colon = address.find_last_of(':');
+			if(colon == std::string::npos || colon + 1 == address.size())
+			{
+				errorOut = "expected host:port or unix:path instead of '" + address + "'";
+				return false;
+			}
+			m_family = AF_INET;
+			m_host = address.substr(0, colon);
+			m_port = address.substr(colon + 1);
+			return true;
+		}
+	};
+}
+
+// Create a socket and connect or bind it to an address
+static int s_openSocket(const std::string& address, bool bind, std::string& errorOut)
+{
+	SocketAddress socketAddress;
+	if(!socketAddress.parse(address, errorOut))
+	{
+		return -1;
+	}
+	if(socketAddress.m_family == AF_UNIX)
+	{
+		struct sockaddr_un unixAddress;
+		memset(&unixAddress, 0, sizeof(unixAddress));
+		unixAddress.sun_family = AF_UNIX;
+		if(socketAddress.m_path.size() >= sizeof(unixAddress.sun_path))
+		{
+			errorOut = "socket path too long '" + socketAddress.m_path + "'";
+			return -1;
+		}
+		strcpy(unixAddress.sun_path, socketAddress.m_path.c_str());
+		int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+		if(fd >= 0)
+		{
+			const struct sockaddr* sa = reinterpret_cast<const struct sockaddr*>(&unixAddress);
+			if((bind ? ::bind(fd, sa, sizeof(unixAddress)) : ::connect(fd, sa, sizeof(unixAddress))) == 0)
+			{
+				return fd;
+			}
+			::close(fd);
+		}
+		errorOut = "'" + address + "': " + strerror(errno);
+		return -1;
+	}
+
+	// without a host the address is the loopback interface, the wildcard address of all the
+	// interfaces has to be asked for with *
+	const bool allInterfaces = (socketAddress.m_host == "*");
+	if(allInterfaces && !bind)
+	{
+		errorOut = "cannot connect to '" + address + "', a host is needed";
+		return -1;
+	}
+	struct addrinfo hints;
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
+	hints.ai_flags = allInterfaces ? AI_PASSIVE : 0;
+	struct addrinfo* addresses = NULL;
+	const bool noHost = socketAddress.m_host.empty() || allInterfaces;
+	int error = getaddrinfo(noHost ? NULL : socketAddress.m_host.c_str(), socketAddress.m_port.c_str(), &hints, &addresses);
+	if(error != 0)
+	{
+		errorOut = "'" + address + "': " + gai_strerror(error);
+		return -1;
+	}
+	int fd = -1;
+	errorOut = "'" + address + "': no usable address";
+	for( struct addrinfo* it = addresses; it != NULL && fd < 0; it = it->ai_next )
+	{
+		fd = socket(it->ai_family, it->ai_socktype, it->ai_protocol);
+		if(fd < 0)
+		{
+			continue;
+		}
+		int reuse = 1;
+		if(bind)
+		{
+			setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+		}
+		if((bind ? ::bind(fd, it->ai_addr, it->ai_addrlen) : ::connect(fd, it->ai_addr, it->ai_addrlen)) != 0)
+		{
+			errorOut = "'" + address + "': " + strerror(errno);
+			::close(fd);
+			fd = -1;
+		}
+	}
+	freeaddrinfo(addresses);
+	return fd;
+}
+
+bool Havok::Connection::connect(const std::string& address, std::string& errorOut)
+{
+	close();
+	m_fd = s_openSocket(address, false, errorOut);
+	return m_fd >= 0;
+}
+
+void Havok::Connection::close()
+{
+	if(m_fd >= 0)
+	{
+		::close(m_fd);
+		m_fd = -1;
+	}
+}
+
+static bool s_sendAll(int fd, const char* data, size_t size)
+{
+	while(size != 0)
+	{
+		ssize_t sent = send(fd, data, size, s_sendFlags);
+		if(sent < 0 && errno == EINTR)
+		{
+			continue;
+		}
+		if(sent <= 0)
+		{
+			return false;
+		}
+		data += sent;
+		size -= sent;
+	}
+	return true;
+}
+
+static bool s_receiveAll(int fd, char* data, size_t size)
+{
+	while(size != 0)
+	{
+		ssize_t received = recv(fd, data, size, 0);
+		if(received < 0 && errno == EINTR)
+		{
+			continue;
+		}
+		if(received <= 0)
+		{
+			return false;
+		}
+		data += received;
+		size -= received;
+	}
+	return true;
+}
+
+bool Havok::Connection::sendMessage(llvm::StringRef message)
+{
+	// 64-bit big endian size
+	unsigned char header[8];
+	const unsigned long long size = message.size();
+	for( int i = 0; i < 8; ++i )
+	{
+		header[i] = static_cast<unsigned char>(size >> (56 - 8 * i));
+	}
+	return m_fd >= 0 && s_sendAll(m_fd, reinterpret_cast<const char*>(header), sizeof(header)) && s_sendAll(m_fd, message.data(), message.size());
+}
+
+bool Havok::Connection::receiveMessage(std::string& messageOut, size_t maxSize)
+{
+	unsigned char header[8];
+	if(m_fd < 0 || !s_receiveAll(m_fd, reinterpret_cast<char*>(header), sizeof(header)))
+	{
+		return false;
+	}
+	unsigned long long size = 0;
+	for( int i = 0; i < 8; ++i )
+	{
+		size = (size << 8) | header[i];
+	}
+	if(size > maxSize)
+	{
+		// not one of our peers, or a corrupted stream
+		close();
+		return false;
+	}
+	messageOut.resize(size_t(size));
+	return size == 0 || s_receiveAll(m_fd, &messageOut[0], messageOut.size());
+}
+
+bool Havok::Connection::setReceiveTimeout(unsigned int seconds)
+{
+	// recv then fails with EAGAIN, which s_receiveAll does not retry
+	struct timeval timeout;
+	timeout.tv_sec = seconds;
+	timeout.tv_usec = 0;
+	return m_fd >= 0 && setsockopt(m_fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout)) == 0;
+}
+
+Havok::Listener::~Listener()
+{
+	if(m_fd >= 0)
+	{
+		::close(m_fd);
+	}
+	if(!m_unixPath.empty())
+	{
+		unlink(m_unixPath.c_str());
+	}
+}
+
+bool Havok::Listener::listen(const std::string& address, std::string& errorOut)
+{
+	if(address.compare(0, 5, "unix:") == 0)
+	{
+		// a socket file left by a previous worker would make bind fail
+		m_unixPath = address.substr(5);
+		unlink(m_unixPath.c_str());
+	}
+	m_fd = s_openSocket(address, true, errorOut);
+	if(m_fd >= 0 && ::listen(m_fd, 16) != 0)
+	{
+		errorOut = "'" + address + "': " + strerror(errno);
+		::close(m_fd);
+		m_fd = -1;
+	}
+	return m_fd >= 0;
+}
+
+bool Havok::Listener::accept(Connection& connectionOut)
+{
+	connectionOut.close();
+	do
+	{
+		connectionOut.m_fd = ::accept(m_fd, NULL, NULL);
+	}
+	while(connectionOut.m_fd < 0 && errno == EINTR);
+	return connectionOut.m_fd >= 0;
+}
+
+void Havok::Listener::release()
+{
+	if(m_fd >= 0)
+	{
+		::close(m_fd);
+		m_fd = -1;
+	}
+	m_unixPath.clear();
+}
+
+#endif
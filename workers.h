@@ -0,0 +1,80 @@
+// Copyright (c) 2012 Havok. All rights reserved. This file is distributed under the terms
+// and conditions defined in file 'LICENSE.txt', which is part of this source code package.
+
+#ifndef WORKERS_H
+#define WORKERS_H
+
+#pragma warning(push,0)
+	#include "llvm/ADT/StringRef.h"
+#pragma warning(pop)
+
+#include <string>
+
+namespace Havok
+{
+	/// Stream connection between a coordinator and a worker. Addresses are either host:port for
+	/// TCP or unix:path for a Unix domain socket (POSIX only). An empty host is the loopback
+	/// interface, * listens on all the interfaces. Messages are byte strings preceded by their size.
+	class Connection
+	{
+		public:
+
+			enum
+			{
+				// Larger messages are rejected, the size comes from the other end
+				MAX_MESSAGE_SIZE = 1024 * 1024 * 1024
+			};
+
+			Connection() : m_fd(-1) {}
+			~Connection() { close(); }
+
+			// Returns false and sets errorOut on failure
+			bool connect(const std::string& address, std::string& errorOut);
+			void close();
+
+			bool sendMessage(llvm::StringRef message);
+			// Returns false on error, when the other end closed the connection or when the message
+			// is larger than maxSize
+			bool receiveMessage(std::string& messageOut, size_t maxSize = MAX_MESSAGE_SIZE);
+			// receiveMessage() fails when the other end sends nothing for this long, 0 waits forever
+			bool setReceiveTimeout(unsigned int seconds);
+
+		protected:
+
+			friend class Listener;
+
+			int m_fd;
+
+		private:
+			Connection(const Connection&);
+			Connection& operator=(const Connection&);
+	};
+
+	/// Accepts the connections of a coordinator, see Connection for the addresses
+	class Listener
+	{
+		public:
+
+			Listener() : m_fd(-1) {}
+			~Listener();
+
+			// Returns false and sets errorOut on failure
+			bool listen(const std::string& address, std::string& errorOut);
+			// Block until a coordinator connects
+			bool accept(Connection& connectionOut);
+			// Close the socket in a forked child, the socket file stays with the parent
+			void release();
+
+		protected:
+
+			int m_fd;
+			// Socket file removed with the listener
+			std::string m_unixPath;
+
+		private:
+			Listener(const Listener&);
+			Listener& operator=(const Listener&);
+	};
+}
+
+#endif //WORKERS_H